@@ -205,6 +205,14 @@ static void CG_SC_Scoreboard( void )
 	SCR_UpdateScoreboardMessage( trap_Cmd_Argv( 1 ) );
 }
 
+/*
+* CG_SC_ScoreboardDelta
+*/
+static void CG_SC_ScoreboardDelta( void )
+{
+	SCR_UpdateScoreboardDelta( strtoul( trap_Cmd_Argv( 1 ), NULL, 10 ), trap_Cmd_Argv( 2 ) );
+}
+
 /*
 * CG_SC_PrintPlayerStats
 */
@@ -924,6 +932,7 @@ static const svcmd_t cg_svcmds[] =
 	{ "cp", CG_SC_CenterPrint },
 	{ "obry", CG_SC_Obituary },
 	{ "scb", CG_SC_Scoreboard },
+	{ "scbd", CG_SC_ScoreboardDelta },
 	{ "plstats", CG_SC_PlayerStats },
 	{ "mm", CG_SC_MatchMessage },
 	{ "ti", CG_CS_UpdateTeamInfo },
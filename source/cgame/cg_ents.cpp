@@ -466,7 +466,7 @@ void CG_NewFrameSnap( snapshot_t *frame, snapshot_t *lerpframe )
 	CG_UpdateEntities();
 	CG_CheckPredictionError();
 
-	cg.predictFrom = 0; // force the prediction to be restarted from the new snapshot
+	CG_ValidatePredictedStates(); // restart the prediction from the new snapshot unless it confirms it
 	cg.fireEvents = true;
 
 	for( i = 0; i < cg.frame.numgamecommands; i++ )
@@ -1449,8 +1449,8 @@ static opFunc_t CG_OperatorFuncForArgument( const char *token )
 
 //=============================================================================
 
-static const char *CG_GetStringArg( struct cg_layoutnode_s **argumentsnode );
-static float CG_GetNumericArg( struct cg_layoutnode_s **argumentsnode );
+static const char *CG_GetStringArg( struct cg_layoutarg_s **argumentsnode );
+static float CG_GetNumericArg( struct cg_layoutarg_s **argumentsnode );
 
 //=============================================================================
 
@@ -1479,7 +1479,7 @@ enum
 //=============================================================================
 // Commands' Functions
 //=============================================================================
-static bool CG_LFuncDrawTimer( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawTimer( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	char time[64];
 	int min, sec, milli;
@@ -1501,7 +1501,7 @@ static bool CG_LFuncDrawTimer( struct cg_layoutnode_s *commandnode, struct cg_la
 	return true;
 }
 
-static bool CG_LFuncDrawPicVar( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPicVar( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int min, max, val, firstimg, lastimg, imgcount;
 	static char filefmt[MAX_QPATH], filenm[MAX_QPATH], *ptr;
@@ -1584,7 +1584,7 @@ static bool CG_LFuncDrawPicVar( struct cg_layoutnode_s *commandnode, struct cg_l
 	return true;
 }
 
-static bool CG_LFuncDrawPicByIndex( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPicByIndex( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int value = (int)CG_GetNumericArg( &argumentnode );
 	int x, y;
@@ -1603,7 +1603,7 @@ static bool CG_LFuncDrawPicByIndex( struct cg_layoutnode_s *commandnode, struct
 	return false;
 }
 
-static bool CG_LFuncDrawPicByItemIndex( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPicByItemIndex( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int itemindex = (int)CG_GetNumericArg( &argumentnode );
 	int x, y;
@@ -1618,7 +1618,7 @@ static bool CG_LFuncDrawPicByItemIndex( struct cg_layoutnode_s *commandnode, str
 	return true;
 }
 
-static bool CG_LFuncDrawPicByName( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPicByName( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int x, y;
 
@@ -1628,7 +1628,7 @@ static bool CG_LFuncDrawPicByName( struct cg_layoutnode_s *commandnode, struct c
 	return true;
 }
 
-static bool CG_LFuncDrawModelByIndex( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawModelByIndex( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	struct model_s *model;
 	int value = (int)CG_GetNumericArg( &argumentnode );
@@ -1643,7 +1643,7 @@ static bool CG_LFuncDrawModelByIndex( struct cg_layoutnode_s *commandnode, struc
 	return false;
 }
 
-static bool CG_LFuncDrawModelByName( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawModelByName( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	struct model_s *model;
 	struct shader_s *shader;
@@ -1656,7 +1656,7 @@ static bool CG_LFuncDrawModelByName( struct cg_layoutnode_s *commandnode, struct
 	return true;
 }
 
-static bool CG_LFuncDrawModelByItemIndex( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawModelByItemIndex( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int i;
 	gsitem_t	*item;
@@ -1677,7 +1677,7 @@ static bool CG_LFuncDrawModelByItemIndex( struct cg_layoutnode_s *commandnode, s
 	return true;
 }
 
-static bool CG_LFuncScale( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncScale( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	layout_cursor_scale = (int)CG_GetNumericArg( &argumentnode );
 	return true;
@@ -1686,7 +1686,7 @@ static bool CG_LFuncScale( struct cg_layoutnode_s *commandnode, struct cg_layout
 #define SCALE_X( n ) ( (layout_cursor_scale == NOSCALE) ? (n) : ((layout_cursor_scale == SCALEBYHEIGHT) ? (n)*cgs.vidHeight/600.0f : (n)*cgs.vidWidth/800.0f) )
 #define SCALE_Y( n ) ( (layout_cursor_scale == NOSCALE) ? (n) : ((layout_cursor_scale == SCALEBYWIDTH) ? (n)*cgs.vidWidth/800.0f : (n)*cgs.vidHeight/600.0f) )
 
-static bool CG_LFuncCursor( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncCursor( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	float x, y;
 
@@ -1700,7 +1700,7 @@ static bool CG_LFuncCursor( struct cg_layoutnode_s *commandnode, struct cg_layou
 	return true;
 }
 
-static bool CG_LFuncMoveCursor( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncMoveCursor( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	float x, y;
 
@@ -1714,7 +1714,7 @@ static bool CG_LFuncMoveCursor( struct cg_layoutnode_s *commandnode, struct cg_l
 	return true;
 }
 
-static bool CG_LFuncSize( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncSize( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	float x, y;
 
@@ -1728,7 +1728,7 @@ static bool CG_LFuncSize( struct cg_layoutnode_s *commandnode, struct cg_layoutn
 	return true;
 }
 
-static bool CG_LFuncColor( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncColor( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int i;
 	for( i = 0; i < 4; i++ )
@@ -1739,19 +1739,19 @@ static bool CG_LFuncColor( struct cg_layoutnode_s *commandnode, struct cg_layout
 	return true;
 }
 
-static bool CG_LFuncColorToTeamColor( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncColorToTeamColor( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_TeamColor( CG_GetNumericArg( &argumentnode ), layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncColorAlpha( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncColorAlpha( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	layout_cursor_color[3] = CG_GetNumericArg( &argumentnode );
 	return true;
 }
 
-static bool CG_LFuncRotationSpeed( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncRotationSpeed( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int i;
 	for( i = 0; i < 3; i++ )
@@ -1762,7 +1762,7 @@ static bool CG_LFuncRotationSpeed( struct cg_layoutnode_s *commandnode, struct c
 	return true;
 }
 
-static bool CG_LFuncAlign( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncAlign( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int v, h;
 
@@ -1774,7 +1774,7 @@ static bool CG_LFuncAlign( struct cg_layoutnode_s *commandnode, struct cg_layout
 	return true;
 }
 
-static bool CG_LFuncFontFamilyExt( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, 
+static bool CG_LFuncFontFamilyExt( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, 
 	int numArguments, struct qfontface_s *(*register_font)( const char *, int , unsigned int ) )
 {
 	struct qfontface_s *font;
@@ -1789,7 +1789,7 @@ static bool CG_LFuncFontFamilyExt( struct cg_layoutnode_s *commandnode, struct c
 	return false;
 }
 
-static bool CG_LFuncFontFamily( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncFontFamily( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *fontname = CG_GetStringArg( &argumentnode );
 
@@ -1805,14 +1805,14 @@ static bool CG_LFuncFontFamily( struct cg_layoutnode_s *commandnode, struct cg_l
 	return CG_LFuncFontFamilyExt( commandnode, argumentnode, numArguments, trap_SCR_RegisterFont );
 }
 
-static bool CG_LFuncSpecialFontFamily( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncSpecialFontFamily( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *fontname = CG_GetStringArg( &argumentnode );
 	Q_strncpyz( layout_cursor_font_name, fontname, sizeof( layout_cursor_font_name ) );
 	return CG_LFuncFontFamilyExt( commandnode, argumentnode, numArguments, trap_SCR_RegisterSpecialFont );
 }
 
-static bool CG_LFuncFontSize( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncFontSize( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	struct qfontface_s *font;
 	const char *fontsize = CG_GetStringArg( &argumentnode );
@@ -1844,7 +1844,7 @@ static bool CG_LFuncFontSize( struct cg_layoutnode_s *commandnode, struct cg_lay
 	return false;
 }
 
-static bool CG_LFuncFontStyle( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncFontStyle( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	struct qfontface_s *font;
 	const char *fontstyle = CG_GetStringArg( &argumentnode );
@@ -1880,7 +1880,7 @@ static bool CG_LFuncFontStyle( struct cg_layoutnode_s *commandnode, struct cg_la
 	return false;
 }
 
-static bool CG_LFuncDrawObituaries( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawObituaries( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int internal_align = (int)CG_GetNumericArg( &argumentnode );
 	int icon_size = (int)CG_GetNumericArg( &argumentnode );
@@ -1890,19 +1890,19 @@ static bool CG_LFuncDrawObituaries( struct cg_layoutnode_s *commandnode, struct
 	return true;
 }
 
-static bool CG_LFuncDrawAwards( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawAwards( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawAwards( layout_cursor_x, layout_cursor_y, layout_cursor_align, layout_cursor_font, layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncDrawClock( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawClock( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawClock( layout_cursor_x, layout_cursor_y, layout_cursor_align, layout_cursor_font, layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncDrawHelpMessage( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawHelpMessage( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	// hide this one when scoreboard is up
 	if( !( cg.predictedPlayerState.stats[STAT_LAYOUTS] & STAT_LAYOUT_SCOREBOARD ) )
@@ -1965,19 +1965,19 @@ static bool CG_LFuncDrawHelpMessage( struct cg_layoutnode_s *commandnode, struct
 	return true;
 }
 
-static bool CG_LFuncDrawTeamMates( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawTeamMates( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawTeamMates();
 	return true;
 }
 
-static bool CG_LFuncDrawPointed( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPointed( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawPlayerNames( layout_cursor_font, layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncDrawString( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawString( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *string = CG_GetStringArg( &argumentnode );
 	
@@ -2017,14 +2017,14 @@ static bool CG_LFuncDrawStringRepeat_x( const char *string, int num_draws )
 	return true;
 }
 
-static bool CG_LFuncDrawStringRepeat( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawStringRepeat( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *string = CG_GetStringArg( &argumentnode );
 	int num_draws = CG_GetNumericArg( &argumentnode );
 	return CG_LFuncDrawStringRepeat_x( string, num_draws );
 }
 
-static bool CG_LFuncDrawStringRepeatConfigString( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawStringRepeatConfigString( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *string = CG_GetStringArg( &argumentnode );
 	int index = (int)CG_GetNumericArg( &argumentnode );
@@ -2039,7 +2039,7 @@ static bool CG_LFuncDrawStringRepeatConfigString( struct cg_layoutnode_s *comman
 	return CG_LFuncDrawStringRepeat_x( string, num_draws );
 }
 
-static bool CG_LFuncDrawItemNameFromIndex( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawItemNameFromIndex( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	gsitem_t	*item;
 	int itemindex = CG_GetNumericArg( &argumentnode );
@@ -2052,7 +2052,7 @@ static bool CG_LFuncDrawItemNameFromIndex( struct cg_layoutnode_s *commandnode,
 	return true;
 }
 
-static bool CG_LFuncDrawConfigstring( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawConfigstring( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int index = (int)CG_GetNumericArg( &argumentnode );
 
@@ -2065,7 +2065,7 @@ static bool CG_LFuncDrawConfigstring( struct cg_layoutnode_s *commandnode, struc
 	return true;
 }
 
-static bool CG_LFuncDrawPlayername( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPlayername( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int index = (int)CG_GetNumericArg( &argumentnode ) - 1;
 
@@ -2080,14 +2080,14 @@ static bool CG_LFuncDrawPlayername( struct cg_layoutnode_s *commandnode, struct
 	return false;
 }
 
-static bool CG_LFuncDrawNumeric( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawNumeric( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int value = (int)CG_GetNumericArg( &argumentnode );
 	CG_DrawHUDNumeric( layout_cursor_x, layout_cursor_y, layout_cursor_align, layout_cursor_color, layout_cursor_width, layout_cursor_height, value );
 	return true;
 }
 
-static bool CG_LFuncDrawStretchNum( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawStretchNum( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	static char num[16];
 	int len;
@@ -2106,7 +2106,7 @@ static bool CG_LFuncDrawStretchNum( struct cg_layoutnode_s *commandnode, struct
 	return true;
 }
 
-static bool CG_LFuncDrawNumeric2( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawNumeric2( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int value = (int)CG_GetNumericArg( &argumentnode );
 
@@ -2114,7 +2114,7 @@ static bool CG_LFuncDrawNumeric2( struct cg_layoutnode_s *commandnode, struct cg
 	return true;
 }
 
-static bool CG_LFuncDrawBar( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawBar( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int value = (int)CG_GetNumericArg( &argumentnode );
 	int maxvalue = (int)CG_GetNumericArg( &argumentnode );
@@ -2124,7 +2124,7 @@ static bool CG_LFuncDrawBar( struct cg_layoutnode_s *commandnode, struct cg_layo
 	return true;
 }
 
-static bool CG_LFuncDrawPicBar( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawPicBar( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int value = (int)CG_GetNumericArg( &argumentnode );
 	int maxvalue = (int)CG_GetNumericArg( &argumentnode );
@@ -2135,7 +2135,7 @@ static bool CG_LFuncDrawPicBar( struct cg_layoutnode_s *commandnode, struct cg_l
 	return true;
 }
 
-static bool CG_LFuncCustomWeaponIcons( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncCustomWeaponIcons( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int weapon = (int)CG_GetNumericArg( &argumentnode );
 	int hasgun = (int)CG_GetNumericArg( &argumentnode );
@@ -2151,13 +2151,13 @@ static bool CG_LFuncCustomWeaponIcons( struct cg_layoutnode_s *commandnode, stru
 	return true;
 }
 
-static bool CG_LFuncCustomWeaponSelect( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncCustomWeaponSelect( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	customWeaponSelectPic = CG_GetStringArg( &argumentnode );
 	return true;
 }
 
-static bool CG_LFuncDrawWeaponIcons( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawWeaponIcons( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int offx, offy, w, h;
 
@@ -2171,13 +2171,13 @@ static bool CG_LFuncDrawWeaponIcons( struct cg_layoutnode_s *commandnode, struct
 	return true;
 }
 
-static bool CG_LFuncDrawCaptureAreas( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawCaptureAreas( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	// FIXME: DELETE ME
 	return true;
 }
 
-static bool CG_LFuncDrawMiniMap( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawMiniMap( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	bool draw_playernames, draw_itemnames;
 
@@ -2189,7 +2189,7 @@ static bool CG_LFuncDrawMiniMap( struct cg_layoutnode_s *commandnode, struct cg_
 	return true;
 }
 
-static bool CG_LFuncDrawLocationName( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawLocationName( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int loc_tag = CG_GetNumericArg( &argumentnode );
 	char string[MAX_CONFIGSTRING_CHARS];
@@ -2203,7 +2203,7 @@ static bool CG_LFuncDrawLocationName( struct cg_layoutnode_s *commandnode, struc
 	return true;
 }
 
-static bool CG_LFuncDrawWeaponWeakAmmo( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawWeaponWeakAmmo( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int offx, offy, fontsize;
 
@@ -2216,7 +2216,7 @@ static bool CG_LFuncDrawWeaponWeakAmmo( struct cg_layoutnode_s *commandnode, str
 	return true;
 }
 
-static bool CG_LFuncDrawWeaponStrongAmmo( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawWeaponStrongAmmo( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int offx, offy, fontsize;
 
@@ -2229,19 +2229,19 @@ static bool CG_LFuncDrawWeaponStrongAmmo( struct cg_layoutnode_s *commandnode, s
 	return true;
 }
 
-static bool CG_LFuncDrawTeamInfo( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawTeamInfo( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawTeamInfo( layout_cursor_x, layout_cursor_y, layout_cursor_align, layout_cursor_font, layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncDrawCrossHair( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawCrossHair( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawCrosshair( layout_cursor_x, layout_cursor_y, layout_cursor_align );
 	return true;
 }
 
-static bool CG_LFuncDrawKeyState( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawKeyState( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *key = CG_GetStringArg( &argumentnode );
 
@@ -2249,13 +2249,13 @@ static bool CG_LFuncDrawKeyState( struct cg_layoutnode_s *commandnode, struct cg
 	return true;
 }
 
-static bool CG_LFuncDrawNet( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawNet( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	CG_DrawNet( layout_cursor_x, layout_cursor_y, layout_cursor_width, layout_cursor_height, layout_cursor_align, layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncDrawChat( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawChat( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	int padding_x, padding_y;
 	struct shader_s *shader;
@@ -2270,7 +2270,7 @@ static bool CG_LFuncDrawChat( struct cg_layoutnode_s *commandnode, struct cg_lay
 }
 
 
-static bool CG_LFuncIf( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncIf( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	return (int)CG_GetNumericArg( &argumentnode ) != 0;
 }
@@ -2280,7 +2280,7 @@ static bool CG_LFuncIf( struct cg_layoutnode_s *commandnode, struct cg_layoutnod
  * CG_LFuncDrawCheckpoint
  * Draw checkpoint message, based on drawTimer
  */
-static bool CG_LFuncDrawCheckpoint( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments )
+static bool CG_LFuncDrawCheckpoint( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments )
 {
 	const char *fmtstr, *sign;
 	char time[64];
@@ -2316,7 +2316,7 @@ static bool CG_LFuncDrawCheckpoint( struct cg_layoutnode_s *commandnode, struct
 typedef struct cg_layoutcommand_s
 {
 	const char *name;
-	bool ( *func )( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments );
+	bool ( *func )( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments );
 	int numparms;
 	const char *help;
 	bool precache;
@@ -2823,7 +2823,7 @@ void Cmd_CG_PrintHudHelp_f( void )
 
 typedef struct cg_layoutnode_s
 {
-	bool ( *func )( struct cg_layoutnode_s *commandnode, struct cg_layoutnode_s *argumentnode, int numArguments );
+	bool ( *func )( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments );
 	int type;
 	char *string;
 	int integer;
@@ -2835,51 +2835,113 @@ typedef struct cg_layoutnode_s
 	bool precache;
 } cg_layoutnode_t;
 
+/*
+* The parsed tree is compiled into a flat program at load time. Each command
+* becomes an op holding its arguments, and "if" ops carry the index of the
+* first op past their block, which is jumped to when the condition fails.
+* Arguments are expressions over operands, with the stat and cvar references
+* resolved up front and the constant parts folded.
+*/
+enum
+{
+	LOPERAND_CONSTANT,
+	LOPERAND_REFERENCE,
+	LOPERAND_CVAR
+};
+
+typedef struct cg_layoutoperand_s
+{
+	int type;
+	float value;
+	int ( *func )( const void *parameter );
+	const void *parameter;
+	cvar_t *cvar;
+	opFunc_t opFunc;					// applied to this and the value of the rest of the expression
+} cg_layoutoperand_t;
+
+typedef struct cg_layoutarg_s
+{
+	int type;							// LNODE_ type of the first token, LNODE_COMMAND ends the list
+	char *string;
+	float value;						// when the whole expression folded to a constant
+	int numOperands;
+	cg_layoutoperand_t *operands;
+} cg_layoutarg_t;
+
+typedef struct cg_layoutop_s
+{
+	bool ( *func )( struct cg_layoutop_s *commandnode, struct cg_layoutarg_s *argumentnode, int numArguments );
+	int numArgs;
+	cg_layoutarg_t *args;
+	int skip;							// first op past the "if" block, -1 if none
+	bool precache;
+} cg_layoutop_t;
+
+typedef struct cg_layoutprogram_s
+{
+	int numOps, maxOps;
+	cg_layoutop_t *ops;
+	int numArgs, maxArgs;
+	cg_layoutarg_t *args;
+	int numOperands, maxOperands;
+	cg_layoutoperand_t *operands;
+} cg_layoutprogram_t;
+
 /*
 * CG_GetStringArg
 */
-static const char *CG_GetStringArg( struct cg_layoutnode_s **argumentsnode )
+static const char *CG_GetStringArg( struct cg_layoutarg_s **argumentsnode )
 {
-	struct cg_layoutnode_s *anode = *argumentsnode;
+	cg_layoutarg_t *arg = *argumentsnode;
 
-	if( !anode || anode->type == LNODE_COMMAND )
+	if( arg->type == LNODE_COMMAND )
 		CG_Error( "'CG_LayoutGetIntegerArg': bad arg count" );
 
 	// we can return anything as string
-	*argumentsnode = anode->next;
-	return anode->string;
+	*argumentsnode = arg + 1;
+	return arg->string;
+}
+
+/*
+* CG_GetOperandValue
+*/
+static inline float CG_GetOperandValue( const cg_layoutoperand_t *operand )
+{
+	switch( operand->type )
+	{
+	case LOPERAND_REFERENCE:
+		return operand->func( operand->parameter );
+	case LOPERAND_CVAR:
+		return (int)operand->cvar->value;
+	default:
+		return operand->value;
+	}
 }
 
 /*
 * CG_GetNumericArg
-* can use recursion for mathematical operations
 */
-static float CG_GetNumericArg( struct cg_layoutnode_s **argumentsnode )
+static float CG_GetNumericArg( struct cg_layoutarg_s **argumentsnode )
 {
-	struct cg_layoutnode_s *anode = *argumentsnode;
+	cg_layoutarg_t *arg = *argumentsnode;
 	float value;
+	int i;
 
-	if( !anode || anode->type == LNODE_COMMAND )
+	if( arg->type == LNODE_COMMAND )
 		CG_Error( "'CG_LayoutGetIntegerArg': bad arg count" );
 
-	if( anode->type != LNODE_NUMERIC && anode->type != LNODE_REFERENCE_NUMERIC )
-		CG_Printf( "WARNING: 'CG_LayoutGetIntegerArg': arg %s is not numeric", anode->string );
+	if( arg->type != LNODE_NUMERIC && arg->type != LNODE_REFERENCE_NUMERIC )
+		CG_Printf( "WARNING: 'CG_LayoutGetIntegerArg': arg %s is not numeric", arg->string );
 
-	*argumentsnode = anode->next;
-	if( anode->type == LNODE_REFERENCE_NUMERIC )
-	{
-		value = cg_numeric_references[anode->integer].func( cg_numeric_references[anode->integer].parameter );
-	}
-	else
-	{
-		value = anode->value;
-	}
+	*argumentsnode = arg + 1;
+	if( !arg->numOperands )
+		return arg->value;
 
-	// recurse if there are operators
-	if( anode->opFunc != NULL )
-	{
-		value = anode->opFunc( value, CG_GetNumericArg( argumentsnode ) );
-	}
+	// operators apply to the value of everything to their right
+	i = arg->numOperands - 1;
+	value = CG_GetOperandValue( &arg->operands[i] );
+	for( i--; i >= 0; i-- )
+		value = arg->operands[i].opFunc( CG_GetOperandValue( &arg->operands[i] ), value );
 
 	return value;
 }
@@ -3174,7 +3236,6 @@ static bool CG_LayoutFixCommasInToken( char **ptr, char **backptr )
 static cg_layoutnode_t *CG_RecurseParseLayoutScript( char **ptr, int level )
 {
 	cg_layoutnode_t	*command = NULL;
-	cg_layoutnode_t	*argumentnode = NULL;
 	cg_layoutnode_t	*node = NULL;
 	cg_layoutnode_t	*rootnode = NULL;
 	int expecArgs = 0, numArgs = 0;
@@ -3305,7 +3366,6 @@ static cg_layoutnode_t *CG_RecurseParseLayoutScript( char **ptr, int level )
 
 			// move on into the new command
 			command = node;
-			argumentnode = NULL;
 			numArgs = 0;
 			expecArgs = command->integer;
 			add = true;
@@ -3317,25 +3377,10 @@ static cg_layoutnode_t *CG_RecurseParseLayoutScript( char **ptr, int level )
 
 		if( add == true )
 		{
-			if( command && command == rootnode ) {
-				if( !argumentnode )
-					argumentnode = node;
-			}
-
 			if( rootnode )
 				rootnode->next = node;
 			node->parent = rootnode;
 			rootnode = node;
-
-			// precache arguments by calling the function at load time
-			if( command && expecArgs == numArgs && command->func && command->precache ) {
-				Vector4Set( layout_cursor_color, 0, 0, 0, 0 );
-				layout_cursor_x = -layout_cursor_width - 1;
-				layout_cursor_y = -layout_cursor_height - 1;
-				layout_cursor_width = 0;
-				layout_cursor_height = 0;
-				command->func( command, argumentnode, numArgs );
-			}
 		}
 	}
 
@@ -3370,38 +3415,96 @@ static void CG_RecursePrintLayoutThread( cg_layoutnode_t *rootnode, int level )
 #endif
 
 /*
-* CG_ParseLayoutScript
+* CG_CountLayoutNodes
 */
-static void CG_ParseLayoutScript( char *string, cg_layoutnode_t *rootnode )
+static void CG_CountLayoutNodes( cg_layoutnode_t *rootnode, int *numCommands, int *numArguments )
 {
+	cg_layoutnode_t *node;
 
-	CG_RecurseFreeLayoutThread( cg.statusBar );
-	cg.statusBar = CG_RecurseParseLayoutScript( &string, 0 );
+	for( node = rootnode; node; node = node->parent )
+	{
+		if( node->type == LNODE_COMMAND )
+			( *numCommands )++;
+		else
+			( *numArguments )++;
 
-#if 0
-	CG_RecursePrintLayoutThread( cg_layoutRootNode, 0 );
-#endif
+		if( node->ifthread )
+			CG_CountLayoutNodes( node->ifthread, numCommands, numArguments );
+	}
 }
 
-//=============================================================================
+/*
+* CG_FoldLayoutArg
+* collapse the constant tail of the expression, or all of it
+*/
+static void CG_FoldLayoutArg( cg_layoutarg_t *arg )
+{
+	int i;
+	float value;
+	cg_layoutoperand_t *operand;
 
-//=============================================================================
+	i = arg->numOperands - 1;
+	if( arg->operands[i].type != LOPERAND_CONSTANT )
+		return;
+
+	value = arg->operands[i].value;
+	for( i--; i >= 0 && arg->operands[i].type == LOPERAND_CONSTANT; i-- )
+		value = arg->operands[i].opFunc( arg->operands[i].value, value );
+
+	if( i < 0 )
+	{
+		arg->value = value;
+		arg->numOperands = 0;
+		return;
+	}
+
+	operand = &arg->operands[i + 1];
+	operand->value = value;
+	operand->opFunc = NULL;
+	arg->numOperands = i + 2;
+}
 
 /*
-* CG_RecurseExecuteLayoutThread
-* Execution works like this: First node (on backwards) is expected to be the command, followed by arguments nodes.
-* we keep a pointer to the command and run the tree counting arguments until we reach the next command,
-* then we call the command function sending the pointer to first argument and the pointer to the command.
-* At return we advance one node (we stopped at last argument node) so it starts again from the next command (if any).
-* 
-* When finding an "if" command with a subtree, we execute the "if" command. In the case it
-* returns any value, we recurse execute the subtree
+* CG_CompileLayoutOperand
 */
-static void CG_RecurseExecuteLayoutThread( cg_layoutnode_t *rootnode )
+static void CG_CompileLayoutOperand( cg_layoutnode_t *node, cg_layoutoperand_t *operand )
 {
-	cg_layoutnode_t	*argumentnode = NULL;
-	cg_layoutnode_t	*commandnode = NULL;
-	int numArguments;
+	const reference_numeric_t *ref;
+
+	memset( operand, 0, sizeof( *operand ) );
+	operand->opFunc = node->opFunc;
+
+	if( node->type != LNODE_REFERENCE_NUMERIC )
+	{
+		operand->type = LOPERAND_CONSTANT;
+		operand->value = node->value;
+		return;
+	}
+
+	ref = &cg_numeric_references[node->integer];
+	// cache the cvar if it exists, never create it here
+	if( ref->func == CG_GetCvar && ( operand->cvar = trap_Cvar_Find( (const char *)ref->parameter ) ) != NULL )
+	{
+		operand->type = LOPERAND_CVAR;
+	}
+	else
+	{
+		operand->type = LOPERAND_REFERENCE;
+		operand->func = ref->func;
+		operand->parameter = ref->parameter;
+	}
+}
+
+/*
+* CG_RecurseCompileLayoutThread
+* emits the ops of a thread, and of its "if" subthreads right after each "if" op
+*/
+static void CG_RecurseCompileLayoutThread( cg_layoutprogram_t *program, cg_layoutnode_t *rootnode )
+{
+	cg_layoutnode_t *commandnode, *node, *last;
+	cg_layoutop_t *op;
+	cg_layoutarg_t *arg;
+	int numArguments, firstArg, firstOperand;
 
 	if( !rootnode )
 		return;
@@ -3409,71 +3512,193 @@ static void CG_RecurseExecuteLayoutThread( cg_layoutnode_t *rootnode )
 	// run until the real root
 	commandnode = rootnode;
 	while( commandnode->parent )
-	{
 		commandnode = commandnode->parent;
-	}
 
-	// now run backwards up to the next command node
 	while( commandnode )
 	{
-		argumentnode = commandnode->next;
-
-		// we could trust the parser, but I prefer counting the arguments here
 		numArguments = 0;
-		while( argumentnode )
-		{
-			if( argumentnode->type == LNODE_COMMAND )
-				break;
-
-			argumentnode = argumentnode->next;
+		for( node = commandnode->next; node && node->type != LNODE_COMMAND; node = node->next )
 			numArguments++;
-		}
-
-		// reset
-		argumentnode = commandnode->next;
 
-		// Execute the command node
 		if( commandnode->integer != numArguments )
 		{
 			CG_Printf( "ERROR: Layout command %s: invalid argument count (expecting %i, found %i)\n", commandnode->string, commandnode->integer, numArguments );
 			return;
 		}
-		if( commandnode->func )
+
+		firstArg = program->numArgs;
+		firstOperand = program->numOperands;
+
+		op = &program->ops[program->numOps++];
+		op->func = commandnode->func;
+		op->numArgs = 0;
+		op->args = &program->args[firstArg];
+		op->skip = -1;
+		op->precache = commandnode->precache;
+
+		// group each argument with the operands chained to it by operators
+		node = commandnode->next;
+		while( node && node->type != LNODE_COMMAND )
 		{
-			//special case for if commands
-			if( commandnode->func( commandnode, argumentnode, numArguments ) )
+			arg = &program->args[program->numArgs++];
+			arg->type = node->type;
+			arg->string = CG_CopyString( node->string );
+			arg->value = 0;
+			arg->numOperands = 0;
+			arg->operands = &program->operands[program->numOperands];
+
+			do
 			{
-				// execute the "if" thread when command returns a value
-				if( commandnode->ifthread )
-					CG_RecurseExecuteLayoutThread( commandnode->ifthread );
-			}
+				CG_CompileLayoutOperand( node, &arg->operands[arg->numOperands++] );
+				program->numOperands++;
+				last = node;
+				node = node->next;
+			} while( last->opFunc && node && node->type != LNODE_COMMAND );
+
+			CG_FoldLayoutArg( arg );
+			op->numArgs++;
 		}
 
-		//move up to next command node
-		commandnode = argumentnode;
-		if( commandnode == rootnode )
-			return;
+		// terminate the arguments list
+		arg = &program->args[program->numArgs++];
+		memset( arg, 0, sizeof( *arg ) );
+		arg->type = LNODE_COMMAND;
 
-		while( commandnode && commandnode->type != LNODE_COMMAND )
+		if( op->func == CG_LFuncIf && op->numArgs == 1 && !op->args[0].numOperands )
 		{
-			commandnode = commandnode->next;
+			// the condition is constant, so is the choice of the block
+			bool taken = (int)op->args[0].value != 0;
+
+			for( arg = op->args; arg->type != LNODE_COMMAND; arg++ )
+				CG_Free( arg->string );
+			program->numOps--;
+			program->numArgs = firstArg;
+			program->numOperands = firstOperand;
+
+			if( taken )
+				CG_RecurseCompileLayoutThread( program, commandnode->ifthread );
 		}
+		else if( commandnode->ifthread )
+		{
+			CG_RecurseCompileLayoutThread( program, commandnode->ifthread );
+			op->skip = program->numOps;
+		}
+
+		commandnode = node;
 	}
 }
 
 /*
-* CG_ExecuteLayoutProgram
+* CG_FreeLayoutProgram
 */
-void CG_ExecuteLayoutProgram( struct cg_layoutnode_s *rootnode )
+static void CG_FreeLayoutProgram( cg_layoutprogram_t *program )
 {
-	CG_RecurseExecuteLayoutThread( rootnode );
+	int i;
+
+	if( !program )
+		return;
+
+	for( i = 0; i < program->numArgs; i++ )
+	{
+		if( program->args[i].string )
+			CG_Free( program->args[i].string );
+	}
+
+	CG_Free( program->ops );
+	CG_Free( program->args );
+	CG_Free( program->operands );
+	CG_Free( program );
 }
 
-//=============================================================================
+/*
+* CG_CompileLayoutProgram
+*/
+static cg_layoutprogram_t *CG_CompileLayoutProgram( cg_layoutnode_t *rootnode )
+{
+	int i, numCommands = 0, numArguments = 0;
+	cg_layoutprogram_t *program;
+	cg_layoutop_t *op;
+
+	if( !rootnode )
+		return NULL;
+
+	CG_CountLayoutNodes( rootnode, &numCommands, &numArguments );
+
+	program = ( cg_layoutprogram_t * )CG_Malloc( sizeof( cg_layoutprogram_t ) );
+	program->maxOps = numCommands;
+	program->ops = ( cg_layoutop_t * )CG_Malloc( sizeof( cg_layoutop_t ) * max( program->maxOps, 1 ) );
+	program->maxArgs = numArguments + numCommands;
+	program->args = ( cg_layoutarg_t * )CG_Malloc( sizeof( cg_layoutarg_t ) * max( program->maxArgs, 1 ) );
+	program->maxOperands = numArguments;
+	program->operands = ( cg_layoutoperand_t * )CG_Malloc( sizeof( cg_layoutoperand_t ) * max( program->maxOperands, 1 ) );
+
+	CG_RecurseCompileLayoutThread( program, rootnode );
+
+	// precache arguments by calling the functions at load time
+	for( i = 0, op = program->ops; i < program->numOps; i++, op++ )
+	{
+		if( !op->func || !op->precache )
+			continue;
+
+		Vector4Set( layout_cursor_color, 0, 0, 0, 0 );
+		layout_cursor_x = -layout_cursor_width - 1;
+		layout_cursor_y = -layout_cursor_height - 1;
+		layout_cursor_width = 0;
+		layout_cursor_height = 0;
+		op->func( op, op->args, op->numArgs );
+	}
+
+	if( cg_debugHUD && cg_debugHUD->integer )
+		CG_Printf( "HUD: compiled %i of %i commands, %i operands\n", program->numOps, numCommands, program->numOperands );
+
+	return program;
+}
+
+/*
+* CG_ParseLayoutScript
+*/
+static void CG_ParseLayoutScript( char *string )
+{
+	cg_layoutnode_t *rootnode;
+
+	CG_FreeLayoutProgram( cg.statusBar );
+
+	rootnode = CG_RecurseParseLayoutScript( &string, 0 );
+
+#if 0
+	CG_RecursePrintLayoutThread( rootnode, 0 );
+#endif
+
+	cg.statusBar = CG_CompileLayoutProgram( rootnode );
+	CG_RecurseFreeLayoutThread( rootnode );
+}
 
 //=============================================================================
 
+/*
+* CG_ExecuteLayoutProgram
+* Runs the ops in order. When an op with a block ("if") returns false,
+* execution jumps past its block.
+*/
+void CG_ExecuteLayoutProgram( struct cg_layoutprogram_s *program )
+{
+	int i;
+	cg_layoutop_t *op;
+
+	if( !program )
+		return;
 
+	for( i = 0; i < program->numOps; )
+	{
+		op = &program->ops[i];
+		if( op->func && !op->func( op, op->args, op->numArgs ) && op->skip >= 0 )
+			i = op->skip;
+		else
+			i++;
+	}
+}
+
+//=============================================================================
 
 /*
 * CG_LoadHUDFile
@@ -3873,7 +4098,7 @@ static void CG_LoadStatusBarFile( char *path )
 		return;
 	}
 	// load the new status bar program
-	CG_ParseLayoutScript( opt, cg.statusBar );
+	CG_ParseLayoutScript( opt );
 	// Free the opt buffer!
 	CG_Free( opt );
 
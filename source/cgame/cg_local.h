@@ -484,6 +484,15 @@ typedef struct
 	struct skinfile_s *skinPrecache[MAX_SKINFILES];
 } cg_static_t;
 
+typedef struct
+{
+	int ucmd;						// the state is the result of running this ucmd
+	int weapon;
+	unsigned int solidsHash;		// of the solids it was traced against
+	bool triggersTouched;			// a push trigger was touched in this prediction round by then
+	player_state_t playerState;
+} cg_predictedState_t;
+
 typedef struct
 {
 	unsigned int time;
@@ -537,8 +546,7 @@ typedef struct
 
 	// prediction optimization (don't run all ucmds in not needed)
 	int predictFrom;
-	entity_state_t predictFromEntityState;
-	player_state_t predictFromPlayerState;
+	cg_predictedState_t predictedStates[CMD_BACKUP];	// results of closed ucmds, indexed by ucmd & CMD_MASK
 
 	int lastWeapon;
 
@@ -597,7 +605,7 @@ typedef struct
 	int checkpoints[MAX_CHECKPOINTS]; // racesow
 
 	// statusbar program
-	struct cg_layoutnode_s *statusBar;
+	struct cg_layoutprogram_s *statusBar;
 
 	cg_viewweapon_t weapon;
 	cg_viewdef_t view;
@@ -691,6 +699,7 @@ void CG_PredictedEvent( int entNum, int ev, int parm );
 void CG_Predict_ChangeWeapon( int new_weapon );
 void CG_PredictMovement( void );
 void CG_CheckPredictionError( void );
+void CG_ValidatePredictedStates( void );
 void CG_BuildSolidList( void );
 void CG_Trace( trace_t *t, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int ignore, int contentmask );
 int CG_PointContents( vec3_t point );
@@ -750,7 +759,7 @@ extern cvar_t *cg_strafeHUD;
 
 void CG_SC_Obituary( void );
 void Cmd_CG_PrintHudHelp_f( void );
-void CG_ExecuteLayoutProgram( struct cg_layoutnode_s *rootnode );
+void CG_ExecuteLayoutProgram( struct cg_layoutprogram_s *program );
 
 // racesow
 void CG_CheckpointsClear( void );
@@ -773,6 +782,7 @@ void CG_ScoresOn_f( void );
 void CG_ScoresOff_f( void );
 bool CG_ExecuteScoreboardTemplateLayout( char *s );
 void SCR_UpdateScoreboardMessage( const char *string );
+void SCR_UpdateScoreboardDelta( unsigned int checksum, const char *delta );
 void SCR_UpdatePlayerStatsMessage( const char *string );
 
 //
@@ -988,6 +988,7 @@ void CG_Reset( void )
 
 	// reset prediction optimization
 	cg.predictFrom = 0;
+	memset( cg.predictedStates, 0, sizeof( cg.predictedStates ) );
 
 	memset( cg_entities, 0, sizeof( cg_entities ) );
 }
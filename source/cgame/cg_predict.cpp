@@ -26,6 +26,9 @@ static entity_state_t *cg_solidList[MAX_PARSE_ENTITIES];
 int cg_numTriggers;
 static entity_state_t *cg_triggersList[MAX_PARSE_ENTITIES];
 static bool	cg_triggersListTriggered[MAX_PARSE_ENTITIES];
+static bool cg_triggersTouched;			// any of cg_triggersListTriggered is set
+
+static unsigned int cg_solidsHash;		// of everything in the solid and trigger lists
 
 static bool ucmdReady = false;
 
@@ -96,6 +99,30 @@ void CG_CheckPredictionError( void )
 	}
 }
 
+/*
+* CG_HashSolid
+*
+* Everything CG_Trace and CG_Predict_TouchTriggers read from a solid entity
+*/
+static unsigned int CG_HashSolid( unsigned int hash, const entity_state_t *ent )
+{
+	int i;
+	unsigned int fields[10];
+	const qbyte *p = ( const qbyte * )fields;
+
+	fields[0] = ent->number;
+	fields[1] = ent->type;
+	fields[2] = ent->solid;
+	fields[3] = ent->modelindex;
+	memcpy( &fields[4], ent->origin, sizeof( vec3_t ) );
+	memcpy( &fields[7], ent->angles, sizeof( vec3_t ) );
+
+	// FNV-1a
+	for( i = 0; i < (int)sizeof( fields ); i++ )
+		hash = ( hash ^ p[i] ) * 16777619;
+	return hash;
+}
+
 /*
 * CG_BuildSolidList
 */
@@ -106,6 +133,7 @@ void CG_BuildSolidList( void )
 
 	cg_numSolids = 0;
 	cg_numTriggers = 0;
+	cg_solidsHash = 2166136261u;
 	for( i = 0; i < cg.frame.numEntities; i++ )
 	{
 		ent = &cg.frame.parsedEntities[i & ( MAX_PARSE_ENTITIES-1 )];
@@ -134,10 +162,12 @@ void CG_BuildSolidList( void )
 
 			case ET_PUSH_TRIGGER:
 				cg_triggersList[cg_numTriggers++] = &cg_entities[ ent->number ].current;
+				cg_solidsHash = CG_HashSolid( cg_solidsHash, ent );
 				break;
 
 			default :
 				cg_solidList[cg_numSolids++] = &cg_entities[ ent->number ].current;
+				cg_solidsHash = CG_HashSolid( cg_solidsHash, ent );
 				break;
 			}
 		}
@@ -212,6 +242,7 @@ void CG_Predict_TouchTriggers( pmove_t *pm, vec3_t previous_origin ) // racesow
 				{
 					GS_TouchPushTrigger( pm->playerState, state );
 					cg_triggersListTriggered[i] = true;
+					cg_triggersTouched = true;
 				}
 			}
 		}
@@ -387,6 +418,93 @@ static void CG_PredictSmoothSteps( void )
 	}
 }
 
+/*
+* CG_PredictedStateMatches
+*
+* Compares the fields that prediction writes to
+*/
+static bool CG_PredictedStateMatches( const player_state_t *predicted, const player_state_t *server )
+{
+	const pmove_state_t *pp = &predicted->pmove, *sp = &server->pmove;
+
+	if( pp->pm_type != sp->pm_type || pp->pm_flags != sp->pm_flags || pp->pm_time != sp->pm_time || pp->gravity != sp->gravity )
+		return false;
+	if( !VectorCompare( pp->origin, sp->origin ) || !VectorCompare( pp->velocity, sp->velocity ) )
+		return false;
+	if( memcmp( pp->stats, sp->stats, sizeof( pp->stats ) ) || memcmp( pp->delta_angles, sp->delta_angles, sizeof( pp->delta_angles ) ) )
+		return false;
+
+	if( predicted->weaponState != server->weaponState )
+		return false;
+	if( predicted->stats[STAT_WEAPON] != server->stats[STAT_WEAPON] || predicted->stats[STAT_PENDING_WEAPON] != server->stats[STAT_PENDING_WEAPON]
+		|| predicted->stats[STAT_WEAPON_TIME] != server->stats[STAT_WEAPON_TIME] || predicted->stats[STAT_PRESHOT_RESET] != server->stats[STAT_PRESHOT_RESET] )
+		return false;
+
+	return memcmp( predicted->inventory, server->inventory, sizeof( predicted->inventory ) ) == 0;
+}
+
+/*
+* CG_ValidatePredictedStates
+*
+* Called for every new snapshot. If the state we predicted for the last ucmd executed by
+* the server matches the snapshot, the states predicted for the following ucmds can be
+* kept as long as running them again from here would give the same result: they were
+* traced against the same solids as this snapshot has, and no push trigger had been
+* touched yet, as the triggered flags start over with every prediction round.
+*/
+void CG_ValidatePredictedStates( void )
+{
+	int ucmd, ucmdExecuted, ucmdHead;
+	const cg_predictedState_t *state;
+
+	cg.predictFrom = 0;
+	if( !cg_predict_optimize->integer )
+		return;
+
+	trap_NET_GetCurrentState( NULL, &ucmdHead, NULL );
+	ucmdExecuted = cg.frame.ucmdExecuted;
+	if( ucmdExecuted <= 0 || ucmdHead - ucmdExecuted >= CMD_BACKUP )
+		return;
+
+	state = &cg.predictedStates[ucmdExecuted & CMD_MASK];
+	if( state->ucmd != ucmdExecuted || !CG_PredictedStateMatches( &state->playerState, &cg.frame.playerState ) )
+		return;
+
+	// continue from the last closed ucmd of the confirmed chain
+	for( ucmd = ucmdExecuted; ucmd + 1 < ucmdHead; ucmd++ )
+	{
+		state = &cg.predictedStates[( ucmd + 1 ) & CMD_MASK];
+		if( state->ucmd != ucmd + 1 || state->solidsHash != cg_solidsHash || state->triggersTouched )
+			break;
+	}
+	cg.predictFrom = ucmd;
+}
+
+/*
+* CG_RestorePredictedState
+*
+* Non-predicted fields always come from the current snapshot
+*/
+static void CG_RestorePredictedState( const cg_predictedState_t *state )
+{
+	player_state_t *ps = &cg.predictedPlayerState;
+	const player_state_t *saved = &state->playerState;
+
+	*ps = cg.frame.playerState;
+	ps->pmove = saved->pmove;
+	VectorCopy( saved->viewangles, ps->viewangles );
+	ps->viewheight = saved->viewheight;
+	ps->fov = saved->fov;
+	ps->weaponState = saved->weaponState;
+	ps->stats[STAT_WEAPON] = saved->stats[STAT_WEAPON];
+	ps->stats[STAT_PENDING_WEAPON] = saved->stats[STAT_PENDING_WEAPON];
+	ps->stats[STAT_WEAPON_TIME] = saved->stats[STAT_WEAPON_TIME];
+	ps->stats[STAT_PRESHOT_RESET] = saved->stats[STAT_PRESHOT_RESET];
+	memcpy( ps->inventory, saved->inventory, sizeof( ps->inventory ) );
+
+	cg_entities[cg.frame.playerState.POVnum].current.weapon = state->weapon;
+}
+
 /*
 * CG_PredictMovement
 * 
@@ -411,8 +529,7 @@ void CG_PredictMovement( void )
 	if( cg.predictFrom > 0 )
 	{
 		ucmdExecuted = cg.predictFrom;
-		cg.predictedPlayerState = cg.predictFromPlayerState;
-		cg_entities[cg.frame.playerState.POVnum].current = cg.predictFromEntityState;
+		CG_RestorePredictedState( &cg.predictedStates[ucmdExecuted & CMD_MASK] );
 	}
 	else
 	{
@@ -437,6 +554,7 @@ void CG_PredictMovement( void )
 
 	// clear the triggered toggles for this prediction round
 	memset( &cg_triggersListTriggered, false, sizeof( cg_triggersListTriggered ) );
+	cg_triggersTouched = false;
 
 	// run frames
 	while( ++ucmdExecuted <= ucmdHead )
@@ -476,15 +594,17 @@ void CG_PredictMovement( void )
 			cg.predictedPlayerState.fov = cInfo->fov - ( (float)( cInfo->fov - cInfo->zoomfov ) * frac );
 		}
 
-		// backup the last predicted ucmd which has a timestamp (it's closed)
-		if( cg_predict_optimize->integer && ucmdExecuted == ucmdHead - 1 )
+		// backup the predicted ucmds which have a timestamp (they're closed)
+		if( cg_predict_optimize->integer && ucmdExecuted < ucmdHead )
 		{
-			if( ucmdExecuted != cg.predictFrom )
-			{
-				cg.predictFrom = ucmdExecuted;
-				cg.predictFromPlayerState = cg.predictedPlayerState;
-				cg.predictFromEntityState = cg_entities[cg.frame.playerState.POVnum].current;
-			}
+			cg_predictedState_t *state = &cg.predictedStates[frame];
+
+			state->ucmd = ucmdExecuted;
+			state->weapon = cg_entities[cg.frame.playerState.POVnum].current.weapon;
+			state->playerState = cg.predictedPlayerState;
+			state->solidsHash = cg_solidsHash;
+			state->triggersTouched = cg_triggersTouched;
+			cg.predictFrom = ucmdExecuted;
 		}
 	}
 
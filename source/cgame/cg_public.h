@@ -30,7 +30,7 @@ typedef unsigned int (*cg_get_raw_samples_cb_t)(void*);
 
 // cg_public.h -- client game dll information visible to engine
 
-#define	CGAME_API_VERSION   65
+#define	CGAME_API_VERSION   66
 
 //
 // structs and variables shared with the main engine
@@ -103,6 +103,7 @@ typedef struct
 	cvar_t *( *Cvar_ForceSet )( const char *name, const char *value );      // will return 0 0 if not found
 	float ( *Cvar_Value )( const char *name );
 	const char *( *Cvar_String )( const char *name );
+	cvar_t *( *Cvar_Find )( const char *name );     // returns NULL instead of creating the cvar
 
 	void ( *Cmd_TokenizeString )( const char *text );
 	int ( *Cmd_Argc )( void );
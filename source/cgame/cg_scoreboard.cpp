@@ -216,6 +216,7 @@ static int SCB_DrawPlayerStats( int x, int y, struct qfontface_s *font )
 // ====================================================
 
 static char scoreboardString[MAX_STRING_CHARS];
+static bool scoreboardResync;
 
 /*
 * SCR_DrawChallengers
@@ -814,6 +815,31 @@ void CG_DrawScoreboard( void )
 void SCR_UpdateScoreboardMessage( const char *string )
 {
 	Q_strncpyz( scoreboardString, string, sizeof( scoreboardString ) );
+	scoreboardResync = false;
+}
+
+/*
+* SCR_UpdateScoreboardDelta
+*
+* Applies a delta against the scoreboard message we hold. If it was built
+* against a different one, ask the server for the full message.
+*/
+void SCR_UpdateScoreboardDelta( unsigned int checksum, const char *delta )
+{
+	char string[MAX_STRING_CHARS];
+
+	if( GS_ScoreboardChecksum( scoreboardString ) != checksum
+		|| !GS_ApplyScoreboardDelta( scoreboardString, delta, string, sizeof( string ) ) )
+	{
+		if( !scoreboardResync && !cgs.demoPlaying )
+		{
+			trap_Cmd_ExecuteText( EXEC_NOW, "scbfull" );
+			scoreboardResync = true;
+		}
+		return;
+	}
+
+	Q_strncpyz( scoreboardString, string, sizeof( scoreboardString ) );
 }
 
 /*
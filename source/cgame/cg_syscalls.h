@@ -107,6 +107,11 @@ static inline const char *trap_Cvar_String( const char *name )
 	return CGAME_IMPORT.Cvar_String( name );
 }
 
+static inline cvar_t *trap_Cvar_Find( const char *name )
+{
+	return CGAME_IMPORT.Cvar_Find( name );
+}
+
 static inline void trap_Cmd_TokenizeString( const char *text )
 {
 	CGAME_IMPORT.Cmd_TokenizeString( text );
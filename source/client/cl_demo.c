@@ -40,6 +40,27 @@ void CL_WriteDemoMessage( msg_t *msg )
 	SNAP_RecordDemoMessage( cls.demo.file, msg, 8 );
 }
 
+/*
+* CL_WriteDemoKeyframeConfigstrings
+* 
+* Writes the configstrings changed since the demo started, which the player
+* restores when seeking to the keyframe that follows.
+*/
+void CL_WriteDemoKeyframeConfigstrings( void )
+{
+	int i;
+	msg_t msg;
+	qbyte msg_buffer[MAX_MSGLEN];
+
+	for( i = 0; i < MAX_CONFIGSTRINGS; )
+	{
+		MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
+		i = SNAP_WriteDemoKeyframeConfigstrings( &msg, &cls.demo.index, cl.configstrings[0], i );
+		if( msg.cursize )
+			SNAP_RecordDemoMessage( cls.demo.file, &msg, 0 );
+	}
+}
+
 /*
 * CL_Stop_f
 * 
@@ -82,6 +103,9 @@ void CL_Stop_f( void )
 	CL_SetDemoMetaKeyValue( "matchname", cl.configstrings[CS_MATCHNAME] );
 	CL_SetDemoMetaKeyValue( "matchscore", cl.configstrings[CS_MATCHSCORE] );
 	CL_SetDemoMetaKeyValue( "matchuuid", cl.configstrings[CS_MATCHUUID] );
+	cls.demo.meta_data_realsize = SNAP_SetDemoMetaIndex( cls.demo.meta_data, sizeof( cls.demo.meta_data ), 
+		cls.demo.meta_data_realsize, &cls.demo.index );
+	SNAP_FreeDemoIndex( &cls.demo.index );
 
 	FS_FCloseFile( cls.demo.file );
 
@@ -187,6 +211,7 @@ void CL_Record_f( void )
 	cls.demo.recording = qtrue;
 	cls.demo.basetime = cls.demo.duration = cls.demo.time = 0;
 	cls.demo.name = ZoneCopyString( demoname );
+	cls.demo.keyframe_time = 0;
 
 	// don't start saving messages until a non-delta compressed message is received
 	CL_AddReliableCommand( "nodelta" ); // request non delta compressed frame from server
@@ -276,6 +301,8 @@ void CL_DemoCompleted( void )
 
 	CL_PauseDemo( qfalse );
 
+	SNAP_FreeDemoIndex( &cls.demo.index );
+
 	Com_Printf( "Demo completed\n" );
 
 	memset( &cls.demo, 0, sizeof( cls.demo ) );
@@ -305,6 +332,10 @@ static void CL_ReadDemoMessage( void )
 		init = qfalse;
 	}
 
+	// reached the keyframe we were seeking to, decode snapshots again
+	if( cls.demo.play_seek_offset && (unsigned)FS_Tell( demofilehandle ) >= cls.demo.play_seek_offset )
+		cls.demo.play_seek_offset = 0;
+
 	read = SNAP_ReadDemoMessage( demofilehandle, &demomsg );
 	if( read == -1 )
 	{
@@ -333,6 +364,72 @@ void CL_ReadDemoPackets( void )
 	}
 }
 
+/*
+* CL_SetDemoBaseConfigstrings
+* 
+* Keeps a copy of the configstrings the demo started with once the first
+* frame is reached, seeking to a keyframe starts from them.
+*/
+void CL_SetDemoBaseConfigstrings( void )
+{
+	if( !cls.demo.index.withConfigstrings || cls.demo.index.configstrings )
+		return;
+	SNAP_SetDemoIndexConfigstrings( &cls.demo.index, cl.configstrings[0] );
+}
+
+/*
+* CL_SeekDemoKeyframe
+* 
+* Restores the configstrings the demo started with and continues reading
+* at the keyframe, which is preceded by the configstrings changed since.
+*/
+static void CL_SeekDemoKeyframe( const snapDemoKeyframe_t *keyframe )
+{
+	int i;
+	const char *cs;
+
+	for( i = 0; i < MAX_CONFIGSTRINGS; i++ )
+	{
+		cs = cls.demo.index.configstrings + i * MAX_CONFIGSTRING_CHARS;
+		if( strcmp( cl.configstrings[i], cs ) )
+			CL_UpdateConfigString( i, cs );
+	}
+
+	FS_Seek( demofilehandle, keyframe->offset, FS_SEEK_SET );
+	demofilelen = demofilelentotal - keyframe->offset;
+	cl.currentSnapNum = cl.receivedSnapNum = 0;
+	cls.demo.play_seek_offset = 0;
+}
+
+/*
+* CL_LoadDemoIndex
+* 
+* Reads the keyframe index from the demo meta data. Demos recorded without
+* one are scanned for keyframes instead.
+*/
+static void CL_LoadDemoIndex( void )
+{
+	char *meta_data;
+	size_t meta_data_realsize;
+	unsigned int start;
+
+	meta_data = Mem_TempMalloc( SNAP_MAX_DEMO_META_DATA_SIZE );
+	meta_data_realsize = SNAP_ReadDemoMetaData( demofilehandle, meta_data, SNAP_MAX_DEMO_META_DATA_SIZE );
+	meta_data_realsize = min( meta_data_realsize, SNAP_MAX_DEMO_META_DATA_SIZE );
+	FS_Seek( demofilehandle, 0, FS_SEEK_SET );
+
+	if( !SNAP_ReadDemoMetaIndex( meta_data, meta_data_realsize, &cls.demo.index ) )
+	{
+		SNAP_FreeDemoIndex( &cls.demo.index );
+
+		start = Sys_Milliseconds();
+		if( SNAP_BuildDemoIndex( demofilehandle, &cls.demo.index ) )
+			Com_DPrintf( "Built demo index with %u keyframes in %u ms\n", cls.demo.index.numKeyframes, Sys_Milliseconds() - start );
+	}
+
+	Mem_TempFree( meta_data );
+}
+
 /*
 * CL_StartDemo
 */
@@ -387,6 +484,8 @@ static void CL_StartDemo( const char *demoname )
 	demofilelentotal = tempdemofilelen;
 	demofilelen = demofilelentotal;
 
+	CL_LoadDemoIndex();
+
 	cls.servername = ZoneCopyString( COM_FileBase( servername ) );
 	COM_StripExtension( cls.servername );
 
@@ -471,6 +570,8 @@ void CL_DemoJump_f( void )
 	qboolean relative;
 	int time;
 	char *p;
+	unsigned int current;
+	const snapDemoKeyframe_t *keyframe;
 
 	if( !cls.demo.playing )
 	{
@@ -518,13 +619,30 @@ void CL_DemoJump_f( void )
 
 	CL_AdjustServerTime( 1 );
 
-	if( cl.serverTime < cl.snapShots[cl.receivedSnapNum&UPDATE_MASK].serverTime )
+	current = cl.snapShots[cl.receivedSnapNum&UPDATE_MASK].serverTime;
+	keyframe = SNAP_FindDemoKeyframe( &cls.demo.index, cl.serverTime );
+
+	// the keyframe carries everything needed to resume from it
+	if( keyframe && cls.demo.index.configstrings && ( cl.serverTime < current || keyframe->time > current ) )
+	{
+		CL_SeekDemoKeyframe( keyframe );
+		cls.demo.play_jump = qtrue;
+		return;
+	}
+
+	if( cl.serverTime < current )
 	{
 		demofilelen = demofilelentotal;
 		FS_Seek( demofilehandle, 0, FS_SEEK_SET );
 		cl.currentSnapNum = cl.receivedSnapNum = 0;
+		current = 0;
 	}
 
+	// only parse the server commands up to the nearest keyframe, snapshots
+	// before it don't need to be decoded
+	if( keyframe && keyframe->time > current )
+		cls.demo.play_seek_offset = keyframe->offset;
+
 	cls.demo.play_jump = qtrue;
 }
 
@@ -410,6 +410,7 @@ void CL_GameModule_Init( void )
 	import.Cvar_ForceSet = Cvar_ForceSet;
 	import.Cvar_String = Cvar_String;
 	import.Cvar_Value = Cvar_Value;
+	import.Cvar_Find = Cvar_Find;
 
 	import.Cmd_TokenizeString = Cmd_TokenizeString;
 	import.Cmd_Argc = Cmd_Argc;
@@ -220,15 +220,20 @@ static void CL_Quit_f( void )
 */
 static void CL_SendConnectPacket( void )
 {
+	int flags = 0;
+
 	userinfo_modified = qfalse;
 
+	if( cls.dictCompression )
+		flags |= CONNECT_FLAG_DICTCOMPRESSION;
+
 	Com_DPrintf("CL_MM_Initialized: %d, cls.mm_ticket: %u\n", CL_MM_Initialized(), cls.mm_ticket );
 	if( CL_MM_Initialized() && cls.mm_ticket != 0 )
 		Netchan_OutOfBandPrint( cls.socket, &cls.serveraddress, "connect %i %i %i \"%s\" %i %u\n",
-				APP_PROTOCOL_VERSION, Netchan_GamePort(), cls.challenge, Cvar_Userinfo(), 0, cls.mm_ticket );
+				APP_PROTOCOL_VERSION, Netchan_GamePort(), cls.challenge, Cvar_Userinfo(), flags, cls.mm_ticket );
 	else
 		Netchan_OutOfBandPrint( cls.socket, &cls.serveraddress, "connect %i %i %i \"%s\" %i\n",
-				APP_PROTOCOL_VERSION, Netchan_GamePort(), cls.challenge, Cvar_Userinfo(), 0 );
+				APP_PROTOCOL_VERSION, Netchan_GamePort(), cls.challenge, Cvar_Userinfo(), flags );
 }
 
 /*
@@ -1102,6 +1107,8 @@ static void CL_ConnectionlessPacket( const socket_t *socket, const netadr_t *add
 		Q_strncpyz( cls.session, MSG_ReadStringLine( msg ), sizeof( cls.session ) );
 
 		Netchan_Setup( &cls.netchan, socket, address, Netchan_GamePort() );
+		if( cls.dictCompression && ( atoi( MSG_ReadStringLine( msg ) ) & CONNECT_FLAG_DICTCOMPRESSION ) )
+			cls.netchan.dictCompression = qtrue;
 		memset( cl.configstrings, 0, sizeof( cl.configstrings ) );
 		CL_SetClientState( CA_HANDSHAKE );
 		CL_AddReliableCommand( "new" );
@@ -1227,6 +1234,8 @@ static void CL_ConnectionlessPacket( const socket_t *socket, const netadr_t *add
 		}
 
 		cls.challenge = atoi( Cmd_Argv( 1 ) );
+		cls.dictCompression = Netchan_DictChecksum() && Cmd_Argc() > 2
+			&& (unsigned int)strtoul( Cmd_Argv( 2 ), NULL, 10 ) == Netchan_DictChecksum();
 		//wsw : r1q2[start]
 		//r1: reset the timer so we don't send dup. getchallenges
 		cls.connect_time = Sys_Milliseconds();
@@ -1261,7 +1270,7 @@ static qboolean CL_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	MSG_ReadLong( msg ); // sequence_ack
 	if( msg->compressed )
 	{
-		zerror = Netchan_DecompressMessage( msg );
+		zerror = Netchan_DecompressMessage( netchan, msg );
 		if( zerror < 0 )
 		{
 			// compression error. Drop the packet
@@ -1421,12 +1430,16 @@ static unsigned int CL_LoadMap( const char *name )
 
 	assert( !cl.cms );
 
-	// if local server is running, share the collision model,
-	// increasing the ref counter
+	// if local server is running the same map, share the collision model,
+	// increasing the ref counter (demos may be played on top of a listen server)
 	if( Com_ServerState() ) {
 		cl.cms = Com_ServerCM( &map_checksum );
+		if( cl.cms && map_checksum != (unsigned)atoi( cl.configstrings[CS_MAPCHECKSUM] ) ) {
+			cl.cms = NULL;
+		}
 	}
-	else {
+
+	if( !cl.cms ) {
 		cl.cms = CM_New( NULL );
 		CM_LoadMap( cl.cms, name, qtrue, &map_checksum );
 	}
@@ -2354,7 +2367,7 @@ void CL_Netchan_Transmit( msg_t *msg )
 	// do not enable client compression until I fix the compression+fragmentation rare case bug
 	if( ( cl_compresspackets->integer && msg->cursize > 60 ) || cl_compresspackets->integer > 1 )
 	{
-		zerror = Netchan_CompressMessage( msg );
+		zerror = Netchan_CompressMessage( &cls.netchan, msg );
 		if( zerror < 0 ) // it's compression error, just send uncompressed
 		{
 			Com_DPrintf( "CL_Netchan_Transmit (ignoring compression): Compression error %i\n", zerror );
@@ -964,12 +964,29 @@ static void CL_ParseFrame( msg_t *msg )
 				SNAP_BeginDemoRecording( cls.demo.file, 0x10000 + cl.servercount, cl.snapFrameTime, 
 					cl.servermessage, cls.reliable ? SV_BITFLAGS_RELIABLE : 0, cls.purelist, 
 					cl.configstrings[0], cl_baselines );
+				SNAP_SetDemoIndexConfigstrings( &cls.demo.index, cl.configstrings[0] );
 
 				// the rest of the demo file will be individual frames
 			}
 
 			if( !cls.demo.waiting )
+			{
 				cls.demo.duration = snap->serverTime - cls.demo.basetime;
+
+				// the message is written after parsing, so the current offset is where it's going to be
+				if( !snap->delta )
+				{
+					SNAP_AddDemoKeyframe( &cls.demo.index, snap->serverTime, FS_Tell( cls.demo.file ) );
+					CL_WriteDemoKeyframeConfigstrings();
+					cls.demo.keyframe_time = snap->serverTime;
+				}
+				else if( snap->serverTime >= cls.demo.keyframe_time + SNAP_DEMO_KEYFRAME_INTERVAL )
+				{
+					// ask for a keyframe now and then to make the demo seekable
+					CL_AddReliableCommand( "nodelta" );
+					cls.demo.keyframe_time = snap->serverTime;
+				}
+			}
 			cls.demo.time = cls.demo.duration;
 		}
 
@@ -1067,7 +1084,7 @@ static void CL_CvarInfoRequest_f( void )
 /*
 * CL_UpdateConfigString
 */
-static void CL_UpdateConfigString( int idx, const char *s )
+void CL_UpdateConfigString( int idx, const char *s )
 {
 	if( !s )
 		return;
@@ -1294,7 +1311,12 @@ void CL_ParseServerMessage( msg_t *msg )
 			break;
 
 		case svc_frame:
-			CL_ParseFrame( msg );
+			if( cls.demo.playing )
+				CL_SetDemoBaseConfigstrings();
+			if( cls.demo.play_seek_offset )
+				SNAP_SkipFrame( msg, NULL ); // seeking to a demo keyframe
+			else
+				CL_ParseFrame( msg );
 			break;
 
 		case svc_demoinfo:
@@ -390,6 +390,8 @@ static qboolean VID_LoadRefresh( const char *name )
 	import.Sys_Microseconds = &Sys_Microseconds;
 	import.Sys_Sleep = &Sys_Sleep;
 
+	import.COM_CPUFeatures = &COM_CPUFeatures;
+
 	import.Cvar_Get = &Cvar_Get;
 	import.Cvar_Set = &Cvar_Set;
 	import.Cvar_ForceSet = &Cvar_ForceSet;
@@ -456,6 +458,11 @@ static qboolean VID_LoadRefresh( const char *name )
 	import.BufQueue_EnqueueCmd = Sys_BufQueue_EnqueueCmd;
 	import.BufQueue_ReadCmds = Sys_BufQueue_ReadCmds;
 
+	import.ThreadPool_Create = QThreadPool_Create;
+	import.ThreadPool_Destroy = QThreadPool_Destroy;
+	import.ThreadPool_NumThreads = QThreadPool_NumThreads;
+	import.ThreadPool_Run = QThreadPool_Run;
+
 	// load dynamic library
 	Com_Printf( "Loading refresh module %s... ", name );
 	funcs[0].name = "GetRefAPI";
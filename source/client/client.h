@@ -184,6 +184,10 @@ typedef struct
 
 	qboolean play_jump;
 	qboolean play_ignore_next_frametime;
+	unsigned int play_seek_offset;	// skip decoding snapshots until reaching this keyframe
+
+	snapDemoIndex_t index;			// keyframes for seeking, recorded or loaded
+	unsigned int keyframe_time;		// serverTime of the last keyframe or nodelta request when recording
 
 	qboolean avi;
 	qboolean avi_video, avi_audio;
@@ -247,6 +251,7 @@ typedef struct
 	netchan_t netchan;
 
 	int challenge;              // from the server to use for connecting
+	qboolean dictCompression;   // the server has the same compression dictionary
 
 	download_t download;
 
@@ -517,6 +522,8 @@ void CL_Stop_f( void );
 void CL_Record_f( void );
 void CL_PauseDemo_f( void );
 void CL_DemoJump_f( void );
+void CL_WriteDemoKeyframeConfigstrings( void );
+void CL_SetDemoBaseConfigstrings( void );
 void CL_BeginDemoAviDump( void );
 size_t CL_ReadDemoMetaData( const char *demopath, char *meta_data, size_t meta_data_size );
 char **CL_DemoComplete( const char *partial );
@@ -527,6 +534,7 @@ char **CL_DemoComplete( const char *partial );
 // cl_parse.c
 //
 void CL_ParseServerMessage( msg_t *msg );
+void CL_UpdateConfigString( int idx, const char *s );
 #define SHOWNET(msg,s) _SHOWNET(msg,s,cl_shownet->integer);
 
 void CL_FreeDownloadList( void );
@@ -77,7 +77,7 @@ void GT_asCallSpawn( void )
 	if( error < 0 ) 
 		return;
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -97,7 +97,7 @@ void GT_asCallMatchStateStarted( void )
 	if( error < 0 ) 
 		return;
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -121,7 +121,7 @@ bool GT_asCallMatchStateFinished( int incomingMatchState )
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgDWord( 0, incomingMatchState );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 
@@ -146,7 +146,7 @@ void GT_asCallThinkRules( void )
 	if( error < 0 ) 
 		return;
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -171,7 +171,7 @@ void GT_asCallPlayerRespawn( edict_t *ent, int old_team, int new_team )
 	ctx->SetArgDWord( 1, old_team );
 	ctx->SetArgDWord( 2, new_team );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -206,7 +206,7 @@ void GT_asCallScoreEvent( gclient_t *client, const char *score_event, const char
 	ctx->SetArgObject( 1, s1 );
 	ctx->SetArgObject( 2, s2 );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 
@@ -235,7 +235,7 @@ char *GT_asCallScoreboardMessage( unsigned int maxlen )
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgDWord( 0, maxlen );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 
@@ -267,7 +267,7 @@ edict_t *GT_asCallSelectSpawnPoint( edict_t *ent )
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 
@@ -307,7 +307,7 @@ bool GT_asCallGameCommand( gclient_t *client, const char *cmd, const char *args,
 	ctx->SetArgObject( 2, s2 );
 	ctx->SetArgDWord( 3, argc );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 
@@ -336,7 +336,7 @@ bool GT_asCallBotStatus( edict_t *ent )
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 
@@ -359,7 +359,7 @@ void GT_asCallShutdown( void )
 	if( error < 0 ) 
 		return;
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -504,7 +504,7 @@ static bool G_asInitializeGametypeScript( asIScriptModule *asModule )
 	if( error < 0 ) 
 		return false;
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		return false;
 
@@ -45,6 +45,7 @@ extern angelwrap_api_t *angelExport;
 #define GAME_AS_ENGINE()					(static_cast<asIScriptEngine *>(game.asEngine))
 
 asIScriptModule *G_LoadGameScript( const char *moduleName, const char *dir, const char *filename, const char *ext );
+int G_ExecuteContext( asIScriptContext *ctx );
 bool G_ExecutionErrorReport( int error );
 
 extern bool inMapFuncCall; // FIXME: this is a nasty hack used to avoid breaking the angelwrap API
@@ -88,7 +88,7 @@ static void G_asCallMapFunction( void *func )
 	if( error < 0 ) 
 		return;
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		G_asShutdownMapScript();
 }
@@ -1352,6 +1352,7 @@ static const asClassDescriptor_t asTeamListClassDescriptor =
 static void objectScoreStats_Clear( score_stats_t *obj ) 
 {
 	memset( obj, 0, sizeof( *obj ) );
+	G_ScoreboardChanged();
 }
 
 static int objectScoreStats_AccShots( int ammo, score_stats_t *obj ) 
@@ -1397,16 +1398,19 @@ static int objectScoreStats_AccDamage( int ammo, score_stats_t *obj )
 static void objectScoreStats_ScoreSet( int newscore, score_stats_t *obj ) 
 {
 	obj->score = newscore;
+	G_ScoreboardChanged();
 }
 
 static void objectScoreStats_ScoreAdd( int score, score_stats_t *obj ) 
 {
 	obj->score += score;
+	G_ScoreboardChanged();
 }
 
 static void objectScoreStats_RoundAdd( score_stats_t *obj )
 {
 	obj->numrounds++;
+	G_ScoreboardChanged();
 }
 
 static const asFuncdef_t scorestats_Funcdefs[] =
@@ -1951,6 +1955,21 @@ static void objectGameClient_SetRaceTime( int sector, unsigned int time, gclient
 	G_SetRaceTime( &game.edicts[ playerNum + 1 ], sector, time );
 }
 
+static bool objectGameClient_DumpReplay( asstring_t *filename, unsigned int duration, gclient_t *self )
+{
+	int playerNum;
+
+	playerNum = (int)( self - game.clients );
+	assert( playerNum >= 0 && playerNum < gs.maxclients );
+
+	if( playerNum < 0 || playerNum >= gs.maxclients )
+		return false;
+	if( !filename || !filename->buffer )
+		return false;
+
+	return trap_DumpReplay( playerNum, filename->buffer, duration ) == qtrue;
+}
+
 static rs_authplayer_t *objectGameClient_getAuth( gclient_t *self )
 {
 	int playerNum;
@@ -2014,6 +2033,7 @@ static const asMethod_t gameclient_Methods[] =
 	{ ASLIB_FUNCTION_DECL(bool, get_chaseActive, () const ), asFUNCTION(objectGameClient_GetChaseActive), asCALL_CDECL_OBJLAST },
 	{ ASLIB_FUNCTION_DECL(void, newRaceRun, ( int numSectors )), asFUNCTION(objectGameClient_NewRaceRun), asCALL_CDECL_OBJLAST },
 	{ ASLIB_FUNCTION_DECL(void, setRaceTime, ( int sector, uint time )), asFUNCTION(objectGameClient_SetRaceTime), asCALL_CDECL_OBJLAST },
+	{ ASLIB_FUNCTION_DECL(bool, dumpReplay, ( const String &in filename, uint duration )), asFUNCTION(objectGameClient_DumpReplay), asCALL_CDECL_OBJLAST },
 	{ ASLIB_FUNCTION_DECL(RS_PlayerAuth @, getAuth, ()), asFUNCTION(objectGameClient_getAuth), asCALL_CDECL_OBJLAST }, // racesow
 
 	ASLIB_METHOD_NULL
@@ -2841,6 +2861,11 @@ static void asFunc_G_Match_FreeBodyQueue( void )
 	G_Match_FreeBodyQueue();
 }
 
+static void asFunc_G_ScoreboardChanged( void )
+{
+	G_ScoreboardChanged();
+}
+
 static void asFunc_G_Items_RespawnByType( unsigned int typeMask, int item_tag, float delay )
 {
 	G_Items_RespawnByType( typeMask, item_tag, delay );
@@ -3408,6 +3433,7 @@ static const asglobfuncs_t asGlobFuncs[] =
 	{ "void G_RemoveProjectiles( Entity @ )", asFUNCTION(asFunc_RS_removeProjectiles), NULL }, // racesow
 	{ "void G_RemoveDeadBodies()", asFUNCTION(asFunc_G_Match_FreeBodyQueue), NULL },
 	{ "void G_Items_RespawnByType( uint typeMask, int item_tag, float delay )", asFUNCTION(asFunc_G_Items_RespawnByType), NULL },
+	{ "void G_ScoreboardChanged()", asFUNCTION(asFunc_G_ScoreboardChanged), NULL },
 
 	// misc
 	{ "void G_Print( const String &in )", asFUNCTION(asFunc_Print), NULL },
@@ -3605,7 +3631,7 @@ bool G_asCallMapEntitySpawnScript( const char *classname, edict_t *ent )
 	// Now we need to pass the parameters to the script function.
 	asContext->SetArgObject( 0, ent );
 
-	error = asContext->Execute();
+	error = G_ExecuteContext( asContext );
 	if( G_ExecutionErrorReport( error ) )
 	{
 		GT_asShutdownScript();
@@ -3694,7 +3720,7 @@ void G_asCallMapEntityThink( edict_t *ent )
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -3730,7 +3756,7 @@ void G_asCallMapEntityTouch( edict_t *ent, edict_t *other, cplane_t *plane, int
 	ctx->SetArgObject( 2, &normal );
 	ctx->SetArgDWord( 3, surfFlags );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -3755,7 +3781,7 @@ void G_asCallMapEntityUse( edict_t *ent, edict_t *other, edict_t *activator )
 	ctx->SetArgObject( 1, other );
 	ctx->SetArgObject( 2, activator );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -3781,7 +3807,7 @@ void G_asCallMapEntityPain( edict_t *ent, edict_t *other, float kick, float dama
 	ctx->SetArgFloat( 2, kick );
 	ctx->SetArgFloat( 3, damage );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -3806,7 +3832,7 @@ void G_asCallMapEntityDie( edict_t *ent, edict_t *inflicter, edict_t *attacker,
 	ctx->SetArgObject( 1, inflicter );
 	ctx->SetArgObject( 2, attacker );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
@@ -3829,13 +3855,28 @@ void G_asCallMapEntityStop( edict_t *ent )
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = G_ExecuteContext( ctx );
 	if( G_ExecutionErrorReport( error ) )
 		GT_asShutdownScript();
 }
 
 // ======================================================================================
 
+/*
+* G_ExecuteContext
+* Runs a prepared script context inside a profiler zone
+*/
+int G_ExecuteContext( asIScriptContext *ctx )
+{
+	int error;
+
+	trap_Prof_Enter( "angelscript" );
+	error = ctx->Execute();
+	trap_Prof_Leave();
+
+	return error;
+}
+
 /*
 * G_ExecutionErrorReport
 */
@@ -359,6 +359,15 @@ static void Cmd_Score_f( edict_t *ent )
 	ent->r.client->level.showscores = newvalue;
 }
 
+/*
+* Cmd_ScoreboardFull_f - The client lost track of the scoreboard deltas
+*/
+static void Cmd_ScoreboardFull_f( edict_t *ent )
+{
+	ent->r.client->level.scoreboard_sent[0] = 0;
+	ent->r.client->level.scoreboard_time = 0;
+}
+
 /*
 * Cmd_CvarInfo_f - Contains a cvar name and string provided by the client
 */
@@ -1293,6 +1302,7 @@ void G_InitGameCommands( void )
 	G_AddCommand( "say", Cmd_SayCmd_f );
 	G_AddCommand( "say_team", Cmd_SayTeam_f );
 	G_AddCommand( "svscore", Cmd_Score_f );
+	G_AddCommand( "scbfull", Cmd_ScoreboardFull_f );
 	G_AddCommand( "god", Cmd_God_f );
 	G_AddCommand( "noclip", Cmd_Noclip_f );
 	G_AddCommand( "use", Cmd_Use_f );
@@ -360,6 +360,7 @@ void G_Teams_SetTeam( edict_t *ent, int team )
 
 	G_Match_CheckReadys();
 	G_UpdatePlayerMatchMsg( ent );
+	G_ScoreboardChanged();
 }
 
 enum
@@ -974,6 +975,7 @@ void G_Teams_LeaveChallengersQueue( edict_t *ent )
 		ent->r.client->queueTimeStamp = 0;
 		G_PrintMsg( ent, "%sYou left the challengers queue\n", S_COLOR_CYAN );
 		G_UpdatePlayerMatchMsg( ent );
+		G_ScoreboardChanged();
 	}
 }
 
@@ -1013,6 +1015,7 @@ void G_Teams_JoinChallengersQueue( edict_t *ent )
 
 		G_PrintMsg( ent, "%sYou entered the challengers queue in position %i\n", S_COLOR_CYAN, pos+1 );
 		G_UpdatePlayerMatchMsg( ent );
+		G_ScoreboardChanged();
 	}
 }
 
@@ -318,6 +318,8 @@ void G_Gametype_GENERIC_PlayerKilled( edict_t *targ, edict_t *attacker, edict_t
 			teamlist[attacker->s.team].stats.score++;
 	}
 
+	G_ScoreboardChanged();
+
 	// drop items
 	if( targ->r.client && !( G_PointContents( targ->s.origin ) & CONTENTS_NODROP ) )
 	{
@@ -774,6 +776,8 @@ void G_Match_LaunchState( int matchState )
 	GS_GamestatSetFlag( GAMESTAT_FLAG_MATCHEXTENDED, false );
 	GS_GamestatSetFlag( GAMESTAT_FLAG_WAITING, false );
 
+	G_ScoreboardChanged();
+
 	switch( matchState )
 	{
 	default:
@@ -1309,6 +1313,7 @@ void G_Match_Ready( edict_t *ent )
 	}
 
 	level.ready[PLAYERNUM( ent )] = true;
+	G_ScoreboardChanged();
 
 	G_PrintMsg( NULL, "%s%s is ready!\n", ent->r.client->netname, S_COLOR_WHITE );
 
@@ -1341,6 +1346,7 @@ void G_Match_NotReady( edict_t *ent )
 	}
 
 	level.ready[PLAYERNUM( ent )] = false;
+	G_ScoreboardChanged();
 
 	G_PrintMsg( NULL, "%s%s is no longer ready.\n", ent->r.client->netname, S_COLOR_WHITE );
 
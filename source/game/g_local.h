@@ -231,6 +231,7 @@ typedef struct
 	bool ready[MAX_CLIENTS];
 	bool forceStart;    // force starting the game, when warmup timelimit is up
 	bool forceExit;     // just exit, ignore extended time checks
+	bool scoreboardChanged;	// the scoreboard message has to be rebuilt
 
 	edict_t	*current_entity;    // entity running from G_RunFrame
 	edict_t	*spawning_entity;   // entity being spawned from G_InitLevel
@@ -912,12 +913,14 @@ void G_ClientDamageFeedback( edict_t *ent );
 //scoreboards string
 extern char scoreboardString[MAX_STRING_CHARS];
 extern const unsigned int scoreboardInterval;
+extern const unsigned int scoreboardFullInterval;
 #define SCOREBOARD_MSG_MAXSIZE ( MAX_STRING_CHARS-8 ) //I know, I know, doesn't make sense having a bigger string than the maxsize value
 
 void MoveClientToIntermission( edict_t *client );
 void G_SetClientStats( edict_t *ent );
 void G_Snap_UpdateWeaponListMessages( void );
 void G_ScoreboardMessage_AddSpectators( void );
+void G_ScoreboardChanged( void );
 void G_UpdateScoreBoardMessages( void );
 
 //
@@ -1123,6 +1126,8 @@ typedef struct
 	score_stats_t stats;
 	bool showscores;
 	unsigned int scoreboard_time;	// when scoreboard was last sent
+	char scoreboard_sent[MAX_STRING_CHARS];	// last scoreboard message sent, the base for deltas
+	unsigned int scoreboard_fulltime;	// when the full scoreboard was last sent
 	bool showPLinks;			// bot debug
 
 	// flood protection
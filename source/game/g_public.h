@@ -20,7 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 // g_public.h -- game dll information visible to server
 
-#define	GAME_API_VERSION    48
+#define	GAME_API_VERSION    50
 
 //===============================================================
 
@@ -97,6 +97,10 @@ typedef struct
 
 	unsigned int ( *Milliseconds )( void );
 
+	// profiler zones, opened and closed in pairs
+	void ( *Prof_Enter )( const char *name );
+	void ( *Prof_Leave )( void );
+
 	qboolean ( *inPVS )( const vec3_t p1, const vec3_t p2 );
 
 	int ( *CM_NumInlineModels )( void );
@@ -179,6 +183,7 @@ typedef struct
 	int ( *FakeClientConnect )( char *fakeUserinfo, char *fakeSocketType, const char *fakeIP );
 	void ( *DropClient )( struct edict_s *ent, int type, const char *message );
 	int ( *GetClientState )( int numClient );
+	qboolean ( *DumpReplay )( int numClient, const char *filename, unsigned int duration );
 	void ( *ExecuteClientThinks )( int clientNum );
 
 	// The edict array is allocated in the game dll so it
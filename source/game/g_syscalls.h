@@ -84,6 +84,16 @@ static inline unsigned int trap_Milliseconds( void )
 	return GAME_IMPORT.Milliseconds();
 }
 
+static inline void trap_Prof_Enter( const char *name )
+{
+	GAME_IMPORT.Prof_Enter( name );
+}
+
+static inline void trap_Prof_Leave( void )
+{
+	GAME_IMPORT.Prof_Leave();
+}
+
 static inline bool trap_inPVS( const vec3_t p1, const vec3_t p2 )
 {
 	return GAME_IMPORT.inPVS( p1, p2 ) == qtrue;
@@ -365,6 +375,11 @@ static inline int trap_GetClientState( int numClient )
 	return GAME_IMPORT.GetClientState( numClient );
 }
 
+static inline qboolean trap_DumpReplay( int numClient, const char *filename, unsigned int duration )
+{
+	return GAME_IMPORT.DumpReplay( numClient, filename, duration );
+}
+
 static inline void trap_ExecuteClientThinks( int clientNum )
 {
 	GAME_IMPORT.ExecuteClientThinks( clientNum );
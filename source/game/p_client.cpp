@@ -681,6 +681,7 @@ void ClientBegin( edict_t *ent )
 
 	// schedule the next scoreboard update
 	ent->r.client->level.scoreboard_time = game.realtime + scoreboardInterval - ( game.realtime%scoreboardInterval );
+	G_ScoreboardChanged();
 
 	AI_EnemyAdded( ent );
 
@@ -1318,6 +1319,7 @@ void ClientDisconnect( edict_t *ent, const char *reason )
 	GClip_UnlinkEntity( ent );
 
 	G_Match_CheckReadys();
+	G_ScoreboardChanged();
 }
 
 /*
@@ -1580,7 +1582,9 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 		pm.snapinitial = qtrue;
 
 	// perform a pmove
+	trap_Prof_Enter( "pmove" );
 	Pmove( &pm );
+	trap_Prof_Leave();
 
 	// save results of pmove
 	client->old_pmove = client->ps.pmove;
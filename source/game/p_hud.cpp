@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 char scoreboardString[MAX_STRING_CHARS];
 const unsigned int scoreboardInterval = 1000;
+const unsigned int scoreboardFullInterval = 10000;
 static const char *G_PlayerStatsMessage( edict_t *ent );
 
 //======================================================================
@@ -31,36 +32,127 @@ static const char *G_PlayerStatsMessage( edict_t *ent );
 //======================================================================
 
 /*
-* G_ClientUpdateScoreBoardMessage
+* G_ScoreboardChanged
 * 
-* Show the scoreboard messages if the scoreboards are active
+* Flags the scoreboard message for rebuilding. Gametypes call this whenever
+* something they show in the scoreboard changes.
 */
-void G_UpdateScoreBoardMessages( void )
+void G_ScoreboardChanged( void )
 {
-	static int nexttime = 0;
-	int i;
-	edict_t	*ent;
-	gclient_t *client;
-	const char *scoreBoardMessage = "";
-	bool forcedUpdate = false;
-	char string[MAX_STRING_CHARS];
+	level.scoreboardChanged = true;
+}
+
+/*
+* G_BuildScoreBoardMessage
+*/
+static void G_BuildScoreBoardMessage( void )
+{
+	const char *scoreBoardMessage;
 	size_t maxlen;
 
-	// fixme : mess of copying
-	maxlen = MAX_STRING_CHARS - ( strlen( "scb \"\"" + 4 ) );
+	// leave room for the command wrapping it
+	maxlen = MAX_STRING_CHARS - strlen( "scb \"\"" );
 
 	if( game.asEngine != NULL )
 		scoreBoardMessage = GT_asCallScoreboardMessage( maxlen );
 	else
 		scoreBoardMessage = G_Gametype_GENERIC_ScoreboardMessage();
 
+	if( !scoreBoardMessage )
+		scoreboardString[0] = 0;
+
 	G_ScoreboardMessage_AddSpectators();
 
-	Q_strncpyz( string, scoreBoardMessage ? scoreBoardMessage : "", maxlen );
-	Q_snprintfz( scoreboardString, sizeof( scoreboardString ), "scb \"%s\"", string );
-	scoreBoardMessage = scoreboardString;
+	scoreboardString[maxlen - 1] = 0;
+}
+
+/*
+* G_SendScoreBoardMessage
+* 
+* Sends the scoreboard as a delta against the last one the client received.
+* Reliable commands arrive in order, so that's also the one the client holds.
+* TV relays get the full message, the spectators they pass it to may not
+* have the base.
+*/
+static void G_SendScoreBoardMessage( edict_t *ent )
+{
+	gclient_t *client = ent->r.client;
+	char *sent = client->level.scoreboard_sent;
+	char delta[MAX_STRING_CHARS - 32];
+	char cmd[MAX_STRING_CHARS];
+
+	if( !strcmp( sent, scoreboardString ) )
+		return;
+
+	// send the full message from time to time so demos recorded midway catch up
+	if( sent[0] && !client->isTV && game.realtime < client->level.scoreboard_fulltime + scoreboardFullInterval
+		&& GS_WriteScoreboardDelta( sent, scoreboardString, delta, sizeof( delta ) )
+		&& strlen( delta ) < strlen( scoreboardString ) )
+	{
+		Q_snprintfz( cmd, sizeof( cmd ), "scbd %u \"%s\"", GS_ScoreboardChecksum( sent ), delta );
+	}
+	else
+	{
+		Q_snprintfz( cmd, sizeof( cmd ), "scb \"%s\"", scoreboardString );
+		client->level.scoreboard_fulltime = game.realtime;
+	}
+
+	trap_GameCmd( ent, cmd );
+	Q_strncpyz( sent, scoreboardString, sizeof( client->level.scoreboard_sent ) );
+}
+
+/*
+* G_UpdateScoreBoardMessages
+* 
+* Show the scoreboard messages if the scoreboards are active
+*/
+void G_UpdateScoreBoardMessages( void )
+{
+	static int nexttime = 0;
+	int i;
+	edict_t	*ent;
+	gclient_t *client;
+	bool forcedUpdate = false, viewers = false;
+
+	// every 10 seconds, send everyone the scoreboard
+	nexttime -= game.snapFrameTime;
+	if( nexttime <= 0 )
+	{
+		do
+		{
+			nexttime += 10000;
+		}
+		while( nexttime <= 0 );
+
+		forcedUpdate = true;
+	}
+
+	for( i = 0; i < gs.maxclients; i++ )
+	{
+		ent = game.edicts + 1 + i;
+		if( !ent->r.inuse || !ent->r.client )
+			continue;
+
+		client = ent->r.client;
+		if( game.realtime > client->level.scoreboard_time + scoreboardInterval
+			&& ( ( client->ps.stats[STAT_LAYOUTS] & STAT_LAYOUT_SCOREBOARD ) || client->isTV ) )
+		{
+			viewers = true;
+			break;
+		}
+	}
+
+	// only rebuild when the gametype flagged a change, or while someone is
+	// looking at it, since pings and script side state aren't tracked
+	if( level.scoreboardChanged || viewers )
+	{
+		G_BuildScoreBoardMessage();
+		level.scoreboardChanged = false;
+	}
+
+	if( !viewers && !forcedUpdate )
+		return;
 
-update:
 	// send to players who have scoreboard visible
 	for( i = 0; i < gs.maxclients; i++ )
 	{
@@ -73,30 +165,13 @@ update:
 		if( game.realtime <= client->level.scoreboard_time + scoreboardInterval )
 			continue;
 
-		if( forcedUpdate || ( client->ps.stats[STAT_LAYOUTS] & STAT_LAYOUT_SCOREBOARD ) )
+		if( forcedUpdate || ( client->ps.stats[STAT_LAYOUTS] & STAT_LAYOUT_SCOREBOARD ) || client->isTV )
 		{
 			client->level.scoreboard_time = game.realtime + scoreboardInterval - ( game.realtime%scoreboardInterval );
-			trap_GameCmd( ent, scoreBoardMessage );
+			G_SendScoreBoardMessage( ent );
 			trap_GameCmd( ent, G_PlayerStatsMessage( ent ) );
 		}
 	}
-
-	if( !forcedUpdate )
-	{
-		// every 10 seconds, send everyone the scoreboard
-		nexttime -= game.snapFrameTime;
-		if( nexttime > 0 )
-			return;
-
-		do
-		{
-			nexttime += 10000;
-		}
-		while( nexttime <= 0 );
-
-		forcedUpdate = true;
-		goto update;
-	}
 }
 
 /*
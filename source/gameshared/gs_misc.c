@@ -352,3 +352,196 @@ const char *GS_MatchMessageString( matchmessage_t mm )
 
 	return "";
 }
+
+//==================================================
+// SCOREBOARD DELTAS
+//==================================================
+
+// the scoreboard message is a sequence of rows, each starting with a '&' token
+// deltas are a run of operations against the rows of the previous message:
+// "@<row>[,<count>]" copies rows from the old message and "=<len>:<text>" adds new text
+#define GS_SCOREBOARD_MAX_ROWS	256
+
+/*
+* GS_ScoreboardRows
+*/
+static int GS_ScoreboardRows( const char *s, const char **rows, int *lens )
+{
+	int numrows;
+	const char *p;
+
+	if( !*s )
+		return 0;
+
+	numrows = 0;
+	rows[0] = s;
+	for( p = s + 1; *p; p++ )
+	{
+		if( *p != '&' || (unsigned char)p[-1] > ' ' )
+			continue;
+		if( numrows + 1 == GS_SCOREBOARD_MAX_ROWS )
+			return -1;
+		lens[numrows] = p - rows[numrows];
+		rows[++numrows] = p;
+	}
+	lens[numrows] = p - rows[numrows];
+
+	return numrows + 1;
+}
+
+/*
+* GS_ScoreboardChecksum
+*
+* Identifies the scoreboard message a delta was built against
+*/
+unsigned int GS_ScoreboardChecksum( const char *s )
+{
+	unsigned int hash = 2166136261u;
+
+	while( *s )
+		hash = ( hash ^ (unsigned char)*s++ ) * 16777619u;
+	return hash;
+}
+
+/*
+* GS_WriteScoreboardDelta
+*
+* Returns qfalse when the delta doesn't fit, in which case the full message should be sent
+*/
+qboolean GS_WriteScoreboardDelta( const char *from, const char *to, char *delta, size_t size )
+{
+	const char *oldrows[GS_SCOREBOARD_MAX_ROWS], *newrows[GS_SCOREBOARD_MAX_ROWS];
+	int oldlens[GS_SCOREBOARD_MAX_ROWS], newlens[GS_SCOREBOARD_MAX_ROWS];
+	int numold, numnew;
+	int i, j, runstart, runlen, litstart, litlen;
+	size_t len, l;
+
+	numold = GS_ScoreboardRows( from, oldrows, oldlens );
+	numnew = GS_ScoreboardRows( to, newrows, newlens );
+	if( numold < 0 || numnew < 0 || !size )
+		return qfalse;
+
+	len = 0;
+	runstart = runlen = 0;
+	litstart = litlen = 0;
+	for( i = 0; i <= numnew; i++ )
+	{
+		j = numold;
+		if( i < numnew )
+		{
+			// rows usually keep their place, so check the one following the last match first
+			j = runstart + runlen;
+			if( j >= numold || oldlens[j] != newlens[i] || memcmp( oldrows[j], newrows[i], newlens[i] ) )
+			{
+				for( j = 0; j < numold; j++ )
+				{
+					if( oldlens[j] == newlens[i] && !memcmp( oldrows[j], newrows[i], newlens[i] ) )
+						break;
+				}
+			}
+		}
+
+		if( runlen && j == runstart + runlen && j < numold )
+		{
+			runlen++;
+			continue;
+		}
+
+		// flush the pending copy
+		if( runlen )
+		{
+			if( runlen == 1 )
+				l = Q_snprintfz( delta + len, size - len, "@%i", runstart );
+			else
+				l = Q_snprintfz( delta + len, size - len, "@%i,%i", runstart, runlen );
+			if( len + l >= size - 1 )
+				return qfalse;
+			len += l;
+			runlen = 0;
+		}
+
+		if( i < numnew && j == numold )
+		{
+			// new rows are contiguous in the message, so they go out as a single string
+			if( !litlen )
+				litstart = i;
+			litlen += newlens[i];
+			continue;
+		}
+
+		// flush the pending text
+		if( litlen )
+		{
+			l = Q_snprintfz( delta + len, size - len, "=%i:", litlen );
+			if( len + l + litlen >= size - 1 )
+				return qfalse;
+			len += l;
+			memcpy( delta + len, newrows[litstart], litlen );
+			len += litlen;
+			litlen = 0;
+		}
+
+		runstart = j;
+		runlen = 1;
+	}
+
+	delta[len] = '\0';
+	return qtrue;
+}
+
+/*
+* GS_ApplyScoreboardDelta
+*/
+qboolean GS_ApplyScoreboardDelta( const char *from, const char *delta, char *to, size_t size )
+{
+	const char *oldrows[GS_SCOREBOARD_MAX_ROWS];
+	int oldlens[GS_SCOREBOARD_MAX_ROWS];
+	int numold, row, count, l;
+	size_t len;
+	char *end;
+
+	numold = GS_ScoreboardRows( from, oldrows, oldlens );
+	if( numold < 0 || !size )
+		return qfalse;
+
+	len = 0;
+	while( *delta )
+	{
+		if( *delta == '@' )
+		{
+			row = strtol( delta + 1, &end, 10 );
+			count = 1;
+			if( *end == ',' )
+				count = strtol( end + 1, &end, 10 );
+			delta = end;
+
+			if( row < 0 || count < 1 || row + count > numold )
+				return qfalse;
+
+			for( ; count > 0; count--, row++ )
+			{
+				if( len + oldlens[row] >= size )
+					return qfalse;
+				memcpy( to + len, oldrows[row], oldlens[row] );
+				len += oldlens[row];
+			}
+		}
+		else if( *delta == '=' )
+		{
+			l = strtol( delta + 1, &end, 10 );
+			if( *end != ':' || l < 0 || (int)strlen( end + 1 ) < l || len + l >= size )
+				return qfalse;
+
+			memcpy( to + len, end + 1, l );
+			len += l;
+			delta = end + 1 + l;
+		}
+		else
+		{
+			return qfalse;
+		}
+	}
+
+	to[len] = '\0';
+	return qtrue;
+}
@@ -647,6 +647,9 @@ int GS_WaterLevel( entity_state_t *state, vec3_t mins, vec3_t maxs );
 void GS_BBoxForEntityState( entity_state_t *state, vec3_t mins, vec3_t maxs );
 float GS_FrameForTime( int *frame, unsigned int curTime, unsigned int startTimeStamp, float frametime, int firstframe, int lastframe, int loopingframes, qboolean forceLoop );
 const char *GS_MatchMessageString( matchmessage_t mm );
+unsigned int GS_ScoreboardChecksum( const char *s );
+qboolean GS_WriteScoreboardDelta( const char *from, const char *to, char *delta, size_t size );
+qboolean GS_ApplyScoreboardDelta( const char *from, const char *delta, char *to, size_t size );
 
 //===============================================================
 
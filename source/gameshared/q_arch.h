@@ -382,14 +382,17 @@ typedef int socket_handle_t;
 #define ATTRIBUTE_ALIGNED( x ) __attribute__( ( aligned( x ) ) )
 #define ATTRIBUTE_NOINLINE     __attribute__((noinline))
 #define ATTRIBUTE_NAKED
+#define ATTRIBUTE_TLS          __thread
 #elif defined ( _MSC_VER )
 #define ATTRIBUTE_ALIGNED( x ) __declspec( align( x ) )
 #define ATTRIBUTE_NOINLINE
 #define ATTRIBUTE_NAKED        __declspec( naked )
+#define ATTRIBUTE_TLS          __declspec( thread )
 #else
 #define ATTRIBUTE_ALIGNED( x )
 #define ATTRIBUTE_NOINLINE
 #define ATTRIBUTE_NAKED
+#define ATTRIBUTE_TLS
 #endif
 
 #ifdef HAVE___STRTOI64
@@ -403,6 +406,16 @@ typedef int socket_handle_t;
 #define STR_TO_POINTER(str) (void *)strtol(str,NULL,0)
 #endif
 
+// CPU features, as returned by COM_CPUFeatures
+#define QCPU_HAS_RDTSC		0x00000001
+#define QCPU_HAS_MMX		0x00000002
+#define QCPU_HAS_MMXEXT		0x00000004
+#define QCPU_HAS_3DNOW		0x00000010
+#define QCPU_HAS_3DNOWEXT	0x00000020
+#define QCPU_HAS_SSE		0x00000040
+#define QCPU_HAS_SSE2		0x00000080
+#define QCPU_HAS_AVX2		0x00000100
+
 // Generic helper definitions for shared library support
 #if defined _WIN32 || defined __CYGWIN__
 # define QF_DLL_IMPORT __declspec(dllimport)
@@ -61,6 +61,8 @@ mempool_t *sq_mempool = NULL;
 int sq_refcount = 0;	// Refcount Init/Shutdown if server and client exists on same process
 
 void StatQuery_DestroyQuery( stat_query_t *query );
+void *SQ_JSON_Alloc( size_t size );
+void SQ_JSON_Free( void *ptr );
 
 //===============================================
 
@@ -364,6 +366,39 @@ void StatQuery_SetCallback( stat_query_t *query, void (*callback_fn)( stat_query
 	query->customp = customp;
 }
 
+static void *SQ_JSON_FrameAlloc( size_t size )
+{
+	return Mem_FrameAllocExt( size, 0 );
+}
+
+static void SQ_JSON_FrameFree( void *ptr )
+{
+}
+
+/*
+* SQ_JSON_PrintFrame
+* 
+* Prints the JSON tree to the frame arena, the intermediate strings cJSON
+* builds while printing are released along with the result.
+*/
+static char *SQ_JSON_PrintFrame( cJSON *json )
+{
+	char *text;
+	cJSON_Hooks hooks;
+
+	hooks.malloc_fn = SQ_JSON_FrameAlloc;
+	hooks.free_fn = SQ_JSON_FrameFree;
+	cJSON_InitHooks( &hooks );
+
+	text = cJSON_Print( json );
+
+	hooks.malloc_fn = SQ_JSON_Alloc;
+	hooks.free_fn = SQ_JSON_Free;
+	cJSON_InitHooks( &hooks );
+
+	return text;
+}
+
 void StatQuery_Prepare( stat_query_t *query )
 {
 	if( !query->req && query->url )
@@ -375,7 +410,7 @@ void StatQuery_Prepare( stat_query_t *query )
 	else if( query->has_json )
 	{
 		const char *json_text;
-		size_t jsonSize, b64Size;
+		size_t jsonSize, b64Size, mark;
 		unsigned long compSize;
 		void *compData, *b64Data;
 		int z_result;
@@ -386,40 +421,37 @@ void StatQuery_Prepare( stat_query_t *query )
 			return;
 		}
 
-		json_text = cJSON_Print( query->json_out );
+		mark = Mem_FrameMark();
+
+		json_text = SQ_JSON_PrintFrame( query->json_out );
 		jsonSize = strlen( json_text );
 
 		// compress
 		compSize = (jsonSize * 1.1) + 12;
-		compData = SQALLOC( compSize );
-		if( compData == NULL )
-		{
-			Com_Printf("StatQuery: Failed to allocate space for compressed JSON\n");
-			return;
-		}
+		compData = Mem_FrameAllocExt( compSize, 0 );
 		z_result = compress( compData, &compSize, (unsigned char*)json_text, jsonSize );
 		if( z_result != Z_OK )
 		{
 			Com_Printf("StatQuery: Failed to compress JSON\n");
-			SQFREE( compData );
+			Mem_FrameRelease( mark );
 			return;
 		}
 
 		// base64
 		b64Data = base64_encode( compData, compSize, &b64Size );
+
+		// we dont need the text and the compressed data anymore
+		Mem_FrameRelease( mark );
+		compData = NULL;
+
 		if( b64Data == NULL )
 		{
 			Com_Printf("StatQuery: Failed to base64_encode JSON\n");
-			SQFREE( compData );
 			return;
 		}
 
 		// Com_Printf("Match report size: %u, compressed: %u, base64'd: %u\n", reportSize, compSize, b64Size );
 
-		// we dont need this anymore
-		SQFREE( compData );
-		compData = NULL;
-
 		// set the json field to POST request
 		wswcurl_formadd_raw( query->req, "data", b64Data, b64Size );
 
@@ -24,16 +24,52 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <assert.h>
 #include <string.h>
 
-/* Trie structure definitions */
+/* Trie structure definitions
+ *
+ * This is a radix tree: every node holds the whole run of letters leading
+ * to it from its parent, so chains of single-child nodes are collapsed.
+ * Children are kept in a sorted array of edges keyed by their first letter
+ * (lowercased for case-insensitive tries). Nodes and labels are carved out
+ * of per-trie arenas, which are released in one go by Trie_Clear and
+ * Trie_Destroy. Removed nodes are recycled, and the label arena is compacted
+ * once removals have left more than half of it unused.
+ */
+
+#define TRIE_MIN_BLOCK_SIZE		256		// arenas start small and double, many tries hold only a few keys
+#define TRIE_MAX_BLOCK_SIZE		4096
+#define TRIE_MIN_SLAB_NODES		8
+#define TRIE_MAX_SLAB_NODES		256
+#define TRIE_COMPACT_MIN_WASTE	4096
+
+struct trie_edge_s
+{
+	unsigned char letter;
+	struct trie_node_s *node;
+};
 
 struct trie_node_s
 {
-	int depth;
-	char letter;
-	struct trie_node_s *child;
-	struct trie_node_s *sibling;
+	const char *label;              // letters leading to this node, not terminated
+	unsigned int label_len;
+	unsigned int num_children;
+	unsigned int max_children;
 	int data_is_set;
 	void *data;
+	struct trie_edge_s *children;   // sorted by letter
+};
+
+struct trie_block_s
+{
+	struct trie_block_s *next;
+	size_t size;
+	size_t used;
+};
+
+struct trie_slab_s
+{
+	struct trie_slab_s *next;
+	unsigned int num_nodes;
+	struct trie_node_s nodes[1];
 };
 
 struct trie_s
@@ -41,70 +77,91 @@ struct trie_s
 	struct trie_node_s *root;
 	unsigned int size;
 	trie_casing_t casing;
-};
 
-typedef enum trie_remove_result_t
-{
-	TRIE_REMOVE_NO_CHILDREN_OR_DATA_LEFT = 0,
-	TRIE_REMOVE_CHILDREN_OR_DATA_LEFT = 1,
-	TRIE_REMOVE_DATA_LEFT,
-	TRIE_REMOVE_KEY_NOT_FOUND
-} trie_remove_result_t;
+	struct trie_block_s *blocks;    // label arena
+	size_t label_bytes;
+	size_t label_waste;             // bytes of labels no longer referenced
+
+	struct trie_slab_s *slabs;      // node arena
+	unsigned int slab_used;         // nodes used in the head slab
+	struct trie_node_s *free_nodes; // recycled nodes, chained through data
+};
 
 /* Forward declarations of internal implementation */
 
-static struct trie_node_s *Trie_CreateNode(
-        int depth,
-        char letter,
-        struct trie_node_s *child,
-        struct trie_node_s *sibling,
-        int data_is_set,
-        void *data
+static void Trie_InitArena(
+        struct trie_s *trie
 );
 
-static void Trie_Destroy_Rec(
+static void Trie_FreeArena(
+        struct trie_s *trie
+);
+
+static struct trie_node_s *Trie_AllocNode(
+        struct trie_s *trie,
+        const char *label,
+        unsigned int label_len
+);
+
+static void Trie_FreeNode(
+        struct trie_s *trie,
         struct trie_node_s *node
 );
 
-static struct trie_node_s *TRIE_Find_Rec(
-        struct trie_node_s *node,
+static const char *Trie_AllocLabel(
+        struct trie_s *trie,
+        const char *letters,
+        size_t len
+);
+
+static inline struct trie_edge_s *Trie_FindEdge(
+        const struct trie_node_s *node,
+        unsigned char letter,
+        unsigned int *position
+);
+
+static struct trie_node_s *Trie_FindNode(
+        const struct trie_s *trie,
         const char *key,
-        trie_find_mode_t mode,
-        trie_casing_t casing,
-        int ( *predicate )( void *value, void *cookie ),
-        void *cookie
+        trie_find_mode_t mode
 );
 
-static int Trie_Insert_Rec(
-        struct trie_node_s *node,
+static int Trie_InsertNode(
+        struct trie_s *trie,
         const char *key,
-        trie_casing_t casing,
         void *data
 );
 
-static trie_remove_result_t Trie_Remove_Rec(
-        struct trie_node_s *node,
+static int Trie_RemoveNode(
+        struct trie_s *trie,
         const char *key,
-        trie_casing_t casing,
         void **data
 );
 
+static void Trie_Compact(
+        struct trie_s *trie
+);
+
 static unsigned int Trie_NoOfKeys(
         const struct trie_node_s *node,
-        trie_casing_t casing,
         int ( *predicate )( void *value, void *cookie ),
-        void *cookie,
-        int addSiblings
+        void *cookie
+);
+
+static const struct trie_node_s *Trie_FirstKey(
+        const struct trie_node_s *node,
+        int ( *predicate )( void *value, void *cookie ),
+        void *cookie
 );
 
 static void Trie_Dump_Rec(
         const struct trie_node_s *node,
         trie_dump_what_t what,
-        trie_casing_t casing,
         int ( *predicate )( void *value, void *cookie ),
         void *cookie,
-        int dumpSiblings,
-        const char *key_prev,
+        char **key_buffer,
+        size_t *key_buffer_size,
+        size_t key_len,
         struct trie_key_value_s **key_value_vector
 );
 
@@ -113,9 +170,8 @@ static int Trie_AlwaysTrue(
         void *
 );
 
-static inline int Trie_LetterCompare(
-        char left,
-        char right,
+static inline unsigned char Trie_Letter(
+        char letter,
         trie_casing_t casing
 );
 
@@ -129,9 +185,8 @@ trie_error_t Trie_Create(
 	if( trie )
 	{
 		*trie = (struct trie_s *) malloc( sizeof( struct trie_s ) );
-		( *trie )->root = Trie_CreateNode( 0, '\0', NULL, NULL, 0, NULL );
-		( *trie )->size = 0;
 		( *trie )->casing = casing;
+		Trie_InitArena( *trie );
 		return TRIE_OK;
 	}
 	else
@@ -144,7 +199,7 @@ trie_error_t Trie_Destroy(
 {
 	if( trie )
 	{
-		Trie_Destroy_Rec( trie->root );
+		Trie_FreeArena( trie );
 		free( trie );
 		return TRIE_OK;
 	}
@@ -158,9 +213,8 @@ trie_error_t Trie_Clear(
 {
 	if( trie )
 	{
-		Trie_Destroy_Rec( trie->root );
-		trie->root = Trie_CreateNode( 0, '\0', NULL, NULL, 0, NULL );
-		trie->size = 0;
+		Trie_FreeArena( trie );
+		Trie_InitArena( trie );
 		return TRIE_OK;
 	}
 	else
@@ -189,7 +243,7 @@ trie_error_t Trie_Insert(
 {
 	if( trie && key )
 	{
-		if( !Trie_Insert_Rec( trie->root, key, trie->casing, data ) )
+		if( !Trie_InsertNode( trie, key, data ) )
 		{
 			// insertion successful
 			++trie->size;
@@ -215,10 +269,12 @@ trie_error_t Trie_Remove(
 {
 	if( trie && key && data )
 	{
-		if( Trie_Remove_Rec( trie->root, key, trie->casing, data ) != TRIE_REMOVE_KEY_NOT_FOUND )
+		if( !Trie_RemoveNode( trie, key, data ) )
 		{
 			// removal successful
 			--trie->size;
+			if( trie->label_waste > TRIE_COMPACT_MIN_WASTE && trie->label_waste > trie->label_bytes / 2 )
+				Trie_Compact( trie );
 			return TRIE_OK;
 		}
 		else
@@ -237,7 +293,7 @@ trie_error_t Trie_Replace(
 {
 	if( trie && key )
 	{
-		struct trie_node_s *result = TRIE_Find_Rec( trie->root, key, TRIE_EXACT_MATCH, trie->casing, Trie_AlwaysTrue, NULL );
+		struct trie_node_s *result = Trie_FindNode( trie, key, TRIE_EXACT_MATCH );
 		if( result )
 		{
 			// key found, replace data pointer
@@ -271,26 +327,18 @@ trie_error_t Trie_FindIf(
         void **data
 )
 {
-	if( trie && key && data )
+	if( trie && key && data && predicate )
 	{
-		const struct trie_node_s *result = TRIE_Find_Rec( trie->root, key, mode, trie->casing, predicate, cookie );
+		const struct trie_node_s *result = Trie_FindNode( trie, key, mode );
+		if( result )
+		{
+			// in prefix mode, take the first key in order below the node
+			result = mode == TRIE_EXACT_MATCH
+			         ? ( predicate( result->data, cookie ) ? result : NULL )
+				 : Trie_FirstKey( result, predicate, cookie );
+		}
 		if( result )
 		{
-			while( result->child && !result->data_is_set )
-			{
-				const struct trie_node_s *sibling;
-				for( sibling = result; sibling->sibling && !sibling->data_is_set; sibling = sibling->sibling )
-					/* search for sibling with data */;
-				if( sibling->data_is_set )
-				{
-					// sibling found, make it the result
-					result = sibling;
-					break;
-				}
-				// descend
-				result = result->child;
-			}
-			assert( result->data_is_set );
 			*data = result->data;
 			return TRIE_OK;
 		}
@@ -321,11 +369,11 @@ trie_error_t Trie_NoOfMatchesIf(
         unsigned int *matches
 )
 {
-	if( trie && prefix && matches )
+	if( trie && prefix && matches && predicate )
 	{
-		struct trie_node_s *node = TRIE_Find_Rec( trie->root, prefix, TRIE_PREFIX_MATCH, trie->casing, predicate, cookie );
+		struct trie_node_s *node = Trie_FindNode( trie, prefix, TRIE_PREFIX_MATCH );
 		*matches = node
-		           ? Trie_NoOfKeys( node, trie->casing, predicate, cookie, 0 )
+		           ? Trie_NoOfKeys( node, predicate, cookie )
 			   : 0;
 		return TRIE_OK;
 	}
@@ -352,18 +400,48 @@ trie_error_t Trie_DumpIf(
         struct trie_dump_s **dump
 )
 {
-	if( prefix && dump && predicate )
+	if( trie && prefix && dump && predicate )
 	{
-		struct trie_node_s *result = TRIE_Find_Rec( trie->root, prefix, TRIE_PREFIX_MATCH, trie->casing, predicate, cookie );
+		struct trie_node_s *result = Trie_FindNode( trie, prefix, TRIE_PREFIX_MATCH );
 		*dump = (struct trie_dump_s *) malloc( sizeof( struct trie_dump_s ) );
+		( *dump )->what = what;
 		// prefix matches some nodes, begin dump
 		if( result )
 		{
-			( *dump )->size = Trie_NoOfKeys( result, trie->casing, predicate, cookie, 0 );
-			( *dump )->what = what;
+			struct trie_key_value_s *key_value_vector;
+			char *key_buffer = NULL;
+			size_t key_buffer_size = 0, key_len = 0;
+
+			if( what & TRIE_DUMP_KEYS )
+			{
+				// keys are rebuilt from the labels, the prefix may end halfway through one
+				const struct trie_node_s *node = trie->root;
+				const char *p = prefix;
+
+				key_buffer_size = 256;
+				key_buffer = (char *) malloc( key_buffer_size );
+				while( node != result )
+				{
+					node = Trie_FindEdge( node, Trie_Letter( *p, trie->casing ), NULL )->node;
+					while( key_len + node->label_len + 1 > key_buffer_size )
+					{
+						key_buffer_size *= 2;
+						key_buffer = (char *) realloc( key_buffer, key_buffer_size );
+					}
+					memcpy( key_buffer + key_len, node->label, node->label_len );
+					key_len += node->label_len;
+					p += node->label_len;
+				}
+				// the result's own label is appended by the dump
+				key_len -= result->label_len;
+			}
+
+			( *dump )->size = Trie_NoOfKeys( result, predicate, cookie );
 			( *dump )->key_value_vector = (struct trie_key_value_s *) malloc( sizeof( struct trie_key_value_s ) *( ( *dump )->size + 1 ) );
-			Trie_Dump_Rec( result, what, trie->casing, predicate, cookie, 0, prefix, &( *dump )->key_value_vector );
-			( *dump )->key_value_vector -= ( *dump )->size;
+			key_value_vector = ( *dump )->key_value_vector;
+			Trie_Dump_Rec( result, what, predicate, cookie, &key_buffer, &key_buffer_size, key_len, &key_value_vector );
+			assert( key_value_vector == ( *dump )->key_value_vector + ( *dump )->size );
+			free( key_buffer );
 		}
 		else
 		{
@@ -394,225 +472,407 @@ trie_error_t Trie_FreeDump(
 
 /* Internal implementations */
 
-static struct trie_node_s *Trie_CreateNode(
-        int depth,
-        char letter,
-        struct trie_node_s *child,
-        struct trie_node_s *sibling,
-        int data_is_set,
-        void *data
+static void Trie_InitArena(
+        struct trie_s *trie
 )
 {
-	struct trie_node_s *result = (struct trie_node_s *) malloc( sizeof( struct trie_node_s ) );
-	assert( result );
-	result->depth = depth;
-	result->letter = letter;
-	result->child = child;
-	result->sibling = sibling;
-	result->data_is_set = data_is_set;
-	result->data = data;
-	return result;
+	trie->size = 0;
+	trie->blocks = NULL;
+	trie->label_bytes = 0;
+	trie->label_waste = 0;
+	trie->slabs = NULL;
+	trie->slab_used = 0;
+	trie->free_nodes = NULL;
+	trie->root = Trie_AllocNode( trie, "", 0 );
 }
 
-static void Trie_Destroy_Rec(
-        struct trie_node_s *node
+static void Trie_FreeArena(
+        struct trie_s *trie
 )
 {
-	assert( node );
-	if( node->sibling )
-		Trie_Destroy_Rec( node->sibling );
-	if( node->child )
-		Trie_Destroy_Rec( node->child );
-	free( node );
-}
+	struct trie_slab_s *slab, *next_slab;
+	struct trie_block_s *block, *next_block;
+	unsigned int i, used;
 
-static struct trie_node_s *TRIE_Find_Rec(
-        struct trie_node_s *node,
-        const char *key,
-        trie_find_mode_t mode,
-        trie_casing_t casing,
-        int ( *predicate )( void *value, void *cookie ),
-        void *cookie
-)
-{
-	assert( key );
-	assert( node );
-	if( !Trie_LetterCompare( *key, node->letter, casing ) )
+	// edge arrays are the only per-node allocations
+	for( slab = trie->slabs, used = trie->slab_used; slab; slab = next_slab )
 	{
-		// prefix matches
-		if( !*key || !*( key+1 ) )
-			// end of key reached, see if node contains data
-			if( mode == TRIE_PREFIX_MATCH || node->data_is_set )
-				// node contains data or prefix match only, key is valid
-				return node;
-			else
-				// no data supplied, key only matches prefix of some node in trie
-				return NULL;
-		else if( node->child )
-			// end of key not reached, continue with child
-			return TRIE_Find_Rec( node->child, key + 1, mode, casing, predicate, cookie );
-		else
-			// end of key not reached, but current node is a leaf
-			return NULL;
+		next_slab = slab->next;
+		if( slab != trie->slabs )
+			used = slab->num_nodes;
+		for( i = 0; i < used; i++ )
+			free( slab->nodes[i].children );
+		free( slab );
 	}
-	else if( node->sibling && Trie_LetterCompare( node->sibling->letter, *key, casing ) <= 0 )
+
+	for( block = trie->blocks; block; block = next_block )
 	{
-		// prefix does not match, but we might have a matching sibling
-		return TRIE_Find_Rec( node->sibling, key, mode, casing, predicate, cookie );
+		next_block = block->next;
+		free( block );
 	}
-	else if( !node->depth )
+
+	trie->slabs = NULL;
+	trie->blocks = NULL;
+	trie->free_nodes = NULL;
+	trie->root = NULL;
+}
+
+static struct trie_node_s *Trie_AllocNode(
+        struct trie_s *trie,
+        const char *label,
+        unsigned int label_len
+)
+{
+	struct trie_node_s *node;
+
+	if( trie->free_nodes )
 	{
-		// node is root
-		if( !*key )
-			if( mode == TRIE_PREFIX_MATCH || node->data_is_set )
-				// key is "", return root
-				return node;
-			else
-				// key is "", but root does not contain data
-				return NULL;
-		else if( node->child )
-			return TRIE_Find_Rec( node->child, key, mode, casing, predicate, cookie );
-		else
-			return NULL;
+		node = trie->free_nodes;
+		trie->free_nodes = (struct trie_node_s *) node->data;
 	}
 	else
 	{
-		// prefix does not match, no matching siblings
-		return NULL;
+		if( !trie->slabs || trie->slab_used == trie->slabs->num_nodes )
+		{
+			unsigned int num_nodes = trie->slabs ? trie->slabs->num_nodes * 2 : TRIE_MIN_SLAB_NODES;
+			struct trie_slab_s *slab;
+
+			if( num_nodes > TRIE_MAX_SLAB_NODES )
+				num_nodes = TRIE_MAX_SLAB_NODES;
+			slab = (struct trie_slab_s *) malloc( sizeof( struct trie_slab_s ) + sizeof( struct trie_node_s ) * ( num_nodes - 1 ) );
+			assert( slab );
+			slab->num_nodes = num_nodes;
+			slab->next = trie->slabs;
+			trie->slabs = slab;
+			trie->slab_used = 0;
+		}
+		node = &trie->slabs->nodes[trie->slab_used++];
 	}
+
+	node->label = label;
+	node->label_len = label_len;
+	node->num_children = 0;
+	node->max_children = 0;
+	node->data_is_set = 0;
+	node->data = NULL;
+	node->children = NULL;
+	return node;
 }
 
-static int Trie_Insert_Rec(
-        struct trie_node_s *node,
-        const char *key,
-        trie_casing_t casing,
-        void *data
+static void Trie_FreeNode(
+        struct trie_s *trie,
+        struct trie_node_s *node
 )
 {
-	assert( key );
-	assert( node );
-	if( !node->depth || !Trie_LetterCompare( *key, node->letter, casing ) )
+	free( node->children );
+	node->children = NULL;
+	node->num_children = node->max_children = 0;
+	node->data_is_set = 0;
+	node->data = trie->free_nodes;
+	trie->free_nodes = node;
+}
+
+static const char *Trie_AllocLabel(
+        struct trie_s *trie,
+        const char *letters,
+        size_t len
+)
+{
+	struct trie_block_s *block = trie->blocks;
+	char *label;
+
+	if( !block || block->used + len > block->size )
 	{
-		// node is root or prefix matches
-		if( ( !node->depth && !*key ) || ( node->depth && !*( key+1 ) ) )
+		size_t size = block ? block->size * 2 : TRIE_MIN_BLOCK_SIZE;
+		qboolean oversized = qfalse;
+
+		if( size > TRIE_MAX_BLOCK_SIZE )
+			size = TRIE_MAX_BLOCK_SIZE;
+		if( len > size / 4 )
 		{
-			// end of key reached, set data
-			if( !node->data_is_set )
-			{
-				node->data = data;
-				node->data_is_set = 1;
-				return TRIE_OK;
-			}
-			else
-				return TRIE_DUPLICATE_KEY;
+			size = len;
+			oversized = qtrue;
+		}
+
+		block = (struct trie_block_s *) malloc( sizeof( struct trie_block_s ) + size );
+		assert( block );
+		block->size = size;
+		block->used = 0;
+
+		// keep filling the current block after an oversized label
+		if( oversized && trie->blocks )
+		{
+			block->next = trie->blocks->next;
+			trie->blocks->next = block;
 		}
 		else
 		{
-			// not end of key, descend to child
-			const char *const nextKey = node->depth
-			                            ? key + 1
-						    : key;
-			if( !node->child || Trie_LetterCompare( node->child->letter, *nextKey, casing ) > 0 )
-				// no matching child, create one
-				node->child = Trie_CreateNode( node->depth + 1, *nextKey, NULL, node->child, 0, NULL );
-			// descend to matching child
-			return Trie_Insert_Rec( node->child, nextKey, casing, data );
+			block->next = trie->blocks;
+			trie->blocks = block;
 		}
 	}
-	else
+
+	label = (char *)( block + 1 ) + block->used;
+	block->used += len;
+	memcpy( label, letters, len );
+	trie->label_bytes += len;
+	return label;
+}
+
+static inline struct trie_edge_s *Trie_FindEdge(
+        const struct trie_node_s *node,
+        unsigned char letter,
+        unsigned int *position
+)
+{
+	unsigned int lo = 0, hi = node->num_children;
+
+	while( lo < hi )
 	{
-		assert( node->depth );
-		if( !node->sibling || Trie_LetterCompare( node->sibling->letter, *key, casing ) > 0 )
-			node->sibling = Trie_CreateNode( node->depth, *key, NULL, node->sibling, 0, NULL );
-		return Trie_Insert_Rec( node->sibling, key, casing, data );
+		unsigned int mid = ( lo + hi ) / 2;
+		if( node->children[mid].letter < letter )
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+
+	if( position )
+		*position = lo;
+	if( lo < node->num_children && node->children[lo].letter == letter )
+		return &node->children[lo];
+	return NULL;
 }
 
-static trie_remove_result_t Trie_Remove_Rec(
+static void Trie_AddEdge(
         struct trie_node_s *node,
+        unsigned int position,
+        unsigned char letter,
+        struct trie_node_s *child
+)
+{
+	if( node->num_children == node->max_children )
+	{
+		node->max_children = node->max_children ? node->max_children * 2 : 2;
+		node->children = (struct trie_edge_s *) realloc( node->children, sizeof( struct trie_edge_s ) * node->max_children );
+		assert( node->children );
+	}
+
+	memmove( node->children + position + 1, node->children + position, sizeof( struct trie_edge_s ) * ( node->num_children - position ) );
+	node->children[position].letter = letter;
+	node->children[position].node = child;
+	node->num_children++;
+}
+
+static struct trie_node_s *Trie_FindNode(
+        const struct trie_s *trie,
         const char *key,
-        trie_casing_t casing,
-        void **data
+        trie_find_mode_t mode
 )
 {
-	trie_remove_result_t status;
-	assert( node );
+	struct trie_node_s *node = trie->root;
+	const struct trie_edge_s *edge;
+	unsigned int i;
+
 	assert( key );
-	if( node->depth && Trie_LetterCompare( node->letter, *key, casing ) < 0 )
+	while( *key )
 	{
-		// node is not root and prefix does not match
-		if( node->sibling )
+		edge = Trie_FindEdge( node, Trie_Letter( *key, trie->casing ), NULL );
+		if( !edge )
+			return NULL;
+
+		node = edge->node;
+		for( i = 1; i < node->label_len; i++ )
 		{
-			// call recursively for sibling
-			status = Trie_Remove_Rec( node->sibling, key, casing, data );
-			if( status == TRIE_REMOVE_NO_CHILDREN_OR_DATA_LEFT )
-			{
-				// sibling node has no children or data, free it and preserve siblings
-				struct trie_node_s *sibling = node->sibling->sibling;
-				free( node->sibling );
-				node->sibling = sibling;
-				// ch : is this right?
-				// return ( node->child != NULL ) || ( node->data_is_set );
-				return ( node->child != NULL ) || ( node->data_is_set ) ? TRIE_REMOVE_CHILDREN_OR_DATA_LEFT : TRIE_REMOVE_NO_CHILDREN_OR_DATA_LEFT;
-			}
-			else
-				return status;
+			if( !key[i] )
+				// the key ends within the label, every key below matches the prefix
+				return mode == TRIE_PREFIX_MATCH ? node : NULL;
+			if( Trie_Letter( key[i], trie->casing ) != Trie_Letter( node->label[i], trie->casing ) )
+				return NULL;
 		}
-		else
-			// key not found
-			return TRIE_REMOVE_KEY_NOT_FOUND;
+		key += node->label_len;
 	}
-	else if( !node->depth || !Trie_LetterCompare( node->letter, *key, casing ) )
+
+	if( mode == TRIE_PREFIX_MATCH || node->data_is_set )
+		return node;
+	return NULL;
+}
+
+static int Trie_InsertNode(
+        struct trie_s *trie,
+        const char *key,
+        void *data
+)
+{
+	struct trie_node_s *node = trie->root, *child, *mid;
+	struct trie_edge_s *edge;
+	unsigned int i, position;
+	unsigned char letter;
+
+	while( *key )
 	{
-		// prefix matches or node is root, check for end of key
-		if( !( !node->depth && !*key ) && !( node->depth && !*( key+1 ) ) )
+		letter = Trie_Letter( *key, trie->casing );
+		edge = Trie_FindEdge( node, letter, &position );
+		if( !edge )
 		{
-			// not end of key, descend
-			if( node->child )
-			{
-				status = Trie_Remove_Rec( node->child, node->depth ? key + 1 : key, casing, data );
-				if( !status )
-				{
-					// child node has no children, free it and preserve siblings
-					struct trie_node_s *sibling = node->child->sibling;
-					free( node->child );
-					node->child = sibling;
-					// ch : is this right?
-					// return ( node->child != NULL ) || ( node->data_is_set );
-					return ( node->child != NULL ) || ( node->data_is_set ) ? TRIE_REMOVE_CHILDREN_OR_DATA_LEFT : TRIE_REMOVE_NO_CHILDREN_OR_DATA_LEFT;
-				}
-				else
-					return status;
-			}
-			else
-				// key not found
-				return TRIE_REMOVE_KEY_NOT_FOUND;
+			// no matching child, the rest of the key becomes a leaf
+			size_t len = strlen( key );
+			child = Trie_AllocNode( trie, Trie_AllocLabel( trie, key, len ), len );
+			child->data = data;
+			child->data_is_set = 1;
+			Trie_AddEdge( node, position, letter, child );
+			return TRIE_OK;
 		}
-		else
+
+		child = edge->node;
+		for( i = 1; i < child->label_len; i++ )
+		{
+			if( !key[i] || Trie_Letter( key[i], trie->casing ) != Trie_Letter( child->label[i], trie->casing ) )
+				break;
+		}
+
+		if( i < child->label_len )
 		{
-			// end of key
-			*data = node->data;
-			node->data = NULL;
-			node->data_is_set = 0;
-			// ch : is this right?
-			// return ( node->child != 0 );
-			return ( node->child != 0 ) ? TRIE_REMOVE_CHILDREN_OR_DATA_LEFT : TRIE_REMOVE_NO_CHILDREN_OR_DATA_LEFT;
+			// split the label, the new node takes the common part
+			mid = Trie_AllocNode( trie, child->label, i );
+			child->label += i;
+			child->label_len -= i;
+			Trie_AddEdge( mid, 0, Trie_Letter( child->label[0], trie->casing ), child );
+			edge->node = mid;
+			child = mid;
 		}
+
+		node = child;
+		key += i;
 	}
-	else
-		// key not found
-		return TRIE_REMOVE_KEY_NOT_FOUND;
+
+	// end of key reached, set data
+	if( node->data_is_set )
+		return TRIE_DUPLICATE_KEY;
+	node->data = data;
+	node->data_is_set = 1;
+	return TRIE_OK;
+}
+
+static void Trie_MergeChild(
+        struct trie_s *trie,
+        struct trie_node_s *node
+)
+{
+	struct trie_node_s *child;
+	struct trie_edge_s *children;
+	unsigned int max_children;
+
+	// the node has no data and a single child, fold the child into it
+	assert( !node->data_is_set && node->num_children == 1 );
+	child = node->children[0].node;
+
+	if( node->label + node->label_len != child->label )
+	{
+		char *letters = (char *) malloc( node->label_len + child->label_len );
+		memcpy( letters, node->label, node->label_len );
+		memcpy( letters + node->label_len, child->label, child->label_len );
+		trie->label_waste += node->label_len + child->label_len;
+		node->label = Trie_AllocLabel( trie, letters, node->label_len + child->label_len );
+		free( letters );
+	}
+	node->label_len += child->label_len;
+
+	node->data = child->data;
+	node->data_is_set = child->data_is_set;
+
+	// swap the edge arrays, the child goes away with the node's old one
+	children = node->children;
+	max_children = node->max_children;
+	node->children = child->children;
+	node->num_children = child->num_children;
+	node->max_children = child->max_children;
+	child->children = children;
+	child->num_children = 1;
+	child->max_children = max_children;
+	Trie_FreeNode( trie, child );
+}
+
+static int Trie_RemoveNode(
+        struct trie_s *trie,
+        const char *key,
+        void **data
+)
+{
+	struct trie_node_s *node = trie->root, *parent = NULL;
+	struct trie_edge_s *edge;
+	unsigned int i, position = 0;
+
+	while( *key )
+	{
+		parent = node;
+		edge = Trie_FindEdge( node, Trie_Letter( *key, trie->casing ), &position );
+		if( !edge )
+			return TRIE_KEY_NOT_FOUND;
+
+		node = edge->node;
+		for( i = 1; i < node->label_len; i++ )
+		{
+			if( !key[i] || Trie_Letter( key[i], trie->casing ) != Trie_Letter( node->label[i], trie->casing ) )
+				return TRIE_KEY_NOT_FOUND;
+		}
+		key += node->label_len;
+	}
+
+	if( !node->data_is_set )
+		return TRIE_KEY_NOT_FOUND;
+
+	*data = node->data;
+	node->data = NULL;
+	node->data_is_set = 0;
+
+	if( !parent )
+		return TRIE_OK;     // the root stays
+
+	if( !node->num_children )
+	{
+		// drop the leaf
+		trie->label_waste += node->label_len;
+		memmove( parent->children + position, parent->children + position + 1, sizeof( struct trie_edge_s ) * ( parent->num_children - position - 1 ) );
+		parent->num_children--;
+		Trie_FreeNode( trie, node );
+
+		if( parent != trie->root && !parent->data_is_set && parent->num_children == 1 )
+			Trie_MergeChild( trie, parent );
+	}
+	else if( node->num_children == 1 )
+	{
+		Trie_MergeChild( trie, node );
+	}
+
+	return TRIE_OK;
+}
+
+static void Trie_Compact(
+        struct trie_s *trie
+)
+{
+	struct trie_dump_s *dump;
+	unsigned int i;
+
+	// rebuild the trie into fresh arenas
+	Trie_Dump( trie, "", TRIE_DUMP_BOTH, &dump );
+	Trie_FreeArena( trie );
+	Trie_InitArena( trie );
+	for( i = 0; i < dump->size; i++ )
+	{
+		Trie_InsertNode( trie, dump->key_value_vector[i].key, dump->key_value_vector[i].value );
+		trie->size++;
+	}
+	Trie_FreeDump( dump );
 }
 
 static unsigned int Trie_NoOfKeys(
         const struct trie_node_s *node,
-        trie_casing_t casing,
         int ( *predicate )( void *value, void *cookie ),
-        void *cookie,
-        int addSiblings
+        void *cookie
 )
 {
-	unsigned int noOfKeys;
+	unsigned int noOfKeys, i;
 	assert( node );
 	assert( predicate );
 	// if data is set, we have a data node, otherwise just a prefix node
@@ -620,41 +880,66 @@ static unsigned int Trie_NoOfKeys(
 		noOfKeys = 1;
 	else
 		noOfKeys = 0;
-	// recursively add siblings and children
-	if( addSiblings && node->sibling )
-		noOfKeys += Trie_NoOfKeys( node->sibling, casing, predicate, cookie, 1 );
-	if( node->child )
-		noOfKeys += Trie_NoOfKeys( node->child, casing, predicate, cookie, 1 );
+	// recursively add children
+	for( i = 0; i < node->num_children; i++ )
+		noOfKeys += Trie_NoOfKeys( node->children[i].node, predicate, cookie );
 	return noOfKeys;
 }
 
+static const struct trie_node_s *Trie_FirstKey(
+        const struct trie_node_s *node,
+        int ( *predicate )( void *value, void *cookie ),
+        void *cookie
+)
+{
+	const struct trie_node_s *result;
+	unsigned int i;
+
+	if( node->data_is_set && predicate( node->data, cookie ) )
+		return node;
+	for( i = 0; i < node->num_children; i++ )
+	{
+		result = Trie_FirstKey( node->children[i].node, predicate, cookie );
+		if( result )
+			return result;
+	}
+	return NULL;
+}
+
 static void Trie_Dump_Rec(
         const struct trie_node_s *node,
         trie_dump_what_t what,
-        trie_casing_t casing,
         int ( *predicate )( void *value, void *cookie ),
         void *cookie,
-        int dumpSiblings,
-        const char *key_prev,
+        char **key_buffer,
+        size_t *key_buffer_size,
+        size_t key_len,
         struct trie_key_value_s **key_value_vector
 )
 {
-	char *key = NULL;
-	int keyDumped = 0;
+	unsigned int i;
+
 	if( what & TRIE_DUMP_KEYS )
 	{
-		key = (char *) malloc( sizeof( char ) * ( node->depth + 1 ) );
-		strncpy( key, key_prev, node->depth ); // copy previous key
-		if( node->depth )
-			key[node->depth - 1] = node->letter; // append/replace letter
-		key[node->depth] = '\0';        // terminate key string
+		// append the label to the key
+		if( key_len + node->label_len + 1 > *key_buffer_size )
+		{
+			while( key_len + node->label_len + 1 > *key_buffer_size )
+				*key_buffer_size *= 2;
+			*key_buffer = (char *) realloc( *key_buffer, *key_buffer_size );
+		}
+		memcpy( *key_buffer + key_len, node->label, node->label_len );
 	}
+	key_len += node->label_len;
+
 	if( node->data_is_set && predicate( node->data, cookie ) )
 	{
 		// dump key and values if requested
 		if( what & TRIE_DUMP_KEYS )
 		{
-			keyDumped = 1;
+			char *key = (char *) malloc( key_len + 1 );
+			memcpy( key, *key_buffer, key_len );
+			key[key_len] = '\0';
 			( *key_value_vector )->key = key;
 		}
 		else
@@ -665,17 +950,10 @@ static void Trie_Dump_Rec(
 		// increment key_vector
 		++ ( *key_value_vector );
 	}
+
 	// dump children
-	if( node->child )
-		Trie_Dump_Rec( node->child, what, casing, predicate, cookie, 1, key, key_value_vector );
-	// dump siblings
-	if( dumpSiblings && node->sibling )
-		Trie_Dump_Rec( node->sibling, what, casing, predicate, cookie, 1, key, key_value_vector );
-	if( ( what & TRIE_DUMP_KEYS ) && !keyDumped )
-	{
-		assert( key );
-		free( key );
-	}
+	for( i = 0; i < node->num_children; i++ )
+		Trie_Dump_Rec( node->children[i].node, what, predicate, cookie, key_buffer, key_buffer_size, key_len, key_value_vector );
 }
 
 static int Trie_AlwaysTrue(
@@ -686,14 +964,13 @@ static int Trie_AlwaysTrue(
 	return 1;
 }
 
-static inline int Trie_LetterCompare(
-        char left,
-        char right,
+static inline unsigned char Trie_Letter(
+        char letter,
         trie_casing_t casing
 )
 {
 	if( casing == TRIE_CASE_SENSITIVE )
-		return ( (int) left ) - ( (int) right );
+		return (unsigned char) letter;
 	else
-		return ( (int) tolower( left ) ) - ( (int) tolower( right ) );
+		return (unsigned char) tolower( (unsigned char) letter );
 }
@@ -0,0 +1,487 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// q_trie_test.c -- runs the trie against a sorted array model over random
+// operations in both casings, "-bench" also times it on pk3-style paths
+
+#include "../../gameshared/q_arch.h"
+#include "../q_trie.h"
+
+#if defined( __GLIBC__ ) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+#include <malloc.h>
+#define TEST_HEAP_USED()	( (size_t)mallinfo2().uordblks )
+#else
+#define TEST_HEAP_USED()	( (size_t)0 )
+#endif
+
+#define NUM_TEST_KEYS		4000
+#define MAX_TEST_KEY		32
+#define NUM_TEST_OPS		200000
+
+#define NUM_BENCH_KEYS		200000
+#define NUM_BENCH_TRIES		3000
+#define NUM_BENCH_SMALL		20
+
+typedef struct
+{
+	const char *key;
+	void *value;
+} modelentry_t;
+
+// the model, present keys sorted under the trie's casing
+static modelentry_t model[NUM_TEST_KEYS];
+static int modelSize;
+static qboolean modelFold;
+
+static char testKeys[NUM_TEST_KEYS][MAX_TEST_KEY];
+
+/*
+* Test_Random
+*/
+static unsigned int test_seed = 0x1234567;
+static int Test_Random( int range )
+{
+	test_seed = test_seed * 1103515245 + 12345;
+	return ( test_seed >> 8 ) % range;
+}
+
+/*
+* Test_Letter
+*/
+static int Test_Letter( int c )
+{
+	return modelFold ? tolower( (unsigned char)c ) : (unsigned char)c;
+}
+
+/*
+* Test_KeyCmp
+*/
+static int Test_KeyCmp( const char *a, const char *b )
+{
+	for( ;; a++, b++ )
+	{
+		int x = Test_Letter( *a ), y = Test_Letter( *b );
+		if( x != y || !x )
+			return x - y;
+	}
+}
+
+/*
+* Test_HasPrefix
+*/
+static qboolean Test_HasPrefix( const char *key, const char *prefix )
+{
+	for( ; *prefix; prefix++, key++ )
+	{
+		if( Test_Letter( *key ) != Test_Letter( *prefix ) )
+			return qfalse;
+	}
+	return qtrue;
+}
+
+/*
+* Test_ModelLowerBound
+*
+* Index of the first present key not sorting before key
+*/
+static int Test_ModelLowerBound( const char *key )
+{
+	int lo = 0, hi = modelSize;
+
+	while( lo < hi )
+	{
+		int mid = ( lo + hi ) >> 1;
+		if( Test_KeyCmp( model[mid].key, key ) < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+* Test_ModelFind
+*/
+static int Test_ModelFind( const char *key )
+{
+	int i = Test_ModelLowerBound( key );
+	return ( i < modelSize && !Test_KeyCmp( model[i].key, key ) ) ? i : -1;
+}
+
+/*
+* Test_Predicate
+*
+* The cookie is a mask for the value, so different calls see different matches
+*/
+static int Test_Predicate( void *value, void *cookie )
+{
+	return ( (size_t)value & (size_t)cookie ) != 0;
+}
+
+/*
+* Test_CheckDump
+*
+* The dump must list exactly the model's keys under prefix, in the model's order
+*/
+static qboolean Test_CheckDump( const trie_dump_t *dump, const char *prefix, void *cookie )
+{
+	int i;
+	unsigned int k = 0;
+
+	for( i = Test_ModelLowerBound( prefix ); i < modelSize && Test_HasPrefix( model[i].key, prefix ); i++ )
+	{
+		if( cookie && !Test_Predicate( model[i].value, cookie ) )
+			continue;
+		if( k >= dump->size )
+		{
+			printf( "dump '%s': missing '%s'\n", prefix, model[i].key );
+			return qfalse;
+		}
+		if( Test_KeyCmp( dump->key_value_vector[k].key, model[i].key ) || dump->key_value_vector[k].value != model[i].value )
+		{
+			printf( "dump '%s': entry %u is '%s', expected '%s'\n", prefix, k, dump->key_value_vector[k].key, model[i].key );
+			return qfalse;
+		}
+		k++;
+	}
+
+	if( k != dump->size )
+	{
+		printf( "dump '%s': %u entries, expected %u\n", prefix, dump->size, k );
+		return qfalse;
+	}
+	return qtrue;
+}
+
+/*
+* Test_FirstMatch
+*
+* What a find with the given mode and predicate must return, NULL if nothing matches
+*/
+static const modelentry_t *Test_FirstMatch( const char *key, trie_find_mode_t mode, void *cookie )
+{
+	int i;
+
+	if( mode == TRIE_EXACT_MATCH )
+	{
+		i = Test_ModelFind( key );
+		if( i < 0 || ( cookie && !Test_Predicate( model[i].value, cookie ) ) )
+			return NULL;
+		return &model[i];
+	}
+
+	for( i = Test_ModelLowerBound( key ); i < modelSize && Test_HasPrefix( model[i].key, key ); i++ )
+	{
+		if( !cookie || Test_Predicate( model[i].value, cookie ) )
+			return &model[i];
+	}
+	return NULL;
+}
+
+/*
+* Test_Op
+*
+* One random operation on both the trie and the model, qfalse if they disagree
+*/
+static qboolean Test_Op( trie_t *trie, int op, const char *key, void *value )
+{
+	int i;
+	unsigned int n, count;
+	void *data, *cookie;
+	const modelentry_t *match;
+	trie_find_mode_t mode;
+	trie_dump_t *dump;
+	trie_error_t err;
+	qboolean ok;
+
+	i = Test_ModelFind( key );
+
+	switch( op )
+	{
+	case 0:
+	case 1:
+		err = Trie_Insert( trie, key, value );
+		if( err != ( i >= 0 ? TRIE_DUPLICATE_KEY : TRIE_OK ) )
+		{
+			printf( "insert '%s': error %i\n", key, err );
+			return qfalse;
+		}
+		if( err == TRIE_OK )
+		{
+			i = Test_ModelLowerBound( key );
+			memmove( &model[i+1], &model[i], ( modelSize - i ) * sizeof( *model ) );
+			model[i].key = key;
+			model[i].value = value;
+			modelSize++;
+		}
+		return qtrue;
+
+	case 2:
+		err = Trie_Remove( trie, key, &data );
+		if( err != ( i >= 0 ? TRIE_OK : TRIE_KEY_NOT_FOUND ) || ( err == TRIE_OK && data != model[i].value ) )
+		{
+			printf( "remove '%s': error %i\n", key, err );
+			return qfalse;
+		}
+		if( err == TRIE_OK )
+		{
+			memmove( &model[i], &model[i+1], ( modelSize - i - 1 ) * sizeof( *model ) );
+			modelSize--;
+		}
+		return qtrue;
+
+	case 3:
+		err = Trie_Replace( trie, key, value, &data );
+		if( err != ( i >= 0 ? TRIE_OK : TRIE_KEY_NOT_FOUND ) || ( err == TRIE_OK && data != model[i].value ) )
+		{
+			printf( "replace '%s': error %i\n", key, err );
+			return qfalse;
+		}
+		if( err == TRIE_OK )
+			model[i].value = value;
+		return qtrue;
+
+	case 4:
+	case 5:
+		mode = ( op == 4 ) ? TRIE_EXACT_MATCH : TRIE_PREFIX_MATCH;
+		cookie = (void *)(size_t)Test_Random( 4 );
+		if( cookie )
+			err = Trie_FindIf( trie, key, mode, Test_Predicate, cookie, &data );
+		else
+			err = Trie_Find( trie, key, mode, &data );
+		match = Test_FirstMatch( key, mode, cookie );
+		if( err != ( match ? TRIE_OK : TRIE_KEY_NOT_FOUND ) || ( match && data != match->value ) )
+		{
+			printf( "find '%s' %s, mask %i: error %i\n", key, mode == TRIE_EXACT_MATCH ? "exact" : "prefix",
+				(int)(size_t)cookie, err );
+			return qfalse;
+		}
+		return qtrue;
+
+	case 6:
+		cookie = (void *)(size_t)Test_Random( 4 );
+		if( cookie )
+			Trie_NoOfMatchesIf( trie, key, Test_Predicate, cookie, &n );
+		else
+			Trie_NoOfMatches( trie, key, &n );
+		count = 0;
+		for( i = Test_ModelLowerBound( key ); i < modelSize && Test_HasPrefix( model[i].key, key ); i++ )
+		{
+			if( !cookie || Test_Predicate( model[i].value, cookie ) )
+				count++;
+		}
+		if( n != count )
+		{
+			printf( "count '%s', mask %i: %u, expected %u\n", key, (int)(size_t)cookie, n, count );
+			return qfalse;
+		}
+		return qtrue;
+
+	default:
+		cookie = (void *)(size_t)Test_Random( 4 );
+		if( cookie )
+			Trie_DumpIf( trie, key, TRIE_DUMP_BOTH, Test_Predicate, cookie, &dump );
+		else
+			Trie_Dump( trie, key, TRIE_DUMP_BOTH, &dump );
+		ok = Test_CheckDump( dump, key, cookie );
+		Trie_FreeDump( dump );
+		return ok;
+	}
+}
+
+/*
+* Test_Run
+*/
+static qboolean Test_Run( trie_casing_t casing, const char *alphabet, int maxLength )
+{
+	int i, j, len, op;
+	int alphabetSize = (int)strlen( alphabet );
+	unsigned int size;
+	trie_t *trie;
+
+	modelFold = ( casing == TRIE_CASE_INSENSITIVE );
+	modelSize = 0;
+
+	// a small alphabet so keys share long prefixes and removals merge nodes
+	for( i = 0; i < NUM_TEST_KEYS; i++ )
+	{
+		len = Test_Random( maxLength + 1 );
+		for( j = 0; j < len; j++ )
+			testKeys[i][j] = alphabet[Test_Random( alphabetSize )];
+		testKeys[i][len] = 0;
+	}
+
+	Trie_Create( casing, &trie );
+
+	for( i = 0; i < NUM_TEST_OPS; i++ )
+	{
+		op = Test_Random( 8 );
+		if( !Test_Op( trie, op, testKeys[Test_Random( NUM_TEST_KEYS )], (void *)(size_t)( i + 1 ) ) )
+		{
+			printf( "%s, keys up to %i letters: failed at operation %i\n",
+				modelFold ? "case insensitive" : "case sensitive", maxLength, i );
+			Trie_Destroy( trie );
+			return qfalse;
+		}
+	}
+
+	Trie_GetSize( trie, &size );
+	if( size != (unsigned int)modelSize )
+	{
+		printf( "size %u, expected %i\n", size, modelSize );
+		Trie_Destroy( trie );
+		return qfalse;
+	}
+
+	Trie_Clear( trie );
+	Trie_GetSize( trie, &size );
+	Trie_Destroy( trie );
+	if( size )
+	{
+		printf( "size %u after clear\n", size );
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/*
+* Test_Check
+*/
+static int Test_Check( void )
+{
+	int fails = 0;
+
+	fails += Test_Run( TRIE_CASE_SENSITIVE, "abcd_", 8 ) ? 0 : 1;
+	fails += Test_Run( TRIE_CASE_SENSITIVE, "abcd_", 30 ) ? 0 : 1;
+	fails += Test_Run( TRIE_CASE_INSENSITIVE, "abcAB_", 8 ) ? 0 : 1;
+	fails += Test_Run( TRIE_CASE_INSENSITIVE, "abcAB_", 30 ) ? 0 : 1;
+
+	printf( "4 runs, %i operations each: %s\n", NUM_TEST_OPS, fails ? "FAILED" : "passed" );
+	return fails;
+}
+
+/*
+* Test_Msec
+*/
+static double Test_Msec( clock_t start )
+{
+	return ( clock() - start ) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+/*
+* Test_Bench
+*/
+static void Test_Bench( void )
+{
+	int i, j, r;
+	int hits;
+	size_t heap;
+	char buf[128];
+	char **keys;
+	void *data;
+	clock_t start;
+	trie_t *trie, **tries;
+	trie_dump_t *dump;
+	static const char *dirs[] =
+	{
+		"textures/", "models/players/", "sounds/weapons/", "maps/",
+		"env/", "gfx/hud/", "models/objects/", "textures/wsw_city1/"
+	};
+
+	keys = malloc( NUM_BENCH_KEYS * sizeof( *keys ) );
+	for( i = 0; i < NUM_BENCH_KEYS; i++ )
+	{
+		snprintf( buf, sizeof( buf ), "%s%s_%c%c%c%i/%s%05i.%s", dirs[Test_Random( 8 )],
+			Test_Random( 2 ) ? "base" : "detail", 'a' + Test_Random( 26 ), 'a' + Test_Random( 26 ),
+			'a' + Test_Random( 26 ), Test_Random( 50 ), Test_Random( 2 ) ? "skin" : "tex", i,
+			Test_Random( 2 ) ? "tga" : "jpg" );
+		keys[i] = strdup( buf );
+	}
+
+	printf( "%i pk3-style paths, case insensitive\n", NUM_BENCH_KEYS );
+
+	heap = TEST_HEAP_USED();
+	start = clock();
+	Trie_Create( TRIE_CASE_INSENSITIVE, &trie );
+	for( i = 0; i < NUM_BENCH_KEYS; i++ )
+		Trie_Insert( trie, keys[i], keys[i] );
+	printf( "  insert all    %8.1f msec\n", Test_Msec( start ) );
+	if( heap )
+		printf( "  memory        %8.1f MB\n", ( TEST_HEAP_USED() - heap ) / ( 1024.0 * 1024.0 ) );
+
+	start = clock();
+	for( hits = 0, r = 0; r < 5; r++ )
+	{
+		for( i = 0; i < NUM_BENCH_KEYS; i++ )
+		{
+			if( Trie_Find( trie, keys[( i * 7919 ) % NUM_BENCH_KEYS], TRIE_EXACT_MATCH, &data ) == TRIE_OK )
+				hits++;
+		}
+	}
+	printf( "  exact lookup  %8.3f usec (%i hits)\n", Test_Msec( start ) * 1000.0 / ( 5.0 * NUM_BENCH_KEYS ), hits );
+
+	start = clock();
+	Trie_Dump( trie, "textures/", TRIE_DUMP_VALUES, &dump );
+	printf( "  prefix dump   %8.1f msec (%u keys)\n", Test_Msec( start ), dump->size );
+	Trie_FreeDump( dump );
+
+	start = clock();
+	Trie_Destroy( trie );
+	printf( "  destroy       %8.1f msec\n", Test_Msec( start ) );
+
+	// many tiny tries, like the file tables of pk3s
+	tries = malloc( NUM_BENCH_TRIES * sizeof( *tries ) );
+	heap = TEST_HEAP_USED();
+	for( i = 0; i < NUM_BENCH_TRIES; i++ )
+	{
+		Trie_Create( TRIE_CASE_INSENSITIVE, &tries[i] );
+		for( j = 0; j < NUM_BENCH_SMALL; j++ )
+		{
+			snprintf( buf, sizeof( buf ), "textures/pack%i/file%02i.tga", i, j );
+			Trie_Insert( tries[i], buf, tries[i] );
+		}
+	}
+	if( heap )
+		printf( "%i tries of %i keys: %.1f MB\n", NUM_BENCH_TRIES, NUM_BENCH_SMALL,
+			( TEST_HEAP_USED() - heap ) / ( 1024.0 * 1024.0 ) );
+	for( i = 0; i < NUM_BENCH_TRIES; i++ )
+		Trie_Destroy( tries[i] );
+	free( tries );
+
+	for( i = 0; i < NUM_BENCH_KEYS; i++ )
+		free( keys[i] );
+	free( keys );
+}
+
+int main( int argc, char **argv )
+{
+	int i;
+
+	if( Test_Check() )
+		return 1;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-bench" ) )
+			Test_Bench();
+	}
+
+	return 0;
+}
@@ -145,6 +145,7 @@ struct cmodel_state_s
 
 	int numfaces;
 	cface_t	*map_faces;
+	qbyte *map_facetdata;           // all facets in one block when loaded from the patch cache
 
 	int nummarkfaces;
 	cface_t	**map_markfaces;
@@ -199,6 +200,8 @@ struct cmodel_state_s
 
 //=======================================================================
 
+extern cvar_t *cm_patchCache;
+
 void	CM_InitBoxHull( cmodel_state_t *cms );
 void	CM_InitOctagonHull( cmodel_state_t *cms );
 
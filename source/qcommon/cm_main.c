@@ -29,6 +29,7 @@ static mempool_t *cmap_mempool;
 
 static cvar_t *cm_noAreas;
 cvar_t *cm_noCurves;
+cvar_t *cm_patchCache;
 
 void CM_LoadQ3BrushModel( cmodel_state_t *cms, void *parent, void *buffer, bspFormatDesc_t *format );
 
@@ -66,8 +67,16 @@ static void CM_Clear( cmodel_state_t *cms )
 
 	if( cms->map_faces )
 	{
-		for( i = 0; i < cms->numfaces; i++ )
-			Mem_Free( cms->map_faces[i].facets );
+		if( cms->map_facetdata )
+		{
+			Mem_Free( cms->map_facetdata );
+			cms->map_facetdata = NULL;
+		}
+		else
+		{
+			for( i = 0; i < cms->numfaces; i++ )
+				Mem_Free( cms->map_faces[i].facets );
+		}
 		Mem_Free( cms->map_faces );
 		cms->map_faces = NULL;
 		cms->numfaces = 0;
@@ -894,6 +903,7 @@ void CM_Init( void )
 
 	cm_noAreas =	    Cvar_Get( "cm_noAreas", "0", CVAR_CHEAT );
 	cm_noCurves =	    Cvar_Get( "cm_noCurves", "0", CVAR_CHEAT );
+	cm_patchCache =	    Cvar_Get( "cm_patchCache", "1", CVAR_ARCHIVE );
 
 	cm_initialized = qtrue;
 }
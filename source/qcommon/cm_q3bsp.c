@@ -298,6 +298,250 @@ static void CM_CreatePatch( cmodel_state_t *cms, cface_t *patch, cshaderref_t *s
 /*
 ===============================================================================
 
+PATCH CACHE
+
+Tessellated patch facets are stored in the write directory, keyed by the
+BSP checksum, so that the next load of the same map skips CM_CreatePatch.
+All facets of a cached map live in a single block (cms->map_facetdata).
+
+===============================================================================
+*/
+
+#define CM_PATCHCACHE_VERSION	1
+#define CM_PATCHCACHE_DIRECTORY	"cache/cm"
+
+typedef struct
+{
+	int version;
+	int subdivLevel;
+	unsigned int checksum;
+	int numfaces;
+	int numfacets;
+	int numsides;
+} cpatchcacheheader_t;
+
+typedef struct
+{
+	int contents;
+	int numfacets;
+	vec3_t mins, maxs;
+} cpatchcacheface_t;
+
+typedef struct
+{
+	int contents;
+	int numsides;
+} cpatchcachefacet_t;
+
+typedef struct
+{
+	vec3_t normal;
+	float dist;
+	int surfFlags;
+} cpatchcacheside_t;
+
+/*
+* CM_PatchCacheName
+*/
+static void CM_PatchCacheName( cmodel_state_t *cms, char *name, size_t size )
+{
+	Q_snprintfz( name, size, "%s/%08x.cmp", CM_PATCHCACHE_DIRECTORY, cms->checksum );
+}
+
+/*
+* CM_LoadPatchCache
+*
+* Fills in cms->map_faces from the cache, returns qfalse if there's no
+* valid entry for this map and the faces have to be built from the BSP
+*/
+static qboolean CM_LoadPatchCache( cmodel_state_t *cms, lump_t *l )
+{
+	int i, j, k, length, count;
+	int numfacets, numsides;
+	char name[MAX_QPATH];
+	qbyte *buf, *data;
+	cpatchcacheheader_t *header;
+	cpatchcacheface_t *inface;
+	cpatchcachefacet_t *infacet;
+	cpatchcacheside_t *inside;
+	cface_t *face;
+	cbrush_t *facet;
+	cbrushside_t *side;
+	cplane_t *plane;
+
+	if( !cm_patchCache->integer )
+		return qfalse;
+
+	if( cms->cmap_bspFormat->flags & BSP_RAVEN )
+		count = l->filelen / sizeof( rdface_t );
+	else
+		count = l->filelen / sizeof( dface_t );
+	if( count < 1 )
+		return qfalse;
+
+	CM_PatchCacheName( cms, name, sizeof( name ) );
+	length = FS_LoadFile( name, ( void ** )&buf, NULL, 0 );
+	if( !buf )
+		return qfalse;
+
+	header = ( cpatchcacheheader_t * )buf;
+	if( length < (int)sizeof( *header ) || header->version != CM_PATCHCACHE_VERSION 
+		|| header->subdivLevel != CM_SUBDIV_LEVEL || header->checksum != cms->checksum 
+		|| header->numfaces != count || header->numfacets < 0 || header->numsides < 0 )
+		goto fail;
+	if( (size_t)length != sizeof( *header ) + header->numfaces * sizeof( *inface ) 
+		+ header->numfacets * sizeof( *infacet ) + header->numsides * sizeof( *inside ) )
+		goto fail;
+
+	inface = ( cpatchcacheface_t * )( buf + sizeof( *header ) );
+	infacet = ( cpatchcachefacet_t * )( inface + header->numfaces );
+	inside = ( cpatchcacheside_t * )( infacet + header->numfacets );
+
+	// make sure the counts add up before trusting them
+	for( i = 0, numfacets = 0; i < count; i++ )
+	{
+		if( inface[i].numfacets < 0 || inface[i].numfacets > header->numfacets - numfacets )
+			goto fail;
+		numfacets += inface[i].numfacets;
+	}
+	for( i = 0, numsides = 0; i < numfacets; i++ )
+	{
+		if( infacet[i].numsides < 0 || infacet[i].numsides > MAX_FACET_PLANES 
+			|| infacet[i].numsides > header->numsides - numsides )
+			goto fail;
+		numsides += infacet[i].numsides;
+	}
+	if( numfacets != header->numfacets || numsides != header->numsides )
+		goto fail;
+
+	cms->map_faces = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_faces ) );
+	cms->numfaces = count;
+
+	data = cms->map_facetdata = Mem_Alloc( cms->mempool, numfacets * sizeof( cbrush_t ) 
+		+ numsides * ( sizeof( cbrushside_t ) + sizeof( cplane_t ) ) );
+	facet = ( cbrush_t * )data; data += numfacets * sizeof( cbrush_t );
+	side = ( cbrushside_t * )data; data += numsides * sizeof( cbrushside_t );
+	plane = ( cplane_t * )data;
+
+	for( i = 0, face = cms->map_faces; i < count; i++, face++, inface++ )
+	{
+		face->contents = inface->contents;
+		face->numfacets = inface->numfacets;
+		face->facets = face->numfacets ? facet : NULL;
+		VectorCopy( inface->mins, face->mins );
+		VectorCopy( inface->maxs, face->maxs );
+
+		for( j = 0; j < face->numfacets; j++, facet++, infacet++ )
+		{
+			facet->contents = infacet->contents;
+			facet->numsides = infacet->numsides;
+			facet->brushsides = side;
+
+			for( k = 0; k < facet->numsides; k++, side++, plane++, inside++ )
+			{
+				VectorCopy( inside->normal, plane->normal );
+				plane->dist = inside->dist;
+				CategorizePlane( plane );
+				side->plane = plane;
+				side->surfFlags = inside->surfFlags;
+			}
+		}
+	}
+
+	FS_FreeFile( buf );
+	return qtrue;
+
+fail:
+	FS_FreeFile( buf );
+	return qfalse;
+}
+
+/*
+* CM_WritePatchCache
+*
+* Written to a temporary file first, TV relays may load the same map at once
+*/
+static void CM_WritePatchCache( cmodel_state_t *cms )
+{
+	int i, j, k, file;
+	char name[MAX_QPATH], tempname[MAX_QPATH];
+	cpatchcacheheader_t header;
+	cpatchcacheface_t outface;
+	cpatchcachefacet_t outfacet;
+	cpatchcacheside_t outside;
+	cface_t *face;
+	cbrush_t *facet;
+	cbrushside_t *side;
+
+	if( !cm_patchCache->integer || !cms->numfaces )
+		return;
+
+	memset( &header, 0, sizeof( header ) );
+	header.version = CM_PATCHCACHE_VERSION;
+	header.subdivLevel = CM_SUBDIV_LEVEL;
+	header.checksum = cms->checksum;
+	header.numfaces = cms->numfaces;
+	for( i = 0, face = cms->map_faces; i < cms->numfaces; i++, face++ )
+	{
+		header.numfacets += face->numfacets;
+		for( j = 0; j < face->numfacets; j++ )
+			header.numsides += face->facets[j].numsides;
+	}
+
+	CM_PatchCacheName( cms, name, sizeof( name ) );
+	Q_snprintfz( tempname, sizeof( tempname ), "%s.%p.tmp", name, ( void * )cms );
+	if( FS_FOpenFile( tempname, &file, FS_WRITE ) == -1 )
+	{
+		Com_DPrintf( S_COLOR_YELLOW "Couldn't write %s\n", tempname );
+		return;
+	}
+
+	FS_Write( &header, sizeof( header ), file );
+
+	memset( &outface, 0, sizeof( outface ) );
+	for( i = 0, face = cms->map_faces; i < cms->numfaces; i++, face++ )
+	{
+		outface.contents = face->contents;
+		outface.numfacets = face->numfacets;
+		VectorCopy( face->mins, outface.mins );
+		VectorCopy( face->maxs, outface.maxs );
+		FS_Write( &outface, sizeof( outface ), file );
+	}
+
+	for( i = 0, face = cms->map_faces; i < cms->numfaces; i++, face++ )
+	{
+		for( j = 0, facet = face->facets; j < face->numfacets; j++, facet++ )
+		{
+			outfacet.contents = facet->contents;
+			outfacet.numsides = facet->numsides;
+			FS_Write( &outfacet, sizeof( outfacet ), file );
+		}
+	}
+
+	for( i = 0, face = cms->map_faces; i < cms->numfaces; i++, face++ )
+	{
+		for( j = 0, facet = face->facets; j < face->numfacets; j++, facet++ )
+		{
+			for( k = 0, side = facet->brushsides; k < facet->numsides; k++, side++ )
+			{
+				VectorCopy( side->plane->normal, outside.normal );
+				outside.dist = side->plane->dist;
+				outside.surfFlags = side->surfFlags;
+				FS_Write( &outside, sizeof( outside ), file );
+			}
+		}
+	}
+
+	FS_FCloseFile( file );
+
+	FS_RemoveFile( name );
+	if( !FS_MoveFile( tempname, name ) )
+		FS_RemoveFile( tempname );
+}
+
+/*
+===============================================================================
+
 MAP LOADING
 
 ===============================================================================
@@ -865,15 +1109,19 @@ void CM_LoadQ3BrushModel( cmodel_state_t *cms, void *parent, void *buf, bspForma
 		CMod_LoadBrushSides( cms, &header.lumps[LUMP_BRUSHSIDES] );
 	CMod_LoadBrushes( cms, &header.lumps[LUMP_BRUSHES] );
 	CMod_LoadMarkBrushes( cms, &header.lumps[LUMP_LEAFBRUSHES] );
-	if( cms->cmap_bspFormat->flags & BSP_RAVEN )
-	{
-		CMod_LoadVertexes_RBSP( cms, &header.lumps[LUMP_VERTEXES] );
-		CMod_LoadFaces_RBSP( cms, &header.lumps[LUMP_FACES] );
-	}
-	else
+	if( !CM_LoadPatchCache( cms, &header.lumps[LUMP_FACES] ) )
 	{
-		CMod_LoadVertexes( cms, &header.lumps[LUMP_VERTEXES] );
-		CMod_LoadFaces( cms, &header.lumps[LUMP_FACES] );
+		if( cms->cmap_bspFormat->flags & BSP_RAVEN )
+		{
+			CMod_LoadVertexes_RBSP( cms, &header.lumps[LUMP_VERTEXES] );
+			CMod_LoadFaces_RBSP( cms, &header.lumps[LUMP_FACES] );
+		}
+		else
+		{
+			CMod_LoadVertexes( cms, &header.lumps[LUMP_VERTEXES] );
+			CMod_LoadFaces( cms, &header.lumps[LUMP_FACES] );
+		}
+		CM_WritePatchCache( cms );
 	}
 	CMod_LoadMarkFaces( cms, &header.lumps[LUMP_LEAFFACES] );
 	CMod_LoadLeafs( cms, &header.lumps[LUMP_LEAFS] );
@@ -885,5 +1133,9 @@ void CM_LoadQ3BrushModel( cmodel_state_t *cms, void *parent, void *buf, bspForma
 	FS_FreeFile( buf );
 
 	if( cms->numvertexes )
+	{
 		Mem_Free( cms->map_verts );
+		cms->map_verts = NULL;
+		cms->numvertexes = 0;
+	}
 }
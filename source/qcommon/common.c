@@ -19,8 +19,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // common.c -- misc functions used in client and server
 #include "qcommon.h"
-#if defined(__GNUC__) && defined(i386)
+#if defined(__GNUC__) && ( defined(i386) || defined(__x86_64__) )
 #include <cpuid.h>
+#elif defined(_MSC_VER) && ( _MSC_VER >= 1600 ) && ( defined(_M_IX86) || defined(_M_X64) )
+#include <intrin.h>
 #endif
 #include <setjmp.h>
 #include "wswcurl.h"
@@ -40,6 +42,9 @@ static char *com_argv[MAX_NUM_ARGVS+1];
 static char com_errormsg[MAX_PRINTMSG];
 
 static jmp_buf abortframe;     // an ERR_DROP occured, exit the entire frame
+static ATTRIBUTE_TLS qboolean com_abortframeThread; // abortframe is on this thread's stack
+static ATTRIBUTE_TLS com_drophandler_t com_dropHandler; // unwinds an ERR_DROP on this thread instead
+static ATTRIBUTE_TLS void *com_dropHandlerContext;
 
 cvar_t *host_speeds;
 cvar_t *log_stats;
@@ -273,6 +278,19 @@ void Com_DPrintf( const char *format, ... )
 }
 
 
+/*
+* Com_SetDropHandler
+* 
+* Routes an ERR_DROP raised on this thread to handler, which must not return.
+* Threads that run work outside of the frame use this to only drop the
+* failing task, pass NULL when the task is done
+*/
+void Com_SetDropHandler( com_drophandler_t handler, void *context )
+{
+	com_dropHandler = handler;
+	com_dropHandlerContext = context;
+}
+
 /*
 * Com_Error
 * 
@@ -282,21 +300,37 @@ void Com_DPrintf( const char *format, ... )
 void Com_Error( com_error_code_t code, const char *format, ... )
 {
 	va_list	argptr;
-	char *msg = com_errormsg;
-	const size_t sizeof_msg = sizeof( com_errormsg );
-	static qboolean	recursive = qfalse;
+	char msg[MAX_PRINTMSG];
+	static ATTRIBUTE_TLS qboolean recursive = qfalse;
 
 	if( recursive )
 	{
-		Com_Printf( "recursive error after: %s", msg ); // wsw : jal : log it
-		Sys_Error( "recursive error after: %s", msg );
+		Com_Printf( "recursive error after: %s", com_errormsg ); // wsw : jal : log it
+		Sys_Error( "recursive error after: %s", com_errormsg );
 	}
 	recursive = qtrue;
 
 	va_start( argptr, format );
-	Q_vsnprintfz( msg, sizeof_msg, format, argptr );
+	Q_vsnprintfz( msg, sizeof( msg ), format, argptr );
 	va_end( argptr );
 
+	Q_strncpyz( com_errormsg, msg, sizeof( com_errormsg ) );
+
+	if( code == ERR_DROP && com_dropHandler )
+	{
+		com_drophandler_t handler = com_dropHandler;
+
+		Com_Printf( "********************\nERROR: %s\n********************\n", msg );
+		com_dropHandler = NULL;
+		recursive = qfalse;
+		handler( com_dropHandlerContext, msg );
+		recursive = qtrue;
+	}
+
+	// worker threads without a drop handler can't unwind to the frame
+	if( code == ERR_DROP && !com_abortframeThread )
+		code = ERR_FATAL;
+
 	if( code == ERR_DROP )
 	{
 		Com_Printf( "********************\nERROR: %s\n********************\n", msg );
@@ -645,8 +679,10 @@ static unsigned int com_CPUFeatures = 0xFFFFFFFF;
 static inline int CPU_haveCPUID()
 {
 	int has_CPUID = 0;
-#if defined(__GNUC__) && defined(i386)
+#if defined(__GNUC__) && ( defined(i386) || defined(__x86_64__) )
 	has_CPUID = __get_cpuid_max( 0, NULL ) ? 1 : 0;
+#elif defined(_MSC_VER) && defined(_M_X64)
+	has_CPUID = 1;
 #elif defined(_MSC_VER) && defined(_M_IX86)
 	__asm {
 		pushfd                      ; Get original EFLAGS
@@ -669,11 +705,16 @@ done:
 static inline int CPU_getCPUIDFeatures()
 {
 	int features = 0;
-#if defined(__GNUC__) && defined(i386)
+#if defined(__GNUC__) && ( defined(i386) || defined(__x86_64__) )
 	if( __get_cpuid_max( 0, NULL ) >= 1 ) {
-		int temp, temp2, temp3;
-		__get_cpuid( 1, &temp, &temp2, &temp3, &features );
+		unsigned int temp, temp2, temp3, edx = 0;
+		__get_cpuid( 1, &temp, &temp2, &temp3, &edx );
+		features = edx;
 	}
+#elif defined(_MSC_VER) && defined(_M_X64)
+	int info[4];
+	__cpuid( info, 1 );
+	features = info[3];
 #elif defined(_MSC_VER) && defined(_M_IX86)
 	__asm {
 		xor     eax, eax            ; Set up for CPUID instruction
@@ -693,10 +734,18 @@ done:
 static inline int CPU_getCPUIDFeaturesExt()
 {
 	int features = 0;
-#if defined(__GNUC__) && defined(i386)
+#if defined(__GNUC__) && ( defined(i386) || defined(__x86_64__) )
 	if( __get_cpuid_max( 0x80000000, NULL ) >= 0x80000001 ) {
-		int temp, temp2, temp3;
-		__get_cpuid( 0x80000001, &temp, &temp2, &temp3, &features );
+		unsigned int temp, temp2, temp3, edx = 0;
+		__get_cpuid( 0x80000001, &temp, &temp2, &temp3, &edx );
+		features = edx;
+	}
+#elif defined(_MSC_VER) && defined(_M_X64)
+	int info[4];
+	__cpuid( info, 0x80000000 );
+	if( (unsigned)info[0] >= 0x80000001 ) {
+		__cpuid( info, 0x80000001 );
+		features = info[3];
 	}
 #elif defined(_MSC_VER) && defined(_M_IX86)
 	__asm {
@@ -713,6 +762,43 @@ done:
 	return features;
 }
 
+/*
+* CPU_haveAVX2
+*
+* The OS has to save the YMM registers on context switches as well
+*/
+static inline int CPU_haveAVX2()
+{
+	int has_AVX2 = 0;
+#if defined(__GNUC__) && ( defined(i386) || defined(__x86_64__) )
+	unsigned int eax, ebx, ecx = 0, edx;
+
+	if( __get_cpuid_max( 0, NULL ) >= 7 ) {
+		__get_cpuid( 1, &eax, &ebx, &ecx, &edx );
+		if( ( ecx & ( bit_OSXSAVE|bit_AVX ) ) == ( bit_OSXSAVE|bit_AVX ) ) {
+			unsigned int xcr0, xcr0_high;
+			__asm__ __volatile__( "xgetbv" : "=a" ( xcr0 ), "=d" ( xcr0_high ) : "c" ( 0 ) );
+			if( ( xcr0 & 6 ) == 6 ) {
+				__cpuid_count( 7, 0, eax, ebx, ecx, edx );
+				has_AVX2 = ( ebx & bit_AVX2 ) ? 1 : 0;
+			}
+		}
+	}
+#elif defined(_MSC_VER) && ( _MSC_VER >= 1600 ) && ( defined(_M_IX86) || defined(_M_X64) )
+	int info[4];
+
+	__cpuid( info, 0 );
+	if( info[0] >= 7 ) {
+		__cpuid( info, 1 );
+		if( ( info[2] & ( ( 1<<27 )|( 1<<28 ) ) ) == ( ( 1<<27 )|( 1<<28 ) ) && ( _xgetbv( 0 ) & 6 ) == 6 ) {
+			__cpuidex( info, 7, 0 );
+			has_AVX2 = ( info[1] & ( 1<<5 ) ) ? 1 : 0;
+		}
+	}
+#endif
+	return has_AVX2;
+}
+
 /*
 * COM_CPUFeatures
 *
@@ -743,6 +829,8 @@ unsigned int COM_CPUFeatures( void )
 				com_CPUFeatures |= QCPU_HAS_SSE;
 			if( CPUIDFeatures & 0x04000000 )
 				com_CPUFeatures |= QCPU_HAS_SSE2;
+			if( CPU_haveAVX2() )
+				com_CPUFeatures |= QCPU_HAS_AVX2;
 		}
 	}
 
@@ -879,6 +967,7 @@ void Qcommon_ShutdownCommands( void )
 */
 void Qcommon_Init( int argc, char **argv )
 {
+	com_abortframeThread = qtrue;
 	if( setjmp( abortframe ) )
 		Sys_Error( "Error during initialization: %s", com_errormsg );
 
@@ -978,6 +1067,8 @@ void Qcommon_Init( int argc, char **argv )
 
 	Qcommon_InitCommands();
 
+	Prof_Init();
+
 	host_speeds =	    Cvar_Get( "host_speeds", "0", 0 );
 	log_stats =	    Cvar_Get( "log_stats", "0", 0 );
 	developer =	    Cvar_Get( "developer", "0", 0 );
@@ -1082,7 +1173,12 @@ void Qcommon_Frame( unsigned int realmsec )
 	static unsigned int gamemsec;
 
 	if( setjmp( abortframe ) )
+	{
+		Mem_FrameReset();
 		return; // an ERR_DROP was thrown
+	}
+
+	Prof_BeginFrame();
 
 	if( log_stats->modified )
 	{
@@ -1130,7 +1226,9 @@ void Qcommon_Frame( unsigned int realmsec )
 		c_pointcontents = 0;
 	}
 
+	PROF_ENTER( "wswcurl" );
 	wswcurl_perform();
+	PROF_LEAVE();
 
 	FS_Frame();
 
@@ -1155,12 +1253,16 @@ void Qcommon_Frame( unsigned int realmsec )
 	if( host_speeds->integer )
 		time_before = Sys_Milliseconds();
 
+	PROF_ENTER( "sv_frame" );
 	SV_Frame( realmsec, gamemsec );
+	PROF_LEAVE();
 
 	if( host_speeds->integer )
 		time_between = Sys_Milliseconds();
 
+	PROF_ENTER( "cl_frame" );
 	CL_Frame( realmsec, gamemsec );
+	PROF_LEAVE();
 
 	if( host_speeds->integer )
 		time_after = Sys_Milliseconds();
@@ -1187,6 +1289,10 @@ void Qcommon_Frame( unsigned int realmsec )
 		frametick = Dynvar_Lookup( "frametick" );
 	Dynvar_CallListeners( frametick, &fc );
 	++fc;
+
+	Mem_FrameReset();
+
+	Prof_EndFrame();
 }
 
 /*
@@ -1211,6 +1317,7 @@ void Qcommon_Shutdown( void )
 
 	Steam_UnloadLibrary();
 
+	Prof_Shutdown();
 	Qcommon_ShutdownCommands();
 	Memory_ShutdownCommands();
 
@@ -1225,6 +1332,7 @@ void Qcommon_Shutdown( void )
 		log_file = 0;
 	}
 	logconsole = NULL;
+	SNAP_ShutdownDemoWriters();
 	FS_Shutdown();
 
 	wswcurl_cleanup();
@@ -167,12 +167,16 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 				var->string = ZoneCopyString( (char *) var_value );
 				var->value = atof( var->string );
 				var->integer = Q_rint( var->value );
+				info_modcount++;
 			}
 			var->flags = flags;
 		}
 
 		if( Cvar_FlagIsSet( flags, CVAR_USERINFO ) && !Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) )
 			userinfo_modified = qtrue; // transmit at next oportunity
+		if( ( Cvar_FlagIsSet( flags, CVAR_USERINFO ) && !Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) ) ||
+			( Cvar_FlagIsSet( flags, CVAR_SERVERINFO ) && !Cvar_FlagIsSet( var->flags, CVAR_SERVERINFO ) ) )
+			info_modcount++;
 
 		Cvar_FlagSet( &var->flags, flags );
 		return var;
@@ -200,6 +204,9 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 	var->integer = Q_rint( var->value );
 	var->flags = flags;
 
+	if( Cvar_FlagIsSet( flags, CVAR_USERINFO ) || Cvar_FlagIsSet( flags, CVAR_SERVERINFO ) )
+		info_modcount++;
+
 	QMutex_Lock( cvar_mutex );
 	Trie_Insert( cvar_trie, var_name, var );
 	QMutex_Unlock( cvar_mutex );
@@ -295,6 +302,8 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean forc
 					var->value = atof( var->string );
 					var->integer = Q_rint( var->value );
 					Cvar_SetModified( var );
+					if( Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) || Cvar_FlagIsSet( var->flags, CVAR_SERVERINFO ) )
+						info_modcount++;
 				}
 			}
 			return var;
@@ -316,6 +325,8 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean forc
 
 	if( Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) )
 		userinfo_modified = qtrue; // transmit at next oportunity
+	if( Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) || Cvar_FlagIsSet( var->flags, CVAR_SERVERINFO ) )
+		info_modcount++;
 
 	Mem_ZoneFree( var->string ); // free the old value string
 
@@ -364,6 +375,9 @@ cvar_t *Cvar_FullSet( const char *var_name, const char *value, cvar_flag_t flags
 		Cvar_FlagSet( &var->flags, flags );
 	}
 
+	if( Cvar_FlagIsSet( flags, CVAR_USERINFO ) || Cvar_FlagIsSet( flags, CVAR_SERVERINFO ) )
+		info_modcount++;
+
 	// if we overwrite the flags, we will also force the value
 	return Cvar_Set2( var_name, value, overwrite_flags );
 }
@@ -712,6 +726,7 @@ static void Cvar_ArchiveList_f( void )
 #endif
 
 qboolean userinfo_modified;
+unsigned int info_modcount;
 
 static char *Cvar_BitInfo( int bit )
 {
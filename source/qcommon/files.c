@@ -240,13 +240,17 @@ static char *FS_CopyString( const char *in )
 }
 
 /*
-* FS_ListFiles
+* FS_ListFilesExt
+* 
+* If frame is true, the list and the names are allocated from the frame arena
+* and must not be freed.
 */
-static char **FS_ListFiles( char *findname, int *numfiles, unsigned musthave, unsigned canthave )
+static char **FS_ListFilesExt( char *findname, int *numfiles, unsigned musthave, unsigned canthave, qboolean frame )
 {
 	const char *s;
 	int nfiles = 0;
-	static char **list = NULL;
+	size_t len;
+	char **list = NULL;
 
 	s = Sys_FS_FindFirst( findname, musthave, canthave );
 	while( s )
@@ -262,7 +266,10 @@ static char **FS_ListFiles( char *findname, int *numfiles, unsigned musthave, un
 
 	*numfiles = nfiles;
 	nfiles++; // add space for a guard
-	list = ( char** )Mem_ZoneMalloc( sizeof( char * ) * nfiles );
+	if( frame )
+		list = ( char** )Mem_FrameAllocExt( sizeof( char * ) * nfiles, 0 );
+	else
+		list = ( char** )Mem_ZoneMalloc( sizeof( char * ) * nfiles );
 
 	s = Sys_FS_FindFirst( findname, musthave, canthave );
 	nfiles = 0;
@@ -271,7 +278,16 @@ static char **FS_ListFiles( char *findname, int *numfiles, unsigned musthave, un
 		if( !COM_ValidateFilename( s ) )
 			continue;
 
-		list[nfiles] = ZoneCopyString( s );
+		if( frame )
+		{
+			len = strlen( s ) + 1;
+			list[nfiles] = ( char* )Mem_FrameAllocExt( len, 0 );
+			memcpy( list[nfiles], s, len );
+		}
+		else
+		{
+			list[nfiles] = ZoneCopyString( s );
+		}
 
 #ifdef _WIN32
 		Q_strlwr( list[nfiles] );
@@ -285,6 +301,14 @@ static char **FS_ListFiles( char *findname, int *numfiles, unsigned musthave, un
 	return list;
 }
 
+/*
+* FS_ListFiles
+*/
+static char **FS_ListFiles( char *findname, int *numfiles, unsigned musthave, unsigned canthave )
+{
+	return FS_ListFilesExt( findname, numfiles, musthave, canthave, qfalse );
+}
+
 /*
 * FS_SearchPakForFile
 */
@@ -626,8 +650,10 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 	size_t filename_size;       // size of one slot
 	int i;
 	size_t max_extension_length;
+	size_t mark;
 	searchpath_t *search;
 	qboolean purepass;
+	const char *found;
 
 	assert( filename && extensions );
 
@@ -650,7 +676,8 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 	}
 
 	// set the filenames to be tested
-	filenames = ( char** )Mem_TempMalloc( sizeof( char * ) * num_extensions );
+	mark = Mem_FrameMark();
+	filenames = ( char** )Mem_FrameAllocExt( sizeof( char * ) * num_extensions, 0 );
 	filename_size = sizeof( char ) * ( strlen( filename ) + max_extension_length + 1 );
 
 	for( i = 0; i < num_extensions; i++ )
@@ -658,7 +685,7 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 		if( i )
 			filenames[i] = ( char * )( ( qbyte * )filenames[0] + filename_size * i );
 		else
-			filenames[i] = ( char* )Mem_TempMalloc( filename_size * num_extensions );
+			filenames[i] = ( char* )Mem_FrameAllocExt( filename_size * num_extensions, 0 );
 		Q_strncpyz( filenames[i], filename, filename_size );
 		COM_ReplaceExtension( filenames[i], extensions[i], filename_size );
 	}
@@ -666,7 +693,8 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 	// search through the path, one element at a time
 	search = fs_searchpaths;
 	purepass = qtrue;
-	while( search )
+	found = NULL;
+	while( search && !found )
 	{
 		if( search->pack ) // is the element a pak file?
 		{
@@ -676,9 +704,8 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 				{
 					if( FS_SearchPakForFile( search->pack, filenames[i], NULL ) )
 					{
-						Mem_TempFree( filenames[0] );
-						Mem_TempFree( filenames );
-						return extensions[i];
+						found = extensions[i];
+						break;
 					}
 				}
 			}
@@ -691,9 +718,8 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 				{
 					if( FS_SearchDirectoryForFile( search, filenames[i], NULL, 0 ) )
 					{
-						Mem_TempFree( filenames[0] );
-						Mem_TempFree( filenames );
-						return extensions[i];
+						found = extensions[i];
+						break;
 					}
 				}
 			}
@@ -709,10 +735,9 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 		}
 	}
 
-	Mem_TempFree( filenames[0] );
-	Mem_TempFree( filenames );
+	Mem_FrameRelease( mark );
 
-	return NULL;
+	return found;
 }
 
 /*
@@ -2650,7 +2675,7 @@ static int FS_PathGetFileListExt( searchpath_t *search, const char *dir, const c
 
 	if( !search->pack )
 	{
-		size_t searchlen;
+		size_t searchlen, mark;
 		int numfiles;
 		char **filenames;
 		unsigned int musthave, canthave;
@@ -2687,7 +2712,8 @@ static int FS_PathGetFileListExt( searchpath_t *search, const char *dir, const c
 			Q_strncatz( tempname, "*.*", sizeof( tempname ) );
 		}
 
-		if( ( filenames = FS_ListFiles( tempname, &numfiles, musthave, canthave ) ) )
+		mark = Mem_FrameMark();
+		if( ( filenames = FS_ListFilesExt( tempname, &numfiles, musthave, canthave, qtrue ) ) )
 		{
 			for( i = 0; i < numfiles; i++ )
 			{
@@ -2712,19 +2738,15 @@ static int FS_PathGetFileListExt( searchpath_t *search, const char *dir, const c
 					else
 					{
 						if( extension && ( len <= extlen ) )
-						{
-							Mem_ZoneFree( filenames[i] );
 							continue;
-						}
 						files[found].name = ZoneCopyString( filenames[i] + searchlen );
 					}
 					files[found].searchPath = search;
 					found++;
 				}
-				Mem_ZoneFree( filenames[i] );
 			}
 		}
-		Mem_ZoneFree( filenames );
+		Mem_FrameRelease( mark );
 
 		return found;
 	}
@@ -3084,7 +3106,7 @@ int FS_GetGameDirectoryList( char *buf, size_t bufsize )
 {
 	char **modnames;
 	int i, j, length, nummods, nummods_total;
-	size_t len, alllen;
+	size_t len, alllen, mark;
 	const char *basename, *s;
 	searchpath_t *basepath;
 
@@ -3098,7 +3120,8 @@ int FS_GetGameDirectoryList( char *buf, size_t bufsize )
 	basepath = fs_basepaths;
 	while( basepath )
 	{
-		if( ( modnames = FS_ListFiles( va( "%s/*", basepath->path ), &nummods, SFF_SUBDIR, SFF_HIDDEN | SFF_SYSTEM ) ) )
+		mark = Mem_FrameMark();
+		if( ( modnames = FS_ListFilesExt( va( "%s/*", basepath->path ), &nummods, SFF_SUBDIR, SFF_HIDDEN | SFF_SYSTEM, qtrue ) ) )
 		{
 			for( i = 0; i < nummods; i++ )
 			{
@@ -3133,11 +3156,10 @@ int FS_GetGameDirectoryList( char *buf, size_t bufsize )
 				strcpy( buf + alllen, basename );
 				alllen += len + 1;
 				buf[alllen] = '\0';
-				Mem_ZoneFree( modnames[i] );
 				nummods_total++;
 			}
-			Mem_ZoneFree( modnames );
 		}
+		Mem_FrameRelease( mark );
 		basepath = basepath->next;
 	}
 
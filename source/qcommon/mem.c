@@ -31,9 +31,26 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define MEMALIGNMENT_DEFAULT		16
 
+// allocations of up to MEMCLASS_MAXSIZE bytes (sentinel included) are carved from
+// slabs into size classes and recycled through per-thread free lists, so neither
+// malloc nor memMutex is touched unless a free list runs dry or overflows
+#define MEMCLASS_MAXSIZE			1024
+#define MEMCLASS_COUNT				28
+
+#define MEMSLAB_SIZE				0x10000
+
+// number of free blocks moved between a thread cache and the shared depot at once
+#define MEMCACHE_BATCH				64
+
+// number of pools each thread keeps its own chains and counters for
+#define MEMCACHE_POOLS				256
+#define MEMCACHE_MAXPROBES			16
+#define MEMCACHE_DEADPOOL			( (mempool_t *)1 )
+
 typedef struct memheader_s
 {
 	// address returned by malloc (may be significantly before this header to satisify alignment)
+	// or NULL if the memory was carved from a slab
 	void *baseaddress;
 
 	// next and previous memheaders in chain belonging to pool
@@ -43,6 +60,9 @@ typedef struct memheader_s
 	// pool this memheader belongs to
 	struct mempool_s *pool;
 
+	// thread cache holding the chain, NULL if the memheader is linked to the pool itself
+	struct memcache_s *cache;
+
 	// size of the memory after the header (excluding header and sentinel2)
 	size_t size;
 
@@ -58,6 +78,10 @@ typedef struct memheader_s
 	// immediately followed by data, which is followed by a MEMHEADER_SENTINEL2 byte
 } memheader_t;
 
+// slab blocks start at a multiple of MEMALIGNMENT_DEFAULT, the header is placed so
+// that it ends where the data begins
+#define MEMSLAB_HEADERSIZE			( ( sizeof( memheader_t ) + MEMALIGNMENT_DEFAULT-1 ) & ~( MEMALIGNMENT_DEFAULT-1 ) )
+
 struct mempool_s
 {
 	// should always be MEMHEADER_SENTINEL1
@@ -96,6 +120,43 @@ struct mempool_s
 	unsigned int sentinel2;
 };
 
+typedef struct memslab_s
+{
+	struct memslab_s *next;
+	int sizeclass;
+} memslab_t;
+
+typedef struct
+{
+	// NULL if the slot is empty, MEMCACHE_DEADPOOL if the pool has been freed
+	mempool_t *pool;
+
+	// allocations made by this thread, the counters may go negative when
+	// blocks are freed by a thread other than the one that allocated them
+	memheader_t *chain;
+	int totalsize;
+	int realsize;
+} memcachepool_t;
+
+typedef struct memcache_s
+{
+	// guards the pool slots, only contended when another thread frees
+	// a block allocated by this one or walks the chains
+	volatile int lock;
+
+	// free slab blocks of each size class, linked through memheader_t->next
+	memheader_t *free[MEMCLASS_COUNT];
+	int numfree[MEMCLASS_COUNT];
+
+	memcachepool_t pools[MEMCACHE_POOLS];
+
+	// set when the owning thread has exited, guarded by memMutex
+	qboolean orphaned;
+
+	// the chain is only ever prepended to, so it can be walked without locking
+	struct memcache_s *next;
+} memcache_t;
+
 // ============================================================================
 
 //#define SHOW_NONFREED
@@ -114,6 +175,16 @@ mempool_t *zoneMemPool;
 
 static qmutex_t *memMutex;
 
+static memcache_t *memCacheChain;
+static ATTRIBUTE_TLS memcache_t *memCache;
+
+// free blocks returned by the thread caches, guarded by memMutex
+static memheader_t *memDepot[MEMCLASS_COUNT];
+static int memDepotCount[MEMCLASS_COUNT];
+
+static memslab_t *memSlabChain;
+static int memNumSlabs;
+
 static qboolean memory_initialized = qfalse;
 static qboolean commands_initialized = qfalse;
 
@@ -129,10 +200,467 @@ static void _Mem_Error( const char *format, ... )
 	Sys_Error( msg );
 }
 
+/*
+* Mem_SizeClass
+* 
+* 16 bytes steps up to 256 bytes, 64 bytes steps up to MEMCLASS_MAXSIZE.
+*/
+static int Mem_SizeClass( size_t size )
+{
+	if( size <= 256 )
+		return ( size + 15 ) / 16 - 1;
+	return 16 + ( size - 256 + 63 ) / 64 - 1;
+}
+
+/*
+* Mem_ClassSize
+*/
+static size_t Mem_ClassSize( int sizeclass )
+{
+	if( sizeclass < 16 )
+		return ( sizeclass + 1 ) * 16;
+	return 256 + ( sizeclass - 15 ) * 64;
+}
+
+/*
+* Mem_LockCache
+*/
+static void Mem_LockCache( memcache_t *cache )
+{
+	while( !Sys_Atomic_CAS( &cache->lock, 0, 1, NULL ) )
+		Sys_Thread_Yield();
+}
+
+/*
+* Mem_UnlockCache
+*/
+static void Mem_UnlockCache( memcache_t *cache )
+{
+	Sys_Atomic_CAS( &cache->lock, 1, 0, NULL );
+}
+
+/*
+* Mem_GetCache
+* 
+* Returns the calling thread's cache, adopting the cache of an exited
+* thread or creating a new one on first use.
+*/
+static memcache_t *Mem_GetCache( void )
+{
+	memcache_t *cache;
+
+	if( memCache )
+		return memCache;
+
+	// caches can't be freed as blocks still allocated from them point back
+	// at them, so reuse one left behind by a thread that has exited
+	QMutex_Lock( memMutex );
+	for( cache = memCacheChain; cache; cache = cache->next )
+	{
+		if( cache->orphaned )
+		{
+			cache->orphaned = qfalse;
+			break;
+		}
+	}
+	QMutex_Unlock( memMutex );
+
+	if( cache )
+	{
+		memCache = cache;
+		return cache;
+	}
+
+	cache = ( memcache_t * )malloc( sizeof( memcache_t ) );
+	if( cache == NULL )
+		_Mem_Error( "Mem_GetCache: out of memory" );
+	memset( cache, 0, sizeof( memcache_t ) );
+
+	QMutex_Lock( memMutex );
+	cache->next = memCacheChain;
+	memCacheChain = cache;
+	QMutex_Unlock( memMutex );
+
+	memCache = cache;
+	return cache;
+}
+
+/*
+* Mem_CachePool
+* 
+* Finds the cache slot for the pool, the cache must be locked unless the result is only peeked at.
+*/
+static memcachepool_t *Mem_CachePool( memcache_t *cache, mempool_t *pool, qboolean create )
+{
+	int i;
+	unsigned int hash;
+	memcachepool_t *slot, *empty = NULL;
+
+	hash = (unsigned int)( ( (size_t)pool >> 4 ) ^ ( (size_t)pool >> 12 ) );
+	for( i = 0; i < MEMCACHE_MAXPROBES; i++ )
+	{
+		slot = &cache->pools[( hash + i ) & ( MEMCACHE_POOLS-1 )];
+		if( slot->pool == pool )
+			return slot;
+		if( !slot->pool )
+		{
+			if( !empty )
+				empty = slot;
+			break;
+		}
+		if( slot->pool == MEMCACHE_DEADPOOL && !empty )
+			empty = slot;
+	}
+
+	if( !create || !empty )
+		return NULL;
+
+	empty->pool = pool;
+	empty->chain = NULL;
+	empty->totalsize = 0;
+	empty->realsize = 0;
+	return empty;
+}
+
+/*
+* Mem_RefillClass
+* 
+* Takes a batch of free blocks from the depot or carves a new slab.
+*/
+static void Mem_RefillClass( memcache_t *cache, int sizeclass )
+{
+	int i, numblocks;
+	size_t blocksize;
+	qbyte *data;
+	memslab_t *slab;
+	memheader_t *mem, *last;
+
+	QMutex_Lock( memMutex );
+	if( memDepot[sizeclass] )
+	{
+		mem = last = memDepot[sizeclass];
+		for( i = 1; i < MEMCACHE_BATCH && last->next; i++ )
+			last = last->next;
+
+		memDepot[sizeclass] = last->next;
+		memDepotCount[sizeclass] -= i;
+		QMutex_Unlock( memMutex );
+
+		last->next = cache->free[sizeclass];
+		cache->free[sizeclass] = mem;
+		cache->numfree[sizeclass] += i;
+		return;
+	}
+	QMutex_Unlock( memMutex );
+
+	slab = ( memslab_t * )malloc( MEMSLAB_SIZE );
+	if( slab == NULL )
+		_Mem_Error( "Mem_RefillClass: out of memory" );
+	slab->sizeclass = sizeclass;
+
+	blocksize = MEMSLAB_HEADERSIZE + Mem_ClassSize( sizeclass );
+	data = ( qbyte * )( ( (size_t)slab + sizeof( memslab_t ) + MEMALIGNMENT_DEFAULT-1 ) & ~( MEMALIGNMENT_DEFAULT-1 ) );
+	numblocks = ( MEMSLAB_SIZE - ( data - ( qbyte * )slab ) ) / blocksize;
+
+	for( i = 0; i < numblocks; i++, data += blocksize )
+	{
+		mem = ( memheader_t * )( data + MEMSLAB_HEADERSIZE - sizeof( memheader_t ) );
+		mem->baseaddress = NULL;
+		mem->pool = NULL;
+		mem->realsize = blocksize;
+		mem->next = cache->free[sizeclass];
+		cache->free[sizeclass] = mem;
+	}
+	cache->numfree[sizeclass] += numblocks;
+
+	QMutex_Lock( memMutex );
+	slab->next = memSlabChain;
+	memSlabChain = slab;
+	memNumSlabs++;
+	QMutex_Unlock( memMutex );
+}
+
+/*
+* Mem_FlushClass
+* 
+* Hands a batch of free blocks over to the depot so that blocks freed by
+* one thread can be reused by another.
+*/
+static void Mem_FlushClass( memcache_t *cache, int sizeclass )
+{
+	int i;
+	memheader_t *mem, *last;
+
+	mem = last = cache->free[sizeclass];
+	for( i = 1; i < MEMCACHE_BATCH; i++ )
+		last = last->next;
+
+	cache->free[sizeclass] = last->next;
+	cache->numfree[sizeclass] -= i;
+
+	QMutex_Lock( memMutex );
+	last->next = memDepot[sizeclass];
+	memDepot[sizeclass] = mem;
+	memDepotCount[sizeclass] += i;
+	QMutex_Unlock( memMutex );
+}
+
+/*
+* Mem_ReleaseCache
+* 
+* Hands all free blocks of the calling thread's cache over to the depot
+* and leaves the cache for the next thread to adopt.
+*/
+static void Mem_ReleaseCache( void )
+{
+	int i;
+	memcache_t *cache = memCache;
+	memheader_t *last;
+
+	if( !cache )
+		return;
+	memCache = NULL;
+
+	QMutex_Lock( memMutex );
+	for( i = 0; i < MEMCLASS_COUNT; i++ )
+	{
+		if( !cache->free[i] )
+			continue;
+
+		for( last = cache->free[i]; last->next; last = last->next );
+		last->next = memDepot[i];
+		memDepot[i] = cache->free[i];
+		memDepotCount[i] += cache->numfree[i];
+
+		cache->free[i] = NULL;
+		cache->numfree[i] = 0;
+	}
+	cache->orphaned = qtrue;
+	QMutex_Unlock( memMutex );
+}
+
+/*
+* Mem_LinkBlock
+*/
+static void Mem_LinkBlock( memheader_t *mem, mempool_t *pool )
+{
+	memcache_t *cache;
+	memcachepool_t *slot;
+
+	cache = Mem_GetCache();
+
+	mem->prev = NULL;
+
+	Mem_LockCache( cache );
+	slot = Mem_CachePool( cache, pool, qtrue );
+	if( slot )
+	{
+		mem->cache = cache;
+		mem->next = slot->chain;
+		slot->chain = mem;
+		if( mem->next )
+			mem->next->prev = mem;
+
+		slot->totalsize += mem->size;
+		slot->realsize += mem->realsize;
+		Mem_UnlockCache( cache );
+		return;
+	}
+	Mem_UnlockCache( cache );
+
+	// this thread uses too many pools, link to the pool itself
+	QMutex_Lock( memMutex );
+
+	mem->cache = NULL;
+	mem->next = pool->chain;
+	pool->chain = mem;
+	if( mem->next )
+		mem->next->prev = mem;
+
+	pool->totalsize += mem->size;
+	pool->realsize += mem->realsize;
+
+	QMutex_Unlock( memMutex );
+}
+
+/*
+* Mem_UnlinkBlock
+*/
+static void Mem_UnlinkBlock( memheader_t *mem, const char *filename, int fileline )
+{
+	mempool_t *pool = mem->pool;
+	memcache_t *cache = mem->cache;
+	memcachepool_t *slot = NULL;
+	memheader_t **chain;
+	int *totalsize, *realsize;
+
+	if( cache )
+	{
+		Mem_LockCache( cache );
+		slot = Mem_CachePool( cache, pool, qfalse );
+		if( !slot )
+			_Mem_Error( "Mem_Free: not allocated or double freed (free at %s:%i)", filename, fileline );
+		chain = &slot->chain;
+		totalsize = &slot->totalsize;
+		realsize = &slot->realsize;
+	}
+	else
+	{
+		QMutex_Lock( memMutex );
+		chain = &pool->chain;
+		totalsize = &pool->totalsize;
+		realsize = &pool->realsize;
+	}
+
+	// unlink memheader from doubly linked list
+	if( ( mem->prev ? mem->prev->next != mem : *chain != mem ) || ( mem->next && mem->next->prev != mem ) )
+		_Mem_Error( "Mem_Free: not allocated or double freed (free at %s:%i)", filename, fileline );
+
+	if( mem->prev )
+		mem->prev->next = mem->next;
+	else
+		*chain = mem->next;
+	if( mem->next )
+		mem->next->prev = mem->prev;
+
+	*totalsize -= mem->size;
+	*realsize -= mem->realsize;
+	mem->pool = NULL;
+
+	if( cache )
+		Mem_UnlockCache( cache );
+	else
+		QMutex_Unlock( memMutex );
+}
+
+/*
+* Mem_ReleaseBlock
+* 
+* Returns an unlinked block to the calling thread's free list or to the system.
+*/
+static void Mem_ReleaseBlock( memheader_t *mem )
+{
+	int sizeclass;
+	memcache_t *cache;
+
+#ifdef MEMTRASH
+	memset( (qbyte *) mem + sizeof( memheader_t ), 0xBF, mem->size + 1 );
+#endif
+
+	if( mem->baseaddress )
+	{
+		free( mem->baseaddress );
+		return;
+	}
+
+	sizeclass = Mem_SizeClass( mem->realsize - MEMSLAB_HEADERSIZE );
+	cache = Mem_GetCache();
+
+	mem->next = cache->free[sizeclass];
+	cache->free[sizeclass] = mem;
+	if( ++cache->numfree[sizeclass] > MEMCACHE_BATCH * 2 )
+		Mem_FlushClass( cache, sizeclass );
+}
+
+/*
+* Mem_CachedPoolStats
+*/
+static void Mem_CachedPoolStats( mempool_t *pool, int *size, int *realsize )
+{
+	memcache_t *cache;
+	memcachepool_t *slot;
+
+	for( cache = memCacheChain; cache; cache = cache->next )
+	{
+		Mem_LockCache( cache );
+		slot = Mem_CachePool( cache, pool, qfalse );
+		if( slot )
+		{
+			if( size )
+				( *size ) += slot->totalsize;
+			if( realsize )
+				( *realsize ) += slot->realsize;
+		}
+		Mem_UnlockCache( cache );
+	}
+}
+
+/*
+* Mem_PrintPoolAllocations
+* 
+* The chains of other threads are walked without locking, printing may allocate.
+*/
+static void Mem_PrintPoolAllocations( mempool_t *pool )
+{
+	memcache_t *cache;
+	memcachepool_t *slot;
+	memheader_t *mem;
+
+	for( mem = pool->chain; mem; mem = mem->next )
+		Com_Printf( "%10i bytes allocated at %s:%i\n", mem->size, mem->filename, mem->fileline );
+
+	for( cache = memCacheChain; cache; cache = cache->next )
+	{
+		slot = Mem_CachePool( cache, pool, qfalse );
+		if( !slot )
+			continue;
+		for( mem = slot->chain; mem; mem = mem->next )
+			Com_Printf( "%10i bytes allocated at %s:%i\n", mem->size, mem->filename, mem->fileline );
+	}
+}
+
+/*
+* Mem_ReleasePoolBlocks
+* 
+* Frees everything allocated from the pool by any thread.
+*/
+static void Mem_ReleasePoolBlocks( mempool_t *pool, qboolean forget, const char *filename, int fileline )
+{
+	memcache_t *cache;
+	memcachepool_t *slot;
+	memheader_t *mem, *next, *list = NULL;
+
+	for( cache = memCacheChain; cache; cache = cache->next )
+	{
+		Mem_LockCache( cache );
+		slot = Mem_CachePool( cache, pool, qfalse );
+		if( slot )
+		{
+			for( mem = slot->chain; mem; mem = next )
+			{
+				next = mem->next;
+				mem->next = list;
+				list = mem;
+			}
+
+			slot->chain = NULL;
+			slot->totalsize = 0;
+			slot->realsize = 0;
+			if( forget )
+				slot->pool = MEMCACHE_DEADPOOL;
+		}
+		Mem_UnlockCache( cache );
+	}
+
+	// blocks are released to the calling thread which may have to lock memMutex
+	for( mem = list; mem; mem = next )
+	{
+		next = mem->next;
+		_Mem_CheckSentinels( (void *)( (qbyte *) mem + sizeof( memheader_t ) ), filename, fileline );
+		mem->pool = NULL;
+		Mem_ReleaseBlock( mem );
+	}
+
+	while( pool->chain )
+		Mem_Free( (void *)( (qbyte *) pool->chain + sizeof( memheader_t ) ) );
+}
+
 void *_Mem_AllocExt( mempool_t *pool, size_t size, size_t alignment, int z, int musthave, int canthave, const char *filename, int fileline )
 {
 	void *base;
 	size_t realsize;
+	int sizeclass;
+	memcache_t *cache;
 	memheader_t *mem;
 
 	if( size <= 0 )
@@ -154,38 +682,42 @@ void *_Mem_AllocExt( mempool_t *pool, size_t size, size_t alignment, int z, int
 	if( developerMemory && developerMemory->integer )
 		Com_DPrintf( "Mem_Alloc: pool %s, file %s:%i, size %i bytes\n", pool->name, filename, fileline, size );
 
-	QMutex_Lock( memMutex );
+	if( alignment <= MEMALIGNMENT_DEFAULT && size < MEMCLASS_MAXSIZE )
+	{
+		cache = Mem_GetCache();
+		sizeclass = Mem_SizeClass( size + 1 );
 
-	pool->totalsize += size;
-	realsize = sizeof( memheader_t ) + size + alignment + sizeof( int );
+		if( !cache->free[sizeclass] )
+			Mem_RefillClass( cache, sizeclass );
 
-	pool->realsize += realsize;
+		mem = cache->free[sizeclass];
+		cache->free[sizeclass] = mem->next;
+		cache->numfree[sizeclass]--;
+	}
+	else
+	{
+		realsize = sizeof( memheader_t ) + size + alignment + sizeof( int );
 
-	base = malloc( realsize );
-	if( base == NULL )
-		_Mem_Error( "Mem_Alloc: out of memory (alloc at %s:%i)", filename, fileline );
+		base = malloc( realsize );
+		if( base == NULL )
+			_Mem_Error( "Mem_Alloc: out of memory (alloc at %s:%i)", filename, fileline );
+
+		// calculate address that aligns the end of the memheader_t to the specified alignment
+		mem = ( memheader_t * )((((size_t)base + sizeof( memheader_t ) + (alignment-1)) & ~(alignment-1)) - sizeof( memheader_t ));
+		mem->baseaddress = base;
+		mem->realsize = realsize;
+	}
 
-	// calculate address that aligns the end of the memheader_t to the specified alignment
-	mem = ( memheader_t * )((((size_t)base + sizeof( memheader_t ) + (alignment-1)) & ~(alignment-1)) - sizeof( memheader_t ));
-	mem->baseaddress = base;
 	mem->filename = filename;
 	mem->fileline = fileline;
 	mem->size = size;
-	mem->realsize = realsize;
 	mem->pool = pool;
 	mem->sentinel1 = MEMHEADER_SENTINEL1;
 
 	// we have to use only a single byte for this sentinel, because it may not be aligned, and some platforms can't use unaligned accesses
 	*( (qbyte *) mem + sizeof( memheader_t ) + mem->size ) = MEMHEADER_SENTINEL2;
 
-	// append to head of list
-	mem->next = pool->chain;
-	mem->prev = NULL;
-	pool->chain = mem;
-	if( mem->next )
-		mem->next->prev = mem;
-
-	QMutex_Unlock( memMutex );
+	Mem_LinkBlock( mem, pool );
 
 	if( z )
 		memset( (void *)( (qbyte *) mem + sizeof( memheader_t ) ), 0, mem->size );
@@ -237,7 +769,6 @@ char *_Mem_CopyString( mempool_t *pool, const char *in, const char *filename, in
 
 void _Mem_Free( void *data, int musthave, int canthave, const char *filename, int fileline )
 {
-	void *base;
 	memheader_t *mem;
 	mempool_t *pool;
 
@@ -256,6 +787,8 @@ void _Mem_Free( void *data, int musthave, int canthave, const char *filename, in
 		_Mem_Error( "Mem_Free: trashed header sentinel 2 (alloc at %s:%i, free at %s:%i)", mem->filename, mem->fileline, filename, fileline );
 
 	pool = mem->pool;
+	if( pool == NULL )
+		_Mem_Error( "Mem_Free: not allocated or double freed (free at %s:%i)", filename, fileline );
 	if( musthave && ( ( pool->flags & musthave ) != musthave ) )
 		_Mem_Error( "Mem_Free: bad pool flags (musthave) (alloc at %s:%i)", filename, fileline );
 	if( canthave && ( pool->flags & canthave ) )
@@ -264,32 +797,9 @@ void _Mem_Free( void *data, int musthave, int canthave, const char *filename, in
 	if( developerMemory && developerMemory->integer )
 		Com_DPrintf( "Mem_Free: pool %s, alloc %s:%i, free %s:%i, size %i bytes\n", pool->name, mem->filename, mem->fileline, filename, fileline, mem->size );
 
-	QMutex_Lock( memMutex );
-
-	// unlink memheader from doubly linked list
-	if( ( mem->prev ? mem->prev->next != mem : pool->chain != mem ) || ( mem->next && mem->next->prev != mem ) )
-		_Mem_Error( "Mem_Free: not allocated or double freed (free at %s:%i)", filename, fileline );
-
-	if( mem->prev )
-		mem->prev->next = mem->next;
-	else
-		pool->chain = mem->next;
-	if( mem->next )
-		mem->next->prev = mem->prev;
-
 	// memheader has been unlinked, do the actual free now
-	pool->totalsize -= mem->size;
-
-	base = mem->baseaddress;
-	pool->realsize -= mem->realsize;
-
-	QMutex_Unlock( memMutex );
-
-#ifdef MEMTRASH
-	memset( mem, 0xBF, sizeof( memheader_t ) + mem->size + sizeof( int ) );
-#endif
-
-	free( base );
+	Mem_UnlinkBlock( mem, filename, fileline );
+	Mem_ReleaseBlock( mem );
 }
 
 mempool_t *_Mem_AllocPool( mempool_t *parent, const char *name, int flags, const char *filename, int fileline )
@@ -345,10 +855,6 @@ mempool_t *_Mem_AllocTempPool( const char *name, const char *filename, int filel
 void _Mem_FreePool( mempool_t **pool, int musthave, int canthave, const char *filename, int fileline )
 {
 	mempool_t **chainAddress;
-#ifdef SHOW_NONFREED
-	memheader_t *mem;
-#endif
-
 	if( !( *pool ) )
 		return;
 	if( musthave && ( ( ( *pool )->flags & musthave ) != musthave ) )
@@ -373,11 +879,10 @@ void _Mem_FreePool( mempool_t **pool, int musthave, int canthave, const char *fi
 		_Mem_Error( "Mem_FreePool: trashed pool sentinel 2 (allocpool at %s:%i, freepool at %s:%i)", ( *pool )->filename, ( *pool )->fileline, filename, fileline );
 
 #ifdef SHOW_NONFREED
-	if( ( *pool )->chain )
-		Com_Printf( "Warning: Memory pool %s has resources that weren't freed:\n", ( *pool )->name );
-	for( mem = ( *pool )->chain; mem; mem = mem->next )
+	if( Mem_PoolTotalSize( *pool ) )
 	{
-		Com_Printf( "%10i bytes allocated at %s:%i\n", mem->size, mem->filename, mem->fileline );
+		Com_Printf( "Warning: Memory pool %s has resources that weren't freed:\n", ( *pool )->name );
+		Mem_PrintPoolAllocations( *pool );
 	}
 #endif
 
@@ -390,8 +895,8 @@ void _Mem_FreePool( mempool_t **pool, int musthave, int canthave, const char *fi
 	if( *chainAddress != *pool )
 		_Mem_Error( "Mem_FreePool: pool already free (freepool at %s:%i)", filename, fileline );
 
-	while( ( *pool )->chain )  // free memory owned by the pool
-		Mem_Free( (void *)( (qbyte *)( *pool )->chain + sizeof( memheader_t ) ) );
+	// free memory owned by the pool
+	Mem_ReleasePoolBlocks( *pool, qtrue, filename, fileline );
 
 	*chainAddress = ( *pool )->next;
 
@@ -406,9 +911,6 @@ void _Mem_FreePool( mempool_t **pool, int musthave, int canthave, const char *fi
 void _Mem_EmptyPool( mempool_t *pool, int musthave, int canthave, const char *filename, int fileline )
 {
 	mempool_t *child, *next;
-#ifdef SHOW_NONFREED
-	memheader_t *mem;
-#endif
 
 	if( pool == NULL )
 		_Mem_Error( "Mem_EmptyPool: pool == NULL (emptypool at %s:%i)", filename, fileline );
@@ -436,22 +938,397 @@ void _Mem_EmptyPool( mempool_t *pool, int musthave, int canthave, const char *fi
 		_Mem_Error( "Mem_EmptyPool: trashed pool sentinel 2 (allocpool at %s:%i, emptypool at %s:%i)", pool->filename, pool->fileline, filename, fileline );
 
 #ifdef SHOW_NONFREED
-	if( pool->chain )
-		Com_Printf( "Warning: Memory pool %s has resources that weren't freed:\n", pool->name );
-	for( mem = pool->chain; mem; mem = mem->next )
+	if( Mem_PoolTotalSize( pool ) )
 	{
-		Com_Printf( "%10i bytes allocated at %s:%i\n", mem->size, mem->filename, mem->fileline );
+		Com_Printf( "Warning: Memory pool %s has resources that weren't freed:\n", pool->name );
+		Mem_PrintPoolAllocations( pool );
 	}
 #endif
-	while( pool->chain )        // free memory owned by the pool
-		Mem_Free( (void *)( (qbyte *) pool->chain + sizeof( memheader_t ) ) );
+	// free memory owned by the pool
+	Mem_ReleasePoolBlocks( pool, qfalse, filename, fileline );
 }
 
 size_t Mem_PoolTotalSize( mempool_t *pool )
 {
+	int totalsize;
+
 	assert( pool != NULL );
 
-	return pool->totalsize;
+	totalsize = pool->totalsize;
+	Mem_CachedPoolStats( pool, &totalsize, NULL );
+	return totalsize;
+}
+
+// ============================================================================
+
+// frame arenas are thread-local bump allocators for short-lived buffers, they
+// are released in bulk either at the end of the frame or by rewinding to a mark
+// taken with Mem_FrameMark, so individual allocations can't be freed
+
+#define MEMARENA_BLOCKSIZE			0x10000
+#define MEMARENA_MAXSPAREBLOCKS		16
+
+#define MEMARENA_ALIGN( x )			( ( (size_t)( x ) + ( MEMALIGNMENT_DEFAULT-1 ) ) & ~( MEMALIGNMENT_DEFAULT-1 ) )
+
+typedef struct memarenaheader_s
+{
+	// file name and line where Mem_FrameAlloc was called
+	const char *filename;
+	int fileline;
+
+	// size of the memory after the header (excluding header and sentinel2)
+	unsigned int size;
+
+	// should always be MEMHEADER_SENTINEL1
+	unsigned int sentinel1;
+	// immediately followed by data, which is followed by a MEMHEADER_SENTINEL2 byte
+} memarenaheader_t;
+
+typedef struct memarenablock_s
+{
+	// previous block in the arena stack or next spare block
+	struct memarenablock_s *prev;
+
+	// usable size of the block, excluding this header
+	size_t size;
+
+	// bytes handed out from this block
+	size_t used;
+
+	// arena offset of the first byte of this block
+	size_t base;
+} memarenablock_t;
+
+typedef struct memarena_s
+{
+	memarenablock_t *current;
+	memarenablock_t *spare;
+
+	// allocations made since the last reset
+	int numallocs;
+
+	// bytes handed out, at most since the last reset and at most ever
+	size_t peaksize;
+	size_t maxsize;
+
+	// total size of all blocks, in use or spare
+	int numblocks;
+	size_t blocksize;
+
+	struct memarena_s *next;
+} memarena_t;
+
+static mempool_t *memArenaPool;
+static memarena_t *memArenaChain;
+static ATTRIBUTE_TLS memarena_t *memArena;
+
+#define MEMARENA_BLOCKDATA( block ) ( (qbyte *)( block ) + MEMARENA_ALIGN( sizeof( memarenablock_t ) ) )
+#define MEMARENA_HEADER( p ) ( (memarenaheader_t *)( MEMARENA_ALIGN( (qbyte *)( p ) + sizeof( memarenaheader_t ) ) - sizeof( memarenaheader_t ) ) )
+#define MEMARENA_NEXT( hdr ) ( (qbyte *)( hdr ) + sizeof( memarenaheader_t ) + ( hdr )->size + 1 )
+
+/*
+* Mem_CheckFrameArenaBlock
+* 
+* Walks the allocations made from the block starting at the given offset.
+*/
+static void Mem_CheckFrameArenaBlock( memarenablock_t *block, size_t offset, const char *filename, int fileline )
+{
+	qbyte *p, *end;
+	memarenaheader_t *hdr;
+
+	p = MEMARENA_BLOCKDATA( block ) + offset;
+	end = MEMARENA_BLOCKDATA( block ) + block->used;
+	while( p < end )
+	{
+		hdr = MEMARENA_HEADER( p );
+
+		assert( hdr->sentinel1 == MEMHEADER_SENTINEL1 );
+		assert( *( (qbyte *) hdr + sizeof( memarenaheader_t ) + hdr->size ) == MEMHEADER_SENTINEL2 );
+
+		if( hdr->sentinel1 != MEMHEADER_SENTINEL1 )
+			_Mem_Error( "Mem_CheckFrameArena: trashed header sentinel 1 (sentinel check at %s:%i)", filename, fileline );
+		if( *( (qbyte *) hdr + sizeof( memarenaheader_t ) + hdr->size ) != MEMHEADER_SENTINEL2 )
+			_Mem_Error( "Mem_CheckFrameArena: trashed header sentinel 2 (block allocated at %s:%i, sentinel check at %s:%i)", hdr->filename, hdr->fileline, filename, fileline );
+
+		p = MEMARENA_NEXT( hdr );
+	}
+}
+
+/*
+* Mem_CheckFrameArena
+* 
+* Only the calling thread's arena can be checked, other threads may be writing to theirs.
+*/
+static void Mem_CheckFrameArena( const char *filename, int fileline )
+{
+	memarenablock_t *block;
+
+	if( !memArena )
+		return;
+
+	for( block = memArena->current; block; block = block->prev )
+		Mem_CheckFrameArenaBlock( block, 0, filename, fileline );
+}
+
+/*
+* Mem_GetFrameArena
+*/
+static memarena_t *Mem_GetFrameArena( void )
+{
+	memarena_t *arena;
+
+	if( memArena )
+		return memArena;
+
+	arena = ( memarena_t * )Mem_Alloc( memArenaPool, sizeof( memarena_t ) );
+
+	QMutex_Lock( memMutex );
+	arena->next = memArenaChain;
+	memArenaChain = arena;
+	QMutex_Unlock( memMutex );
+
+	memArena = arena;
+	return arena;
+}
+
+/*
+* Mem_FrameArenaBlockAlloc
+* 
+* Returns NULL if the block can't fit the allocation.
+*/
+static void *Mem_FrameArenaBlockAlloc( memarenablock_t *block, size_t size, const char *filename, int fileline )
+{
+	qbyte *p;
+	memarenaheader_t *hdr;
+
+	p = MEMARENA_BLOCKDATA( block ) + block->used;
+	hdr = MEMARENA_HEADER( p );
+	if( (qbyte *)hdr + sizeof( memarenaheader_t ) + size + 1 > MEMARENA_BLOCKDATA( block ) + block->size )
+		return NULL;
+
+	hdr->filename = filename;
+	hdr->fileline = fileline;
+	hdr->size = size;
+	hdr->sentinel1 = MEMHEADER_SENTINEL1;
+	*( (qbyte *) hdr + sizeof( memarenaheader_t ) + size ) = MEMHEADER_SENTINEL2;
+
+	block->used = MEMARENA_NEXT( hdr ) - MEMARENA_BLOCKDATA( block );
+
+	return (void *)( (qbyte *) hdr + sizeof( memarenaheader_t ) );
+}
+
+/*
+* Mem_FrameArenaPushBlock
+*/
+static memarenablock_t *Mem_FrameArenaPushBlock( memarena_t *arena, size_t size, const char *filename, int fileline )
+{
+	size_t needed;
+	memarenablock_t *block, **prev;
+
+	// worst case size of a single allocation in an empty block
+	needed = sizeof( memarenaheader_t ) + MEMALIGNMENT_DEFAULT + size + 1;
+
+	for( prev = &arena->spare, block = arena->spare; block; prev = &block->prev, block = block->prev )
+	{
+		if( block->size >= needed )
+		{
+			*prev = block->prev;
+			break;
+		}
+	}
+
+	if( !block )
+	{
+		if( needed < MEMARENA_BLOCKSIZE )
+			needed = MEMARENA_BLOCKSIZE;
+
+		block = ( memarenablock_t * )_Mem_AllocExt( memArenaPool, MEMARENA_ALIGN( sizeof( memarenablock_t ) ) + needed, 0, 0, 0, 0, filename, fileline );
+		block->size = needed;
+
+		arena->numblocks++;
+		arena->blocksize += needed;
+	}
+
+	block->used = 0;
+	block->base = arena->current ? arena->current->base + arena->current->used : 0;
+	block->prev = arena->current;
+	arena->current = block;
+
+	return block;
+}
+
+/*
+* Mem_FrameArenaReleaseBlock
+*/
+static void Mem_FrameArenaReleaseBlock( memarena_t *arena, memarenablock_t *block )
+{
+	if( block->size > MEMARENA_BLOCKSIZE || arena->numblocks > MEMARENA_MAXSPAREBLOCKS )
+	{
+		arena->numblocks--;
+		arena->blocksize -= block->size;
+		Mem_Free( block );
+		return;
+	}
+
+	block->prev = arena->spare;
+	arena->spare = block;
+}
+
+/*
+* _Mem_FrameAllocExt
+* 
+* Allocates from the calling thread's frame arena.
+*/
+void *_Mem_FrameAllocExt( size_t size, int z, const char *filename, int fileline )
+{
+	void *data;
+	size_t mark;
+	memarena_t *arena;
+	memarenablock_t *block;
+
+	if( size <= 0 )
+		return NULL;
+
+	arena = Mem_GetFrameArena();
+
+	block = arena->current;
+	data = block ? Mem_FrameArenaBlockAlloc( block, size, filename, fileline ) : NULL;
+	if( !data )
+	{
+		block = Mem_FrameArenaPushBlock( arena, size, filename, fileline );
+		data = Mem_FrameArenaBlockAlloc( block, size, filename, fileline );
+	}
+
+	arena->numallocs++;
+	mark = block->base + block->used;
+	if( mark > arena->peaksize )
+		arena->peaksize = mark;
+	if( mark > arena->maxsize )
+		arena->maxsize = mark;
+
+	if( z )
+		memset( data, 0, size );
+
+	return data;
+}
+
+/*
+* Mem_FrameMark
+* 
+* Returns the current position in the calling thread's frame arena,
+* use Mem_FrameRelease to free everything allocated after it.
+*/
+size_t Mem_FrameMark( void )
+{
+	memarena_t *arena = memArena;
+
+	if( !arena || !arena->current )
+		return 0;
+	return arena->current->base + arena->current->used;
+}
+
+/*
+* _Mem_FrameRelease
+*/
+void _Mem_FrameRelease( size_t mark, const char *filename, int fileline )
+{
+	memarena_t *arena = memArena;
+	memarenablock_t *block;
+
+	if( !arena )
+		return;
+
+	assert( mark <= Mem_FrameMark() );
+
+	while( ( block = arena->current ) != NULL )
+	{
+		if( block->base < mark )
+		{
+			Mem_CheckFrameArenaBlock( block, mark - block->base, filename, fileline );
+			block->used = mark - block->base;
+			break;
+		}
+
+		Mem_CheckFrameArenaBlock( block, 0, filename, fileline );
+		arena->current = block->prev;
+		Mem_FrameArenaReleaseBlock( arena, block );
+	}
+}
+
+/*
+* _Mem_FrameReset
+* 
+* Frees everything in the calling thread's frame arena.
+*/
+void _Mem_FrameReset( const char *filename, int fileline )
+{
+	memarena_t *arena = memArena;
+
+	if( !arena )
+		return;
+
+	_Mem_FrameRelease( 0, filename, fileline );
+
+	arena->numallocs = 0;
+	arena->peaksize = 0;
+}
+
+/*
+* Mem_FreeFrameArena
+* 
+* Frees the calling thread's frame arena along with all of its blocks.
+*/
+static void Mem_FreeFrameArena( void )
+{
+	memarena_t *arena = memArena, **prev;
+	memarenablock_t *block, *next;
+
+	if( !arena )
+		return;
+	memArena = NULL;
+
+	QMutex_Lock( memMutex );
+	for( prev = &memArenaChain; *prev; prev = &( *prev )->next )
+	{
+		if( *prev == arena )
+		{
+			*prev = arena->next;
+			break;
+		}
+	}
+	QMutex_Unlock( memMutex );
+
+	for( block = arena->current; block; block = next )
+	{
+		next = block->prev;
+		Mem_Free( block );
+	}
+	for( block = arena->spare; block; block = next )
+	{
+		next = block->prev;
+		Mem_Free( block );
+	}
+	Mem_Free( arena );
+}
+
+/*
+* Mem_PrintFrameArenaStats
+*/
+static void Mem_PrintFrameArenaStats( void )
+{
+	int i;
+	memarena_t *arena;
+
+	QMutex_Lock( memMutex );
+
+	for( i = 0, arena = memArenaChain; arena; arena = arena->next, i++ )
+	{
+		Com_Printf( "frame arena %i%s: %i allocations, %i bytes peak this frame, %i bytes (%.3fMB) peak overall, %i bytes (%.3fMB) in %i blocks\n", 
+			i, arena == memArena ? " (this thread)" : "", arena->numallocs, (int)arena->peaksize, 
+			(int)arena->maxsize, arena->maxsize / 1048576.0, (int)arena->blocksize, arena->blocksize / 1048576.0, arena->numblocks );
+	}
+
+	QMutex_Unlock( memMutex );
 }
 
 void _Mem_CheckSentinels( void *data, const char *filename, int fileline )
@@ -476,6 +1353,8 @@ static void _Mem_CheckSentinelsPool( mempool_t *pool, const char *filename, int
 {
 	memheader_t *mem;
 	mempool_t *child;
+	memcache_t *cache;
+	memcachepool_t *slot;
 
 	// recurse into children
 	if( pool->child )
@@ -494,6 +1373,15 @@ static void _Mem_CheckSentinelsPool( mempool_t *pool, const char *filename, int
 
 	for( mem = pool->chain; mem; mem = mem->next )
 		_Mem_CheckSentinels( (void *)( (qbyte *) mem + sizeof( memheader_t ) ), filename, fileline );
+
+	for( cache = memCacheChain; cache; cache = cache->next )
+	{
+		slot = Mem_CachePool( cache, pool, qfalse );
+		if( !slot )
+			continue;
+		for( mem = slot->chain; mem; mem = mem->next )
+			_Mem_CheckSentinels( (void *)( (qbyte *) mem + sizeof( memheader_t ) ), filename, fileline );
+	}
 }
 
 void _Mem_CheckSentinelsGlobal( const char *filename, int fileline )
@@ -502,6 +1390,8 @@ void _Mem_CheckSentinelsGlobal( const char *filename, int fileline )
 
 	for( pool = poolChain; pool; pool = pool->next )
 		_Mem_CheckSentinelsPool( pool, filename, fileline );
+
+	Mem_CheckFrameArena( filename, fileline );
 }
 
 static void Mem_CountPoolStats( mempool_t *pool, int *count, int *size, int *realsize )
@@ -521,14 +1411,16 @@ static void Mem_CountPoolStats( mempool_t *pool, int *count, int *size, int *rea
 		( *size ) += pool->totalsize;
 	if( realsize )
 		( *realsize ) += pool->realsize;
+	Mem_CachedPoolStats( pool, size, realsize );
 }
 
 static void Mem_PrintStats( void )
 {
-	int count, size, real;
+	int i, count, size, real;
 	int total, totalsize, realsize;
+	int numfree, freesize;
 	mempool_t *pool;
-	memheader_t *mem;
+	memcache_t *cache;
 
 	Mem_CheckSentinelsGlobal();
 
@@ -545,22 +1437,39 @@ static void Mem_PrintStats( void )
 	// temporary pools are not nested
 	for( pool = poolChain; pool; pool = pool->next )
 	{
-		if( ( pool->flags & MEMPOOL_TEMPORARY ) && pool->chain )
+		if( !( pool->flags & MEMPOOL_TEMPORARY ) )
+			continue;
+
+		size = pool->totalsize; real = pool->realsize - sizeof( mempool_t );
+		Mem_CachedPoolStats( pool, &size, &real );
+		if( size )
 		{
-			Com_Printf( "%i bytes (%.3fMB) (%i bytes (%.3fMB actual)) of temporary memory still allocated (Leak!)\n", pool->totalsize, pool->totalsize / 1048576.0,
-				pool->realsize, pool->realsize / 1048576.0 );
+			Com_Printf( "%i bytes (%.3fMB) (%i bytes (%.3fMB actual)) of temporary memory still allocated (Leak!)\n", size, size / 1048576.0,
+				real, real / 1048576.0 );
 			Com_Printf( "listing temporary memory allocations for %s:\n", pool->name );
 
-			for( mem = tempMemPool->chain; mem; mem = mem->next )
-				Com_Printf( "%10i bytes allocated at %s:%i\n", mem->size, mem->filename, mem->fileline );
+			Mem_PrintPoolAllocations( pool );
 		}
 	}
+
+	for( numfree = 0, freesize = 0, i = 0; i < MEMCLASS_COUNT; i++ )
+	{
+		count = memDepotCount[i];
+		for( cache = memCacheChain; cache; cache = cache->next )
+			count += cache->numfree[i];
+		numfree += count;
+		freesize += count * ( MEMSLAB_HEADERSIZE + Mem_ClassSize( i ) );
+	}
+
+	Com_Printf( "%i slabs (%.3fMB) for small allocations, %i blocks (%.3fMB) free\n", memNumSlabs, memNumSlabs * MEMSLAB_SIZE / 1048576.0, 
+		numfree, freesize / 1048576.0 );
+
+	Mem_PrintFrameArenaStats();
 }
 
 static void Mem_PrintPoolStats( mempool_t *pool, int listchildren, int listallocations )
 {
 	mempool_t *child;
-	memheader_t *mem;
 	int totalsize = 0, realsize = 0;
 
 	Mem_CountPoolStats( pool, NULL, &totalsize, &realsize );
@@ -583,10 +1492,7 @@ static void Mem_PrintPoolStats( mempool_t *pool, int listchildren, int listalloc
 	pool->lastchecksize = totalsize;
 
 	if( listallocations )
-	{
-		for( mem = pool->chain; mem; mem = mem->next )
-			Com_Printf( "%10i bytes allocated at %s:%i\n", mem->size, mem->filename, mem->fileline );
-	}
+		Mem_PrintPoolAllocations( pool );
 
 	if( listchildren )
 	{
@@ -655,6 +1561,20 @@ static void MemStats_f( void )
 }
 
 
+/*
+* Mem_ThreadExit
+* 
+* Called by the system layer on every thread it started, right before the thread exits.
+*/
+static void Mem_ThreadExit( void )
+{
+	if( !memory_initialized )
+		return;
+
+	Mem_FreeFrameArena();
+	Mem_ReleaseCache();
+}
+
 /*
 * Memory_Init
 */
@@ -666,8 +1586,11 @@ void Memory_Init( void )
 
 	zoneMemPool = Mem_AllocPool( NULL, "Zone" );
 	tempMemPool = Mem_AllocTempPool( "Temporary Memory" );
+	memArenaPool = Mem_AllocPool( NULL, "Frame Arenas" );
 
 	memory_initialized = qtrue;
+
+	Sys_Thread_SetExitHook( Mem_ThreadExit );
 }
 
 /*
@@ -694,10 +1617,14 @@ void Memory_InitCommands( void )
 void Memory_Shutdown( void )
 {
 	mempool_t *pool, *next;
+	memslab_t *slab;
+	memcache_t *cache;
 
 	if( !memory_initialized )
 		return;
 
+	Sys_Thread_SetExitHook( NULL );
+
 	// set the cvar to NULL so nothing is printed to non-existing console
 	developerMemory = NULL;
 
@@ -706,6 +1633,10 @@ void Memory_Shutdown( void )
 	Mem_FreePool( &zoneMemPool );
 	Mem_FreePool( &tempMemPool );
 
+	Mem_FreePool( &memArenaPool );
+	memArenaChain = NULL;
+	memArena = NULL;
+
 	for( pool = poolChain; pool; pool = next )
 	{
 		// do it here, because pool is to be freed
@@ -717,6 +1648,25 @@ void Memory_Shutdown( void )
 		Mem_FreePool( &pool );
 	}
 
+	// everything has been returned to the free lists, release the slabs
+	while( memSlabChain )
+	{
+		slab = memSlabChain->next;
+		free( memSlabChain );
+		memSlabChain = slab;
+	}
+	memNumSlabs = 0;
+	memset( memDepot, 0, sizeof( memDepot ) );
+	memset( memDepotCount, 0, sizeof( memDepotCount ) );
+
+	while( memCacheChain )
+	{
+		cache = memCacheChain->next;
+		free( memCacheChain );
+		memCacheChain = cache;
+	}
+	memCache = NULL;
+
 	QMutex_Destroy( &memMutex );
 
 	memory_initialized = qfalse;
@@ -488,6 +488,7 @@ const char *ML_GetFilenameExt( const char *fullname, qboolean recursive )
 	mapinfo_t *map;
 	trie_error_t err;
 	char *fullname2;
+	size_t mark;
 
 	if( !ml_initialized )
 		return MLIST_NULL;
@@ -495,12 +496,13 @@ const char *ML_GetFilenameExt( const char *fullname, qboolean recursive )
 	if( !ML_ValidateFullname( fullname ) )
 		return MLIST_NULL;
 
-	fullname2 = ( char* )Mem_TempMalloc( strlen( fullname ) + 1 );
+	mark = Mem_FrameMark();
+	fullname2 = ( char* )Mem_FrameAllocExt( strlen( fullname ) + 1, 0 );
 	strcpy( fullname2, fullname );
 	Q_strlwr( fullname2 );
 
 	err = Trie_Find( mlist_fullnames_trie, fullname2, TRIE_EXACT_MATCH, (void **)&map );
-	Mem_Free( fullname2 );
+	Mem_FrameRelease( mark );
 
 	if( err == TRIE_OK )
 		return map->filename;
@@ -18,9 +18,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#ifdef __linux__
+#define _GNU_SOURCE // recvmmsg, sendmmsg
+#endif
+
 #include "qcommon.h"
 
 #include "sys_net.h"
+#include "../qalgo/hash.h"
 
 #ifdef _WIN32
 #include "../win32/winquake.h"
@@ -48,6 +53,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #	define MSG_NOSIGNAL 0
 #endif
 
+#if defined ( __linux__ ) && defined ( MSG_WAITFORONE )
+#	define NET_BATCHED_IO
+#endif
+
+#ifdef __linux__
+#	include <sys/epoll.h>
+#	include <sys/timerfd.h>
+#	include <errno.h>
+#	define NET_EPOLL_WAIT
+#endif
+
 
 typedef struct
 {
@@ -63,10 +79,11 @@ typedef struct
 } loopback_t;
 
 static loopback_t loopbacks[2];
-static char *errorstring = NULL;
-static size_t errorstring_size = 0;
+static ATTRIBUTE_TLS char errorstring[MAX_PRINTMSG];  // per thread, sockets may be used off the main thread
 static qboolean	net_initialized = qfalse;
 
+static void NET_Wait_Invalidate( void );
+
 #define MAX_IPS 16
 static int numIP;
 static qbyte localIP[MAX_IPS][4];
@@ -334,6 +351,218 @@ static qboolean NET_SocketMakeNonBlocking( socket_handle_t handle )
 	return qtrue;
 }
 
+#ifdef NET_BATCHED_IO
+/*
+=============================================================================
+BATCHED UDP I/O
+
+Sockets with batching enabled read up to NET_BATCH_RECV_SLOTS datagrams with
+a single recvmmsg and hand them out one by one from NET_UDP_GetPacket.
+Outgoing datagrams are queued and pushed with one sendmmsg per socket in
+NET_FlushBatches, or when the queue fills up.
+=============================================================================
+*/
+
+#define NET_BATCH_MAX_SOCKETS	8
+#define NET_BATCH_RECV_SLOTS	32
+#define NET_BATCH_SEND_SLOTS	128
+
+typedef struct
+{
+	qboolean inuse;
+	socket_handle_t handle;
+
+	// receive ring
+	int recvHead;                       // next datagram to hand out
+	int recvCount;                      // datagrams read by the last recvmmsg
+	struct mmsghdr recvHdrs[NET_BATCH_RECV_SLOTS];
+	struct iovec recvIovs[NET_BATCH_RECV_SLOTS];
+	struct sockaddr_storage recvAddrs[NET_BATCH_RECV_SLOTS];
+	qbyte recvData[NET_BATCH_RECV_SLOTS][MAX_MSGLEN];
+
+	// send queue
+	int sendCount;
+	struct mmsghdr sendHdrs[NET_BATCH_SEND_SLOTS];
+	struct iovec sendIovs[NET_BATCH_SEND_SLOTS];
+	struct sockaddr_storage sendAddrs[NET_BATCH_SEND_SLOTS];
+	qbyte sendData[NET_BATCH_SEND_SLOTS][MAX_PACKETLEN];
+} net_batch_t;
+
+static net_batch_t *net_batches[NET_BATCH_MAX_SOCKETS];
+
+typedef struct
+{
+	unsigned int recvCalls, recvPackets;
+	unsigned int sendCalls, sendPackets;
+} net_batchstats_t;
+
+static net_batchstats_t net_batchstats;
+
+/*
+* NET_Batch_Find
+*/
+static net_batch_t *NET_Batch_Find( socket_handle_t handle )
+{
+	int i;
+
+	for( i = 0; i < NET_BATCH_MAX_SOCKETS; i++ )
+	{
+		if( net_batches[i] && net_batches[i]->inuse && net_batches[i]->handle == handle )
+			return net_batches[i];
+	}
+
+	return NULL;
+}
+
+/*
+* NET_Batch_Flush
+*/
+static void NET_Batch_Flush( net_batch_t *batch )
+{
+	int sent, ret;
+
+	sent = 0;
+	while( sent < batch->sendCount )
+	{
+		ret = sendmmsg( batch->handle, batch->sendHdrs + sent, batch->sendCount - sent, MSG_NOSIGNAL );
+		net_batchstats.sendCalls++;
+		if( ret == SOCKET_ERROR )
+		{
+			NET_SetErrorStringFromLastError( "sendmmsg" );
+			if( Sys_NET_GetLastError() == NET_ERR_WOULDBLOCK )
+				break;
+
+			// skip the datagram that failed, like a failed sendto would
+			Com_DPrintf( "NET_Batch_Flush: %s\n", NET_ErrorString() );
+			sent++;
+			continue;
+		}
+		net_batchstats.sendPackets += ret;
+		sent += ret;
+	}
+
+	batch->sendCount = 0;
+}
+
+/*
+* NET_Batch_Queue
+* Returns qfalse if the datagram doesn't fit into a send slot
+*/
+static qboolean NET_Batch_Queue( net_batch_t *batch, const void *data, size_t length,
+	const struct sockaddr_storage *addr, socklen_t addrlen )
+{
+	int slot;
+	struct mmsghdr *hdr;
+
+	if( length > sizeof( batch->sendData[0] ) )
+		return qfalse;
+
+	if( batch->sendCount == NET_BATCH_SEND_SLOTS )
+		NET_Batch_Flush( batch );
+
+	slot = batch->sendCount++;
+	memcpy( batch->sendData[slot], data, length );
+	batch->sendAddrs[slot] = *addr;
+	batch->sendIovs[slot].iov_base = batch->sendData[slot];
+	batch->sendIovs[slot].iov_len = length;
+
+	hdr = &batch->sendHdrs[slot];
+	memset( hdr, 0, sizeof( *hdr ) );
+	hdr->msg_hdr.msg_name = &batch->sendAddrs[slot];
+	hdr->msg_hdr.msg_namelen = addrlen;
+	hdr->msg_hdr.msg_iov = &batch->sendIovs[slot];
+	hdr->msg_hdr.msg_iovlen = 1;
+
+	return qtrue;
+}
+
+/*
+* NET_Batch_Receive
+* Refills the receive ring. Returns the number of datagrams read, 0 if none
+* were pending, or -1 on error
+*/
+static int NET_Batch_Receive( net_batch_t *batch )
+{
+	int i, ret;
+
+	for( i = 0; i < NET_BATCH_RECV_SLOTS; i++ )
+	{
+		struct mmsghdr *hdr = &batch->recvHdrs[i];
+
+		batch->recvIovs[i].iov_base = batch->recvData[i];
+		batch->recvIovs[i].iov_len = sizeof( batch->recvData[i] );
+
+		memset( hdr, 0, sizeof( *hdr ) );
+		hdr->msg_hdr.msg_name = &batch->recvAddrs[i];
+		hdr->msg_hdr.msg_namelen = sizeof( batch->recvAddrs[i] );
+		hdr->msg_hdr.msg_iov = &batch->recvIovs[i];
+		hdr->msg_hdr.msg_iovlen = 1;
+	}
+
+	batch->recvHead = 0;
+	batch->recvCount = 0;
+
+	ret = recvmmsg( batch->handle, batch->recvHdrs, NET_BATCH_RECV_SLOTS, MSG_DONTWAIT, NULL );
+	net_batchstats.recvCalls++;
+	if( ret == SOCKET_ERROR )
+	{
+		net_error_t err;
+
+		NET_SetErrorStringFromLastError( "recvmmsg" );
+
+		err = Sys_NET_GetLastError();
+		if( err == NET_ERR_WOULDBLOCK || err == NET_ERR_CONNRESET )  // would block
+			return 0;
+
+		return -1;
+	}
+
+	net_batchstats.recvPackets += ret;
+	batch->recvCount = ret;
+	return ret;
+}
+
+/*
+* NET_Batch_GetPacket
+*/
+static int NET_Batch_GetPacket( net_batch_t *batch, netadr_t *address, msg_t *message )
+{
+	int ret;
+	size_t len;
+	struct mmsghdr *hdr;
+
+	if( batch->recvHead >= batch->recvCount )
+	{
+		ret = NET_Batch_Receive( batch );
+		if( ret <= 0 )
+			return ret;
+	}
+
+	hdr = &batch->recvHdrs[batch->recvHead];
+	len = hdr->msg_len;
+
+	if( !SockaddressToAddress( (struct sockaddr *)&batch->recvAddrs[batch->recvHead], address ) )
+	{
+		batch->recvHead++;
+		return -1;
+	}
+
+	if( ( hdr->msg_hdr.msg_flags & MSG_TRUNC ) || len >= message->maxsize )
+	{
+		batch->recvHead++;
+		NET_SetErrorString( "Oversized packet" );
+		return -1;
+	}
+
+	memcpy( message->data, batch->recvData[batch->recvHead], len );
+	message->readcount = 0;
+	message->cursize = len;
+
+	batch->recvHead++;
+	return 1;
+}
+#endif
+
 /*
 * NET_UDP_GetPacket
 */
@@ -349,6 +578,14 @@ static int NET_UDP_GetPacket( const socket_t *socket, netadr_t *address, msg_t *
 	assert( message->data );
 	assert( message->maxsize > 0 );
 
+#ifdef NET_BATCHED_IO
+	{
+		net_batch_t *batch = NET_Batch_Find( socket->handle );
+		if( batch )
+			return NET_Batch_GetPacket( batch, address, message );
+	}
+#endif
+
 	fromlen = sizeof( from );
 	ret = recvfrom( socket->handle, (char*)message->data, message->maxsize, 0, (struct sockaddr *)&from, &fromlen );
 	if( ret == SOCKET_ERROR )
@@ -396,6 +633,21 @@ static qboolean NET_UDP_SendPacket( const socket_t *socket, const void *data, si
 		return qfalse;
 
 	addrlen = ( addr.ss_family == AF_INET6 ? sizeof( struct sockaddr_in6 ) : sizeof( struct sockaddr_in ) );
+
+#ifdef NET_BATCHED_IO
+	{
+		net_batch_t *batch = NET_Batch_Find( socket->handle );
+		if( batch )
+		{
+			if( NET_Batch_Queue( batch, data, length, &addr, addrlen ) )
+				return qtrue;
+
+			// too large for a slot, keep the ordering and send it directly
+			NET_Batch_Flush( batch );
+		}
+	}
+#endif
+
 	if( sendto( socket->handle, data, length, 0, (struct sockaddr *)&addr, addrlen ) == SOCKET_ERROR )
 	{
 		NET_SetErrorStringFromLastError( "sendto" );
@@ -498,6 +750,8 @@ static void NET_UDP_CloseSocket( socket_t *socket )
 	if( !socket->open )
 		return;
 
+	NET_SetSocketBatching( socket, qfalse );
+
 	Sys_NET_SocketClose( socket->handle );
 	socket->handle = 0;
 	socket->open = qfalse;
@@ -1182,6 +1436,36 @@ qboolean NET_CompareBaseAddress( const netadr_t *a, const netadr_t *b )
 	}
 }
 
+/*
+* NET_BaseAddressHash
+* 
+* Hashes the address without the port, consistent with NET_CompareBaseAddress
+*/
+unsigned int NET_BaseAddressHash( const netadr_t *address )
+{
+	switch( address->type )
+	{
+	case NA_IP:
+		return COM_SuperFastHash( address->address.ipv4.ip, sizeof( address->address.ipv4.ip ), NA_IP );
+	case NA_IP6:
+		return COM_SuperFastHash( address->address.ipv6.ip, sizeof( address->address.ipv6.ip ), NA_IP6 ) ^ address->address.ipv6.scope_id;
+	default:
+		return address->type;
+	}
+}
+
+/*
+* NET_ClientHashKey
+* 
+* Bucket of a client connection in a table of size entries (a power of two).
+* The key is the base address and the game port, so fixing up a translated
+* address port doesn't require rehashing
+*/
+unsigned int NET_ClientHashKey( const netadr_t *address, int game_port, unsigned int size )
+{
+	return ( NET_BaseAddressHash( address ) ^ ( ( game_port & 0xffff ) * 0x9E3779B1 ) ) & ( size - 1 );
+}
+
 /*
 * NET_GetAddressPort
 * 
@@ -1560,21 +1844,10 @@ const char *NET_ErrorString( void )
 void NET_SetErrorString( const char *format, ... )
 {
 	va_list	argptr;
-	char msg[MAX_PRINTMSG];
 
 	va_start( argptr, format );
-	Q_vsnprintfz( msg, sizeof( msg ), format, argptr );
+	Q_vsnprintfz( errorstring, sizeof( errorstring ), format, argptr );
 	va_end( argptr );
-
-	if( errorstring_size < strlen( msg ) + 1 )
-	{
-		if( errorstring )
-			Mem_ZoneFree( errorstring );
-		errorstring_size = strlen( msg ) + 1 + 64;
-		errorstring = ( char* )Mem_ZoneMalloc( errorstring_size );
-	}
-
-	Q_strncpyz( errorstring, msg, errorstring_size );
 }
 
 /*
@@ -1750,6 +2023,9 @@ void NET_CloseSocket( socket_t *socket )
 	if( !socket->open )
 		return;
 
+	// the handle may be reused by a new socket
+	NET_Wait_Invalidate();
+
 	switch( socket->type )
 	{
 	case SOCKET_LOOPBACK:
@@ -1797,17 +2073,245 @@ int NET_SetSocketNoDelay( socket_t *socket, int nodelay )
 }
 
 /*
-* NET_Sleep
+* NET_SetSocketBatching
+* Enables batched receiving and sending on a UDP socket where supported.
+* Queued datagrams are only sent when NET_FlushBatches is called, or before
+* NET_Sleep blocks.
 */
-void NET_Sleep( int msec, socket_t *sockets[] )
+qboolean NET_SetSocketBatching( const socket_t *socket, qboolean enable )
+{
+#ifdef NET_BATCHED_IO
+	int i;
+	net_batch_t *batch;
+
+	if( !socket->open || socket->type != SOCKET_UDP )
+		return qfalse;
+
+	batch = NET_Batch_Find( socket->handle );
+	if( !enable )
+	{
+		if( batch )
+		{
+			NET_Batch_Flush( batch );
+			batch->inuse = qfalse;
+		}
+		return qtrue;
+	}
+
+	if( batch )
+		return qtrue;
+
+	for( i = 0; i < NET_BATCH_MAX_SOCKETS; i++ )
+	{
+		if( !net_batches[i] || !net_batches[i]->inuse )
+			break;
+	}
+	if( i == NET_BATCH_MAX_SOCKETS )
+		return qfalse;
+
+	if( !net_batches[i] )
+		net_batches[i] = Mem_ZoneMalloc( sizeof( net_batch_t ) );
+
+	batch = net_batches[i];
+	batch->inuse = qtrue;
+	batch->handle = socket->handle;
+	batch->recvHead = batch->recvCount = 0;
+	batch->sendCount = 0;
+	return qtrue;
+#else
+	return qfalse;
+#endif
+}
+
+/*
+* NET_FlushBatches
+* Sends all datagrams queued on batched sockets
+*/
+void NET_FlushBatches( void )
+{
+#ifdef NET_BATCHED_IO
+	int i;
+
+	for( i = 0; i < NET_BATCH_MAX_SOCKETS; i++ )
+	{
+		if( net_batches[i] && net_batches[i]->inuse && net_batches[i]->sendCount )
+			NET_Batch_Flush( net_batches[i] );
+	}
+#endif
+}
+
+/*
+* NET_BatchStats_f
+*/
+static void NET_BatchStats_f( void )
+{
+#ifdef NET_BATCHED_IO
+	Com_Printf( "recvmmsg: %u calls, %u packets\n", net_batchstats.recvCalls, net_batchstats.recvPackets );
+	Com_Printf( "sendmmsg: %u calls, %u packets\n", net_batchstats.sendCalls, net_batchstats.sendPackets );
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) )
+		memset( &net_batchstats, 0, sizeof( net_batchstats ) );
+#else
+	Com_Printf( "Batched network I/O is not supported on this platform\n" );
+#endif
+}
+
+#ifdef NET_EPOLL_WAIT
+#define NET_WAIT_MAX_SOCKETS	8
+
+// the epoll set is kept between waits and only rebuilt when the sockets change
+typedef struct
+{
+	int epollfd;
+	int timerfd;
+	int numHandles;             // -1 when the set must be rebuilt
+	int handles[NET_WAIT_MAX_SOCKETS];
+} net_waitset_t;
+
+static net_waitset_t net_waitset = { -1, -1, -1 };
+
+/*
+* NET_Wait_Close
+*/
+static void NET_Wait_Close( void )
+{
+	if( net_waitset.epollfd >= 0 )
+		close( net_waitset.epollfd );
+	if( net_waitset.timerfd >= 0 )
+		close( net_waitset.timerfd );
+	net_waitset.epollfd = net_waitset.timerfd = -1;
+	net_waitset.numHandles = -1;
+}
+
+/*
+* NET_Wait_Setup
+* Makes sure the epoll set watches exactly the given sockets and the timer
+*/
+static qboolean NET_Wait_Setup( socket_t *sockets[] )
+{
+	int i, numHandles;
+	struct epoll_event ev;
+
+	for( numHandles = 0; sockets[numHandles]; numHandles++ );
+	if( numHandles > NET_WAIT_MAX_SOCKETS )
+		return qfalse;
+
+	if( numHandles == net_waitset.numHandles )
+	{
+		for( i = 0; i < numHandles; i++ )
+		{
+			if( sockets[i]->handle != net_waitset.handles[i] )
+				break;
+		}
+		if( i == numHandles )
+			return qtrue;
+	}
+
+	if( net_waitset.timerfd < 0 )
+	{
+		net_waitset.timerfd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC );
+		if( net_waitset.timerfd < 0 )
+			return qfalse;
+	}
+
+	if( net_waitset.epollfd >= 0 )
+		close( net_waitset.epollfd );
+	net_waitset.numHandles = -1;
+
+	net_waitset.epollfd = epoll_create1( EPOLL_CLOEXEC );
+	if( net_waitset.epollfd < 0 )
+		return qfalse;
+
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN;
+	ev.data.fd = net_waitset.timerfd;
+	if( epoll_ctl( net_waitset.epollfd, EPOLL_CTL_ADD, net_waitset.timerfd, &ev ) < 0 )
+		return qfalse;
+
+	for( i = 0; i < numHandles; i++ )
+	{
+		ev.data.fd = sockets[i]->handle;
+		if( epoll_ctl( net_waitset.epollfd, EPOLL_CTL_ADD, sockets[i]->handle, &ev ) < 0 )
+			return qfalse;
+		net_waitset.handles[i] = sockets[i]->handle;
+	}
+	net_waitset.numHandles = numHandles;
+
+	return qtrue;
+}
+
+/*
+* NET_Wait_Epoll
+* Blocks until a socket is readable or the timer reaches the deadline
+*/
+static qboolean NET_Wait_Epoll( quint64 usec, socket_t *sockets[] )
+{
+	qbyte drain[8];
+	struct itimerspec its;
+	struct epoll_event events[NET_WAIT_MAX_SOCKETS + 1];
+
+	if( !NET_Wait_Setup( sockets ) )
+		return qfalse;
+
+	// drop an expiration left over from a wait which ended on a packet
+	while( read( net_waitset.timerfd, drain, sizeof( drain ) ) > 0 );
+
+	memset( &its, 0, sizeof( its ) );
+	its.it_value.tv_sec = usec / 1000000;
+	its.it_value.tv_nsec = ( usec % 1000000 ) * 1000;
+	if( timerfd_settime( net_waitset.timerfd, 0, &its, NULL ) < 0 )
+		return qfalse;
+
+	while( epoll_wait( net_waitset.epollfd, events, NET_WAIT_MAX_SOCKETS + 1, -1 ) < 0 )
+	{
+		if( errno != EINTR )
+			return qfalse;
+	}
+
+	return qtrue;
+}
+#endif
+
+/*
+* NET_Wait_Invalidate
+*/
+static void NET_Wait_Invalidate( void )
+{
+#ifdef NET_EPOLL_WAIT
+	net_waitset.numHandles = -1;
+#endif
+}
+
+/*
+* NET_SleepUntil
+* Blocks until one of the sockets has data or Sys_Microseconds reaches the deadline
+*/
+void NET_SleepUntil( quint64 deadline, socket_t *sockets[] )
 {
 	struct timeval timeout;
 	fd_set fdset;
+	quint64 now, usec;
 	int i;
 
 	if( !sockets || !sockets[0] )
 		return;
 
+	// push any queued datagrams out before blocking
+	NET_FlushBatches();
+
+#ifdef NET_BATCHED_IO
+	// don't sleep on datagrams that were already read into a receive ring
+	for( i = 0; sockets[i]; i++ )
+	{
+		net_batch_t *batch;
+
+		if( !sockets[i]->open || sockets[i]->type != SOCKET_UDP )
+			continue;
+		batch = NET_Batch_Find( sockets[i]->handle );
+		if( batch && batch->recvHead < batch->recvCount )
+			return;
+	}
+#endif
+
 	FD_ZERO( &fdset );
 
 	for( i = 0; sockets[i]; i++ )
@@ -1830,11 +2334,30 @@ void NET_Sleep( int msec, socket_t *sockets[] )
 		}
 	}
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = ( msec % 1000 ) * 1000;
+	now = Sys_Microseconds();
+	if( deadline <= now )
+		return;
+	usec = deadline - now;
+
+#ifdef NET_EPOLL_WAIT
+	if( NET_Wait_Epoll( usec, sockets ) )
+		return;
+	NET_Wait_Close();
+#endif
+
+	timeout.tv_sec = usec / 1000000;
+	timeout.tv_usec = usec % 1000000;
 	select( FD_SETSIZE, &fdset, NULL, NULL, &timeout );
 }
 
+/*
+* NET_Sleep
+*/
+void NET_Sleep( int msec, socket_t *sockets[] )
+{
+	NET_SleepUntil( Sys_Microseconds() + (quint64)msec * 1000, sockets );
+}
+
 /*
 * NET_Monitor
 * Monitors the given sockets with the given timeout in milliseconds
@@ -1924,6 +2447,8 @@ void NET_Init( void )
 
 	GetLocalAddress();
 
+	Cmd_AddCommand( "net_batchstats", NET_BatchStats_f );
+
 	net_initialized = qtrue;
 }
 
@@ -1935,12 +2460,28 @@ void NET_Shutdown( void )
 	if( !net_initialized )
 		return;
 
-	if( errorstring )
+	Cmd_RemoveCommand( "net_batchstats" );
+
+#ifdef NET_EPOLL_WAIT
+	NET_Wait_Close();
+#endif
+
+#ifdef NET_BATCHED_IO
 	{
-		Mem_ZoneFree( errorstring );
-		errorstring = NULL;
-		errorstring_size = 0;
+		int i;
+
+		for( i = 0; i < NET_BATCH_MAX_SOCKETS; i++ )
+		{
+			if( net_batches[i] )
+			{
+				Mem_ZoneFree( net_batches[i] );
+				net_batches[i] = NULL;
+			}
+		}
 	}
+#endif
+
+	errorstring[0] = '\0';
 
 	Sys_NET_Shutdown();
 
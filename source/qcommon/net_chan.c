@@ -85,6 +85,7 @@ static int game_port;
 static cvar_t *showpackets;
 static cvar_t *showdrop;
 static cvar_t *net_showfragments;
+static cvar_t *net_compressdict;
 
 /*
 * Netchan_OutOfBand
@@ -141,8 +142,6 @@ void Netchan_Setup( netchan_t *chan, const socket_t *socket, const netadr_t *add
 }
 
 
-static qbyte msg_process_data[MAX_MSGLEN];
-
 //=============================================================
 // Zlib compression
 //=============================================================
@@ -320,23 +319,176 @@ int Netchan_ZLibCompressChunk( qbyte *in, int len_in, qbyte *out, int max_len_ou
 
 #endif // ALT_ZLIB_COMPRESSION
 
+//=============================================================
+// Preset dictionary compression
+//
+// Single messages are too small for deflate to find much to match on,
+// so channels that negotiated it at connect prime the raw deflate
+// window with a dictionary trained offline from recorded demos (see
+// net_traindict). Both ends must have loaded the very same file, which
+// is verified by its checksum during the challenge.
+//=============================================================
+
+#define NETCHAN_DICT_MAXSIZE	( 1<<MAX_WBITS )
+
+static qbyte *netchan_dict;
+static int netchan_dictlen;
+static unsigned int netchan_dictchecksum;
+
+// the streams are kept around and reset per message, channels may be
+// serviced from several threads so they are guarded by netchan_dictmutex
+static z_stream netchan_dictdeflate, netchan_dictinflate;
+static qboolean netchan_dictdeflate_init, netchan_dictinflate_init;
+static qmutex_t *netchan_dictmutex;
+
+/*
+* Netchan_ZLibCompressChunkDict
+*/
+static int Netchan_ZLibCompressChunkDict( const qbyte *in, int len_in, qbyte *out, int max_len_out,
+										 const qbyte *dict, int dictlen )
+{
+	z_stream *zs = &netchan_dictdeflate;
+	int result;
+
+	if( !netchan_dictdeflate_init )
+	{
+		memset( zs, 0, sizeof( *zs ) );
+		result = deflateInit2( zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY );
+		if( result != Z_OK )
+			return -1;
+		netchan_dictdeflate_init = qtrue;
+	}
+	else if( deflateReset( zs ) != Z_OK )
+	{
+		return -1;
+	}
+
+	if( deflateSetDictionary( zs, dict, dictlen ) != Z_OK )
+		return -1;
+
+	zs->next_in = (Bytef *)in;
+	zs->avail_in = len_in;
+	zs->next_out = out;
+	zs->avail_out = max_len_out;
+
+	result = deflate( zs, Z_FINISH );
+	if( result != Z_STREAM_END )
+		return -1;
+
+	return zs->total_out;
+}
+
+/*
+* Netchan_ZLibDecompressChunkDict
+*/
+static int Netchan_ZLibDecompressChunkDict( const qbyte *in, int len_in, qbyte *out, int max_len_out,
+										   const qbyte *dict, int dictlen )
+{
+	z_stream *zs = &netchan_dictinflate;
+	int result;
+
+	if( !netchan_dictinflate_init )
+	{
+		memset( zs, 0, sizeof( *zs ) );
+		result = inflateInit2( zs, -MAX_WBITS );
+		if( result != Z_OK )
+			return -1;
+		netchan_dictinflate_init = qtrue;
+	}
+	else if( inflateReset( zs ) != Z_OK )
+	{
+		return -1;
+	}
+
+	if( inflateSetDictionary( zs, dict, dictlen ) != Z_OK )
+		return -1;
+
+	zs->next_in = (Bytef *)in;
+	zs->avail_in = len_in;
+	zs->next_out = out;
+	zs->avail_out = max_len_out;
+
+	result = inflate( zs, Z_FINISH );
+	if( result != Z_STREAM_END )
+	{
+		Com_DPrintf( "ZLib data error! Error %d on inflate.\nMessage: %s", result, zs->msg );
+		return -1;
+	}
+
+	return zs->total_out;
+}
+
+/*
+* Netchan_LoadDict
+*/
+static void Netchan_LoadDict( void )
+{
+	int length;
+	void *buffer;
+
+	if( netchan_dict )
+	{
+		Mem_ZoneFree( netchan_dict );
+		netchan_dict = NULL;
+	}
+	netchan_dictlen = 0;
+	netchan_dictchecksum = 0;
+
+	if( !net_compressdict->string[0] )
+		return;
+
+	length = FS_LoadFile( net_compressdict->string, &buffer, NULL, 0 );
+	if( !buffer )
+		return;
+
+	if( length > 0 )
+	{
+		// only the end of the dictionary fits into the deflate window
+		netchan_dictlen = min( length, NETCHAN_DICT_MAXSIZE );
+		netchan_dict = Mem_ZoneMalloc( netchan_dictlen );
+		memcpy( netchan_dict, (qbyte *)buffer + length - netchan_dictlen, netchan_dictlen );
+
+		netchan_dictchecksum = crc32( 0, netchan_dict, netchan_dictlen );
+		if( !netchan_dictchecksum )
+			netchan_dictchecksum = 1;
+	}
+
+	FS_FreeFile( buffer );
+}
+
+/*
+* Netchan_DictChecksum
+* 
+* Identifies the compression dictionary, 0 if there's none. The dictionary
+* is only loaded at startup, as live channels may be using it.
+*/
+unsigned int Netchan_DictChecksum( void )
+{
+	return netchan_dictchecksum;
+}
+
 /*
 * Netchan_CompressMessage
 */
-int Netchan_CompressMessage( msg_t *msg )
+int Netchan_CompressMessage( netchan_t *chan, msg_t *msg )
 {
 	int length;
+	qbyte msg_process_data[MAX_MSGLEN];
 
 	if( msg == NULL || !msg->data )
 		return 0;
 
-	// zero-fill our buffer
-	length = 0;
-	memset( msg_process_data, 0, sizeof( msg_process_data ) );
-
 	//compress the message
-	length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, 
-		msg_process_data, sizeof( msg_process_data ), Z_DEFAULT_COMPRESSION, -MAX_WBITS );
+	if( chan && chan->dictCompression && netchan_dict )
+	{
+		QMutex_Lock( netchan_dictmutex );
+		length = Netchan_ZLibCompressChunkDict( msg->data, msg->cursize, 
+			msg_process_data, sizeof( msg_process_data ), netchan_dict, netchan_dictlen );
+		QMutex_Unlock( netchan_dictmutex );
+	}
+	else
+		length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, 
+			msg_process_data, sizeof( msg_process_data ), Z_DEFAULT_COMPRESSION, -MAX_WBITS );
 	if( length < 0 )  // failed to compress, return the error
 		return length;
 
@@ -356,9 +508,10 @@ int Netchan_CompressMessage( msg_t *msg )
 /*
 * Netchan_DecompressMessage
 */
-int Netchan_DecompressMessage( msg_t *msg )
+int Netchan_DecompressMessage( netchan_t *chan, msg_t *msg )
 {
 	int length;
+	qbyte msg_process_data[MAX_MSGLEN];
 
 	if( msg == NULL || !msg->data )
 		return 0;
@@ -366,7 +519,16 @@ int Netchan_DecompressMessage( msg_t *msg )
 	if( msg->compressed == qfalse )
 		return 0;
 
-	length = Netchan_ZLibDecompressChunk( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, ( sizeof( msg_process_data ) - msg->readcount ), -MAX_WBITS );
+	if( chan && chan->dictCompression )
+	{
+		if( !netchan_dict )
+			return -1;
+		QMutex_Lock( netchan_dictmutex );
+		length = Netchan_ZLibDecompressChunkDict( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, ( sizeof( msg_process_data ) - msg->readcount ), netchan_dict, netchan_dictlen );
+		QMutex_Unlock( netchan_dictmutex );
+	}
+	else
+		length = Netchan_ZLibDecompressChunk( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, ( sizeof( msg_process_data ) - msg->readcount ), -MAX_WBITS );
 	if( length < 0 )
 		return length;
 
@@ -756,6 +918,297 @@ int Netchan_GamePort( void )
 	return game_port;
 }
 
+//=============================================================
+// Dictionary training
+//
+// Picks the byte strings that show up in the most messages of a set of
+// demos. The samples are split into as many epochs as the dictionary
+// has segments, and each epoch contributes its best scoring segment.
+// The segment k-mers are then cleared so that later epochs don't pick
+// the same content again. Stronger segments go last, closest to the data.
+//=============================================================
+
+#define NETDICT_KMER			8
+#define NETDICT_SEGMENT			64
+#define NETDICT_HASH_BITS		20
+#define NETDICT_MAX_SAMPLES		( 32 * 1024 * 1024 )
+#define NETDICT_EVAL_MESSAGES	4096
+
+typedef struct
+{
+	qbyte *data;
+	size_t size;
+	int *lengths;
+	int numMessages, maxMessages;
+} netdict_samples_t;
+
+typedef struct
+{
+	size_t offset;
+	unsigned int score;
+} netdict_segment_t;
+
+/*
+* Netchan_DictHash
+*/
+static inline unsigned int Netchan_DictHash( const qbyte *p )
+{
+	quint64 v;
+
+	memcpy( &v, p, sizeof( v ) );
+	return (unsigned int)( ( v * 0xcf1bbcdcb7a56463ULL ) >> ( 64 - NETDICT_HASH_BITS ) );
+}
+
+/*
+* Netchan_TrainDict_AddDemo
+*/
+static void Netchan_TrainDict_AddDemo( netdict_samples_t *samples, const char *filename )
+{
+	int demofile, length, msglen, num = 0;
+
+	length = FS_FOpenFile( filename, &demofile, FS_READ|SNAP_DEMO_GZ );
+	if( !demofile || length < 1 )
+	{
+		Com_Printf( "Couldn't open %s\n", filename );
+		if( demofile )
+			FS_FCloseFile( demofile );
+		return;
+	}
+
+	while( samples->size + MAX_MSGLEN <= NETDICT_MAX_SAMPLES )
+	{
+		if( FS_Read( &msglen, 4, demofile ) != 4 )
+			break;
+		msglen = LittleLong( msglen );
+		if( msglen <= 0 || msglen > MAX_MSGLEN )
+			break;
+		if( FS_Read( samples->data + samples->size, msglen, demofile ) != msglen )
+			break;
+
+		if( samples->numMessages == samples->maxMessages )
+		{
+			samples->maxMessages += 4096;
+			if( samples->lengths )
+				samples->lengths = Mem_Realloc( samples->lengths, samples->maxMessages * sizeof( *samples->lengths ) );
+			else
+				samples->lengths = Mem_TempMalloc( samples->maxMessages * sizeof( *samples->lengths ) );
+		}
+		samples->lengths[samples->numMessages++] = msglen;
+		samples->size += msglen;
+		num++;
+	}
+
+	FS_FCloseFile( demofile );
+
+	Com_Printf( "%s: %i messages\n", filename, num );
+}
+
+/*
+* Netchan_TrainDict_CmpSegments
+*/
+static int Netchan_TrainDict_CmpSegments( const void *p1, const void *p2 )
+{
+	const netdict_segment_t *s1 = p1, *s2 = p2;
+
+	if( s1->score == s2->score )
+		return 0;
+	return s1->score < s2->score ? -1 : 1;
+}
+
+/*
+* Netchan_TrainDict
+*/
+static int Netchan_TrainDict( const netdict_samples_t *samples, qbyte *dict, int dictsize )
+{
+	const qbyte *data = samples->data;
+	unsigned int *counts, score, best;
+	int *last;
+	int i, j, numSegments, numSelected, window, dictlen;
+	size_t ofs, pos, start, end, epoch, bestpos;
+	netdict_segment_t *segments;
+
+	counts = Mem_TempMalloc( ( 1<<NETDICT_HASH_BITS ) * sizeof( *counts ) );
+	last = Mem_TempMalloc( ( 1<<NETDICT_HASH_BITS ) * sizeof( *last ) );
+	memset( last, -1, ( 1<<NETDICT_HASH_BITS ) * sizeof( *last ) );
+
+	// count in how many messages each k-mer appears
+	for( i = 0, ofs = 0; i < samples->numMessages; ofs += samples->lengths[i], i++ )
+	{
+		for( j = 0; j + NETDICT_KMER <= samples->lengths[i]; j++ )
+		{
+			unsigned int h = Netchan_DictHash( data + ofs + j );
+			if( last[h] != i )
+			{
+				last[h] = i;
+				counts[h]++;
+			}
+		}
+	}
+
+	Mem_TempFree( last );
+
+	numSegments = dictsize / NETDICT_SEGMENT;
+	segments = Mem_TempMalloc( numSegments * sizeof( *segments ) );
+	epoch = max( samples->size / numSegments, NETDICT_SEGMENT );
+	window = NETDICT_SEGMENT - NETDICT_KMER + 1;
+
+	numSelected = 0;
+	for( start = 0; numSelected < numSegments && start + NETDICT_SEGMENT <= samples->size; start += epoch )
+	{
+		end = min( start + epoch, samples->size );
+
+		// slide a segment over the epoch, scoring the sum of its k-mer counts
+		best = score = 0;
+		bestpos = start;
+		for( pos = start; pos + NETDICT_KMER <= end; pos++ )
+		{
+			score += counts[Netchan_DictHash( data + pos )];
+			if( pos - start < (size_t)window - 1 )
+				continue;
+			if( pos - start >= (size_t)window )
+				score -= counts[Netchan_DictHash( data + pos - window )];
+			if( score > best )
+			{
+				best = score;
+				bestpos = pos - window + 1;
+			}
+		}
+
+		// content seen in a single message isn't worth the room
+		if( best <= (unsigned int)window )
+			continue;
+
+		segments[numSelected].offset = bestpos;
+		segments[numSelected].score = best;
+		numSelected++;
+
+		for( j = 0; j < window; j++ )
+			counts[Netchan_DictHash( data + bestpos + j )] = 0;
+	}
+
+	qsort( segments, numSelected, sizeof( *segments ), Netchan_TrainDict_CmpSegments );
+
+	dictlen = 0;
+	for( i = 0; i < numSelected; i++ )
+	{
+		memcpy( dict + dictlen, data + segments[i].offset, NETDICT_SEGMENT );
+		dictlen += NETDICT_SEGMENT;
+	}
+
+	Mem_TempFree( segments );
+	Mem_TempFree( counts );
+
+	return dictlen;
+}
+
+/*
+* Netchan_TrainDict_f
+*/
+static void Netchan_TrainDict_f( void )
+{
+	netdict_samples_t samples;
+	char name[MAX_QPATH];
+	char *buffer, *s;
+	qbyte *dict;
+	int i, numdemos, dictlen, step, length;
+	size_t bufSize, ofs;
+	int plain, primed, original, evaluated;
+	int file;
+	qbyte msg_process_data[MAX_MSGLEN];
+
+	if( Cmd_Argc() < 2 )
+	{
+		Com_Printf( "Usage: %s <output> [demo1 demo2 ...]\n", Cmd_Argv( 0 ) );
+		Com_Printf( "Without demos given, all the demos in the demos directory are used\n" );
+		return;
+	}
+
+	memset( &samples, 0, sizeof( samples ) );
+	samples.data = Mem_TempMalloc( NETDICT_MAX_SAMPLES );
+
+	if( Cmd_Argc() > 2 )
+	{
+		for( i = 2; i < Cmd_Argc(); i++ )
+		{
+			Q_snprintfz( name, sizeof( name ), "demos/%s", Cmd_Argv( i ) );
+			COM_DefaultExtension( name, APP_DEMO_EXTENSION_STR, sizeof( name ) );
+			Netchan_TrainDict_AddDemo( &samples, name );
+		}
+	}
+	else
+	{
+		numdemos = FS_GetFileListExt( "demos", APP_DEMO_EXTENSION_STR, NULL, &bufSize, 0, 0 );
+		if( numdemos )
+		{
+			buffer = Mem_TempMalloc( bufSize );
+			FS_GetFileList( "demos", APP_DEMO_EXTENSION_STR, buffer, bufSize, 0, 0 );
+			for( i = 0, s = buffer; i < numdemos; i++, s += strlen( s ) + 1 )
+			{
+				Q_snprintfz( name, sizeof( name ), "demos/%s", s );
+				Netchan_TrainDict_AddDemo( &samples, name );
+			}
+			Mem_TempFree( buffer );
+		}
+	}
+
+	if( samples.size < 4 * NETCHAN_DICT_MAXSIZE )
+	{
+		Com_Printf( "Not enough demo data to train a dictionary: %i bytes\n", (int)samples.size );
+		goto done;
+	}
+
+	dict = Mem_TempMalloc( NETCHAN_DICT_MAXSIZE );
+	dictlen = Netchan_TrainDict( &samples, dict, NETCHAN_DICT_MAXSIZE );
+	if( !dictlen )
+	{
+		Com_Printf( "No repeated content found in the demos\n" );
+		Mem_TempFree( dict );
+		goto done;
+	}
+
+	// see how a spread of the messages compresses with and without it
+	plain = primed = original = evaluated = 0;
+	step = max( samples.numMessages / NETDICT_EVAL_MESSAGES, 1 );
+	for( i = 0, ofs = 0; i < samples.numMessages; ofs += samples.lengths[i], i++ )
+	{
+		if( i % step )
+			continue;
+
+		length = samples.lengths[i];
+		original += length;
+		evaluated++;
+
+		length = Netchan_ZLibCompressChunk( samples.data + ofs, samples.lengths[i], msg_process_data, sizeof( msg_process_data ), Z_DEFAULT_COMPRESSION, -MAX_WBITS );
+		plain += ( length > 0 && length < samples.lengths[i] ) ? length : samples.lengths[i];
+		QMutex_Lock( netchan_dictmutex );
+		length = Netchan_ZLibCompressChunkDict( samples.data + ofs, samples.lengths[i], msg_process_data, sizeof( msg_process_data ), dict, dictlen );
+		QMutex_Unlock( netchan_dictmutex );
+		primed += ( length > 0 && length < samples.lengths[i] ) ? length : samples.lengths[i];
+	}
+
+	if( FS_FOpenFile( Cmd_Argv( 1 ), &file, FS_WRITE ) == -1 )
+	{
+		Com_Printf( "Couldn't open %s for writing\n", Cmd_Argv( 1 ) );
+	}
+	else
+	{
+		FS_Write( dict, dictlen, file );
+		FS_FCloseFile( file );
+
+		Com_Printf( "Wrote a %i bytes dictionary to %s, trained on %i messages\n", dictlen, Cmd_Argv( 1 ), samples.numMessages );
+		if( original )
+			Com_Printf( "Compressed sizes over %i messages: %.1f%% without it, %.1f%% with it\n", evaluated,
+				100.0f * plain / original, 100.0f * primed / original );
+	}
+
+	Mem_TempFree( dict );
+
+done:
+	if( samples.lengths )
+		Mem_Free( samples.lengths );
+	Mem_TempFree( samples.data );
+}
+
 /*
 * Netchan_Init
 */
@@ -767,6 +1220,12 @@ void Netchan_Init( void )
 	showpackets = Cvar_Get( "showpackets", "0", 0 );
 	showdrop = Cvar_Get( "showdrop", "0", 0 );
 	net_showfragments = Cvar_Get( "net_showfragments", "0", 0 );
+	net_compressdict = Cvar_Get( "net_compressdict", "netchan.dict", CVAR_ARCHIVE );
+
+	netchan_dictmutex = QMutex_Create();
+	Netchan_LoadDict();
+
+	Cmd_AddCommand( "net_traindict", Netchan_TrainDict_f );
 }
 
 /*
@@ -774,4 +1233,26 @@ void Netchan_Init( void )
 */
 void Netchan_Shutdown( void )
 {
+	Cmd_RemoveCommand( "net_traindict" );
+
+	if( netchan_dictdeflate_init )
+	{
+		deflateEnd( &netchan_dictdeflate );
+		netchan_dictdeflate_init = qfalse;
+	}
+	if( netchan_dictinflate_init )
+	{
+		inflateEnd( &netchan_dictinflate );
+		netchan_dictinflate_init = qfalse;
+	}
+
+	if( netchan_dict )
+	{
+		Mem_ZoneFree( netchan_dict );
+		netchan_dict = NULL;
+	}
+	netchan_dictlen = 0;
+	netchan_dictchecksum = 0;
+
+	QMutex_Destroy( &netchan_dictmutex );
 }
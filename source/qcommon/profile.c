@@ -0,0 +1,535 @@
+/*
+Copyright (C) 2014 Chasseur de bots
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// profile.c -- hierarchical zone profiler
+//
+// Zones are named scopes opened with Prof_Enter and closed with Prof_Leave,
+// timed in microseconds. Every zone keeps totals and a log2 histogram of its
+// per-frame time, and the events of the last PROF_MAX_FRAMES frames are kept
+// so they can be dumped in the Chrome trace event format (chrome://tracing).
+// The profiler is meant to be used from the main thread only.
+
+#include "qcommon.h"
+#include "../qalgo/hash.h"
+
+#define PROF_MAX_ZONES				128
+#define PROF_ZONES_HASH_SIZE		256     // must be a power of two
+#define PROF_MAX_ZONE_NAME			32
+#define PROF_MAX_DEPTH				32
+#define PROF_MAX_FRAMES				32
+#define PROF_MAX_FRAME_EVENTS		4096
+#define PROF_HISTOGRAM_BUCKETS		20      // log2 of microseconds, the last one catches everything above
+#define PROF_HITCH_DUMP_DELAY		10000   // don't write hitch traces more often than this, in milliseconds
+
+#define PROF_DUMP_DIRECTORY			"profiles"
+
+typedef struct
+{
+	char name[PROF_MAX_ZONE_NAME];
+	unsigned int hash;
+
+	// accumulated during the current frame
+	unsigned int frameCalls;
+	quint64 frameTime;
+	quint64 frameSelfTime;
+
+	// accumulated since the last reset
+	unsigned int frames;                // number of frames the zone was entered in
+	quint64 calls;
+	quint64 time;
+	quint64 selfTime;
+	quint64 maxFrameTime;
+	unsigned int histogram[PROF_HISTOGRAM_BUCKETS];
+} prof_zone_t;
+
+typedef struct
+{
+	unsigned short zone;
+	unsigned short depth;
+	unsigned int start;                 // relative to the start of the frame
+	unsigned int duration;
+} prof_event_t;
+
+typedef struct
+{
+	unsigned int number;
+	quint64 start;
+	unsigned int duration;
+	int numEvents;
+	int droppedEvents;
+	prof_event_t events[PROF_MAX_FRAME_EVENTS];
+} prof_frame_t;
+
+typedef struct
+{
+	int zone;
+	int event;
+	quint64 start;
+	quint64 childTime;
+} prof_stackentry_t;
+
+qboolean prof_active = qfalse;
+
+static cvar_t *com_profile;
+static cvar_t *com_profile_hitch;
+
+static prof_zone_t prof_zones[PROF_MAX_ZONES];
+static int prof_numZones;
+static short prof_zonesHash[PROF_ZONES_HASH_SIZE];      // zone index + 1
+
+static prof_frame_t *prof_frames;      // [PROF_MAX_FRAMES]
+static prof_frame_t *prof_frame;       // current frame, NULL outside of frames
+static unsigned int prof_frameCount;
+static unsigned int prof_numFrames;    // frames accumulated since the last reset
+
+static prof_stackentry_t prof_stack[PROF_MAX_DEPTH];
+static int prof_depth;
+
+static int prof_sleepZone;             // time spent in the "sleep" zone doesn't count towards hitches
+static unsigned int prof_lastHitchDump;
+
+/*
+* Prof_FindZone
+*/
+static int Prof_FindZone( const char *name )
+{
+	int i, len;
+	unsigned int hash, slot;
+	prof_zone_t *zone;
+
+	len = strlen( name );
+	hash = COM_SuperFastHash( ( const qbyte * )name, len, len );
+
+	for( i = 0; i < PROF_ZONES_HASH_SIZE; i++ )
+	{
+		slot = ( hash + i ) & ( PROF_ZONES_HASH_SIZE - 1 );
+		if( !prof_zonesHash[slot] )
+			break;
+
+		zone = &prof_zones[prof_zonesHash[slot] - 1];
+		if( zone->hash == hash && !strncmp( zone->name, name, sizeof( zone->name ) - 1 ) )
+			return prof_zonesHash[slot] - 1;
+	}
+
+	if( i == PROF_ZONES_HASH_SIZE || prof_numZones == PROF_MAX_ZONES )
+		return -1;
+
+	// register a new zone, the name is copied so that the zone survives
+	// unloading of the module which owns the string
+	zone = &prof_zones[prof_numZones];
+	memset( zone, 0, sizeof( *zone ) );
+	Q_strncpyz( zone->name, name, sizeof( zone->name ) );
+	zone->hash = hash;
+	prof_zonesHash[slot] = ++prof_numZones;
+
+	return prof_numZones - 1;
+}
+
+/*
+* Prof_Enter
+*/
+void Prof_Enter( const char *name )
+{
+	prof_stackentry_t *entry;
+
+	if( !prof_frame )
+		return;
+
+	if( prof_depth++ >= PROF_MAX_DEPTH )
+		return;
+
+	entry = &prof_stack[prof_depth - 1];
+	entry->zone = Prof_FindZone( name );
+	entry->childTime = 0;
+
+	if( entry->zone >= 0 && prof_frame->numEvents < PROF_MAX_FRAME_EVENTS )
+	{
+		entry->event = prof_frame->numEvents++;
+	}
+	else
+	{
+		entry->event = -1;
+		prof_frame->droppedEvents++;
+	}
+
+	entry->start = Sys_Microseconds();
+}
+
+/*
+* Prof_Leave
+*/
+void Prof_Leave( void )
+{
+	quint64 now, duration;
+	prof_stackentry_t *entry;
+	prof_zone_t *zone;
+	prof_event_t *event;
+
+	if( !prof_frame || !prof_depth )
+		return;
+
+	if( prof_depth-- > PROF_MAX_DEPTH )
+		return;
+
+	now = Sys_Microseconds();
+	entry = &prof_stack[prof_depth];
+	duration = now > entry->start ? now - entry->start : 0;
+
+	if( prof_depth )
+		prof_stack[prof_depth - 1].childTime += duration;
+
+	if( entry->zone < 0 )
+		return;
+
+	zone = &prof_zones[entry->zone];
+	zone->frameCalls++;
+	zone->frameTime += duration;
+	zone->frameSelfTime += duration > entry->childTime ? duration - entry->childTime : 0;
+
+	if( entry->event >= 0 )
+	{
+		event = &prof_frame->events[entry->event];
+		event->zone = entry->zone;
+		event->depth = prof_depth;
+		event->start = entry->start - prof_frame->start;
+		event->duration = duration;
+	}
+}
+
+/*
+* Prof_HistogramBucket
+*/
+static int Prof_HistogramBucket( quint64 usec )
+{
+	int bucket;
+
+	for( bucket = 0; usec && bucket < PROF_HISTOGRAM_BUCKETS - 1; bucket++ )
+		usec >>= 1;
+
+	return bucket;
+}
+
+/*
+* Prof_HistogramPercentile
+* Returns the upper bound of the bucket the percentile falls in
+*/
+static quint64 Prof_HistogramPercentile( const prof_zone_t *zone, float percentile )
+{
+	int i;
+	unsigned int count, target;
+
+	if( !zone->frames )
+		return 0;
+
+	target = (unsigned int)( zone->frames * percentile );
+	for( i = 0, count = 0; i < PROF_HISTOGRAM_BUCKETS - 1; i++ )
+	{
+		count += zone->histogram[i];
+		if( count > target )
+			break;
+	}
+
+	return i ? ( (quint64)1 << i ) - 1 : 0;
+}
+
+/*
+* Prof_ResetStats
+*/
+static void Prof_ResetStats( void )
+{
+	int i;
+	prof_zone_t *zone;
+
+	for( i = 0, zone = prof_zones; i < prof_numZones; i++, zone++ )
+	{
+		zone->frames = 0;
+		zone->calls = 0;
+		zone->time = zone->selfTime = zone->maxFrameTime = 0;
+		memset( zone->histogram, 0, sizeof( zone->histogram ) );
+	}
+
+	prof_numFrames = 0;
+}
+
+/*
+* Prof_WriteTrace
+* Writes all recorded frames, oldest first, in the Chrome trace event format
+*/
+static qboolean Prof_WriteTrace( const char *filename )
+{
+	int file, i, j;
+	unsigned int first;
+	qboolean comma;
+	prof_frame_t *frame;
+	prof_event_t *event;
+
+	if( !prof_frames || !prof_frameCount )
+		return qfalse;
+
+	if( FS_FOpenFile( filename, &file, FS_WRITE ) == -1 )
+		return qfalse;
+
+	FS_Printf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+	comma = qfalse;
+	first = prof_frameCount > PROF_MAX_FRAMES ? prof_frameCount - PROF_MAX_FRAMES : 0;
+	for( i = first; i < (int)prof_frameCount; i++ )
+	{
+		frame = &prof_frames[i % PROF_MAX_FRAMES];
+		if( frame == prof_frame )
+			continue;
+
+		for( j = 0, event = frame->events; j < frame->numEvents; j++, event++ )
+		{
+			FS_Printf( file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.0f,\"dur\":%u",
+				comma ? ",\n" : "", prof_zones[event->zone].name, (double)( frame->start + event->start ), event->duration );
+			if( !event->depth )
+				FS_Printf( file, ",\"args\":{\"frame\":%u,\"dropped\":%i}", frame->number, frame->droppedEvents );
+			FS_Printf( file, "}" );
+			comma = qtrue;
+		}
+	}
+
+	FS_Printf( file, "\n]}\n" );
+	FS_FCloseFile( file );
+
+	return qtrue;
+}
+
+/*
+* Prof_CheckActive
+* Allocates or releases the frame ring when com_profile is toggled
+*/
+static void Prof_CheckActive( void )
+{
+	if( !com_profile->modified )
+		return;
+	com_profile->modified = qfalse;
+
+	if( com_profile->integer && !prof_frames )
+	{
+		prof_frames = Mem_ZoneMalloc( sizeof( prof_frame_t ) * PROF_MAX_FRAMES );
+		prof_frameCount = 0;
+		Prof_ResetStats();
+	}
+	else if( !com_profile->integer && prof_frames )
+	{
+		Mem_ZoneFree( prof_frames );
+		prof_frames = NULL;
+	}
+
+	prof_active = prof_frames ? qtrue : qfalse;
+}
+
+/*
+* Prof_BeginFrame
+*/
+void Prof_BeginFrame( void )
+{
+	// the previous frame may have been aborted by an error
+	if( prof_frame )
+		Prof_EndFrame();
+
+	Prof_CheckActive();
+	if( !prof_active )
+		return;
+
+	prof_frame = &prof_frames[prof_frameCount % PROF_MAX_FRAMES];
+	prof_frame->number = prof_frameCount++;
+	prof_frame->start = Sys_Microseconds();
+	prof_frame->duration = 0;
+	prof_frame->numEvents = 0;
+	prof_frame->droppedEvents = 0;
+
+	prof_depth = 0;
+	Prof_Enter( "frame" );
+}
+
+/*
+* Prof_EndFrame
+*/
+void Prof_EndFrame( void )
+{
+	int i;
+	unsigned int busy;
+	prof_zone_t *zone;
+	prof_frame_t *frame;
+
+	if( !prof_frame )
+		return;
+
+	// close everything that is still open, including the frame zone
+	while( prof_depth )
+		Prof_Leave();
+
+	frame = prof_frame;
+	frame->duration = frame->numEvents ? frame->events[0].duration : 0;
+	prof_frame = NULL;
+
+	busy = frame->duration;
+	if( prof_sleepZone >= 0 )
+		busy -= (unsigned int)min( (quint64)busy, prof_zones[prof_sleepZone].frameTime );
+
+	for( i = 0, zone = prof_zones; i < prof_numZones; i++, zone++ )
+	{
+		if( !zone->frameCalls )
+			continue;
+
+		zone->frames++;
+		zone->calls += zone->frameCalls;
+		zone->time += zone->frameTime;
+		zone->selfTime += zone->frameSelfTime;
+		if( zone->frameTime > zone->maxFrameTime )
+			zone->maxFrameTime = zone->frameTime;
+		zone->histogram[Prof_HistogramBucket( zone->frameTime )]++;
+
+		zone->frameCalls = 0;
+		zone->frameTime = zone->frameSelfTime = 0;
+	}
+	prof_numFrames++;
+
+	if( com_profile_hitch->value > 0 && busy >= com_profile_hitch->value * 1000 )
+	{
+		unsigned int now = Sys_Milliseconds();
+		const char *filename;
+
+		if( !prof_lastHitchDump || now - prof_lastHitchDump >= PROF_HITCH_DUMP_DELAY )
+		{
+			prof_lastHitchDump = now;
+			filename = va( "%s/hitch_%u.json", PROF_DUMP_DIRECTORY, frame->number );
+			if( Prof_WriteTrace( filename ) )
+				Com_Printf( "Frame %u took %.1f ms, trace written to %s\n", frame->number,
+					busy * 0.001f, filename );
+		}
+	}
+}
+
+/*
+* Prof_Stats_f
+*/
+static void Prof_Stats_f( void )
+{
+	int i;
+	prof_zone_t *zone;
+
+	if( !prof_numFrames )
+	{
+		Com_Printf( "No profiled frames, set com_profile to 1\n" );
+		return;
+	}
+
+	Com_Printf( "Profile of %u frames (times in usec per frame)\n", prof_numFrames );
+	Com_Printf( "zone                     calls      avg     self      p50      p99      max\n" );
+	Com_Printf( "------------------------ -------- -------- -------- -------- -------- --------\n" );
+	for( i = 0, zone = prof_zones; i < prof_numZones; i++, zone++ )
+	{
+		if( !zone->frames )
+			continue;
+
+		Com_Printf( "%-24s %8.1f %8u %8u %8u %8u %8u\n", zone->name, (float)zone->calls / prof_numFrames,
+			(unsigned int)( zone->time / prof_numFrames ), (unsigned int)( zone->selfTime / prof_numFrames ),
+			(unsigned int)Prof_HistogramPercentile( zone, 0.5f ), (unsigned int)Prof_HistogramPercentile( zone, 0.99f ),
+			(unsigned int)zone->maxFrameTime );
+	}
+}
+
+/*
+* Prof_Dump_f
+*/
+static void Prof_Dump_f( void )
+{
+	char filename[MAX_QPATH];
+
+	if( !prof_active )
+	{
+		Com_Printf( "Profiler is not active, set com_profile to 1\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 )
+	{
+		Q_snprintfz( filename, sizeof( filename ), "%s/%s", PROF_DUMP_DIRECTORY, Cmd_Argv( 1 ) );
+		COM_SanitizeFilePath( filename );
+		if( !COM_ValidateRelativeFilename( filename ) )
+		{
+			Com_Printf( "Invalid filename\n" );
+			return;
+		}
+		COM_DefaultExtension( filename, ".json", sizeof( filename ) );
+	}
+	else
+	{
+		Q_snprintfz( filename, sizeof( filename ), "%s/profile_%u.json", PROF_DUMP_DIRECTORY, prof_frameCount );
+	}
+
+	if( !Prof_WriteTrace( filename ) )
+	{
+		Com_Printf( "Couldn't write %s\n", filename );
+		return;
+	}
+
+	Com_Printf( "Wrote %s\n", filename );
+}
+
+/*
+* Prof_Reset_f
+*/
+static void Prof_Reset_f( void )
+{
+	Prof_ResetStats();
+}
+
+/*
+* Prof_Init
+*/
+void Prof_Init( void )
+{
+	com_profile = Cvar_Get( "com_profile", "0", 0 );
+	com_profile->modified = qtrue;
+	com_profile_hitch = Cvar_Get( "com_profile_hitch", "0", 0 );
+
+	memset( prof_zonesHash, 0, sizeof( prof_zonesHash ) );
+	prof_numZones = 0;
+
+	Prof_FindZone( "frame" );
+	prof_sleepZone = Prof_FindZone( "sleep" );
+
+	Cmd_AddCommand( "profile_stats", Prof_Stats_f );
+	Cmd_AddCommand( "profile_dump", Prof_Dump_f );
+	Cmd_AddCommand( "profile_reset", Prof_Reset_f );
+}
+
+/*
+* Prof_Shutdown
+*/
+void Prof_Shutdown( void )
+{
+	Cmd_RemoveCommand( "profile_stats" );
+	Cmd_RemoveCommand( "profile_dump" );
+	Cmd_RemoveCommand( "profile_reset" );
+
+	if( prof_frames )
+	{
+		Mem_ZoneFree( prof_frames );
+		prof_frames = NULL;
+	}
+	prof_frame = NULL;
+	prof_active = qfalse;
+}
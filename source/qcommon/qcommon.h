@@ -141,14 +141,32 @@ void SNAP_ParseBaseline( msg_t *msg, entity_state_t *baselines );
 void SNAP_SkipFrame( msg_t *msg, struct snapshot_s *header );
 struct snapshot_s *SNAP_ParseFrame( msg_t *msg, struct snapshot_s *lastFrame, int *suppressCount, struct snapshot_s *backup, entity_state_t *baselines, int showNet );
 
+// encoded frame snapshots, shared by clients which are sent the same frame
+// from the same delta base. the data is allocated from the frame arena
+typedef struct
+{
+	unsigned int frameKey;
+	unsigned int baseKey;				// 0 if not delta compressed
+	size_t length;
+	qbyte *data;
+} snap_encodedbody_t;
+
+typedef struct
+{
+	int numBodies;
+	int maxBodies;
+	snap_encodedbody_t *bodies;			// [maxBodies]
+} snap_bodycache_t;
+
 void SNAP_WriteFrameSnapToClient( struct ginfo_s *gi, struct client_s *client, msg_t *msg, unsigned int frameNum, unsigned int gameTime,
 								 entity_state_t *baselines, struct client_entities_s *client_entities,
-								 int numcmds, gcommand_t *commands, const char *commandsData );
+								 int numcmds, gcommand_t *commands, const char *commandsData, snap_bodycache_t *bodycache );
 
 void SNAP_BuildClientFrameSnap( struct cmodel_state_s *cms, struct ginfo_s *gi, unsigned int frameNum, unsigned int timeStamp,
 							   struct fatvis_s *fatvis, struct client_s *client, 
 							   game_state_t *gameState, struct client_entities_s *client_entities,
 							   qboolean relay, struct mempool_s *mempool );
+void SNAP_CopyClientFrameSnap( struct cmodel_state_s *cms, struct client_s *client, struct client_s *from, unsigned int frameNum, struct mempool_s *mempool );
 
 void SNAP_FreeClientFrames( struct client_s *client );
 
@@ -164,6 +182,46 @@ size_t SNAP_SetDemoMetaKeyValue( char *meta_data, size_t meta_data_max_size, siz
 							  const char *key, const char *value );
 size_t SNAP_ReadDemoMetaData( int demofile, char *meta_data, size_t meta_data_size );
 
+#define SNAP_DEMO_KEYFRAME_INTERVAL		10000	// msecs between nodelta frames the demo writers try to keep
+#define SNAP_DEMO_INDEX_META_KEY		"seekindex"
+#define SNAP_DEMO_INDEX_CS_META_KEY		"seekconfigstrings"
+
+typedef struct
+{
+	unsigned int time;			// serverTime of the nodelta frame
+	unsigned int offset;		// uncompressed offset of the demo message holding it
+} snapDemoKeyframe_t;
+
+typedef struct
+{
+	unsigned int numKeyframes;
+	unsigned int maxKeyframes;
+	snapDemoKeyframe_t *keyframes;
+
+	qboolean withConfigstrings;	// keyframes are preceded by the configstrings changed since the demo started
+	char *configstrings;		// the configstrings the demo started with
+} snapDemoIndex_t;
+
+void SNAP_AddDemoKeyframe( snapDemoIndex_t *index, unsigned int time, unsigned int offset );
+const snapDemoKeyframe_t *SNAP_FindDemoKeyframe( const snapDemoIndex_t *index, unsigned int time );
+void SNAP_FreeDemoIndex( snapDemoIndex_t *index );
+void SNAP_SetDemoIndexConfigstrings( snapDemoIndex_t *index, const char *configstrings );
+int SNAP_WriteDemoKeyframeConfigstrings( msg_t *msg, const snapDemoIndex_t *index, const char *configstrings, int start );
+size_t SNAP_SetDemoMetaIndex( char *meta_data, size_t meta_data_max_size, size_t meta_data_realsize, const snapDemoIndex_t *index );
+qboolean SNAP_ReadDemoMetaIndex( const char *meta_data, size_t meta_data_realsize, snapDemoIndex_t *index );
+qboolean SNAP_BuildDemoIndex( int demofile, snapDemoIndex_t *index );
+
+typedef struct snapDemoWriter_s snapDemoWriter_t;
+
+snapDemoWriter_t *SNAP_CreateDemoWriter( int demofile, size_t queueSize );
+void SNAP_DemoWriterRecordMessage( snapDemoWriter_t *writer, msg_t *msg, int offset );
+void SNAP_FlushDemoWriter( snapDemoWriter_t *writer );
+int SNAP_DemoWriterPending( snapDemoWriter_t *writer );
+unsigned int SNAP_DemoWriterTell( snapDemoWriter_t *writer );
+void SNAP_DestroyDemoWriter( snapDemoWriter_t **pwriter );
+void SNAP_PrintDemoWriterStats( snapDemoWriter_t *writer );
+void SNAP_ShutdownDemoWriters( void );
+
 //============================================================================
 
 int COM_Argc( void );
@@ -275,6 +333,10 @@ enum clc_ops_e
 #define SV_BITFLAGS_HTTP			( 1<<3 )
 #define SV_BITFLAGS_HTTP_BASEURL	( 1<<4 )
 
+// connect packet flags
+#define CONNECT_FLAG_TVCLIENT			( 1<<0 )
+#define CONNECT_FLAG_DICTCOMPRESSION	( 1<<1 )	// netchan compression with the preset dictionary
+
 // framesnap flags
 #define FRAMESNAP_FLAG_DELTA		( 1<<0 )
 #define FRAMESNAP_FLAG_ALLENTITIES	( 1<<1 )
@@ -630,7 +692,11 @@ qboolean    NET_SendPacket( const socket_t *socket, const void *data, size_t len
 int			NET_Get( const socket_t *socket, netadr_t *address, void *data, size_t length );
 int         NET_Send( const socket_t *socket, const void *data, size_t length, const netadr_t *address );
 
+qboolean	NET_SetSocketBatching( const socket_t *socket, qboolean enable );
+void		NET_FlushBatches( void );
+
 void	    NET_Sleep( int msec, socket_t *sockets[] );
+void	    NET_SleepUntil( quint64 deadline, socket_t *sockets[] );
 int         NET_Monitor( int msec, socket_t *sockets[], 
 	void (*read_cb)(socket_t *socket, void*), void (*exception_cb)(socket_t *socket, void*), void *privatep[] );
 const char *NET_ErrorString( void );
@@ -649,6 +715,8 @@ void			NET_SetAddressPort( netadr_t *address, unsigned short port );
 
 qboolean    NET_CompareAddress( const netadr_t *a, const netadr_t *b );
 qboolean    NET_CompareBaseAddress( const netadr_t *a, const netadr_t *b );
+unsigned int NET_BaseAddressHash( const netadr_t *address );
+unsigned int NET_ClientHashKey( const netadr_t *address, int game_port, unsigned int size );
 qboolean    NET_IsLANAddress( const netadr_t *address );
 qboolean    NET_IsLocalAddress( const netadr_t *address );
 qboolean    NET_IsAnyAddress( const netadr_t *address );
@@ -684,6 +752,8 @@ typedef struct
 	qbyte unsentBuffer[MAX_MSGLEN];
 	qboolean unsentIsCompressed;
 
+	qboolean dictCompression;	// compressed messages use the preset dictionary
+
 	qboolean fatal_error;
 } netchan_t;
 
@@ -697,8 +767,9 @@ qboolean Netchan_Process( netchan_t *chan, msg_t *msg );
 qboolean Netchan_Transmit( netchan_t *chan, msg_t *msg );
 qboolean Netchan_PushAllFragments( netchan_t *chan );
 qboolean Netchan_TransmitNextFragment( netchan_t *chan );
-int Netchan_CompressMessage( msg_t *msg );
-int Netchan_DecompressMessage( msg_t *msg );
+int Netchan_CompressMessage( netchan_t *chan, msg_t *msg );
+int Netchan_DecompressMessage( netchan_t *chan, msg_t *msg );
+unsigned int Netchan_DictChecksum( void );
 void Netchan_OutOfBand( const socket_t *socket, const netadr_t *address, size_t length, const qbyte *data );
 void Netchan_OutOfBandPrint( const socket_t *socket, const netadr_t *address, const char *format, ... );
 int Netchan_GamePort( void );
@@ -815,6 +886,9 @@ void	    Com_EndRedirect( void );
 void	    Com_Printf( const char *format, ... );
 void	    Com_DPrintf( const char *format, ... );
 void	    Com_Error( com_error_code_t code, const char *format, ... );
+
+typedef void ( *com_drophandler_t )( void *context, const char *msg );
+void	    Com_SetDropHandler( com_drophandler_t handler, void *context );
 void	    Com_Quit( void );
 
 int			Com_ClientState( void );        // this should have just been a cvar...
@@ -850,6 +924,28 @@ extern unsigned int time_after_ref;
 /*
 ==============================================================
 
+PROFILER
+
+==============================================================
+*/
+
+// zones are opened and closed in pairs from the main thread, the names
+// are copied on first use
+void	    Prof_Init( void );
+void	    Prof_Shutdown( void );
+void	    Prof_BeginFrame( void );
+void	    Prof_EndFrame( void );
+void	    Prof_Enter( const char *name );
+void	    Prof_Leave( void );
+
+extern qboolean prof_active;
+
+#define PROF_ENTER( name ) do { if( prof_active ) Prof_Enter( name ); } while( 0 )
+#define PROF_LEAVE() do { if( prof_active ) Prof_Leave(); } while( 0 )
+
+/*
+==============================================================
+
 MEMORY MANAGEMENT
 
 ==============================================================
@@ -913,6 +1009,18 @@ extern mempool_t *zoneMemPool;
 #define Mem_TempMalloc( size ) Mem_Alloc( tempMemPool, size )
 #define Mem_TempFree( data ) Mem_Free( data )
 
+// thread-local arena for buffers that don't outlive the frame, Qcommon_Frame resets
+// the main thread's arena, other threads must use marks or call Mem_FrameReset
+void *_Mem_FrameAllocExt( size_t size, int z, const char *filename, int fileline );
+size_t Mem_FrameMark( void );
+void _Mem_FrameRelease( size_t mark, const char *filename, int fileline );
+void _Mem_FrameReset( const char *filename, int fileline );
+
+#define Mem_FrameAllocExt( size, z ) _Mem_FrameAllocExt( size, z, __FILE__, __LINE__ )
+#define Mem_FrameAlloc( size ) _Mem_FrameAllocExt( size, 1, __FILE__, __LINE__ )
+#define Mem_FrameRelease( mark ) _Mem_FrameRelease( mark, __FILE__, __LINE__ )
+#define Mem_FrameReset() _Mem_FrameReset( __FILE__, __LINE__ )
+
 void *Q_malloc( size_t size );
 void *Q_realloc( void *buf, size_t newsize );
 void Q_free( void *buf );
@@ -970,14 +1078,7 @@ CPU FEATURES
 ==============================================================
 */
 
-#define QCPU_HAS_RDTSC		0x00000001
-#define QCPU_HAS_MMX		0x00000002
-#define QCPU_HAS_MMXEXT		0x00000004
-#define QCPU_HAS_3DNOW		0x00000010
-#define QCPU_HAS_3DNOWEXT	0x00000020
-#define QCPU_HAS_SSE		0x00000040
-#define QCPU_HAS_SSE2		0x00000080
-
+// the QCPU_HAS_* flags are in q_arch.h
 unsigned int COM_CPUFeatures( void );
 
 /*
@@ -27,6 +27,9 @@ typedef struct qmutex_s qmutex_t;
 struct qthread_s;
 typedef struct qthread_s qthread_t;
 
+struct qthreadpool_s;
+typedef struct qthreadpool_s qthreadpool_t;
+
 qmutex_t *QMutex_Create( void );
 void QMutex_Destroy( qmutex_t **pmutex );
 void QMutex_Lock( qmutex_t *mutex );
@@ -35,6 +38,11 @@ void QMutex_Unlock( qmutex_t *mutex );
 qthread_t *QThread_Create( void *(*routine) (void*), void *param );
 void QThread_Join( qthread_t *thread );
 
+qthreadpool_t *QThreadPool_Create( int numThreads );
+void QThreadPool_Destroy( qthreadpool_t **ppool );
+int QThreadPool_NumThreads( const qthreadpool_t *pool );
+void QThreadPool_Run( qthreadpool_t *pool, void (*job)( void *, int ), void *param, int numJobs );
+
 void QThreads_Init( void );
 void QThreads_Shutdown( void );
 
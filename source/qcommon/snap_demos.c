@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "qcommon.h"
+#include "sys_threads.h"
 
 #define DEMO_SAFEWRITE(demofile,msg,force) \
 	if( force || (msg)->cursize > (msg)->maxsize / 2 ) \
@@ -319,6 +320,9 @@ void SNAP_StopDemoRecording( int demofile )
 
 /*
 * SNAP_WriteDemoMetaData
+*
+* The file must not be written to by a demo writer thread at this point,
+* see SNAP_DestroyDemoWriter.
 */
 void SNAP_WriteDemoMetaData( const char *filename, const char *meta_data, size_t meta_data_realsize )
 {
@@ -416,3 +420,601 @@ size_t SNAP_ReadDemoMetaData( int demofile, char *meta_data, size_t meta_data_si
 
 	return meta_data_realsize;
 }
+
+/*
+=============================================================================
+
+DEMO SEEK INDEX
+
+Demo writers note the file offset and the server time of every message that
+carries a nodelta frame and store the list in the meta data. The player can
+then start decoding snapshots at the nearest keyframe instead of at the
+start of the demo.
+
+Writers which keep a copy of the configstrings the demo started with also
+write the configstrings changed since right before every keyframe, so
+that the player can restore the configstrings and seek straight to it.
+
+=============================================================================
+*/
+
+#define SNAP_DEMO_INDEX_META_SIZE		8192
+
+/*
+* SNAP_AddDemoKeyframe
+*/
+void SNAP_AddDemoKeyframe( snapDemoIndex_t *index, unsigned int time, unsigned int offset )
+{
+	snapDemoKeyframe_t *kf;
+
+	if( index->numKeyframes ) {
+		kf = &index->keyframes[index->numKeyframes - 1];
+		if( time <= kf->time || offset <= kf->offset ) {
+			return;
+		}
+	}
+
+	if( index->numKeyframes == index->maxKeyframes ) {
+		index->maxKeyframes = index->maxKeyframes ? index->maxKeyframes * 2 : 64;
+		if( index->keyframes ) {
+			index->keyframes = Mem_Realloc( index->keyframes, index->maxKeyframes * sizeof( *kf ) );
+		} else {
+			index->keyframes = Mem_ZoneMalloc( index->maxKeyframes * sizeof( *kf ) );
+		}
+	}
+
+	kf = &index->keyframes[index->numKeyframes++];
+	kf->time = time;
+	kf->offset = offset;
+}
+
+/*
+* SNAP_FindDemoKeyframe
+*
+* Returns the last keyframe at or before given time
+*/
+const snapDemoKeyframe_t *SNAP_FindDemoKeyframe( const snapDemoIndex_t *index, unsigned int time )
+{
+	unsigned int lo, hi, mid;
+
+	if( !index->numKeyframes || index->keyframes[0].time > time ) {
+		return NULL;
+	}
+
+	lo = 0;
+	hi = index->numKeyframes;
+	while( hi - lo > 1 ) {
+		mid = ( lo + hi ) / 2;
+		if( index->keyframes[mid].time <= time ) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return &index->keyframes[lo];
+}
+
+/*
+* SNAP_FreeDemoIndex
+*/
+void SNAP_FreeDemoIndex( snapDemoIndex_t *index )
+{
+	if( index->keyframes ) {
+		Mem_Free( index->keyframes );
+	}
+	if( index->configstrings ) {
+		Mem_Free( index->configstrings );
+	}
+	memset( index, 0, sizeof( *index ) );
+}
+
+/*
+* SNAP_SetDemoIndexConfigstrings
+*
+* Stores a copy of the configstrings the demo started with.
+*/
+void SNAP_SetDemoIndexConfigstrings( snapDemoIndex_t *index, const char *configstrings )
+{
+	if( !index->configstrings ) {
+		index->configstrings = Mem_ZoneMalloc( MAX_CONFIGSTRINGS * MAX_CONFIGSTRING_CHARS );
+	}
+	memcpy( index->configstrings, configstrings, MAX_CONFIGSTRINGS * MAX_CONFIGSTRING_CHARS );
+	index->withConfigstrings = qtrue;
+}
+
+/*
+* SNAP_WriteDemoKeyframeConfigstrings
+*
+* Writes the configstrings that differ from the ones the demo started with,
+* until the message is half full. Returns the index to continue from, which
+* is MAX_CONFIGSTRINGS once all have been written.
+*/
+int SNAP_WriteDemoKeyframeConfigstrings( msg_t *msg, const snapDemoIndex_t *index, const char *configstrings, int start )
+{
+	int i;
+	const char *cs, *base;
+
+	if( !index->configstrings ) {
+		return MAX_CONFIGSTRINGS;
+	}
+
+	for( i = start; i < MAX_CONFIGSTRINGS && msg->cursize <= msg->maxsize / 2; i++ ) {
+		cs = configstrings + i * MAX_CONFIGSTRING_CHARS;
+		base = index->configstrings + i * MAX_CONFIGSTRING_CHARS;
+		if( !strcmp( cs, base ) ) {
+			continue;
+		}
+
+		MSG_WriteByte( msg, svc_servercs );
+		MSG_WriteString( msg, va( "cs %i \"%s\"", i, cs ) );
+	}
+
+	return i;
+}
+
+/*
+* SNAP_EncodeDemoIndex
+*
+* Writes every step'th keyframe as space separated pairs of hex time:offset
+* deltas. Returns qfalse if the string didn't fit into the buffer.
+*/
+static qboolean SNAP_EncodeDemoIndex( const snapDemoIndex_t *index, unsigned int step, char *buf, size_t size )
+{
+	unsigned int i, time, offset;
+	size_t len;
+	const snapDemoKeyframe_t *kf;
+
+	buf[0] = '\0';
+	len = 0;
+	time = offset = 0;
+
+	for( i = 0; i < index->numKeyframes; i += step ) {
+		kf = &index->keyframes[i];
+		Q_snprintfz( buf + len, size - len, "%s%x:%x", len ? " " : "", kf->time - time, kf->offset - offset );
+		len += strlen( buf + len );
+		if( len + 1 >= size ) {
+			return qfalse;
+		}
+		time = kf->time;
+		offset = kf->offset;
+	}
+
+	return qtrue;
+}
+
+/*
+* SNAP_SetDemoMetaIndex
+*
+* Stores the index in the meta data, thinning it out if it grows too large.
+*/
+size_t SNAP_SetDemoMetaIndex( char *meta_data, size_t meta_data_max_size, size_t meta_data_realsize, const snapDemoIndex_t *index )
+{
+	unsigned int step;
+	char *buf;
+
+	if( !index->numKeyframes ) {
+		return meta_data_realsize;
+	}
+
+	buf = Mem_TempMalloc( SNAP_DEMO_INDEX_META_SIZE );
+	for( step = 1; !SNAP_EncodeDemoIndex( index, step, buf, SNAP_DEMO_INDEX_META_SIZE ); step *= 2 );
+
+	meta_data_realsize = SNAP_SetDemoMetaKeyValue( meta_data, meta_data_max_size, meta_data_realsize, 
+		SNAP_DEMO_INDEX_META_KEY, buf );
+	if( index->withConfigstrings ) {
+		meta_data_realsize = SNAP_SetDemoMetaKeyValue( meta_data, meta_data_max_size, meta_data_realsize, 
+			SNAP_DEMO_INDEX_CS_META_KEY, "1" );
+	}
+
+	Mem_TempFree( buf );
+
+	return meta_data_realsize;
+}
+
+/*
+* SNAP_ReadDemoMetaIndex
+*/
+qboolean SNAP_ReadDemoMetaIndex( const char *meta_data, size_t meta_data_realsize, snapDemoIndex_t *index )
+{
+	const char *s, *key, *val;
+	const char *end = meta_data + meta_data_realsize;
+	unsigned int time, offset, dt, doffset;
+	int n;
+
+	for( s = meta_data; s < end && *s; ) {
+		key = s;
+		val = key + strlen( key ) + 1;
+		if( val >= end ) {
+			break;
+		}
+		s = val + strlen( val ) + 1;
+
+		if( !Q_stricmp( key, SNAP_DEMO_INDEX_CS_META_KEY ) ) {
+			index->withConfigstrings = atoi( val ) != 0 ? qtrue : qfalse;
+			continue;
+		}
+
+		if( Q_stricmp( key, SNAP_DEMO_INDEX_META_KEY ) ) {
+			continue;
+		}
+
+		time = offset = 0;
+		while( sscanf( val, "%x:%x%n", &dt, &doffset, &n ) == 2 ) {
+			time += dt;
+			offset += doffset;
+			SNAP_AddDemoKeyframe( index, time, offset );
+			val += n;
+		}
+	}
+
+	return index->numKeyframes > 0 ? qtrue : qfalse;
+}
+
+/*
+=============================================================================
+
+ASYNCHRONOUS DEMO WRITER
+
+Demo messages are copied into a bounded command queue and written (and
+compressed, for gzipped demos) by a separate thread, so that disk stalls
+do not hold up the caller. The queue blocks the caller when full.
+
+A single writer thread, started with the first writer and reused by the
+following ones, serves all writers. It sleeps on a semaphore that is
+posted for every queued message.
+
+=============================================================================
+*/
+
+enum
+{
+	CMD_DEMOWRITER_WRITE,
+	CMD_DEMOWRITER_SHUTDOWN,
+
+	NUM_DEMOWRITER_CMDS
+};
+
+typedef struct
+{
+	int id;
+	int len;
+	qbyte data[MAX_MSGLEN];
+} demoWriterWriteCmd_t;
+
+#define DEMOWRITER_CMD_HEADER_SIZE	( sizeof( int ) * 2 )
+
+typedef unsigned (*queueCmdHandler_t)( const void * );
+
+struct snapDemoWriter_s
+{
+	int demofile;
+	qbufQueue_t *queue;
+	qsemaphore_t *done;				// posted once the shutdown command is handled
+	size_t queueSize;
+	demoWriterWriteCmd_t cmd;
+	unsigned int offset;			// uncompressed file offset once all queued messages are written
+
+	// updated by the producer
+	unsigned int messages;
+	quint64 bytes;
+	unsigned int peakQueued;
+	unsigned int stalls;
+	quint64 stallTime;
+	unsigned int maxStallTime;
+
+	// updated by the writer thread
+	volatile quint64 written;
+	volatile quint64 writeTime;
+
+	// only prepended to by the producers, only unlinked from by the writer thread
+	struct snapDemoWriter_s *next;
+};
+
+static snapDemoWriter_t *snap_writer_thread_writer;	// the writer handled by the thread
+
+static qmutex_t *snap_writers_mutex;
+static snapDemoWriter_t * volatile snap_writers;
+
+static qthread_t *snap_writer_thread;
+static qsemaphore_t *snap_writer_wake;		// posted for every queued command
+static volatile qboolean snap_writer_quit;
+
+/*
+* SNAP_DemoWriter_HandleWriteCmd
+*/
+static unsigned SNAP_DemoWriter_HandleWriteCmd( const void *pcmd )
+{
+	const demoWriterWriteCmd_t *cmd = pcmd;
+	snapDemoWriter_t *writer = snap_writer_thread_writer;
+	quint64 start;
+	int len;
+
+	start = Sys_Microseconds();
+
+	len = LittleLong( cmd->len );
+	FS_Write( &len, 4, writer->demofile );
+	FS_Write( cmd->data, cmd->len, writer->demofile );
+
+	writer->written += cmd->len + 4;
+	writer->writeTime += Sys_Microseconds() - start;
+
+	return ( DEMOWRITER_CMD_HEADER_SIZE + cmd->len + 3 ) & ~3;
+}
+
+/*
+* SNAP_DemoWriter_HandleShutdownCmd
+*/
+static unsigned SNAP_DemoWriter_HandleShutdownCmd( const void *pcmd )
+{
+	return 0;
+}
+
+/*
+* SNAP_DemoWriterThreadProc
+*/
+static void *SNAP_DemoWriterThreadProc( void *param )
+{
+	snapDemoWriter_t *writer, *next, **prev;
+	queueCmdHandler_t cmdHandlers[NUM_DEMOWRITER_CMDS] =
+	{
+		(queueCmdHandler_t)SNAP_DemoWriter_HandleWriteCmd,
+		(queueCmdHandler_t)SNAP_DemoWriter_HandleShutdownCmd,
+	};
+
+	while( 1 ) {
+		Sys_Semaphore_Wait( snap_writer_wake );
+
+		if( snap_writer_quit ) {
+			break;
+		}
+
+		for( writer = snap_writers; writer; writer = next ) {
+			next = writer->next;
+
+			snap_writer_thread_writer = writer;
+			if( Sys_BufQueue_ReadCmds( writer->queue, cmdHandlers ) >= 0 ) {
+				continue;
+			}
+
+			// the writer has been shut down, let go of it
+			QMutex_Lock( snap_writers_mutex );
+			for( prev = ( snapDemoWriter_t ** )&snap_writers; *prev != writer; prev = &( *prev )->next );
+			*prev = next;
+			QMutex_Unlock( snap_writers_mutex );
+
+			Sys_Semaphore_Post( writer->done, 1 );
+		}
+		snap_writer_thread_writer = NULL;
+	}
+
+	return NULL;
+}
+
+/*
+* SNAP_StartDemoWriterThread
+*/
+static qboolean SNAP_StartDemoWriterThread( void )
+{
+	if( snap_writer_thread ) {
+		return qtrue;
+	}
+
+	if( Sys_Semaphore_Create( &snap_writer_wake, 0 ) != 0 ) {
+		return qfalse;
+	}
+
+	snap_writers_mutex = QMutex_Create();
+	snap_writer_quit = qfalse;
+	snap_writer_thread = QThread_Create( SNAP_DemoWriterThreadProc, NULL );
+	return qtrue;
+}
+
+/*
+* SNAP_ShutdownDemoWriters
+*
+* Stops the writer thread, all writers must have been destroyed by now.
+*/
+void SNAP_ShutdownDemoWriters( void )
+{
+	if( !snap_writer_thread ) {
+		return;
+	}
+
+	snap_writer_quit = qtrue;
+	Sys_Semaphore_Post( snap_writer_wake, 1 );
+	QThread_Join( snap_writer_thread );
+	snap_writer_thread = NULL;
+
+	QMutex_Destroy( &snap_writers_mutex );
+	Sys_Semaphore_Destroy( snap_writer_wake );
+	snap_writer_wake = NULL;
+}
+
+/*
+* SNAP_CreateDemoWriter
+*
+* Hands given demo file over to the writer thread. Anything written to the
+* file directly must happen either before the writer is created or after
+* it's been destroyed.
+*/
+snapDemoWriter_t *SNAP_CreateDemoWriter( int demofile, size_t queueSize )
+{
+	snapDemoWriter_t *writer;
+
+	if( !demofile ) {
+		return NULL;
+	}
+
+	if( !SNAP_StartDemoWriterThread() ) {
+		return NULL;
+	}
+
+	if( queueSize < sizeof( demoWriterWriteCmd_t ) * 2 ) {
+		queueSize = sizeof( demoWriterWriteCmd_t ) * 2;
+	}
+
+	writer = Mem_ZoneMalloc( sizeof( *writer ) );
+	if( Sys_Semaphore_Create( &writer->done, 0 ) != 0 ) {
+		Mem_ZoneFree( writer );
+		return NULL;
+	}
+	writer->demofile = demofile;
+	writer->queueSize = queueSize;
+	writer->offset = FS_Tell( demofile );
+	writer->queue = Sys_BufQueue_Create( queueSize, 1 );
+
+	QMutex_Lock( snap_writers_mutex );
+	writer->next = snap_writers;
+	snap_writers = writer;
+	QMutex_Unlock( snap_writers_mutex );
+
+	return writer;
+}
+
+/*
+* SNAP_DemoWriterRecordMessage
+*
+* Queues the message for writing, blocking if the queue is full.
+*/
+void SNAP_DemoWriterRecordMessage( snapDemoWriter_t *writer, msg_t *msg, int offset )
+{
+	int len;
+	unsigned cmd_size, queued;
+	quint64 start;
+
+	if( !writer ) {
+		return;
+	}
+
+	len = msg->cursize - offset;
+	if( len <= 0 ) {
+		return;
+	}
+	if( len > MAX_MSGLEN ) {
+		// too large to be queued, write it directly once the writer is done
+		SNAP_FlushDemoWriter( writer );
+		SNAP_RecordDemoMessage( writer->demofile, msg, offset );
+		writer->offset = FS_Tell( writer->demofile );
+		return;
+	}
+
+	writer->cmd.id = CMD_DEMOWRITER_WRITE;
+	writer->cmd.len = len;
+	memcpy( writer->cmd.data, msg->data + offset, len );
+	cmd_size = ( DEMOWRITER_CMD_HEADER_SIZE + len + 3 ) & ~3;
+
+	if( Sys_BufQueue_CanEnqueueCmd( writer->queue, cmd_size ) ) {
+		Sys_BufQueue_EnqueueCmd( writer->queue, &writer->cmd, cmd_size );
+		Sys_Semaphore_Post( snap_writer_wake, 1 );
+	} else {
+		unsigned int stallTime;
+
+		// the writer thread can't keep up, wait for it
+		start = Sys_Microseconds();
+		Sys_BufQueue_EnqueueCmd( writer->queue, &writer->cmd, cmd_size );
+		Sys_Semaphore_Post( snap_writer_wake, 1 );
+		stallTime = Sys_Microseconds() - start;
+
+		writer->stalls++;
+		writer->stallTime += stallTime;
+		if( stallTime > writer->maxStallTime ) {
+			writer->maxStallTime = stallTime;
+		}
+	}
+
+	writer->messages++;
+	writer->bytes += len + 4;
+	writer->offset += len + 4;
+
+	queued = Sys_BufQueue_Length( writer->queue );
+	if( queued > writer->peakQueued ) {
+		writer->peakQueued = queued;
+	}
+}
+
+/*
+* SNAP_FlushDemoWriter
+*
+* Blocks until all queued messages have been written to the file.
+*/
+void SNAP_FlushDemoWriter( snapDemoWriter_t *writer )
+{
+	if( !writer ) {
+		return;
+	}
+	Sys_BufQueue_Finish( writer->queue );
+}
+
+/*
+* SNAP_DemoWriterPending
+*
+* Returns the number of queued bytes which haven't been written yet.
+*/
+int SNAP_DemoWriterPending( snapDemoWriter_t *writer )
+{
+	if( !writer ) {
+		return 0;
+	}
+	return Sys_BufQueue_Length( writer->queue );
+}
+
+/*
+* SNAP_DemoWriterTell
+*
+* Returns the file offset the next recorded message is going to be written at.
+*/
+unsigned int SNAP_DemoWriterTell( snapDemoWriter_t *writer )
+{
+	if( !writer ) {
+		return 0;
+	}
+	return writer->offset;
+}
+
+/*
+* SNAP_DestroyDemoWriter
+*
+* Flushes pending messages and detaches the file from the writer thread.
+*/
+void SNAP_DestroyDemoWriter( snapDemoWriter_t **pwriter )
+{
+	snapDemoWriter_t *writer;
+	int cmd = CMD_DEMOWRITER_SHUTDOWN;
+
+	if( !pwriter || !*pwriter ) {
+		return;
+	}
+
+	writer = *pwriter;
+	*pwriter = NULL;
+
+	Sys_BufQueue_EnqueueCmd( writer->queue, &cmd, sizeof( cmd ) );
+	Sys_Semaphore_Post( snap_writer_wake, 1 );
+
+	// the thread lets go of the writer once it's handled the shutdown command
+	Sys_Semaphore_Wait( writer->done );
+	Sys_Semaphore_Destroy( writer->done );
+	Sys_BufQueue_Destroy( &writer->queue );
+
+	Mem_ZoneFree( writer );
+}
+
+/*
+* SNAP_PrintDemoWriterStats
+*/
+void SNAP_PrintDemoWriterStats( snapDemoWriter_t *writer )
+{
+	if( !writer ) {
+		return;
+	}
+
+	Com_Printf( "  messages:       %u\n", writer->messages );
+	Com_Printf( "  queued:         %u KB\n", (unsigned int)( writer->bytes / 1024 ) );
+	Com_Printf( "  written:        %u KB\n", (unsigned int)( writer->written / 1024 ) );
+	Com_Printf( "  pending:        %i/%u bytes\n", Sys_BufQueue_Length( writer->queue ), (unsigned int)writer->queueSize );
+	Com_Printf( "  peak pending:   %u bytes\n", writer->peakQueued );
+	Com_Printf( "  write time:     %u ms\n", (unsigned int)( writer->writeTime / 1000 ) );
+	Com_Printf( "  stalls:         %u\n", writer->stalls );
+	Com_Printf( "  stall time:     %u ms (max %u usec)\n", (unsigned int)( writer->stallTime / 1000 ), writer->maxStallTime );
+}
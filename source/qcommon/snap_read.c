@@ -673,3 +673,105 @@ snapshot_t *SNAP_ParseFrame( msg_t *msg, snapshot_t *lastFrame, int *suppressCou
 
 	return newframe;
 }
+
+/*
+* SNAP_BuildDemoIndex
+*
+* Scans the whole demo file for nodelta frames, for demos recorded without
+* the seek index. The file is rewound to the start afterwards.
+*/
+qboolean SNAP_BuildDemoIndex( int demofile, snapDemoIndex_t *index )
+{
+	int cmd, offset;
+	qboolean reliable = qfalse, ok = qtrue;
+	qbyte *msg_buffer;
+	msg_t msg;
+	snapshot_t header;
+
+	if( FS_Seek( demofile, 0, FS_SEEK_SET ) < 0 ) {
+		return qfalse;
+	}
+
+	msg_buffer = Mem_TempMalloc( MAX_MSGLEN );
+	MSG_Init( &msg, msg_buffer, MAX_MSGLEN );
+
+	while( ok ) {
+		offset = FS_Tell( demofile );
+		if( SNAP_ReadDemoMessage( demofile, &msg ) == -1 ) {
+			break;
+		}
+
+		while( ok ) {
+			if( msg.readcount > msg.cursize ) {
+				ok = qfalse;
+				break;
+			}
+
+			cmd = MSG_ReadByte( &msg );
+			if( cmd == -1 ) {
+				break;
+			}
+
+			switch( cmd ) {
+				case svc_nop:
+					break;
+				case svc_servercmd:
+					if( !reliable ) {
+						MSG_ReadLong( &msg );
+					}
+					MSG_ReadString( &msg );
+					break;
+				case svc_servercs:
+					MSG_ReadString( &msg );
+					break;
+				case svc_serverdata:
+					MSG_ReadLong( &msg );		// protocol
+					MSG_ReadLong( &msg );		// spawncount
+					MSG_ReadShort( &msg );		// snapFrameTime
+					MSG_ReadString( &msg );		// base game directory
+					MSG_ReadString( &msg );		// game directory
+					MSG_ReadShort( &msg );		// playernum
+					MSG_ReadString( &msg );		// level name
+					reliable = ( MSG_ReadByte( &msg ) & SV_BITFLAGS_RELIABLE ) ? qtrue : qfalse;
+					// serverdata is always sent alone, skip the pure list
+					msg.readcount = msg.cursize;
+					break;
+				case svc_spawnbaseline:
+					SNAP_ParseBaseline( &msg, NULL );
+					break;
+				case svc_download:
+					MSG_ReadString( &msg );
+					MSG_ReadLong( &msg );
+					MSG_SkipData( &msg, MSG_ReadLong( &msg ) );
+					break;
+				case svc_clcack:
+					MSG_ReadLong( &msg );
+					MSG_ReadLong( &msg );
+					break;
+				case svc_frame:
+					SNAP_SkipFrame( &msg, &header );
+					if( !header.delta ) {
+						SNAP_AddDemoKeyframe( index, header.serverTime, offset );
+					}
+					break;
+				case svc_demoinfo:
+					MSG_SkipData( &msg, MSG_ReadLong( &msg ) );
+					break;
+				case svc_extension:
+					MSG_ReadByte( &msg );
+					MSG_ReadByte( &msg );
+					MSG_SkipData( &msg, MSG_ReadShort( &msg ) );
+					break;
+				default:
+					ok = qfalse;
+					break;
+			}
+		}
+	}
+
+	Mem_TempFree( msg_buffer );
+
+	FS_Seek( demofile, 0, FS_SEEK_SET );
+
+	return ok && index->numKeyframes > 0;
+}
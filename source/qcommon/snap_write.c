@@ -618,15 +618,81 @@ static void SNAP_RelayMultiPOVCommands( ginfo_t *gi, client_t *client, msg_t *ms
 	}
 }
 
+/*
+* SNAP_WriteFrameSnapBody
+*
+* Writes everything in the frame which doesn't depend on the client,
+* only on the frame and the one it's delta compressed from
+*/
+static void SNAP_WriteFrameSnapBody( ginfo_t *gi, client_snapshot_t *oldframe, client_snapshot_t *frame, msg_t *msg,
+									entity_state_t *baselines, client_entities_t *client_entities )
+{
+	int i;
+
+	// send over the areabits
+	MSG_WriteByte( msg, frame->areabytes );
+	MSG_WriteData( msg, frame->areabits, frame->areabytes );
+
+	SNAP_WriteDeltaGameStateToClient( oldframe, frame, msg );
+
+	// delta encode the playerstate
+	for( i = 0; i < frame->numplayers; i++ )
+	{
+		if( oldframe && oldframe->numplayers > i )
+			SNAP_WritePlayerstateToClient( &oldframe->ps[i], &frame->ps[i], msg );
+		else
+			SNAP_WritePlayerstateToClient( NULL, &frame->ps[i], msg );
+	}
+	MSG_WriteByte( msg, 0 );
+
+	// delta encode the entities
+	SNAP_EmitPacketEntities( gi, oldframe, frame, msg, baselines, client_entities ? client_entities->entities : NULL, client_entities ? client_entities->num_entities : 0 );
+}
+
+/*
+* SNAP_FindEncodedBody
+*
+* Returns the cached encoding of the frame from the given delta base, its
+* data is NULL if it's yet to be written. NULL if the frame can't be cached
+*/
+static snap_encodedbody_t *SNAP_FindEncodedBody( snap_bodycache_t *bodycache, client_snapshot_t *frame, client_snapshot_t *oldframe )
+{
+	int i;
+	unsigned int baseKey;
+	snap_encodedbody_t *body;
+
+	if( !frame->contentKey || ( oldframe && !oldframe->contentKey ) )
+		return NULL;
+
+	baseKey = oldframe ? oldframe->contentKey : 0;
+	for( i = 0, body = bodycache->bodies; i < bodycache->numBodies; i++, body++ )
+	{
+		if( body->frameKey == frame->contentKey && body->baseKey == baseKey )
+			return body;
+	}
+
+	if( bodycache->numBodies == bodycache->maxBodies )
+		return NULL;
+
+	body = &bodycache->bodies[bodycache->numBodies++];
+	body->frameKey = frame->contentKey;
+	body->baseKey = baseKey;
+	body->length = 0;
+	body->data = NULL;
+	return body;
+}
+
 /*
 * SNAP_WriteFrameSnapToClient
 */
 void SNAP_WriteFrameSnapToClient( ginfo_t *gi, client_t *client, msg_t *msg, unsigned int frameNum, unsigned int gameTime,
 								 entity_state_t *baselines, client_entities_t *client_entities,
-								 int numcmds, gcommand_t *commands, const char *commandsData )
+								 int numcmds, gcommand_t *commands, const char *commandsData, snap_bodycache_t *bodycache )
 {
 	client_snapshot_t *frame, *oldframe;
 	int flags, i, index, pos, length, supcnt;
+	size_t start;
+	snap_encodedbody_t *body;
 
 	// this is the frame we are creating
 	frame = &client->snapShots[frameNum & UPDATE_MASK];
@@ -721,24 +787,24 @@ void SNAP_WriteFrameSnapToClient( ginfo_t *gi, client_t *client, msg_t *msg, uns
 	}
 	MSG_WriteShort( msg, -1 );
 
-	// send over the areabits
-	MSG_WriteByte( msg, frame->areabytes );
-	MSG_WriteData( msg, frame->areabits, frame->areabytes );
-
-	SNAP_WriteDeltaGameStateToClient( oldframe, frame, msg );
-
-	// delta encode the playerstate
-	for( i = 0; i < frame->numplayers; i++ )
+	body = bodycache ? SNAP_FindEncodedBody( bodycache, frame, oldframe ) : NULL;
+	if( body && body->data )
 	{
-		if( oldframe && oldframe->numplayers > i )
-			SNAP_WritePlayerstateToClient( &oldframe->ps[i], &frame->ps[i], msg );
-		else
-			SNAP_WritePlayerstateToClient( NULL, &frame->ps[i], msg );
+		MSG_WriteData( msg, body->data, body->length );
 	}
-	MSG_WriteByte( msg, 0 );
+	else
+	{
+		start = msg->cursize;
 
-	// delta encode the entities
-	SNAP_EmitPacketEntities( gi, oldframe, frame, msg, baselines, client_entities ? client_entities->entities : NULL, client_entities ? client_entities->num_entities : 0 );
+		SNAP_WriteFrameSnapBody( gi, oldframe, frame, msg, baselines, client_entities );
+
+		if( body )
+		{
+			body->length = msg->cursize - start;
+			body->data = ( qbyte * )Mem_FrameAllocExt( body->length, 0 );
+			memcpy( body->data, msg->data + start, body->length );
+		}
+	}
 
 	// write length into reserved space
 	length = msg->cursize - pos - 2;
@@ -799,11 +865,10 @@ static qboolean SNAP_BitsCullEntity( cmodel_state_t *cms, edict_t *ent, qbyte *b
 
 //=====================================================================
 
-#define	MAX_SNAPSHOT_ENTITIES	1024
 typedef struct
 {
 	int numSnapshotEntities;
-	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	int snapshotEntities[MAX_EDICTS];
 	int entityAddedToSnapList[MAX_EDICTS];
 } snapshotEntityNumbers_t;
 
@@ -812,9 +877,6 @@ typedef struct
 */
 static void SNAP_AddEntNumToSnapList( int entNum, snapshotEntityNumbers_t *entsList )
 {
-	if( entsList->numSnapshotEntities >= MAX_SNAPSHOT_ENTITIES )  // silent ignore of overflood
-		return;
-
 	// don't double add entities
 	if( entsList->entityAddedToSnapList[entNum] )
 		return;
@@ -1059,6 +1121,178 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 	SNAP_SortSnapList( entsList );
 }
 
+#define SNAP_ENTITY_DELTA_COST	16		// rough size of an entity delta, in bytes
+#define SNAP_ENTITY_FULL_COST	48		// rough size of an entity delta from its baseline
+
+typedef struct
+{
+	int index;							// into the snapshot entities list
+	int priority;
+	int cost;
+	const entity_state_t *prev;			// state in the previous snapshot, if any
+} snapCandidate_t;
+
+/*
+* SNAP_MakeClientEntityState
+*/
+static void SNAP_MakeClientEntityState( edict_t *ent, entity_state_t *state )
+{
+	*state = ent->s;
+	state->svflags = ent->r.svflags;
+
+	// don't mark *any* missiles as solid
+	if( ent->r.svflags & SVF_PROJECTILE )
+		state->solid = 0;
+}
+
+/*
+* SNAP_CmpCandidates
+*/
+static int SNAP_CmpCandidates( const snapCandidate_t *a, const snapCandidate_t *b )
+{
+	if( a->priority != b->priority )
+		return b->priority - a->priority;
+	return a->index - b->index;
+}
+
+/*
+* SNAP_PrioritizeSnapList
+*
+* Fits the visible entities into the client's snapshot byte budget. Entities
+* which must always be current (the client itself, players, broadcasts and
+* anything carrying events) are sent first, the rest of the changed ones are
+* ranked by staleness over distance. Entities the client already has and which
+* don't make it are held at the state of the previous snapshot, new ones are
+* left out until there's room for them. Nothing is held back while the
+* budget has room for it.
+*/
+static void SNAP_PrioritizeSnapList( ginfo_t *gi, client_t *client, client_snapshot_t *frame, unsigned int frameNum, unsigned int timeStamp,
+									edict_t *clent, vec3_t vieworg, client_entities_t *client_entities,
+									snapshotEntityNumbers_t *entsList, const entity_state_t **held, mempool_t *mempool )
+{
+	int e, i, oi, entNum, numCandidates, used, numKept;
+	float dist;
+	unsigned int stale;
+	vec3_t center;
+	edict_t *ent;
+	entity_state_t state;
+	const entity_state_t *prev;
+	client_snapshot_t *oldframe;
+	snapCandidate_t candidates[MAX_EDICTS];
+	qboolean keep[MAX_EDICTS];
+
+	if( !client->snapRefreshTime )
+		client->snapRefreshTime = ( unsigned int * )Mem_Alloc( mempool, sizeof( unsigned int ) * MAX_EDICTS );
+
+	// the previously built frame is what the client is going to have, or
+	// at least what we are delta compressing towards
+	oldframe = NULL;
+	if( client->lastSentFrameNum && client->lastSentFrameNum < frameNum && frameNum - client->lastSentFrameNum < UPDATE_MASK )
+	{
+		oldframe = &client->snapShots[client->lastSentFrameNum & UPDATE_MASK];
+		if( oldframe->multipov != frame->multipov ||
+			client_entities->next_entities + entsList->numSnapshotEntities - oldframe->first_entity > client_entities->num_entities )
+			oldframe = NULL;	// states have been overwritten or would be while copying them
+	}
+
+	used = 0;
+	numCandidates = 0;
+	oi = 0;
+	prev = NULL;
+
+	for( e = 0; e < entsList->numSnapshotEntities; e++ )
+	{
+		entNum = entsList->snapshotEntities[e];
+		ent = EDICT_NUM( entNum );
+		held[e] = NULL;
+		keep[e] = qtrue;
+
+		// both lists are sorted by entity number
+		prev = NULL;
+		if( oldframe )
+		{
+			for( ; oi < oldframe->num_entities; oi++ )
+			{
+				prev = &client_entities->entities[( oldframe->first_entity + oi ) % client_entities->num_entities];
+				if( prev->number >= entNum )
+					break;
+			}
+			if( oi >= oldframe->num_entities || prev->number != entNum )
+				prev = NULL;
+		}
+
+		SNAP_MakeClientEntityState( ent, &state );
+		if( prev && !memcmp( prev, &state, sizeof( state ) ) )
+		{
+			client->snapRefreshTime[entNum] = timeStamp;
+			continue;	// nothing to send
+		}
+
+		if( ent == clent || ent->r.owner == clent || ent->r.client || ( ent->r.svflags & SVF_BROADCAST ) ||
+			state.events[0] || state.teleported ||
+			( prev && ( prev->events[0] || prev->type != state.type || prev->modelindex != state.modelindex ) ) )
+		{
+			used += prev ? SNAP_ENTITY_DELTA_COST : SNAP_ENTITY_FULL_COST;
+			client->snapRefreshTime[entNum] = timeStamp;
+			continue;
+		}
+
+		if( VectorCompare( ent->r.absmin, ent->r.absmax ) )
+		{
+			VectorCopy( ent->s.origin, center );
+		}
+		else
+		{
+			VectorAdd( ent->r.absmin, ent->r.absmax, center );
+			VectorScale( center, 0.5f, center );
+		}
+		dist = DistanceFast( vieworg, center );
+		stale = timeStamp - client->snapRefreshTime[entNum];
+
+		candidates[numCandidates].index = e;
+		candidates[numCandidates].priority = ( int )( ( min( stale, 10000 ) + 1 ) * 256.0f / ( dist + 256.0f ) );
+		candidates[numCandidates].cost = prev ? SNAP_ENTITY_DELTA_COST : SNAP_ENTITY_FULL_COST;
+		candidates[numCandidates].prev = prev;
+		numCandidates++;
+	}
+
+	// fit as many of the remaining changes as the budget allows
+	qsort( candidates, numCandidates, sizeof( *candidates ), ( int ( * )( const void *, const void * ) )SNAP_CmpCandidates );
+
+	for( i = 0; i < numCandidates; i++ )
+	{
+		e = candidates[i].index;
+		entNum = entsList->snapshotEntities[e];
+
+		if( used + candidates[i].cost <= client->snapBudget )
+		{
+			used += candidates[i].cost;
+			client->snapRefreshTime[entNum] = timeStamp;
+			continue;
+		}
+
+		if( candidates[i].prev )
+			held[e] = candidates[i].prev;
+		else if( oldframe )
+			keep[e] = qfalse;	// the client doesn't have it yet, it can wait
+	}
+
+	// drop the new entities which didn't fit
+	numKept = 0;
+	for( e = 0; e < entsList->numSnapshotEntities; e++ )
+	{
+		if( !keep[e] )
+		{
+			entsList->entityAddedToSnapList[entsList->snapshotEntities[e]] = qfalse;
+			continue;
+		}
+		entsList->snapshotEntities[numKept] = entsList->snapshotEntities[e];
+		held[numKept] = held[e];
+		numKept++;
+	}
+	entsList->numSnapshotEntities = numKept;
+}
+
 /*
 * SNAP_BuildClientFrameSnap
 *
@@ -1077,6 +1311,7 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 	entity_state_t *state;
 	int numplayers, numareas;
 	snapshotEntityNumbers_t entsList;
+	const entity_state_t *held[MAX_EDICTS];
 
 	assert( gameState );
 
@@ -1100,6 +1335,7 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 	frame->sentTimeStamp = timeStamp;
 	frame->UcmdExecuted = client->UcmdExecuted;
 	frame->relay = relay;
+	frame->contentKey = 0;
 
 	if( client->mv )
 	{
@@ -1181,6 +1417,12 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 	memset( entsList.entityAddedToSnapList, 0, sizeof( entsList.entityAddedToSnapList ) );
 	SNAP_BuildSnapEntitiesList( cms, gi, clent, org, fatvis->skyorg, fatvis->pvs, frame, &entsList );
 
+	// fit the entities into the client's byte budget
+	if( client->snapBudget > 0 && clent && !frame->multipov && !relay )
+		SNAP_PrioritizeSnapList( gi, client, frame, frameNum, timeStamp, clent, org, client_entities, &entsList, held, mempool );
+	else
+		memset( held, 0, sizeof( held[0] ) * entsList.numSnapshotEntities );
+
 	//Com_Printf( "Snap NumEntities:%i\n", entsList.numSnapshotEntities );
 
 	if( developer->integer )
@@ -1210,12 +1452,10 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 		ent = EDICT_NUM( entsList.snapshotEntities[e] );
 		state = &client_entities->entities[ne%client_entities->num_entities];
 
-		*state = ent->s;
-		state->svflags = ent->r.svflags;
-
-		// don't mark *any* missiles as solid
-		if( ent->r.svflags & SVF_PROJECTILE )
-			state->solid = 0;
+		if( held[e] )
+			*state = *held[e];
+		else
+			SNAP_MakeClientEntityState( ent, state );
 
 		frame->num_entities++;
 		ne++;
@@ -1224,6 +1464,55 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 	client_entities->next_entities = ne;
 }
 
+/*
+* SNAP_CopyClientFrameSnap
+*
+* Gives the client the frame already built for another client which
+* has the same point of view. The entities are shared, so both clients
+* must be using the same client_entities
+*/
+void SNAP_CopyClientFrameSnap( cmodel_state_t *cms, client_t *client, client_t *from, unsigned int frameNum, mempool_t *mempool )
+{
+	client_snapshot_t *frame, *src;
+	qbyte *areabits;
+	player_state_t *ps;
+	int numareas, ps_size;
+
+	frame = &client->snapShots[frameNum & UPDATE_MASK];
+	src = &from->snapShots[frameNum & UPDATE_MASK];
+
+	// keep our own arrays, growing them if needed
+	numareas = frame->numareas;
+	areabits = frame->areabits;
+	if( numareas < src->numareas )
+	{
+		if( areabits )
+			Mem_Free( areabits );
+		numareas = src->numareas;
+		areabits = ( qbyte * )Mem_Alloc( mempool, numareas * CM_AreaRowSize( cms ) );
+	}
+
+	ps_size = frame->ps_size;
+	ps = frame->ps;
+	if( ps_size < src->numplayers )
+	{
+		if( ps )
+			Mem_Free( ps );
+		ps_size = src->numplayers;
+		ps = ( player_state_t * )Mem_Alloc( mempool, sizeof( player_state_t ) * ps_size );
+	}
+
+	*frame = *src;
+	frame->numareas = numareas;
+	frame->areabits = areabits;
+	frame->ps_size = ps_size;
+	frame->ps = ps;
+	frame->UcmdExecuted = client->UcmdExecuted;
+
+	memcpy( frame->areabits, src->areabits, src->areabytes );
+	memcpy( frame->ps, src->ps, sizeof( player_state_t ) * src->numplayers );
+}
+
 /*
 * SNAP_FreeClientFrame
 *
@@ -1260,4 +1549,10 @@ void SNAP_FreeClientFrames( client_t *client )
 		frame = &client->snapShots[i];
 		SNAP_FreeClientFrame( frame );
 	}
+
+	if( client->snapRefreshTime )
+	{
+		Mem_Free( client->snapRefreshTime );
+		client->snapRefreshTime = NULL;
+	}
 }
@@ -22,21 +22,31 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define SYS_THREADS_H
 
 typedef struct qbufQueue_s qbufQueue_t;
+typedef struct qsemaphore_s qsemaphore_t;
 
 int Sys_Thread_Create( qthread_t **pthread, void *(*routine) (void*), void *param );
 void Sys_Thread_Join( qthread_t *thread );
 void Sys_Thread_Yield( void );
+void Sys_Thread_SetExitHook( void ( *hook )( void ) );
 
 int Sys_Mutex_Create( qmutex_t **pmutex );
 void Sys_Mutex_Destroy( qmutex_t *mutex );
 void Sys_Mutex_Lock( qmutex_t *mutex );
 void Sys_Mutex_Unlock( qmutex_t *mutex );
 int Sys_Atomic_Add( volatile int *value, int add, qmutex_t *mutex );
+qboolean Sys_Atomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex );
+
+int Sys_Semaphore_Create( qsemaphore_t **psem, int count );
+void Sys_Semaphore_Destroy( qsemaphore_t *sem );
+void Sys_Semaphore_Wait( qsemaphore_t *sem );
+void Sys_Semaphore_Post( qsemaphore_t *sem, int count );
 
 qbufQueue_t *Sys_BufQueue_Create( size_t bufSize, int flags );
 void Sys_BufQueue_Destroy( qbufQueue_t **pqueue );
 void Sys_BufQueue_Finish( qbufQueue_t *queue );
 void Sys_BufQueue_EnqueueCmd( qbufQueue_t *queue, const void *cmd, unsigned cmd_size );
+int Sys_BufQueue_Length( qbufQueue_t *queue );
+int Sys_BufQueue_CanEnqueueCmd( qbufQueue_t *queue, unsigned cmd_size );
 int Sys_BufQueue_ReadCmds( qbufQueue_t *queue, unsigned (**cmdHandlers)( const void * ) );
 
 #endif // SYS_THREADS_H
@@ -0,0 +1,693 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// mem_test.c -- stresses the zone allocator from several threads, "-bench" also
+// times it against a copy of the malloc-per-block allocator it replaced
+
+#include "../qcommon.h"
+#include "../sys_threads.h"
+
+#if defined( __GLIBC__ ) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+#include <malloc.h>
+#define TEST_HEAP_USED()	( (size_t)mallinfo2().uordblks )
+#else
+#define TEST_HEAP_USED()	( (size_t)0 )
+#endif
+
+#define RING_SIZE			4096
+#define NUM_RING_ALLOCS		1000000
+#define NUM_POOL_ALLOCS		50000
+#define NUM_EXITING_THREADS	1000
+
+#define BENCH_THREADS		8
+#define BENCH_ITERATIONS	2000000
+#define BENCH_LIVE			1024
+
+static int test_fails;
+
+// ============================================================================
+
+// mem.c needs these from the rest of the engine
+
+void Com_Printf( const char *format, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, format );
+	vprintf( format, argptr );
+	va_end( argptr );
+}
+
+void Com_DPrintf( const char *format, ... )
+{
+}
+
+void Sys_Error( const char *format, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, format );
+	vprintf( format, argptr );
+	va_end( argptr );
+	printf( "\n" );
+	exit( 1 );
+}
+
+cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags )
+{
+	return NULL;
+}
+
+void Cmd_AddCommand( const char *cmd_name, xcommand_t function )
+{
+}
+
+void Cmd_RemoveCommand( const char *cmd_name )
+{
+}
+
+int Cmd_Argc( void )
+{
+	return 0;
+}
+
+char *Cmd_Argv( int arg )
+{
+	return "";
+}
+
+char *Cmd_Args( void )
+{
+	return "";
+}
+
+// ============================================================================
+
+/*
+* Test_Random
+*/
+static int Test_Random( unsigned int *seed, int range )
+{
+	*seed = *seed * 1103515245 + 12345;
+	return ( *seed >> 8 ) % range;
+}
+
+/*
+* Test_Seconds
+*/
+static double Test_Seconds( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+* Test_Expect
+*/
+static void Test_Expect( qboolean ok, const char *what, int value, int expected )
+{
+	if( ok )
+		return;
+	printf( "%s: %i, expected %i\n", what, value, expected );
+	test_fails++;
+}
+
+/*
+* Test_Fill
+*
+* Every byte of a block depends on its size, so a block handed out twice shows up
+*/
+static void Test_Fill( qbyte *data, size_t size )
+{
+	memset( data, (int)( size & 0xff ), size );
+}
+
+static qboolean Test_Filled( const qbyte *data, size_t size )
+{
+	size_t i;
+
+	for( i = 0; i < size; i++ )
+	{
+		if( data[i] != (qbyte)( size & 0xff ) )
+			return qfalse;
+	}
+	return qtrue;
+}
+
+// ============================================================================
+
+/*
+* cross-thread frees: one thread allocates, another one frees
+*/
+
+typedef struct
+{
+	mempool_t *pool;
+	qmutex_t *mutex;
+	void *blocks[RING_SIZE];
+	size_t sizes[RING_SIZE];
+	volatile int head, tail;
+	volatile int done;
+	int corrupt;
+} ring_t;
+
+static void *Test_Producer( void *param )
+{
+	int i;
+	size_t size;
+	unsigned int seed = 99;
+	void *data;
+	ring_t *ring = param;
+
+	for( i = 0; i < NUM_RING_ALLOCS; i++ )
+	{
+		// mostly slab sizes, some that go to malloc
+		size = 1 + Test_Random( &seed, Test_Random( &seed, 8 ) ? 1000 : 4000 );
+		data = Mem_AllocExt( ring->pool, size, 0 );
+		Test_Fill( data, size );
+
+		for( ;; )
+		{
+			QMutex_Lock( ring->mutex );
+			if( ( ring->head + 1 ) % RING_SIZE != ring->tail )
+				break;
+			QMutex_Unlock( ring->mutex );
+			Sys_Thread_Yield();
+		}
+		ring->blocks[ring->head] = data;
+		ring->sizes[ring->head] = size;
+		ring->head = ( ring->head + 1 ) % RING_SIZE;
+		QMutex_Unlock( ring->mutex );
+	}
+
+	QMutex_Lock( ring->mutex );
+	ring->done = 1;
+	QMutex_Unlock( ring->mutex );
+	return NULL;
+}
+
+static void *Test_Consumer( void *param )
+{
+	void *data;
+	size_t size;
+	ring_t *ring = param;
+
+	for( ;; )
+	{
+		QMutex_Lock( ring->mutex );
+		if( ring->tail == ring->head )
+		{
+			int done = ring->done;
+			QMutex_Unlock( ring->mutex );
+			if( done )
+				break;
+			Sys_Thread_Yield();
+			continue;
+		}
+		data = ring->blocks[ring->tail];
+		size = ring->sizes[ring->tail];
+		ring->tail = ( ring->tail + 1 ) % RING_SIZE;
+		QMutex_Unlock( ring->mutex );
+
+		if( !Test_Filled( data, size ) )
+			ring->corrupt++;
+		Mem_CheckSentinels( data );
+		Mem_Free( data );
+	}
+	return NULL;
+}
+
+/*
+* Test_CrossThreadFree
+*/
+static void Test_CrossThreadFree( void )
+{
+	ring_t *ring;
+	qthread_t *producer, *consumer;
+
+	ring = malloc( sizeof( *ring ) );
+	memset( ring, 0, sizeof( *ring ) );
+	ring->pool = Mem_AllocPool( NULL, "Ring" );
+	ring->mutex = QMutex_Create();
+
+	producer = QThread_Create( Test_Producer, ring );
+	consumer = QThread_Create( Test_Consumer, ring );
+	QThread_Join( producer );
+	QThread_Join( consumer );
+
+	Test_Expect( !ring->corrupt, "cross-thread frees: corrupt blocks", ring->corrupt, 0 );
+	Test_Expect( !Mem_PoolTotalSize( ring->pool ), "cross-thread frees: bytes left in pool",
+		(int)Mem_PoolTotalSize( ring->pool ), 0 );
+
+	Mem_FreePool( &ring->pool );
+	QMutex_Destroy( &ring->mutex );
+	free( ring );
+}
+
+// ============================================================================
+
+/*
+* pools freed by another thread while the allocating one is still running
+*/
+
+typedef struct
+{
+	mempool_t *pool, *child, *other;
+	qsemaphore_t *allocated, *freed;
+	int expected, expectedChild;
+	int corrupt;
+} poolowner_t;
+
+static void *Test_PoolOwner( void *param )
+{
+	int i;
+	size_t size;
+	unsigned int seed = 7;
+	void *data;
+	poolowner_t *owner = param;
+
+	for( i = 0; i < NUM_POOL_ALLOCS; i++ )
+	{
+		size = 1 + Test_Random( &seed, i & 1 ? 3000 : 600 );
+		Test_Fill( Mem_AllocExt( owner->pool, size, 0 ), size );
+		owner->expected += size;
+
+		Test_Fill( Mem_AllocExt( owner->child, 17, 0 ), 17 );
+		owner->expectedChild += 17;
+	}
+
+	Sys_Semaphore_Post( owner->allocated, 1 );
+	Sys_Semaphore_Wait( owner->freed );
+
+	// the slots of the freed pools must not leak into a new pool, even
+	// if it ends up at the same address
+	for( i = 0; i < NUM_POOL_ALLOCS; i++ )
+	{
+		size = 1 + Test_Random( &seed, 600 );
+		data = Mem_AllocExt( owner->other, size, 0 );
+		Test_Fill( data, size );
+		if( i & 1 )
+			Mem_Free( data );
+		else
+			owner->expected += size;
+	}
+
+	return NULL;
+}
+
+/*
+* Test_FreePoolFromOtherThread
+*/
+static void Test_FreePoolFromOtherThread( void )
+{
+	qthread_t *thread;
+	poolowner_t owner;
+
+	memset( &owner, 0, sizeof( owner ) );
+	owner.pool = Mem_AllocPool( NULL, "Owned" );
+	owner.child = Mem_AllocPool( owner.pool, "Owned child" );
+	Sys_Semaphore_Create( &owner.allocated, 0 );
+	Sys_Semaphore_Create( &owner.freed, 0 );
+
+	thread = QThread_Create( Test_PoolOwner, &owner );
+	Sys_Semaphore_Wait( owner.allocated );
+
+	Test_Expect( Mem_PoolTotalSize( owner.pool ) == (size_t)owner.expected, "pool size seen from another thread",
+		(int)Mem_PoolTotalSize( owner.pool ), owner.expected );
+	Test_Expect( Mem_PoolTotalSize( owner.child ) == (size_t)owner.expectedChild, "child pool size seen from another thread",
+		(int)Mem_PoolTotalSize( owner.child ), owner.expectedChild );
+
+	Mem_CheckSentinelsGlobal();
+	Mem_FreePool( &owner.pool );
+
+	owner.other = Mem_AllocPool( NULL, "Other" );
+	owner.expected = 0;
+	Sys_Semaphore_Post( owner.freed, 1 );
+	QThread_Join( thread );
+
+	Test_Expect( Mem_PoolTotalSize( owner.other ) == (size_t)owner.expected, "new pool size after free",
+		(int)Mem_PoolTotalSize( owner.other ), owner.expected );
+
+	// emptying from this thread while the owner is gone
+	Mem_EmptyPool( owner.other );
+	Test_Expect( !Mem_PoolTotalSize( owner.other ), "bytes left after Mem_EmptyPool",
+		(int)Mem_PoolTotalSize( owner.other ), 0 );
+	Mem_FreePool( &owner.other );
+
+	Sys_Semaphore_Destroy( owner.allocated );
+	Sys_Semaphore_Destroy( owner.freed );
+}
+
+// ============================================================================
+
+/*
+* threads that exit while blocks they allocated are still in use
+*/
+
+typedef struct
+{
+	mempool_t *pool;
+	void *kept;
+} exitingthread_t;
+
+static void *Test_ExitingThread( void *param )
+{
+	int i;
+	void *data[32];
+	exitingthread_t *t = param;
+
+	for( i = 0; i < 32; i++ )
+		data[i] = Mem_AllocExt( t->pool, 16 + i * 24, 0 );
+	for( i = 1; i < 32; i++ )
+		Mem_Free( data[i] );
+
+	// outlives the thread, so its cache can't be freed
+	t->kept = data[0];
+	Test_Fill( t->kept, 16 );
+	return NULL;
+}
+
+/*
+* Test_OrphanedCaches
+*
+* Each exiting thread leaves its cache behind and the next one should adopt it,
+* so the heap must not grow by a cache per thread
+*/
+static void Test_OrphanedCaches( void )
+{
+	int i, corrupt = 0;
+	size_t heap, growth;
+	mempool_t *pool;
+	qthread_t *thread;
+	static exitingthread_t threads[NUM_EXITING_THREADS];
+
+	pool = Mem_AllocPool( NULL, "Exiting threads" );
+
+	// the first thread creates the cache all the others adopt
+	threads[0].pool = pool;
+	QThread_Join( QThread_Create( Test_ExitingThread, &threads[0] ) );
+
+	heap = TEST_HEAP_USED();
+	for( i = 1; i < NUM_EXITING_THREADS; i++ )
+	{
+		threads[i].pool = pool;
+		thread = QThread_Create( Test_ExitingThread, &threads[i] );
+		QThread_Join( thread );
+	}
+	growth = TEST_HEAP_USED() - heap;
+
+	Test_Expect( Mem_PoolTotalSize( pool ) == NUM_EXITING_THREADS * 16, "bytes kept by exited threads",
+		(int)Mem_PoolTotalSize( pool ), NUM_EXITING_THREADS * 16 );
+
+	// a cache is several kilobytes, a kept block a few dozen bytes
+	if( heap && growth > NUM_EXITING_THREADS * 256 )
+	{
+		printf( "exited threads: heap grew by %i bytes, caches aren't adopted\n", (int)growth );
+		test_fails++;
+	}
+
+	for( i = 0; i < NUM_EXITING_THREADS; i++ )
+	{
+		if( !Test_Filled( threads[i].kept, 16 ) )
+			corrupt++;
+		Mem_Free( threads[i].kept );
+	}
+	Test_Expect( !corrupt, "exited threads: corrupt blocks", corrupt, 0 );
+	Test_Expect( !Mem_PoolTotalSize( pool ), "exited threads: bytes left in pool", (int)Mem_PoolTotalSize( pool ), 0 );
+
+	Mem_FreePool( &pool );
+}
+
+// ============================================================================
+
+/*
+* Test_ManyPools
+*
+* More pools than a thread keeps its own chains for
+*/
+static void Test_ManyPools( void )
+{
+	int i, wrong = 0;
+	void *data;
+	mempool_t *pools[600];
+
+	for( i = 0; i < 600; i++ )
+	{
+		pools[i] = Mem_AllocPool( NULL, "Many" );
+		Mem_Alloc( pools[i], 100 );
+		Mem_Alloc( pools[i], 10000 );
+		data = Mem_Alloc( pools[i], 10 );
+		data = Mem_Realloc( data, 5000 );
+		Mem_Free( data );
+	}
+
+	for( i = 0; i < 600; i++ )
+	{
+		if( Mem_PoolTotalSize( pools[i] ) != 10100 )
+			wrong++;
+		Mem_FreePool( &pools[i] );
+	}
+	Test_Expect( !wrong, "pools with the wrong size", wrong, 0 );
+}
+
+/*
+* Test_Check
+*/
+static int Test_Check( void )
+{
+	Memory_Init();
+
+	Test_CrossThreadFree();
+	Test_FreePoolFromOtherThread();
+	Test_OrphanedCaches();
+	Test_ManyPools();
+
+	Mem_CheckSentinelsGlobal();
+	Memory_Shutdown();
+
+	printf( "4 stress tests: %s\n", test_fails ? "FAILED" : "passed" );
+	return test_fails;
+}
+
+// ============================================================================
+
+/*
+* the allocator mem.c used before the slabs: malloc for every block, linked
+* into the pool's chain under one global mutex
+*/
+
+typedef struct refheader_s
+{
+	void *baseaddress;
+	struct refheader_s *next;
+	struct refheader_s *prev;
+	struct refpool_s *pool;
+	size_t size;
+	size_t realsize;
+	const char *filename;
+	int fileline;
+	unsigned int sentinel1;
+} refheader_t;
+
+typedef struct refpool_s
+{
+	refheader_t *chain;
+	int totalsize;
+	int realsize;
+} refpool_t;
+
+static qmutex_t *refMutex;
+
+static void *Test_RefAlloc( refpool_t *pool, size_t size )
+{
+	void *base;
+	size_t realsize, alignment = 16;
+	refheader_t *mem;
+
+	QMutex_Lock( refMutex );
+
+	pool->totalsize += size;
+	realsize = sizeof( refheader_t ) + size + alignment + sizeof( int );
+	pool->realsize += realsize;
+
+	base = malloc( realsize );
+	mem = ( refheader_t * )((((size_t)base + sizeof( refheader_t ) + (alignment-1)) & ~(alignment-1)) - sizeof( refheader_t ));
+	mem->baseaddress = base;
+	mem->filename = __FILE__;
+	mem->fileline = __LINE__;
+	mem->size = size;
+	mem->realsize = realsize;
+	mem->pool = pool;
+	mem->sentinel1 = 0xDEADF00D;
+	*( (qbyte *) mem + sizeof( refheader_t ) + mem->size ) = 0xDF;
+
+	mem->next = pool->chain;
+	mem->prev = NULL;
+	pool->chain = mem;
+	if( mem->next )
+		mem->next->prev = mem;
+
+	QMutex_Unlock( refMutex );
+
+	return (void *)( (qbyte *) mem + sizeof( refheader_t ) );
+}
+
+static void Test_RefFree( void *data )
+{
+	refheader_t *mem = ( refheader_t * )( (qbyte *) data - sizeof( refheader_t ) );
+	refpool_t *pool = mem->pool;
+	void *base;
+
+	QMutex_Lock( refMutex );
+
+	if( mem->prev )
+		mem->prev->next = mem->next;
+	else
+		pool->chain = mem->next;
+	if( mem->next )
+		mem->next->prev = mem->prev;
+
+	pool->totalsize -= mem->size;
+	pool->realsize -= mem->realsize;
+	base = mem->baseaddress;
+
+	QMutex_Unlock( refMutex );
+
+	free( base );
+}
+
+typedef struct
+{
+	qboolean reference;
+	mempool_t *pool;
+	refpool_t *refpool;
+	int seed;
+} benchthread_t;
+
+static void *Test_BenchThread( void *param )
+{
+	int i, slot;
+	size_t size;
+	unsigned int seed;
+	void *live[BENCH_LIVE];
+	benchthread_t *t = param;
+
+	memset( live, 0, sizeof( live ) );
+	seed = 1234567 * ( t->seed + 1 );
+
+	// random live set of small blocks, like the bulk of the engine's allocations
+	for( i = 0; i < BENCH_ITERATIONS; i++ )
+	{
+		slot = Test_Random( &seed, BENCH_LIVE );
+		size = 8 + Test_Random( &seed, 248 );
+		if( t->reference )
+		{
+			if( live[slot] )
+				Test_RefFree( live[slot] );
+			live[slot] = Test_RefAlloc( t->refpool, size );
+		}
+		else
+		{
+			if( live[slot] )
+				Mem_Free( live[slot] );
+			live[slot] = Mem_AllocExt( t->pool, size, 0 );
+		}
+	}
+
+	for( i = 0; i < BENCH_LIVE; i++ )
+	{
+		if( !live[i] )
+			continue;
+		if( t->reference )
+			Test_RefFree( live[i] );
+		else
+			Mem_Free( live[i] );
+	}
+	return NULL;
+}
+
+/*
+* Test_Bench
+*/
+static void Test_Bench( void )
+{
+	int i, n, shared, reference;
+	double start, nsec[2];
+	mempool_t *pools[BENCH_THREADS];
+	refpool_t refpools[BENCH_THREADS];
+	qthread_t *threads[BENCH_THREADS];
+	benchthread_t params[BENCH_THREADS];
+
+	Memory_Init();
+	refMutex = QMutex_Create();
+	memset( refpools, 0, sizeof( refpools ) );
+	for( i = 0; i < BENCH_THREADS; i++ )
+		pools[i] = Mem_AllocPool( NULL, "Bench" );
+
+	printf( "ns per alloc+free and thread, %i live blocks of 8-255 bytes, old / new allocator\n", BENCH_LIVE );
+	for( shared = 0; shared < 2; shared++ )
+	{
+		for( n = 1; n <= BENCH_THREADS; n *= 2 )
+		{
+			for( reference = 1; reference >= 0; reference-- )
+			{
+				for( i = 0; i < n; i++ )
+				{
+					params[i].reference = reference ? qtrue : qfalse;
+					params[i].pool = pools[shared ? 0 : i];
+					params[i].refpool = &refpools[shared ? 0 : i];
+					params[i].seed = i;
+				}
+
+				start = Test_Seconds();
+				for( i = 0; i < n; i++ )
+					threads[i] = QThread_Create( Test_BenchThread, &params[i] );
+				for( i = 0; i < n; i++ )
+					QThread_Join( threads[i] );
+				nsec[reference] = ( Test_Seconds() - start ) * 1e9 / BENCH_ITERATIONS;
+			}
+
+			printf( "  %s pool, %i thread%s: %6.1f / %6.1f\n", shared ? "shared" : "own", n, n > 1 ? "s" : " ",
+				nsec[1], nsec[0] );
+		}
+	}
+
+	for( i = 0; i < BENCH_THREADS; i++ )
+		Mem_FreePool( &pools[i] );
+	QMutex_Destroy( &refMutex );
+	Memory_Shutdown();
+}
+
+int main( int argc, char **argv )
+{
+	int i;
+
+	if( Test_Check() )
+		return 1;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-bench" ) )
+			Test_Bench();
+	}
+
+	return 0;
+}
@@ -119,6 +119,166 @@ void QThreads_Shutdown( void )
 
 // ============================================================================
 
+struct qthreadpool_s
+{
+	int numThreads;
+	qthread_t **threads;
+	qsemaphore_t *wake;         // posted once for each worker that should pick up jobs
+	qsemaphore_t *done;         // posted by each woken worker once the jobs run out
+	volatile int terminated;
+
+	void (*job)( void *, int );
+	void *param;
+	int numJobs;
+	volatile int nextJob;
+};
+
+/*
+* QThreadPool_RunJobs
+*/
+static void QThreadPool_RunJobs( qthreadpool_t *pool )
+{
+	int index;
+
+	while( ( index = Sys_Atomic_Add( &pool->nextJob, 1, NULL ) - 1 ) < pool->numJobs ) {
+		pool->job( pool->param, index );
+	}
+}
+
+/*
+* QThreadPool_Worker
+*/
+static void *QThreadPool_Worker( void *param )
+{
+	qthreadpool_t *pool = ( qthreadpool_t * )param;
+
+	while( 1 ) {
+		Sys_Semaphore_Wait( pool->wake );
+		if( pool->terminated ) {
+			break;
+		}
+
+		QThreadPool_RunJobs( pool );
+
+		Sys_Semaphore_Post( pool->done, 1 );
+	}
+
+	return NULL;
+}
+
+/*
+* QThreadPool_Create
+*
+* Returns NULL when numThreads is 0 or the threads couldn't be started,
+* QThreadPool_Run then simply runs the jobs on the calling thread.
+*/
+qthreadpool_t *QThreadPool_Create( int numThreads )
+{
+	int i;
+	qthreadpool_t *pool;
+
+	if( numThreads <= 0 ) {
+		return NULL;
+	}
+
+	pool = malloc( sizeof( *pool ) + sizeof( qthread_t * ) * numThreads );
+	memset( pool, 0, sizeof( *pool ) );
+	pool->threads = ( qthread_t ** )( pool + 1 );
+
+	if( Sys_Semaphore_Create( &pool->wake, 0 ) != 0 ) {
+		free( pool );
+		return NULL;
+	}
+	if( Sys_Semaphore_Create( &pool->done, 0 ) != 0 ) {
+		Sys_Semaphore_Destroy( pool->wake );
+		free( pool );
+		return NULL;
+	}
+
+	for( i = 0; i < numThreads; i++ ) {
+		if( Sys_Thread_Create( &pool->threads[i], QThreadPool_Worker, pool ) != 0 ) {
+			break;
+		}
+		pool->numThreads++;
+	}
+
+	if( !pool->numThreads ) {
+		QThreadPool_Destroy( &pool );
+	}
+	return pool;
+}
+
+/*
+* QThreadPool_Destroy
+*/
+void QThreadPool_Destroy( qthreadpool_t **ppool )
+{
+	int i;
+	qthreadpool_t *pool;
+
+	assert( ppool != NULL );
+	if( !ppool || !*ppool ) {
+		return;
+	}
+
+	pool = *ppool;
+	*ppool = NULL;
+
+	pool->terminated = 1;
+	Sys_Semaphore_Post( pool->wake, pool->numThreads );
+	for( i = 0; i < pool->numThreads; i++ ) {
+		Sys_Thread_Join( pool->threads[i] );
+		free( pool->threads[i] );
+	}
+
+	Sys_Semaphore_Destroy( pool->done );
+	Sys_Semaphore_Destroy( pool->wake );
+	free( pool );
+}
+
+/*
+* QThreadPool_NumThreads
+*/
+int QThreadPool_NumThreads( const qthreadpool_t *pool )
+{
+	return pool ? pool->numThreads : 0;
+}
+
+/*
+* QThreadPool_Run
+*
+* Calls job( param, index ) for every index in [0, numJobs) on the worker
+* threads and blocks until all of them have returned. The calling thread
+* only waits, so jobs never run on the stack that owns the frame's abort
+* point. Must not be called concurrently on the same pool.
+*/
+void QThreadPool_Run( qthreadpool_t *pool, void (*job)( void *, int ), void *param, int numJobs )
+{
+	int i, numWorkers;
+
+	if( numJobs <= 0 ) {
+		return;
+	}
+
+	if( !pool ) {
+		for( i = 0; i < numJobs; i++ ) {
+			job( param, i );
+		}
+		return;
+	}
+
+	pool->job = job;
+	pool->param = param;
+	pool->numJobs = numJobs;
+	pool->nextJob = 0;
+
+	numWorkers = min( pool->numThreads, numJobs );
+	Sys_Semaphore_Post( pool->wake, numWorkers );
+	for( i = 0; i < numWorkers; i++ ) {
+		Sys_Semaphore_Wait( pool->done );
+	}
+}
+
 typedef struct qbufQueue_s
 {
 	int blockWrite;
@@ -269,6 +429,47 @@ void Sys_BufQueue_EnqueueCmd( qbufQueue_t *queue, const void *cmd, unsigned cmd_
 	Sys_BufQueue_BufLenAdd( queue, cmd_size ); // atomic
 }
 
+/*
+* Sys_BufQueue_Length
+*
+* Returns the number of bytes pending in the buffer.
+*/
+int Sys_BufQueue_Length( qbufQueue_t *queue )
+{
+	if( !queue ) {
+		return 0;
+	}
+	return queue->cmdbuf_len;
+}
+
+/*
+* Sys_BufQueue_CanEnqueueCmd
+*
+* Returns qfalse if enqueuing a command of given size would have
+* to wait for the reader to free some space in the buffer.
+*/
+int Sys_BufQueue_CanEnqueueCmd( qbufQueue_t *queue, unsigned cmd_size )
+{
+	unsigned write_remains;
+
+	if( !queue || queue->terminated ) {
+		return 1;
+	}
+	if( queue->bufSize < queue->write_pos ) {
+		return 1;
+	}
+
+	write_remains = queue->bufSize - queue->write_pos;
+
+	if( sizeof( int ) > write_remains ) {
+		return queue->cmdbuf_len + cmd_size + write_remains <= queue->bufSize;
+	}
+	if( cmd_size > write_remains ) {
+		return queue->cmdbuf_len + sizeof( int ) + cmd_size + write_remains <= queue->bufSize;
+	}
+	return queue->cmdbuf_len + cmd_size <= queue->bufSize;
+}
+
 /*
 * Sys_BufQueue_ReadCmds
 */
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "r_local.h"
 #include "r_imagelib.h"
+#include "r_imagefilter.h"
 #include "../qalgo/hash.h"
 
 #define	MAX_GLIMAGES	    8192
@@ -38,6 +39,8 @@ GLuint currentTextures[MAX_TEXTURE_UNITS];
 
 static int *r_8to24table;
 
+static unsigned int r_imageCPUFeatures;
+
 static mempool_t *r_imagesPool;
 static char *r_imagePathBuf, *r_imagePathBuf2;
 static size_t r_sizeof_imagePathBuf, r_sizeof_imagePathBuf2;
@@ -312,8 +315,13 @@ enum
 static qbyte *r_screenShotBuffer;
 static size_t r_screenShotBufferSize;
 
-static qbyte *r_imageBuffers[NUM_QGL_CONTEXTS][NUM_IMAGE_BUFFERS];
-static size_t r_imageBufSize[NUM_QGL_CONTEXTS][NUM_IMAGE_BUFFERS];
+// each decoder thread of the loader gets its own set of buffers
+// after the ones of the GL contexts
+#define MAX_IMAGE_DECODERS		8
+#define NUM_IMAGE_BUFFER_SETS	( NUM_QGL_CONTEXTS + MAX_IMAGE_DECODERS )
+
+static qbyte *r_imageBuffers[NUM_IMAGE_BUFFER_SETS][NUM_IMAGE_BUFFERS];
+static size_t r_imageBufSize[NUM_IMAGE_BUFFER_SETS][NUM_IMAGE_BUFFERS];
 
 #define R_PrepareImageBuffer(ctx,buffer,size) _R_PrepareImageBuffer(ctx,buffer,size,__FILE__,__LINE__)
 
@@ -337,22 +345,32 @@ static qbyte *_R_PrepareImageBuffer( int ctx, int buffer, size_t size,
 }
 
 /*
-* R_FreeImageBuffers
+* R_FreeImageBufferSet
 */
-void R_FreeImageBuffers( void )
+static void R_FreeImageBufferSet( int ctx )
 {
-	int i, j;
+	int j;
 
-	for( i = 0; i < NUM_QGL_CONTEXTS; i++ )
-		for( j = 0; j < NUM_IMAGE_BUFFERS; j++ )
+	for( j = 0; j < NUM_IMAGE_BUFFERS; j++ )
+	{
+		if( r_imageBuffers[ctx][j] )
 		{
-			if( r_imageBuffers[i][j] )
-			{
-				R_Free( r_imageBuffers[i][j] );
-				r_imageBuffers[i][j] = NULL;
-			}
-			r_imageBufSize[i][j] = 0;
+			R_Free( r_imageBuffers[ctx][j] );
+			r_imageBuffers[ctx][j] = NULL;
 		}
+		r_imageBufSize[ctx][j] = 0;
+	}
+}
+
+/*
+* R_FreeImageBuffers
+*/
+void R_FreeImageBuffers( void )
+{
+	int i;
+
+	for( i = 0; i < NUM_IMAGE_BUFFER_SETS; i++ )
+		R_FreeImageBufferSet( i );
 }
 
 /*
@@ -512,56 +530,12 @@ static void R_FlipTexture( const qbyte *in, qbyte *out, int width, int height,
 static void R_ResampleTexture( int ctx, const qbyte *in, int inwidth, int inheight, qbyte *out, 
 	int outwidth, int outheight, int samples )
 {
-	int i, j, k;
-	int inwidthS, outwidthS;
-	unsigned int frac, fracstep;
-	const qbyte *inrow, *inrow2, *pix1, *pix2, *pix3, *pix4;
-	unsigned *p1, *p2;
-	qbyte *opix;
+	unsigned *lines = NULL;
 
-	if( inwidth == outwidth && inheight == outheight )
-	{
-		memcpy( out, in, inwidth * inheight * samples );
-		return;
-	}
-
-	p1 = ( unsigned * )R_PrepareImageBuffer( ctx, TEXTURE_LINE_BUF, outwidth * sizeof( *p1 ) * 2 );
-	p2 = p1 + outwidth;
+	if( inwidth != outwidth || inheight != outheight )
+		lines = ( unsigned * )R_PrepareImageBuffer( ctx, TEXTURE_LINE_BUF, outwidth * sizeof( *lines ) * 2 );
 
-	fracstep = inwidth * 0x10000 / outwidth;
-
-	frac = fracstep >> 2;
-	for( i = 0; i < outwidth; i++ )
-	{
-		p1[i] = samples * ( frac >> 16 );
-		frac += fracstep;
-	}
-
-	frac = 3 * ( fracstep >> 2 );
-	for( i = 0; i < outwidth; i++ )
-	{
-		p2[i] = samples * ( frac >> 16 );
-		frac += fracstep;
-	}
-
-	inwidthS = inwidth * samples;
-	outwidthS = outwidth * samples;
-	for( i = 0; i < outheight; i++, out += outwidthS )
-	{
-		inrow = in + inwidthS * (int)( ( i + 0.25 ) * inheight / outheight );
-		inrow2 = in + inwidthS * (int)( ( i + 0.75 ) * inheight / outheight );
-		for( j = 0; j < outwidth; j++ )
-		{
-			pix1 = inrow + p1[j];
-			pix2 = inrow + p2[j];
-			pix3 = inrow2 + p1[j];
-			pix4 = inrow2 + p2[j];
-			opix = out + j * samples;
-
-			for( k = 0; k < samples; k++ )
-				opix[k] = ( pix1[k] + pix2[k] + pix3[k] + pix4[k] ) >> 2;
-		}
-	}
+	R_ResampleImage( in, inwidth, inheight, out, outwidth, outheight, samples, lines, r_imageCPUFeatures );
 }
 
 /*
@@ -623,31 +597,10 @@ static void R_ResampleTexture16( int ctx, const unsigned short *in, int inwidth,
 
 /*
 * R_MipMap
-* 
-* Operates in place, quartering the size of the texture
-* note: if given odd width/height this discards the last row/column of
-* pixels, rather than doing a proper box-filter scale down (LordHavoc)
 */
 static void R_MipMap( qbyte *in, int width, int height, int samples )
 {
-	int i, j, k, samples2;
-	qbyte *out;
-
-	// width <<= 2;
-	width *= samples;
-	height >>= 1;
-	samples2 = samples << 1;
-
-
-	out = in;
-	for( i = 0; i < height; i++, in += width )
-	{
-		for( j = 0; j < width; j += samples2, out += samples, in += samples2 )
-		{
-			for( k = 0; k < samples; k++ )
-				out[k] = ( in[k] + in[k+samples] + in[width+k] + in[width+k+samples] )>>2;
-		}
-	}
+	R_MipMapImage( in, width, height, samples, r_imageCPUFeatures );
 }
 
 /*
@@ -767,6 +720,71 @@ static void R_SetupTexParameters( int target, int flags )
 #endif
 }
 
+/*
+* R_UploadSize
+*/
+static void R_UploadSize( int width, int height, int flags, qboolean noScale, int *scaledWidth, int *scaledHeight )
+{
+	int w, h;
+
+	// we can't properly mipmap a NPT-texture in software
+	if( ( glConfig.ext.texture_non_power_of_two && ( flags & IT_NOMIPMAP ) ) || noScale )
+	{
+		w = width;
+		h = height;
+	}
+	else
+	{
+		for( w = 1; w < width; w <<= 1 );
+		for( h = 1; h < height; h <<= 1 );
+	}
+
+	R_ScaledImageSize( w, h, scaledWidth, scaledHeight, flags, qfalse );
+}
+
+/*
+* R_UploadFormat
+*/
+static void R_UploadFormat( int flags, int samples, int *comp, int *format, int *type )
+{
+	if( flags & IT_DEPTH )
+	{
+		*comp = *format = GL_DEPTH_COMPONENT;
+		*type = glConfig.ext.depth24 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+	}
+	else if( flags & IT_FRAMEBUFFER )
+	{
+		if( samples == 4 )
+		{
+			*comp = *format = GL_RGBA;
+			*type = glConfig.ext.rgb8_rgba8 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT_4_4_4_4;
+		}
+		else
+		{
+			*comp = *format = GL_RGB;
+			*type = glConfig.ext.rgb8_rgba8 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT_5_6_5;
+		}
+	}
+	else if( flags & IT_LUMINANCE )
+	{
+		*comp = *format = GL_LUMINANCE;
+		*type = GL_UNSIGNED_BYTE;
+	}
+	else
+	{
+		if( samples == 4 )
+			*format = ( flags & IT_BGRA ? GL_BGRA_EXT : GL_RGBA );
+		else
+			*format = ( flags & IT_BGRA ? GL_BGR_EXT : GL_RGB );
+#ifdef GL_ES_VERSION_2_0
+		*comp = *format;
+#else
+		*comp = R_TextureFormat( samples, flags & IT_NOCOMPRESS ? qtrue : qfalse );
+#endif
+		*type = GL_UNSIGNED_BYTE;
+	}
+}
+
 /*
 * R_Upload32
 */
@@ -782,20 +800,7 @@ static void R_Upload32( int ctx, qbyte **data, int width, int height, int flags,
 
 	assert( samples );
 
-	// we can't properly mipmap a NPT-texture in software
-	if( ( glConfig.ext.texture_non_power_of_two && ( flags & IT_NOMIPMAP ) )
-		|| ( subImage && noScale ) )
-	{
-		scaledWidth = width;
-		scaledHeight = height;
-	}
-	else
-	{
-		for( scaledWidth = 1; scaledWidth < width; scaledWidth <<= 1 );
-		for( scaledHeight = 1; scaledHeight < height; scaledHeight <<= 1 );
-	}
-
-	R_ScaledImageSize( scaledWidth, scaledHeight, &scaledWidth, &scaledHeight, flags, qfalse );
+	R_UploadSize( width, height, flags, subImage && noScale, &scaledWidth, &scaledHeight );
 
 	// don't ever bother with > maxSize textures
 	if( flags & IT_CUBEMAP )
@@ -826,42 +831,7 @@ static void R_Upload32( int ctx, qbyte **data, int width, int height, int flags,
 	if( upload_height )
 		*upload_height = scaledHeight;
 
-	if( flags & IT_DEPTH )
-	{
-		comp = format = GL_DEPTH_COMPONENT;
-		type = glConfig.ext.depth24 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
-	}
-	else if( flags & IT_FRAMEBUFFER )
-	{
-		if( samples == 4 )
-		{
-			comp = format = GL_RGBA;
-			type = glConfig.ext.rgb8_rgba8 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT_4_4_4_4;
-		}
-		else
-		{
-			comp = format = GL_RGB;
-			type = glConfig.ext.rgb8_rgba8 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT_5_6_5;
-		}
-	}
-	else if( flags & IT_LUMINANCE )
-	{
-		comp = format = GL_LUMINANCE;
-		type = GL_UNSIGNED_BYTE;
-	}
-	else
-	{
-		if( samples == 4 )
-			format = ( flags & IT_BGRA ? GL_BGRA_EXT : GL_RGBA );
-		else
-			format = ( flags & IT_BGRA ? GL_BGR_EXT : GL_RGB );
-#ifdef GL_ES_VERSION_2_0
-		comp = format;
-#else
-		comp = R_TextureFormat( samples, flags & IT_NOCOMPRESS ? qtrue : qfalse );
-#endif
-		type = GL_UNSIGNED_BYTE;
-	}
+	R_UploadFormat( flags, samples, &comp, &format, &type );
 
 	R_SetupTexParameters( target, flags );
 
@@ -1009,17 +979,416 @@ static int R_MipLevel( int width, int height, int scaledWidth, int scaledHeight
 }
 
 /*
-* R_LoadImageFromDisk
+==============================================================================
+
+MIP CHAINS
+
+==============================================================================
 */
-static qboolean R_LoadImageFromDisk( int ctx, image_t *image, void (*bind)(int, const image_t *) )
+
+// images from disk are decoded, resampled and mipmapped into a single block
+// of memory before anything is handed to GL, so that the loader can do that
+// on several threads at once and the result can be kept in the mip cache
+typedef struct
+{
+	int flags;						// image flags, IT_BGRA is set by the decoder
+	int width, height, samples;		// of the source image
+	int uploadWidth, uploadHeight;
+	int numFaces, numMips;
+	qbyte *data;					// mip levels of all faces back to back
+	char extension[8];
+} imagemips_t;
+
+#define IMAGECACHE_VERSION		1
+#define IMAGECACHE_DIRECTORY	"cache/mips"
+#define IMAGECACHE_EXTENSION	".mip"
+
+// flags that change the contents of the mip chain
+#define IMAGECACHE_FLAGS		( IT_NOMIPMAP|IT_NOPICMIP|IT_SKY|IT_FLIPX|IT_FLIPY|IT_FLIPDIAGONAL )
+
+typedef struct
 {
-	int flags = image->flags;
-	char *pathname = image->name;
-	size_t pathsize = image->name_size;
-	size_t len = strlen( pathname );
-	const char *extension = "";
+	int version;
+	unsigned int srcHash;
+	int srcLength;
+	int flags;						// IMAGECACHE_FLAGS and IT_BGRA
+	int bgra;
+	int width, height, samples;
+	int uploadWidth, uploadHeight;
+	int numMips;
+	char extension[8];
+} imagecacheheader_t;
+
+typedef struct
+{
+	char *name;						// relative to IMAGECACHE_DIRECTORY
+	int size;
+	time_t mtime;
+	qboolean inuse;					// belongs to an image that is currently registered
+} imagecacheentry_t;
+
+static qmutex_t *r_imageCacheMutex;
+static size_t r_imageCacheSize;		// bytes in the cache directory, written ones included
+static qboolean r_imageCacheScanned;
+
+/*
+* R_MipChainSize
+*/
+static size_t R_MipChainSize( int width, int height, int samples, int numMips )
+{
+	int i;
+	size_t size = 0;
+
+	for( i = 0; i < numMips; i++ )
+	{
+		size += width * height * samples;
+
+		width >>= 1;
+		height >>= 1;
+		if( !width )
+			width = 1;
+		if( !height )
+			height = 1;
+	}
+	return size;
+}
+
+/*
+* R_BuildMipChain
+*
+* Produces the same levels R_Upload32 would upload for the given faces
+*/
+static void R_BuildMipChain( int ctx, qbyte **pic, int width, int height, int samples, imagemips_t *mips )
+{
+	int i, j, w, h;
+	int flags = mips->flags;
+	qbyte *scaled = NULL, *out;
+
+	mips->width = width;
+	mips->height = height;
+	mips->samples = samples;
+
+	R_UploadSize( width, height, flags, qfalse, &mips->uploadWidth, &mips->uploadHeight );
+	mips->numMips = ( flags & IT_NOMIPMAP ) ? 1 : R_MipCount( mips->uploadWidth, mips->uploadHeight );
+
+	mips->data = R_MallocExt( r_imagesPool, 
+		R_MipChainSize( mips->uploadWidth, mips->uploadHeight, samples, mips->numMips ) * mips->numFaces, 16, 0 );
+
+	if( !( flags & IT_CUBEMAP ) && ( flags & ( IT_FLIPX|IT_FLIPY|IT_FLIPDIAGONAL ) ) )
+	{
+		qbyte *temp = R_PrepareImageBuffer( ctx, TEXTURE_FLIPPING_BUF0, width * height * samples );
+		R_FlipTexture( pic[0], temp, width, height, samples, 
+			(flags & IT_FLIPX) ? qtrue : qfalse, 
+			(flags & IT_FLIPY) ? qtrue : qfalse, 
+			(flags & IT_FLIPDIAGONAL) ? qtrue : qfalse );
+		pic = &r_imageBuffers[ctx][TEXTURE_FLIPPING_BUF0];
+	}
+
+	out = mips->data;
+	for( i = 0; i < mips->numFaces; i++ )
+	{
+		w = mips->uploadWidth;
+		h = mips->uploadHeight;
+
+		if( ( w == width ) && ( h == height ) && ( flags & IT_NOMIPMAP ) )
+		{
+			memcpy( out, pic[i], w * h * samples );
+			out += w * h * samples;
+			continue;
+		}
+
+		if( !scaled )
+			scaled = R_PrepareImageBuffer( ctx, TEXTURE_RESAMPLING_BUF, w * h * samples );
+
+		R_ResampleTexture( ctx, pic[i], width, height, scaled, w, h, samples );
+		memcpy( out, scaled, w * h * samples );
+		out += w * h * samples;
+
+		for( j = 1; j < mips->numMips; j++ )
+		{
+			R_MipMap( scaled, w, h, samples );
+
+			w >>= 1;
+			h >>= 1;
+			if( w < 1 )
+				w = 1;
+			if( h < 1 )
+				h = 1;
+
+			memcpy( out, scaled, w * h * samples );
+			out += w * h * samples;
+		}
+	}
+}
+
+/*
+* R_FreeImageMips
+*/
+static void R_FreeImageMips( imagemips_t *mips )
+{
+	if( mips->data )
+	{
+		R_Free( mips->data );
+		mips->data = NULL;
+	}
+}
+
+/*
+* R_ReadImageCache
+*/
+static qboolean R_ReadImageCache( const char *cachename, const imagecacheheader_t *key, imagemips_t *mips )
+{
+	int file, length;
+	int w, h, numMips;
+	size_t size;
+	imagecacheheader_t header;
+
+	length = ri.FS_FOpenFile( cachename, &file, FS_READ );
+	if( !file )
+		return qfalse;
+
+	if( length < (int)sizeof( header ) || ri.FS_Read( &header, sizeof( header ), file ) != sizeof( header ) )
+		goto fail;
+	if( header.version != key->version || header.srcHash != key->srcHash || header.srcLength != key->srcLength )
+		goto fail;
+	if( ( header.flags & ~IT_BGRA ) != key->flags || header.bgra != key->bgra )
+		goto fail;
+	if( header.samples < 1 || header.samples > 4 || header.width < 1 || header.height < 1 )
+		goto fail;
+
+	// picmip and texture size limits may have changed since the entry was written
+	R_UploadSize( header.width, header.height, mips->flags, qfalse, &w, &h );
+	numMips = ( mips->flags & IT_NOMIPMAP ) ? 1 : R_MipCount( w, h );
+	if( w != header.uploadWidth || h != header.uploadHeight || numMips != header.numMips )
+		goto fail;
+
+	size = R_MipChainSize( w, h, header.samples, numMips );
+	if( (size_t)length != sizeof( header ) + size )
+		goto fail;
+
+	mips->data = R_MallocExt( r_imagesPool, size, 16, 0 );
+	if( ri.FS_Read( mips->data, size, file ) != (int)size )
+	{
+		R_FreeImageMips( mips );
+		goto fail;
+	}
+	ri.FS_FCloseFile( file );
+
+	mips->flags |= header.flags & IT_BGRA;
+	mips->width = header.width;
+	mips->height = header.height;
+	mips->samples = header.samples;
+	mips->uploadWidth = w;
+	mips->uploadHeight = h;
+	mips->numMips = numMips;
+	header.extension[sizeof( header.extension ) - 1] = '\0';
+	Q_strncpyz( mips->extension, header.extension, sizeof( mips->extension ) );
+	return qtrue;
+
+fail:
+	ri.FS_FCloseFile( file );
+	return qfalse;
+}
+
+/*
+* R_WriteImageCache
+*/
+static void R_WriteImageCache( const char *cachename, const imagecacheheader_t *key, const imagemips_t *mips )
+{
+	int file;
+	size_t size;
+	imagecacheheader_t header;
+
+	if( ri.FS_FOpenFile( cachename, &file, FS_WRITE ) == -1 )
+	{
+		ri.Com_DPrintf( S_COLOR_YELLOW "Couldn't write %s\n", cachename );
+		return;
+	}
+
+	header = *key;
+	header.flags |= mips->flags & IT_BGRA;
+	header.width = mips->width;
+	header.height = mips->height;
+	header.samples = mips->samples;
+	header.uploadWidth = mips->uploadWidth;
+	header.uploadHeight = mips->uploadHeight;
+	header.numMips = mips->numMips;
+	Q_strncpyz( header.extension, mips->extension, sizeof( header.extension ) );
+
+	size = R_MipChainSize( mips->uploadWidth, mips->uploadHeight, mips->samples, mips->numMips );
+	ri.FS_Write( &header, sizeof( header ), file );
+	ri.FS_Write( mips->data, size, file );
+	ri.FS_FCloseFile( file );
+
+	// R_TrimImageCache brings the directory back under budget after registration
+	ri.Mutex_Lock( r_imageCacheMutex );
+	r_imageCacheSize += sizeof( header ) + size;
+	ri.Mutex_Unlock( r_imageCacheMutex );
+}
+
+/*
+* R_ImageCacheName
+*
+* All entries are kept in a single directory, so that the whole cache can be
+* listed when it needs trimming. An entry that ends up shared by two images
+* is just rebuilt, as the header won't match the other source.
+*/
+static void R_ImageCacheName( const char *name, int flags, char *cachename, size_t cachesize, qboolean relative )
+{
+	char *p;
+
+	if( relative )
+		Q_snprintfz( cachename, cachesize, "%s_%x%s", name, flags & IMAGECACHE_FLAGS, IMAGECACHE_EXTENSION );
+	else
+		Q_snprintfz( cachename, cachesize, "%s/%s_%x%s", IMAGECACHE_DIRECTORY, name, flags & IMAGECACHE_FLAGS, IMAGECACHE_EXTENSION );
+
+	for( p = cachename + ( relative ? 0 : sizeof( IMAGECACHE_DIRECTORY ) ); *p; p++ )
+	{
+		if( *p == '/' )
+			*p = '.';
+	}
+}
+
+/*
+* R_ImageCacheEntryCmpByName
+*/
+static int R_ImageCacheEntryCmpByName( const void *p1, const void *p2 )
+{
+	return strcmp( ( (const imagecacheentry_t *)p1 )->name, ( (const imagecacheentry_t *)p2 )->name );
+}
+
+/*
+* R_ImageCacheEntryCmpByAge
+*
+* Entries of registered images go last, the rest from the least recently written
+*/
+static int R_ImageCacheEntryCmpByAge( const void *p1, const void *p2 )
+{
+	const imagecacheentry_t *e1 = p1, *e2 = p2;
+
+	if( e1->inuse != e2->inuse )
+		return e1->inuse ? 1 : -1;
+	if( e1->mtime != e2->mtime )
+		return e1->mtime < e2->mtime ? -1 : 1;
+	return 0;
+}
+
+/*
+* R_TrimImageCache
+*
+* Deletes entries until the cache fits into r_image_cache_size megabytes,
+* plus some slack so that it isn't scanned again on every registration.
+* Entries that the images of the current registration came from are kept.
+*/
+static void R_TrimImageCache( void )
+{
+	int i, j, k, file, length;
+	int numfiles, numentries;
+	size_t budget, total;
+	char filenames[1024], *fileptr;
+	char cachename[1024];
+	imagecacheentry_t *entries, key, *entry;
+	image_t *image;
+
+	budget = (size_t)max( r_image_cache_size->integer, 0 ) * 1024 * 1024;
+
+	ri.Mutex_Lock( r_imageCacheMutex );
+	total = r_imageCacheSize;
+	ri.Mutex_Unlock( r_imageCacheMutex );
+
+	if( r_imageCacheScanned && total <= budget )
+		return;
+
+	numfiles = ri.FS_GetFileList( IMAGECACHE_DIRECTORY, IMAGECACHE_EXTENSION, NULL, 0, 0, 0 );
+	entries = R_MallocExt( r_imagesPool, sizeof( *entries ) * ( numfiles + 1 ), 0, 1 );
+
+	total = 0;
+	numentries = 0;
+	for( i = 0; i < numfiles; i += k )
+	{
+		if( ( k = ri.FS_GetFileList( IMAGECACHE_DIRECTORY, IMAGECACHE_EXTENSION, filenames, sizeof( filenames ), i, numfiles ) ) == 0 )
+		{
+			k = 1; // advance by one file
+			continue;
+		}
+
+		fileptr = filenames;
+		for( j = 0; j < k; j++, fileptr += strlen( fileptr ) + 1 )
+		{
+			Q_snprintfz( cachename, sizeof( cachename ), "%s/%s", IMAGECACHE_DIRECTORY, fileptr );
+
+			length = ri.FS_FOpenFile( cachename, &file, FS_READ );
+			if( !file )
+				continue;
+			ri.FS_FCloseFile( file );
+
+			entry = &entries[numentries++];
+			entry->name = R_CopyString( fileptr );
+			entry->size = max( length, 0 );
+			entry->mtime = ri.FS_FileMTime( cachename );
+			total += entry->size;
+		}
+	}
+
+	if( total > budget )
+	{
+		size_t target = budget - budget / 4;
+
+		qsort( entries, numentries, sizeof( *entries ), R_ImageCacheEntryCmpByName );
+
+		for( i = 0, image = images; i < MAX_GLIMAGES; i++, image++ )
+		{
+			if( !image->name || ( image->flags & IT_CUBEMAP ) )
+				continue;
+			if( image->registrationSequence != rsh.registrationSequence )
+				continue;
+
+			R_ImageCacheName( image->name, image->flags, cachename, sizeof( cachename ), qtrue );
+			key.name = cachename;
+			entry = bsearch( &key, entries, numentries, sizeof( *entries ), R_ImageCacheEntryCmpByName );
+			if( entry )
+				entry->inuse = qtrue;
+		}
+
+		qsort( entries, numentries, sizeof( *entries ), R_ImageCacheEntryCmpByAge );
+
+		for( i = 0; i < numentries && total > target && !entries[i].inuse; i++ )
+		{
+			Q_snprintfz( cachename, sizeof( cachename ), "%s/%s", IMAGECACHE_DIRECTORY, entries[i].name );
+			if( ri.FS_RemoveFile( cachename ) )
+				total -= entries[i].size;
+		}
+
+		ri.Com_DPrintf( "Trimmed %s to %i KB, %i entries removed\n", IMAGECACHE_DIRECTORY, (int)( total / 1024 ), i );
+	}
+
+	for( i = 0; i < numentries; i++ )
+		R_Free( entries[i].name );
+	R_Free( entries );
+
+	// anything written from now on is added by R_WriteImageCache
+	ri.Mutex_Lock( r_imageCacheMutex );
+	r_imageCacheSize = total;
+	r_imageCacheScanned = qtrue;
+	ri.Mutex_Unlock( r_imageCacheMutex );
+}
+
+/*
+* R_BuildImageMips
+*
+* Decodes the image or fetches it from the mip cache. Doesn't touch GL or
+* the image itself, so it may run on any thread that owns the buffer set ctx.
+*/
+static qboolean R_BuildImageMips( int ctx, const char *name, int flags, imagemips_t *mips )
+{
+	size_t len = strlen( name );
+	size_t pathsize = len + 15;
+	char *pathname = alloca( pathsize );
 	int width = 1, height = 1, samples = 1;
 
+	memset( mips, 0, sizeof( *mips ) );
+	strcpy( pathname, name );
+
 	if( flags & IT_CUBEMAP )
 	{
 		int i, j;
@@ -1048,7 +1417,6 @@ static qboolean R_LoadImageFromDisk( int ctx, image_t *image, void (*bind)(int,
 				pathname[len+2] = cubemapSides[i][j].suf[1];
 				pathname[len+3] = 0;
 
-				Q_strncatz( pathname, extension, pathsize );
 				samples = R_ReadImageFromDisk( ctx, pathname, pathsize, 
 					&(pic[j]), &width, &height, &flags, j );
 				if( pic[j] )
@@ -1072,7 +1440,7 @@ static qboolean R_LoadImageFromDisk( int ctx, image_t *image, void (*bind)(int,
 						int flags = cubemapSides[i][j].flags;
 						qbyte *temp = R_PrepareImageBuffer( ctx,
 							TEXTURE_FLIPPING_BUF0+j, width * height * samples );
-						R_FlipTexture( pic[j], temp, width, height, 4, 
+						R_FlipTexture( pic[j], temp, width, height, samples, 
 							(flags & IT_FLIPX) ? qtrue : qfalse, 
 							(flags & IT_FLIPY) ? qtrue : qfalse, 
 							(flags & IT_FLIPDIAGONAL) ? qtrue : qfalse );
@@ -1088,57 +1456,148 @@ static qboolean R_LoadImageFromDisk( int ctx, image_t *image, void (*bind)(int,
 
 		if( i != 2 )
 		{
-			pathname[len] = 0;
-			image->width = width;
-			image->height = height;
-			image->samples = samples;
-
-			bind( 0, image );
-
-			R_Upload32( ctx, pic, width, height, flags, &image->upload_width, 
-				&image->upload_height, samples, qfalse, qfalse );
+			mips->flags = flags;
+			mips->numFaces = 6;
+			R_BuildMipChain( ctx, pic, width, height, samples, mips );
 
-			image->extension[0] = '.';
-			Q_strncpyz( &image->extension[1], &pathname[len+4], sizeof( image->extension )-1 );
+			mips->extension[0] = '.';
+			Q_strncpyz( &mips->extension[1], &pathname[len+4], sizeof( mips->extension )-1 );
 			return qtrue;
 		}
-		else
-		{
-			ri.Com_DPrintf( S_COLOR_YELLOW "Missing image: %s\n", image->name );
-		}
+
+		ri.Com_DPrintf( S_COLOR_YELLOW "Missing image: %s\n", name );
 	}
 	else
 	{
 		qbyte *pic = NULL;
+		const char *extension;
+		char *cachename = NULL;
+		imagecacheheader_t key;
 
-		Q_strncatz( pathname, extension, pathsize );
-		samples = R_ReadImageFromDisk( ctx, pathname, pathsize, &pic, &width, &height, &flags, 0 );
+		mips->flags = flags;
+		mips->numFaces = 1;
 
-		if( pic )
+		// the cache is keyed by the contents of the source file, so an
+		// updated texture never picks up a stale entry
+		extension = ri.FS_FirstExtension( pathname, IMAGE_EXTENSIONS, NUM_IMAGE_EXTENSIONS );
+		if( extension && r_image_cache->integer )
 		{
+			qbyte *src;
+
+			memset( &key, 0, sizeof( key ) );
+			key.version = IMAGECACHE_VERSION;
+			key.flags = flags & IMAGECACHE_FLAGS;
+			key.bgra = glConfig.ext.bgra ? 1 : 0;
+
+			COM_ReplaceExtension( pathname, extension, pathsize );
+			key.srcLength = R_LoadFile( pathname, (void **)&src );
 			pathname[len] = 0;
-			image->width = width;
-			image->height = height;
-			image->samples = samples;
 
-			bind( 0, image );
+			if( src )
+			{
+				size_t cachesize = len + sizeof( IMAGECACHE_DIRECTORY ) + sizeof( IMAGECACHE_EXTENSION ) + 16;
+
+				key.srcHash = COM_SuperFastHash( src, key.srcLength, key.srcLength );
+				R_FreeFile( src );
 
-			R_Upload32( ctx, &pic, width, height, flags, &image->upload_width, 
-				&image->upload_height, samples, qfalse, qfalse );
+				cachename = alloca( cachesize );
+				R_ImageCacheName( name, flags, cachename, cachesize, qfalse );
 
-			image->extension[0] = '.';
-			Q_strncpyz( &image->extension[1], &pathname[len+1], sizeof( image->extension )-1 );
-			return qtrue;
+				if( R_ReadImageCache( cachename, &key, mips ) )
+					return qtrue;
+			}
 		}
-		else
+
+		samples = R_ReadImageFromDisk( ctx, pathname, pathsize, &pic, &width, &height, &flags, 0 );
+		if( pic )
 		{
-			ri.Com_DPrintf( S_COLOR_YELLOW "Missing image: %s\n", image->name );
+			mips->flags = flags;
+			R_BuildMipChain( ctx, &pic, width, height, samples, mips );
+
+			mips->extension[0] = '.';
+			Q_strncpyz( &mips->extension[1], &pathname[len+1], sizeof( mips->extension )-1 );
+
+			if( cachename )
+				R_WriteImageCache( cachename, &key, mips );
+			return qtrue;
 		}
+
+		ri.Com_DPrintf( S_COLOR_YELLOW "Missing image: %s\n", name );
 	}
 
 	return qfalse;
 }
 
+/*
+* R_UploadImageMips
+*/
+static void R_UploadImageMips( image_t *image, const imagemips_t *mips, void (*bind)(int, const image_t *) )
+{
+	int i, j, w, h;
+	int comp, format, type;
+	int target, target2;
+	const qbyte *data = mips->data;
+
+	image->width = mips->width;
+	image->height = mips->height;
+	image->samples = mips->samples;
+	image->upload_width = mips->uploadWidth;
+	image->upload_height = mips->uploadHeight;
+	Q_strncpyz( image->extension, mips->extension, sizeof( image->extension ) );
+
+	bind( 0, image );
+
+	if( mips->flags & IT_CUBEMAP )
+	{
+		target = GL_TEXTURE_CUBE_MAP_ARB;
+		target2 = GL_TEXTURE_CUBE_MAP_POSITIVE_X_ARB;
+	}
+	else
+	{
+		target = GL_TEXTURE_2D;
+		target2 = GL_TEXTURE_2D;
+	}
+
+	R_UploadFormat( mips->flags, mips->samples, &comp, &format, &type );
+
+	R_SetupTexParameters( target, mips->flags );
+
+	for( i = 0; i < mips->numFaces; i++, target2++ )
+	{
+		w = mips->uploadWidth;
+		h = mips->uploadHeight;
+
+		for( j = 0; j < mips->numMips; j++ )
+		{
+			qglTexImage2D( target2, j, comp, w, h, 0, format, type, data );
+			data += w * h * mips->samples;
+
+			w >>= 1;
+			h >>= 1;
+			if( w < 1 )
+				w = 1;
+			if( h < 1 )
+				h = 1;
+		}
+	}
+}
+
+/*
+* R_LoadImageFromDisk
+*/
+static qboolean R_LoadImageFromDisk( int ctx, image_t *image, void (*bind)(int, const image_t *) )
+{
+	imagemips_t mips;
+
+	if( !R_BuildImageMips( ctx, image->name, image->flags, &mips ) )
+		return qfalse;
+
+	R_UploadImageMips( image, &mips, bind );
+
+	R_FreeImageMips( &mips );
+	return qtrue;
+}
+
 /*
 * R_LinkPic
 */
@@ -2018,6 +2477,12 @@ void R_InitImages( void )
 
 	r_imagesPool = R_AllocPool( r_mempool, "Images" );
 
+	r_imageCPUFeatures = ri.COM_CPUFeatures();
+
+	ri.Mutex_Create( &r_imageCacheMutex );
+	r_imageCacheSize = 0;
+	r_imageCacheScanned = qfalse;
+
 	r_imagePathBuf = r_imagePathBuf2 = NULL;
 	r_sizeof_imagePathBuf = r_sizeof_imagePathBuf2 = 0;
 
@@ -2096,6 +2561,9 @@ void R_FreeUnusedImages( void )
 			rsh.shadowmapTextures[i] = NULL;
 		}
 	}
+
+	if( r_image_cache->integer )
+		R_TrimImageCache();
 }
 
 /*
@@ -2136,6 +2604,9 @@ void R_ShutdownImages( void )
 
 	R_FreePool( &r_imagesPool );
 
+	ri.Mutex_Destroy( r_imageCacheMutex );
+	r_imageCacheMutex = NULL;
+
 	r_screenShotBuffer = NULL;
 	r_screenShotBufferSize = 0;
 
@@ -2166,8 +2637,24 @@ typedef struct
 
 typedef unsigned (*queueCmdHandler_t)( const void * );
 
+// pics queued to the loader are decoded in batches on the decoder pool,
+// then uploaded in order from the loader thread, which owns the GL context
+#define MAX_LOADER_BATCH	64
+
+typedef struct
+{
+	int numPics;
+	int pics[MAX_LOADER_BATCH];
+	imagemips_t mips[MAX_LOADER_BATCH];
+	qboolean built[MAX_LOADER_BATCH];
+	int nextPic;				// next pic to be picked by a decoder
+	qmutex_t *mutex;
+} loaderBatch_t;
+
 static qbufQueue_t *loader_queue;
 static qthread_t *loader_thread = NULL;
+static qthreadpool_t *loader_pool = NULL;
+static loaderBatch_t loader_batch;
 
 static void *R_ImageLoaderThreadProc( void *param );
 
@@ -2224,6 +2711,10 @@ static void R_InitImageLoader( void )
 		return;
 	}
 
+	loader_pool = ri.ThreadPool_Create( bound( 0, r_image_threads->integer, MAX_IMAGE_DECODERS ) );
+	loader_batch.numPics = 0;
+	ri.Mutex_Create( &loader_batch.mutex );
+
 	loader_queue = ri.BufQueue_Create( 0x100000, 1 );
 	ri.Thread_Create( &loader_thread, R_ImageLoaderThreadProc, loader_queue );
 
@@ -2276,11 +2767,93 @@ static void R_ShutdownImageLoader( void )
 
 	ri.BufQueue_Destroy( &loader_queue );
 
+	ri.ThreadPool_Destroy( &loader_pool );
+	ri.Mutex_Destroy( loader_batch.mutex );
+	loader_batch.mutex = NULL;
+
 	GLimp_SharedContext_Destroy( context );
 }
 
 //
 
+/*
+* R_BindLoaderTexture
+*/
+static void R_BindLoaderTexture( int tmu, const image_t *tex )
+{
+	R_BindContextTexture( tex );
+}
+
+/*
+* R_NumImageDecoders
+*/
+static int R_NumImageDecoders( void )
+{
+	int numDecoders = ri.ThreadPool_NumThreads( loader_pool );
+	return numDecoders > 0 ? numDecoders : 1;
+}
+
+/*
+* R_DecodeLoaderBatchJob
+*/
+static void R_DecodeLoaderBatchJob( void *param, int decoder )
+{
+	int i;
+	image_t *image;
+	loaderBatch_t *batch = param;
+
+	while( 1 ) {
+		ri.Mutex_Lock( batch->mutex );
+		i = batch->nextPic++;
+		ri.Mutex_Unlock( batch->mutex );
+
+		if( i >= batch->numPics ) {
+			break;
+		}
+
+		image = images + batch->pics[i];
+		batch->built[i] = R_BuildImageMips( NUM_QGL_CONTEXTS + decoder, image->name, image->flags, &batch->mips[i] );
+	}
+}
+
+/*
+* R_LoadLoaderBatch
+*/
+static void R_LoadLoaderBatch( void )
+{
+	int i;
+	image_t *image;
+	loaderBatch_t *batch = &loader_batch;
+
+	if( !batch->numPics ) {
+		return;
+	}
+
+	batch->nextPic = 0;
+	ri.ThreadPool_Run( loader_pool, R_DecodeLoaderBatchJob, batch, R_NumImageDecoders() );
+
+	for( i = 0; i < batch->numPics; i++ ) {
+		if( batch->built[i] ) {
+			R_UploadImageMips( images + batch->pics[i], &batch->mips[i], R_BindLoaderTexture );
+			R_FreeImageMips( &batch->mips[i] );
+		}
+	}
+
+	// the main context may only see the textures once they're complete
+	qglFinish();
+
+	for( i = 0; i < batch->numPics; i++ ) {
+		image = images + batch->pics[i];
+		if( batch->built[i] ) {
+			image->loaded = qtrue;
+		} else {
+			image->missing = qtrue;
+		}
+	}
+
+	batch->numPics = 0;
+}
+
 /*
 * R_HandleInitLoaderCmd
 */
@@ -2296,34 +2869,23 @@ static unsigned R_HandleInitLoaderCmd( void *pcmd )
 */
 static unsigned R_HandleShutdownLoaderCmd( void *pcmd )
 {
+	R_LoadLoaderBatch();
+
 	GLimp_SharedContext_MakeCurrent( NULL );
 
 	return 0;
 }
 
-/*
-* R_BindLoaderTexture
-*/
-static void R_BindLoaderTexture( int tmu, const image_t *tex )
-{
-	R_BindContextTexture( tex );
-}
-
 /*
 * R_HandleLoadPicLoaderCmd
 */
 static unsigned R_HandleLoadPicLoaderCmd( void *pcmd )
 {
 	loaderPicCmd_t *cmd = pcmd;
-	image_t *image = images + cmd->pic;
-	qboolean loaded;
 
-	loaded = R_LoadImageFromDisk( QGL_CONTEXT_LOADER, image, R_BindLoaderTexture );
-	if( !loaded ) {
-		image->missing = qtrue;
-	} else {
-		qglFinish();
-		image->loaded = qtrue;
+	loader_batch.pics[loader_batch.numPics++] = cmd->pic;
+	if( loader_batch.numPics == MAX_LOADER_BATCH ) {
+		R_LoadLoaderBatch();
 	}
 
 	return sizeof( *cmd );
@@ -2334,8 +2896,16 @@ static unsigned R_HandleLoadPicLoaderCmd( void *pcmd )
 */
 static unsigned R_HandleUnbindLoaderCmd( void *pcmd )
 {
+	int i;
 	image_t tex;
 
+	R_LoadLoaderBatch();
+
+	// done loading for now, don't hold on to the decoders' buffers
+	for( i = 0; i < R_NumImageDecoders(); i++ ) {
+		R_FreeImageBufferSet( NUM_QGL_CONTEXTS + i );
+	}
+
 	memset( &tex, 0, sizeof( tex ) );
 
 	R_BindContextTexture( &tex );
@@ -2369,6 +2939,9 @@ static void *R_ImageLoaderThreadProc( void *param )
 			break;
 		}
 
+		// the queue has run dry, don't keep what we have waiting
+		R_LoadLoaderBatch();
+
 		ri.Thread_Yield();
 	}
  
@@ -0,0 +1,385 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// r_imagefilter.c -- resampling and mipmapping of 8-bit images
+// kept free of GL and the refresh imports, so that ref_gl/test can link it as is
+
+#include "../gameshared/q_arch.h"
+#include "r_imagefilter.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# define R_IMAGE_SSE
+# include <emmintrin.h>
+# if ( defined( __GNUC__ ) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) || defined( __clang__ )
+#  define R_IMAGE_AVX2
+#  define R_AVX2_FUNC __attribute__( ( target( "avx2" ) ) )
+#  include <immintrin.h>
+# elif defined( _MSC_VER ) && _MSC_VER >= 1700
+#  define R_IMAGE_AVX2
+#  define R_AVX2_FUNC
+#  include <immintrin.h>
+# endif
+#endif
+
+#ifdef R_IMAGE_SSE
+/*
+* R_LoadPixel32
+*/
+static inline int R_LoadPixel32( const qbyte *p )
+{
+	int v;
+	memcpy( &v, p, sizeof( v ) );
+	return v;
+}
+
+/*
+* R_Average4_SSE2
+*
+* Per-byte ( a + b + c + d ) >> 2, widened to 16 bits so it matches the C code exactly
+*/
+static inline __m128i R_Average4_SSE2( __m128i a, __m128i b, __m128i c, __m128i d )
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo, hi;
+
+	lo = _mm_add_epi16( _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) ),
+		_mm_add_epi16( _mm_unpacklo_epi8( c, zero ), _mm_unpacklo_epi8( d, zero ) ) );
+	hi = _mm_add_epi16( _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) ),
+		_mm_add_epi16( _mm_unpackhi_epi8( c, zero ), _mm_unpackhi_epi8( d, zero ) ) );
+	return _mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) );
+}
+
+/*
+* R_ResampleRow_SSE2
+*
+* Returns the number of output pixels done, the caller finishes the row
+*/
+static int R_ResampleRow_SSE2( const qbyte *inrow, const qbyte *inrow2, const unsigned *p1, const unsigned *p2,
+	qbyte *out, int outwidth, int samples )
+{
+	int j;
+	__m128i a, b, c, d;
+
+	if( samples != 4 )
+		return 0;
+
+	for( j = 0; j + 4 <= outwidth; j += 4 )
+	{
+		a = _mm_setr_epi32( R_LoadPixel32( inrow + p1[j] ), R_LoadPixel32( inrow + p1[j+1] ),
+			R_LoadPixel32( inrow + p1[j+2] ), R_LoadPixel32( inrow + p1[j+3] ) );
+		b = _mm_setr_epi32( R_LoadPixel32( inrow + p2[j] ), R_LoadPixel32( inrow + p2[j+1] ),
+			R_LoadPixel32( inrow + p2[j+2] ), R_LoadPixel32( inrow + p2[j+3] ) );
+		c = _mm_setr_epi32( R_LoadPixel32( inrow2 + p1[j] ), R_LoadPixel32( inrow2 + p1[j+1] ),
+			R_LoadPixel32( inrow2 + p1[j+2] ), R_LoadPixel32( inrow2 + p1[j+3] ) );
+		d = _mm_setr_epi32( R_LoadPixel32( inrow2 + p2[j] ), R_LoadPixel32( inrow2 + p2[j+1] ),
+			R_LoadPixel32( inrow2 + p2[j+2] ), R_LoadPixel32( inrow2 + p2[j+3] ) );
+		_mm_storeu_si128( ( __m128i * )( out + j * 4 ), R_Average4_SSE2( a, b, c, d ) );
+	}
+
+	return j;
+}
+
+/*
+* R_MipMapRow_SSE2
+*
+* Returns the number of input pixels consumed, the caller finishes the row
+*/
+static int R_MipMapRow_SSE2( const qbyte *in, const qbyte *in2, qbyte *out, int width, int samples )
+{
+	int j;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lomask = _mm_set1_epi16( 0xff );
+	__m128i a0, a1, b0, b1, lo, hi;
+
+	switch( samples )
+	{
+		case 4:
+			for( j = 0; j + 8 <= width; j += 8, in += 32, in2 += 32, out += 16 )
+			{
+				__m128 f0, f1, g0, g1;
+
+				f0 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )in ) );
+				f1 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )( in + 16 ) ) );
+				g0 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )in2 ) );
+				g1 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )( in2 + 16 ) ) );
+
+				// even and odd pixels of both rows
+				a0 = _mm_castps_si128( _mm_shuffle_ps( f0, f1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+				a1 = _mm_castps_si128( _mm_shuffle_ps( f0, f1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+				b0 = _mm_castps_si128( _mm_shuffle_ps( g0, g1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+				b1 = _mm_castps_si128( _mm_shuffle_ps( g0, g1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+				_mm_storeu_si128( ( __m128i * )out, R_Average4_SSE2( a0, a1, b0, b1 ) );
+			}
+			return j;
+		case 3:
+			// two output pixels from 14 bytes of each row, the last two bytes are discarded
+			for( j = 0; j * 3 + 14 <= width * 3; j += 4, in += 12, in2 += 12, out += 6 )
+			{
+				a0 = _mm_add_epi16( _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i * )in ), zero ),
+					_mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i * )in2 ), zero ) );
+				a1 = _mm_add_epi16( _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i * )( in + 6 ) ), zero ),
+					_mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i * )( in2 + 6 ) ), zero ) );
+				a0 = _mm_srli_epi16( _mm_add_epi16( a0, _mm_srli_si128( a0, 6 ) ), 2 );
+				a1 = _mm_srli_epi16( _mm_add_epi16( a1, _mm_srli_si128( a1, 6 ) ), 2 );
+				lo = _mm_or_si128( _mm_and_si128( a0, _mm_setr_epi16( -1, -1, -1, 0, 0, 0, 0, 0 ) ),
+					_mm_slli_si128( a1, 6 ) );
+				lo = _mm_packus_epi16( lo, zero );
+				*( int * )out = _mm_cvtsi128_si32( lo );
+				*( unsigned short * )( out + 4 ) = ( unsigned short )_mm_extract_epi16( lo, 2 );
+			}
+			return j;
+		case 1:
+			for( j = 0; j + 32 <= width; j += 32, in += 32, in2 += 32, out += 16 )
+			{
+				a0 = _mm_loadu_si128( ( const __m128i * )in );
+				a1 = _mm_loadu_si128( ( const __m128i * )( in + 16 ) );
+				b0 = _mm_loadu_si128( ( const __m128i * )in2 );
+				b1 = _mm_loadu_si128( ( const __m128i * )( in2 + 16 ) );
+
+				lo = _mm_add_epi16( _mm_add_epi16( _mm_and_si128( a0, lomask ), _mm_srli_epi16( a0, 8 ) ),
+					_mm_add_epi16( _mm_and_si128( b0, lomask ), _mm_srli_epi16( b0, 8 ) ) );
+				hi = _mm_add_epi16( _mm_add_epi16( _mm_and_si128( a1, lomask ), _mm_srli_epi16( a1, 8 ) ),
+					_mm_add_epi16( _mm_and_si128( b1, lomask ), _mm_srli_epi16( b1, 8 ) ) );
+				_mm_storeu_si128( ( __m128i * )out, _mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) ) );
+			}
+			return j;
+		default:
+			break;
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef R_IMAGE_AVX2
+/*
+* R_Average4_AVX2
+*/
+static inline R_AVX2_FUNC __m256i R_Average4_AVX2( __m256i a, __m256i b, __m256i c, __m256i d )
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo, hi;
+
+	lo = _mm256_add_epi16( _mm256_add_epi16( _mm256_unpacklo_epi8( a, zero ), _mm256_unpacklo_epi8( b, zero ) ),
+		_mm256_add_epi16( _mm256_unpacklo_epi8( c, zero ), _mm256_unpacklo_epi8( d, zero ) ) );
+	hi = _mm256_add_epi16( _mm256_add_epi16( _mm256_unpackhi_epi8( a, zero ), _mm256_unpackhi_epi8( b, zero ) ),
+		_mm256_add_epi16( _mm256_unpackhi_epi8( c, zero ), _mm256_unpackhi_epi8( d, zero ) ) );
+	return _mm256_packus_epi16( _mm256_srli_epi16( lo, 2 ), _mm256_srli_epi16( hi, 2 ) );
+}
+
+/*
+* R_ResampleRow_AVX2
+*
+* Gathers 8 output pixels at a time, 3-byte pixels are read as dwords as long
+* as that stays inside the row
+*/
+static R_AVX2_FUNC int R_ResampleRow_AVX2( const qbyte *inrow, const qbyte *inrow2, const unsigned *p1, const unsigned *p2,
+	qbyte *out, int outwidth, int inwidthS, int samples )
+{
+	int j;
+	__m256i i1, i2, res;
+	__m128i lo, hi;
+	const __m128i pack3 = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+
+	if( samples != 4 && samples != 3 )
+		return R_ResampleRow_SSE2( inrow, inrow2, p1, p2, out, outwidth, samples );
+
+	for( j = 0; j + 8 <= outwidth; j += 8 )
+	{
+		if( samples == 3 && p2[j+7] + 4 > (unsigned)inwidthS )
+			break;
+
+		i1 = _mm256_loadu_si256( ( const __m256i * )( p1 + j ) );
+		i2 = _mm256_loadu_si256( ( const __m256i * )( p2 + j ) );
+		res = R_Average4_AVX2( _mm256_i32gather_epi32( ( const int * )inrow, i1, 1 ),
+			_mm256_i32gather_epi32( ( const int * )inrow, i2, 1 ),
+			_mm256_i32gather_epi32( ( const int * )inrow2, i1, 1 ),
+			_mm256_i32gather_epi32( ( const int * )inrow2, i2, 1 ) );
+
+		if( samples == 4 )
+		{
+			_mm256_storeu_si256( ( __m256i * )( out + j * 4 ), res );
+			continue;
+		}
+
+		lo = _mm_shuffle_epi8( _mm256_castsi256_si128( res ), pack3 );
+		hi = _mm_shuffle_epi8( _mm256_extracti128_si256( res, 1 ), pack3 );
+		_mm_storel_epi64( ( __m128i * )( out + j * 3 ), lo );
+		*( int * )( out + j * 3 + 8 ) = _mm_cvtsi128_si32( _mm_srli_si128( lo, 8 ) );
+		_mm_storel_epi64( ( __m128i * )( out + j * 3 + 12 ), hi );
+		*( int * )( out + j * 3 + 20 ) = _mm_cvtsi128_si32( _mm_srli_si128( hi, 8 ) );
+	}
+
+	if( samples == 4 )
+		j += R_ResampleRow_SSE2( inrow, inrow2, p1 + j, p2 + j, out + j * 4, outwidth - j, samples );
+	return j;
+}
+
+/*
+* R_MipMapRow_AVX2
+*/
+static R_AVX2_FUNC int R_MipMapRow_AVX2( const qbyte *in, const qbyte *in2, qbyte *out, int width, int samples )
+{
+	int j;
+	__m256 f0, f1, g0, g1;
+	__m256i res;
+
+	if( samples != 4 )
+		return R_MipMapRow_SSE2( in, in2, out, width, samples );
+
+	for( j = 0; j + 16 <= width; j += 16, in += 64, in2 += 64, out += 32 )
+	{
+		f0 = _mm256_castsi256_ps( _mm256_loadu_si256( ( const __m256i * )in ) );
+		f1 = _mm256_castsi256_ps( _mm256_loadu_si256( ( const __m256i * )( in + 32 ) ) );
+		g0 = _mm256_castsi256_ps( _mm256_loadu_si256( ( const __m256i * )in2 ) );
+		g1 = _mm256_castsi256_ps( _mm256_loadu_si256( ( const __m256i * )( in2 + 32 ) ) );
+
+		res = R_Average4_AVX2( _mm256_castps_si256( _mm256_shuffle_ps( f0, f1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ),
+			_mm256_castps_si256( _mm256_shuffle_ps( f0, f1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ),
+			_mm256_castps_si256( _mm256_shuffle_ps( g0, g1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ),
+			_mm256_castps_si256( _mm256_shuffle_ps( g0, g1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ) );
+
+		// shuffles work within 128-bit lanes, put the 64-bit pairs back in order
+		_mm256_storeu_si256( ( __m256i * )out, _mm256_permute4x64_epi64( res, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+	}
+
+	return j + R_MipMapRow_SSE2( in, in2, out, width - j, samples );
+}
+#endif
+
+/*
+* R_ResampleImage
+*
+* lines must hold outwidth * 2 offsets, it's not used when the size doesn't change
+*/
+void R_ResampleImage( const qbyte *in, int inwidth, int inheight, qbyte *out, 
+	int outwidth, int outheight, int samples, unsigned *lines, unsigned int cpuFeatures )
+{
+	int i, j, k;
+	int inwidthS, outwidthS;
+	unsigned int frac, fracstep;
+	const qbyte *inrow, *inrow2, *pix1, *pix2, *pix3, *pix4;
+	unsigned *p1, *p2;
+	qbyte *opix;
+
+	if( inwidth == outwidth && inheight == outheight )
+	{
+		memcpy( out, in, inwidth * inheight * samples );
+		return;
+	}
+
+	p1 = lines;
+	p2 = p1 + outwidth;
+
+	fracstep = inwidth * 0x10000 / outwidth;
+
+	frac = fracstep >> 2;
+	for( i = 0; i < outwidth; i++ )
+	{
+		p1[i] = samples * ( frac >> 16 );
+		frac += fracstep;
+	}
+
+	frac = 3 * ( fracstep >> 2 );
+	for( i = 0; i < outwidth; i++ )
+	{
+		p2[i] = samples * ( frac >> 16 );
+		frac += fracstep;
+	}
+
+	inwidthS = inwidth * samples;
+	outwidthS = outwidth * samples;
+	for( i = 0; i < outheight; i++, out += outwidthS )
+	{
+		inrow = in + inwidthS * (int)( ( i + 0.25 ) * inheight / outheight );
+		inrow2 = in + inwidthS * (int)( ( i + 0.75 ) * inheight / outheight );
+
+		j = 0;
+#ifdef R_IMAGE_AVX2
+		if( cpuFeatures & QCPU_HAS_AVX2 )
+			j = R_ResampleRow_AVX2( inrow, inrow2, p1, p2, out, outwidth, inwidthS, samples );
+		else
+#endif
+#ifdef R_IMAGE_SSE
+		if( cpuFeatures & QCPU_HAS_SSE2 )
+			j = R_ResampleRow_SSE2( inrow, inrow2, p1, p2, out, outwidth, samples );
+#endif
+
+		for( ; j < outwidth; j++ )
+		{
+			pix1 = inrow + p1[j];
+			pix2 = inrow + p2[j];
+			pix3 = inrow2 + p1[j];
+			pix4 = inrow2 + p2[j];
+			opix = out + j * samples;
+
+			for( k = 0; k < samples; k++ )
+				opix[k] = ( pix1[k] + pix2[k] + pix3[k] + pix4[k] ) >> 2;
+		}
+	}
+}
+
+/*
+* R_MipMapImage
+* 
+* Operates in place, quartering the size of the texture
+* note: if given odd width/height this discards the last row/column of
+* pixels, rather than doing a proper box-filter scale down (LordHavoc)
+*/
+void R_MipMapImage( qbyte *in, int width, int height, int samples, unsigned int cpuFeatures )
+{
+	int i, j, k, samples2;
+	qbyte *out;
+#ifdef R_IMAGE_SSE
+	int simd, pixels = width;
+#endif
+
+	// width <<= 2;
+	width *= samples;
+	height >>= 1;
+	samples2 = samples << 1;
+
+
+	out = in;
+	for( i = 0; i < height; i++, in += width )
+	{
+		j = 0;
+#ifdef R_IMAGE_SSE
+		// odd widths make the C loop below walk into the next row, leave them alone
+		if( !( pixels & 1 ) && ( cpuFeatures & ( QCPU_HAS_SSE2|QCPU_HAS_AVX2 ) ) )
+		{
+# ifdef R_IMAGE_AVX2
+			if( cpuFeatures & QCPU_HAS_AVX2 )
+				simd = R_MipMapRow_AVX2( in, in + width, out, pixels, samples );
+			else
+# endif
+				simd = R_MipMapRow_SSE2( in, in + width, out, pixels, samples );
+			j = simd * samples;
+			in += j;
+			out += j >> 1;
+		}
+#endif
+
+		for( ; j < width; j += samples2, out += samples, in += samples2 )
+		{
+			for( k = 0; k < samples; k++ )
+				out[k] = ( in[k] + in[k+samples] + in[width+k] + in[width+k+samples] )>>2;
+		}
+	}
+}
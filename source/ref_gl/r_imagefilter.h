@@ -0,0 +1,29 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#ifndef R_IMAGEFILTER_H
+#define R_IMAGEFILTER_H
+
+// cpuFeatures are QCPU_HAS_* flags, the SIMD paths produce the same bytes as the C code
+
+void R_ResampleImage( const qbyte *in, int inwidth, int inheight, qbyte *out, 
+	int outwidth, int outheight, int samples, unsigned *lines, unsigned int cpuFeatures );
+void R_MipMapImage( qbyte *in, int width, int height, int samples, unsigned int cpuFeatures );
+
+#endif // R_IMAGEFILTER_H
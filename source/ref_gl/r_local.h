@@ -394,6 +394,10 @@ extern cvar_t *r_floorcolor;
 extern cvar_t *r_maxglslbones;
 
 extern cvar_t *r_multithreading;
+extern cvar_t *r_skeletal_threads;
+extern cvar_t *r_image_threads;
+extern cvar_t *r_image_cache;
+extern cvar_t *r_image_cache_size;
 
 extern cvar_t *gl_finish;
 extern cvar_t *gl_cull;
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define R_MODEL_H
 
 #include "r_surface.h"
+#include "r_skinning.h"
 
 /*
 
@@ -275,11 +276,6 @@ SKELETAL MODELS
 ==============================================================================
 */
 
-//
-// in memory representation
-//
-#define SKM_MAX_WEIGHTS		4
-
 //
 // in memory representation
 //
@@ -289,12 +285,6 @@ typedef struct
 	shader_t		*shader;
 } mskskin_t;
 
-typedef struct
-{
-	qbyte			indices[SKM_MAX_WEIGHTS];
-	qbyte			weights[SKM_MAX_WEIGHTS];
-} mskblend_t;
-
 typedef struct mskmesh_s
 {
 	char			*name;
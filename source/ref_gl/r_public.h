@@ -22,7 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../cgame/ref.h"
 
-#define REF_API_VERSION 4
+#define REF_API_VERSION 6
 
 struct mempool_s;
 struct cinematics_s;
@@ -30,6 +30,7 @@ struct cinematics_s;
 typedef struct qthread_s qthread_t;
 typedef struct qmutex_s qmutex_t;
 typedef struct qbufQueue_s qbufQueue_t;
+typedef struct qthreadpool_s qthreadpool_t;
 
 //
 // these are the functions exported by the refresh module
@@ -64,6 +65,8 @@ typedef struct
 	quint64 ( *Sys_Microseconds )( void );
 	void ( *Sys_Sleep )( unsigned int milliseconds );
 
+	unsigned int ( *COM_CPUFeatures )( void );
+
 	int ( *FS_FOpenFile )( const char *filename, int *filenum, int mode );
 	int ( *FS_FOpenAbsoluteFile )( const char *filename, int *filenum, int mode );
 	int ( *FS_Read )( void *buffer, size_t len, int file );
@@ -116,6 +119,11 @@ typedef struct
 	void ( *BufQueue_Finish )( qbufQueue_t *queue );
 	void ( *BufQueue_EnqueueCmd )( qbufQueue_t *queue, const void *cmd, unsigned cmd_size );
 	int ( *BufQueue_ReadCmds )( qbufQueue_t *queue, unsigned (**cmdHandlers)( const void * ) );
+
+	qthreadpool_t *( *ThreadPool_Create )( int numThreads );
+	void ( *ThreadPool_Destroy )( qthreadpool_t **ppool );
+	int ( *ThreadPool_NumThreads )( const qthreadpool_t *pool );
+	void ( *ThreadPool_Run )( qthreadpool_t *pool, void (*job)( void *, int ), void *param, int numJobs );
 } ref_import_t;
 
 typedef struct
@@ -122,6 +122,10 @@ cvar_t *gl_driver;
 cvar_t *gl_finish;
 cvar_t *gl_cull;
 cvar_t *r_multithreading;
+cvar_t *r_skeletal_threads;
+cvar_t *r_image_threads;
+cvar_t *r_image_cache;
+cvar_t *r_image_cache_size;
 
 static qboolean	r_verbose;
 
@@ -1021,6 +1025,10 @@ static void R_Register( const char *screenshotsPrefix )
 	r_maxglslbones = ri.Cvar_Get( "r_maxglslbones", STR_TOSTR( MAX_GLSL_UNIFORM_BONES ), CVAR_LATCH_VIDEO );
 
 	r_multithreading = ri.Cvar_Get( "r_multithreading", "0", CVAR_ARCHIVE|CVAR_LATCH_VIDEO );
+	r_skeletal_threads = ri.Cvar_Get( "r_skeletal_threads", "2", CVAR_ARCHIVE|CVAR_LATCH_VIDEO );
+	r_image_threads = ri.Cvar_Get( "r_image_threads", "2", CVAR_ARCHIVE|CVAR_LATCH_VIDEO );
+	r_image_cache = ri.Cvar_Get( "r_image_cache", "1", CVAR_ARCHIVE );
+	r_image_cache_size = ri.Cvar_Get( "r_image_cache_size", "256", CVAR_ARCHIVE );
 
 	gl_finish = ri.Cvar_Get( "gl_finish", "0", CVAR_ARCHIVE );
 	gl_cull = ri.Cvar_Get( "gl_cull", "1", 0 );
@@ -0,0 +1,278 @@
+/*
+Copyright (C) 2002-2011 Victor Luchits
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// r_skinning.c -- CPU skinning of skeletal models
+// kept free of GL and the refresh imports, so that ref_gl/test can link it as is
+
+#include "../gameshared/q_arch.h"
+#include "r_math.h"
+#include "r_skinning.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# define R_SKINNING_SSE
+# include <emmintrin.h>
+#endif
+
+// set the FP precision to fast
+#if defined ( _WIN32 ) && ( _MSC_VER >= 1400 ) && defined( NDEBUG )
+# pragma float_control(except, off, push)
+# pragma float_control(precise, off, push)
+# pragma fp_contract(on)		// this line is needed on Itanium processors
+#endif
+
+#ifdef R_SKINNING_SSE
+/*
+* R_SkeletalBlendPoses_SSE2
+*/
+static void R_SkeletalBlendPoses_SSE2( unsigned int numblends, const mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose )
+{
+	unsigned int i, j, k;
+	float *pose, *b, f;
+	const mskblend_t *blend;
+	__m128 w, r0, r1, r2, r3;
+
+	for( i = 0, j = numbones, blend = blends; i < numblends; i++, j++, blend++ ) {
+		pose = relbonepose[j];
+
+		b = relbonepose[blend->indices[0]];
+		f = blend->weights[0] * (1.0 / 255.0);
+
+		// the w column is blended too, nothing reads it
+		w = _mm_set1_ps( f );
+		r0 = _mm_mul_ps( w, _mm_loadu_ps( b + 0 ) );
+		r1 = _mm_mul_ps( w, _mm_loadu_ps( b + 4 ) );
+		r2 = _mm_mul_ps( w, _mm_loadu_ps( b + 8 ) );
+		r3 = _mm_mul_ps( w, _mm_loadu_ps( b + 12 ) );
+
+		for( k = 1; k < SKM_MAX_WEIGHTS && blend->weights[k]; k++ ) {
+			b = relbonepose[blend->indices[k]];
+			f = blend->weights[k] * (1.0 / 255.0);
+
+			w = _mm_set1_ps( f );
+			r0 = _mm_add_ps( r0, _mm_mul_ps( w, _mm_loadu_ps( b + 0 ) ) );
+			r1 = _mm_add_ps( r1, _mm_mul_ps( w, _mm_loadu_ps( b + 4 ) ) );
+			r2 = _mm_add_ps( r2, _mm_mul_ps( w, _mm_loadu_ps( b + 8 ) ) );
+			r3 = _mm_add_ps( r3, _mm_mul_ps( w, _mm_loadu_ps( b + 12 ) ) );
+		}
+
+		_mm_storeu_ps( pose + 0, r0 );
+		_mm_storeu_ps( pose + 4, r1 );
+		_mm_storeu_ps( pose + 8, r2 );
+		_mm_storeu_ps( pose + 12, r3 );
+	}
+}
+
+/*
+* R_SkeletalTransformVector
+*
+* Rotates the xyz of v by the pose, in the same order of operations as
+* the plain C version, so the results are identical
+*/
+static inline __m128 R_SkeletalTransformVector( const float *pose, const float *v )
+{
+	__m128 r;
+
+	r = _mm_mul_ps( _mm_set1_ps( v[0] ), _mm_loadu_ps( pose + 0 ) );
+	r = _mm_add_ps( r, _mm_mul_ps( _mm_set1_ps( v[1] ), _mm_loadu_ps( pose + 4 ) ) );
+	r = _mm_add_ps( r, _mm_mul_ps( _mm_set1_ps( v[2] ), _mm_loadu_ps( pose + 8 ) ) );
+	return r;
+}
+
+#define R_SKM_XYZMASK		_mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) )
+#define R_SKM_WMASK			_mm_castsi128_ps( _mm_set_epi32( -1, 0, 0, 0 ) )
+
+/*
+* R_SkeletalTransformVerts_SSE2
+*/
+static void R_SkeletalTransformVerts_SSE2( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+{
+	const float *pose;
+	__m128 r, xyzmask = R_SKM_XYZMASK, one = _mm_set_ps( 1, 0, 0, 0 );
+
+	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		r = _mm_add_ps( R_SkeletalTransformVector( pose, v ), _mm_loadu_ps( pose + 12 ) );
+		_mm_storeu_ps( ov, _mm_or_ps( _mm_and_ps( r, xyzmask ), one ) );
+	}
+}
+
+/*
+* R_SkeletalTransformNormals_SSE2
+*/
+static void R_SkeletalTransformNormals_SSE2( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+{
+	const float *pose;
+	__m128 xyzmask = R_SKM_XYZMASK;
+
+	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		_mm_storeu_ps( ov, _mm_and_ps( R_SkeletalTransformVector( pose, v ), xyzmask ) );
+	}
+}
+
+/*
+* R_SkeletalTransformNormalsAndSVecs_SSE2
+*/
+static void R_SkeletalTransformNormalsAndSVecs_SSE2( int numverts, const unsigned int *blends, mat4_t *relbonepose,
+	const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv )
+{
+	const float *pose;
+	__m128 xyzmask = R_SKM_XYZMASK, wmask = R_SKM_WMASK;
+
+	for( ; numverts; numverts--, v += 4, ov += 4, sv += 4, osv += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		_mm_storeu_ps( ov, _mm_and_ps( R_SkeletalTransformVector( pose, v ), xyzmask ) );
+		_mm_storeu_ps( osv, _mm_or_ps( _mm_and_ps( R_SkeletalTransformVector( pose, sv ), xyzmask ),
+			_mm_and_ps( _mm_loadu_ps( sv ), wmask ) ) );
+	}
+}
+#endif
+
+/*
+* R_SkeletalBlendPoses
+*
+* Writes the numblends weighted combinations of the first numbones poses right after them
+*/
+void R_SkeletalBlendPoses( unsigned int numblends, const mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose,
+	unsigned int cpuFeatures )
+{
+	unsigned int i, j, k;
+	float *pose, *b, f;
+	const mskblend_t *blend;
+
+#ifdef R_SKINNING_SSE
+	if( cpuFeatures & QCPU_HAS_SSE2 ) {
+		R_SkeletalBlendPoses_SSE2( numblends, blends, numbones, relbonepose );
+		return;
+	}
+#endif
+
+	for( i = 0, j = numbones, blend = blends; i < numblends; i++, j++, blend++ ) {
+		pose = relbonepose[j];
+
+		b = relbonepose[blend->indices[0]];
+		f = blend->weights[0] * (1.0 / 255.0);
+
+		pose[ 0] = f * b[ 0]; pose[ 1] = f * b[ 1]; pose[ 2] = f * b[ 2];
+		pose[ 4] = f * b[ 4]; pose[ 5] = f * b[ 5]; pose[ 6] = f * b[ 6];
+		pose[ 8] = f * b[ 8]; pose[ 9] = f * b[ 9]; pose[10] = f * b[10];
+		pose[12] = f * b[12]; pose[13] = f * b[13]; pose[14] = f * b[14];
+
+		for( k = 1; k < SKM_MAX_WEIGHTS && blend->weights[k]; k++ ) {
+			b = relbonepose[blend->indices[k]];
+			f = blend->weights[k] * (1.0 / 255.0);
+
+			pose[ 0] += f * b[ 0]; pose[ 1] += f * b[ 1]; pose[ 2] += f * b[ 2];
+			pose[ 4] += f * b[ 4]; pose[ 5] += f * b[ 5]; pose[ 6] += f * b[ 6];
+			pose[ 8] += f * b[ 8]; pose[ 9] += f * b[ 9]; pose[10] += f * b[10];
+			pose[12] += f * b[12]; pose[13] += f * b[13]; pose[14] += f * b[14];
+		}
+	}
+}
+
+/*
+* R_SkeletalTransformVerts
+*/
+void R_SkeletalTransformVerts( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov,
+	unsigned int cpuFeatures )
+{
+	const float *pose;
+
+#ifdef R_SKINNING_SSE
+	if( cpuFeatures & QCPU_HAS_SSE2 ) {
+		R_SkeletalTransformVerts_SSE2( numverts, blends, relbonepose, v, ov );
+		return;
+	}
+#endif
+
+	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		ov[0] = v[0] * pose[0] + v[1] * pose[4] + v[2] * pose[ 8] + pose[12];
+		ov[1] = v[0] * pose[1] + v[1] * pose[5] + v[2] * pose[ 9] + pose[13];
+		ov[2] = v[0] * pose[2] + v[1] * pose[6] + v[2] * pose[10] + pose[14];
+		ov[3] = 1;
+	}
+}
+
+/*
+* R_SkeletalTransformNormals
+*/
+void R_SkeletalTransformNormals( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov,
+	unsigned int cpuFeatures )
+{
+	const float *pose;
+
+#ifdef R_SKINNING_SSE
+	if( cpuFeatures & QCPU_HAS_SSE2 ) {
+		R_SkeletalTransformNormals_SSE2( numverts, blends, relbonepose, v, ov );
+		return;
+	}
+#endif
+
+	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		ov[0] = v[0] * pose[0] + v[1] * pose[4] + v[2] * pose[ 8];
+		ov[1] = v[0] * pose[1] + v[1] * pose[5] + v[2] * pose[ 9];
+		ov[2] = v[0] * pose[2] + v[1] * pose[6] + v[2] * pose[10];
+		ov[3] = 0;
+	}
+}
+
+/*
+* R_SkeletalTransformNormalsAndSVecs
+*/
+void R_SkeletalTransformNormalsAndSVecs( int numverts, const unsigned int *blends, mat4_t *relbonepose,
+	const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv, unsigned int cpuFeatures )
+{
+	const float *pose;
+
+#ifdef R_SKINNING_SSE
+	if( cpuFeatures & QCPU_HAS_SSE2 ) {
+		R_SkeletalTransformNormalsAndSVecs_SSE2( numverts, blends, relbonepose, v, ov, sv, osv );
+		return;
+	}
+#endif
+
+	for( ; numverts; numverts--, v += 4, ov += 4, sv += 4, osv += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		ov[0] = v[0] * pose[0] + v[1] * pose[4] + v[2] * pose[ 8];
+		ov[1] = v[0] * pose[1] + v[1] * pose[5] + v[2] * pose[ 9];
+		ov[2] = v[0] * pose[2] + v[1] * pose[6] + v[2] * pose[10];
+		ov[3] = 0;
+
+		osv[0] = sv[0] * pose[0] + sv[1] * pose[4] + sv[2] * pose[ 8];
+		osv[1] = sv[0] * pose[1] + sv[1] * pose[5] + sv[2] * pose[ 9];
+		osv[2] = sv[0] * pose[2] + sv[1] * pose[6] + sv[2] * pose[10];
+		osv[3] = sv[3];
+	}
+}
+
+// set the FP precision back to whatever value it was
+#if defined ( _WIN32 ) && ( _MSC_VER >= 1400 ) && defined( NDEBUG )
+# pragma float_control(pop)
+# pragma float_control(pop)
+# pragma fp_contract(off)	// this line is needed on Itanium processors
+#endif
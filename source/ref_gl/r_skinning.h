@@ -0,0 +1,44 @@
+/*
+Copyright (C) 2002-2011 Victor Luchits
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef R_SKINNING_H
+#define R_SKINNING_H
+
+#define SKM_MAX_WEIGHTS		4
+
+typedef struct
+{
+	qbyte			indices[SKM_MAX_WEIGHTS];
+	qbyte			weights[SKM_MAX_WEIGHTS];
+} mskblend_t;
+
+// cpuFeatures are QCPU_HAS_* flags, the SSE2 paths produce the same bytes as the C code,
+// except for the w column of the blended poses which only the SSE2 path writes
+
+void R_SkeletalBlendPoses( unsigned int numblends, const mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose,
+	unsigned int cpuFeatures );
+void R_SkeletalTransformVerts( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov,
+	unsigned int cpuFeatures );
+void R_SkeletalTransformNormals( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov,
+	unsigned int cpuFeatures );
+void R_SkeletalTransformNormalsAndSVecs( int numverts, const unsigned int *blends, mat4_t *relbonepose,
+	const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv, unsigned int cpuFeatures );
+
+#endif // R_SKINNING_H
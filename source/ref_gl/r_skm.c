@@ -896,12 +896,16 @@ static float R_SkeletalModelLerpBBox( const entity_t *e, const model_t *mod, vec
 typedef struct skmcacheentry_s
 {
 	size_t size;
+	size_t used;				// size requested by the current owner, the rest is stale
 	qbyte *data;
 	struct skmcacheentry_s *next;
 } skmcacheentry_t;
 
 mempool_t *r_skmcachepool;
 
+static qthreadpool_t *r_skmthreadpool;		// splits the CPU skinning of large meshes
+static unsigned int r_skmCPUFeatures;
+
 static skmcacheentry_t *r_skmcache_head;	// actual entries are linked to this
 static skmcacheentry_t *r_skmcache_free;	// actual entries are linked to this
 static skmcacheentry_t *r_skmcachekeys[MAX_ENTITIES*(MOD_MAX_LODS+1)];		// entities linked to cache entries
@@ -917,12 +921,17 @@ void R_InitSkeletalCache( void )
 
 	r_skmcache_head = NULL;
 	r_skmcache_free = NULL;
+
+	r_skmthreadpool = ri.ThreadPool_Create( r_skeletal_threads->integer );
+	r_skmCPUFeatures = ri.COM_CPUFeatures();
 }
 
 /*
-* R_SkeletalModelLerpBBox
+* R_GetSketalCache
+*
+* Returns the size requested when the chunk was allocated, not its capacity
 */
-static qbyte *R_GetSketalCache( int entNum, int lodNum )
+static qbyte *R_GetSketalCache( int entNum, int lodNum, size_t *size )
 {
 	skmcacheentry_t *cache;
 	
@@ -930,6 +939,7 @@ static qbyte *R_GetSketalCache( int entNum, int lodNum )
 	if( !cache ) {
 		return NULL;
 	}
+	*size = cache->used;
 	return cache->data;
 }
 
@@ -984,6 +994,7 @@ static qbyte *R_AllocSkeletalDataCache( int entNum, int lodNum, size_t size )
 	}
 
 	assert( best->size >= size );
+	best->used = size;
 
 	// unlink this cache entry from the current list
 	if( best_prev ) {
@@ -1037,116 +1048,77 @@ void R_ShutdownSkeletalCache( void )
 
 	r_skmcache_head = NULL;
 	r_skmcache_free = NULL;
+
+	ri.ThreadPool_Destroy( &r_skmthreadpool );
 }
 
 //=======================================================================
 
-// set the FP precision to fast
-#if defined ( _WIN32 ) && ( _MSC_VER >= 1400 ) && defined( NDEBUG )
-# pragma float_control(except, off, push)
-# pragma float_control(precise, off, push)
-# pragma fp_contract(on)		// this line is needed on Itanium processors
-#endif
+#define SKM_MIN_JOB_VERTS		1024		// don't split the skinning into smaller pieces than this
 
-/*
-* R_SkeletalBlendPoses
-*/
-static void R_SkeletalBlendPoses( unsigned int numblends, mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose )
+typedef struct
 {
-	unsigned int i, j, k;
-	float *pose;
-	mskblend_t *blend;
-
-	for( i = 0, j = numbones, blend = blends; i < numblends; i++, j++, blend++ ) {
-		float *b, f;
-
-		pose = relbonepose[j];
-
-		b = relbonepose[blend->indices[0]];
-		f = blend->weights[0] * (1.0 / 255.0);
-
-		pose[ 0] = f * b[ 0]; pose[ 1] = f * b[ 1]; pose[ 2] = f * b[ 2];
-		pose[ 4] = f * b[ 4]; pose[ 5] = f * b[ 5]; pose[ 6] = f * b[ 6];
-		pose[ 8] = f * b[ 8]; pose[ 9] = f * b[ 9]; pose[10] = f * b[10];
-		pose[12] = f * b[12]; pose[13] = f * b[13]; pose[14] = f * b[14];
-
-		for( k = 1; k < SKM_MAX_WEIGHTS && blend->weights[k]; k++ ) {
-			b = relbonepose[blend->indices[k]];
-			f = blend->weights[k] * (1.0 / 255.0);
-
-			pose[ 0] += f * b[ 0]; pose[ 1] += f * b[ 1]; pose[ 2] += f * b[ 2];
-			pose[ 4] += f * b[ 4]; pose[ 5] += f * b[ 5]; pose[ 6] += f * b[ 6];
-			pose[ 8] += f * b[ 8]; pose[ 9] += f * b[ 9]; pose[10] += f * b[10];
-			pose[12] += f * b[12]; pose[13] += f * b[13]; pose[14] += f * b[14];
-		}
-	}
-}
+	const mskmesh_t *mesh;
+	mat4_t *relbonepose;
+	vattribmask_t vattribs;
+	vec4_t *xyzArray;
+	vec4_t *normalsArray;
+	vec4_t *sVectorsArray;
+	int jobVerts;
+} skmtransformjob_t;
 
 /*
-* R_SkeletalTransformVerts
+* R_SkeletalTransformJob
 */
-static void R_SkeletalTransformVerts( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+static void R_SkeletalTransformJob( void *param, int index )
 {
-	const float *pose;
-
-	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
-		pose = relbonepose[*blends];
-
-		ov[0] = v[0] * pose[0] + v[1] * pose[4] + v[2] * pose[ 8] + pose[12];
-		ov[1] = v[0] * pose[1] + v[1] * pose[5] + v[2] * pose[ 9] + pose[13];
-		ov[2] = v[0] * pose[2] + v[1] * pose[6] + v[2] * pose[10] + pose[14];
-		ov[3] = 1;
+	const skmtransformjob_t *job = ( const skmtransformjob_t * )param;
+	const mskmesh_t *skmesh = job->mesh;
+	int first = index * job->jobVerts;
+	int numverts = min( job->jobVerts, (int)skmesh->numverts - first );
+
+	R_SkeletalTransformVerts( numverts, skmesh->vertexBlends + first, job->relbonepose,
+		( vec_t * )skmesh->xyzArray[first], ( vec_t * )job->xyzArray[first], r_skmCPUFeatures );
+
+	if( job->vattribs & VATTRIB_SVECTOR_BIT ) {
+		R_SkeletalTransformNormalsAndSVecs( numverts, skmesh->vertexBlends + first, job->relbonepose,
+			( vec_t * )skmesh->normalsArray[first], ( vec_t * )job->normalsArray[first],
+			( vec_t * )skmesh->sVectorsArray[first], ( vec_t * )job->sVectorsArray[first], r_skmCPUFeatures );
+	} else if( job->vattribs & VATTRIB_NORMAL_BIT ) {
+		R_SkeletalTransformNormals( numverts, skmesh->vertexBlends + first, job->relbonepose,
+			( vec_t * )skmesh->normalsArray[first], ( vec_t * )job->normalsArray[first], r_skmCPUFeatures );
 	}
 }
 
 /*
-* R_SkeletalTransformNormals
+* R_SkeletalTransformMesh
+* 
+* Large meshes are split between the skinning threads
 */
-static void R_SkeletalTransformNormals( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+static void R_SkeletalTransformMesh( const mskmesh_t *skmesh, mat4_t *relbonepose, vattribmask_t vattribs,
+	vec4_t *xyzArray, vec4_t *normalsArray, vec4_t *sVectorsArray )
 {
-	const float *pose;
-
-	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
-		pose = relbonepose[*blends];
-
-		ov[0] = v[0] * pose[0] + v[1] * pose[4] + v[2] * pose[ 8];
-		ov[1] = v[0] * pose[1] + v[1] * pose[5] + v[2] * pose[ 9];
-		ov[2] = v[0] * pose[2] + v[1] * pose[6] + v[2] * pose[10];
-		ov[3] = 0;
+	int numJobs;
+	skmtransformjob_t job;
+
+	job.mesh = skmesh;
+	job.relbonepose = relbonepose;
+	job.vattribs = vattribs;
+	job.xyzArray = xyzArray;
+	job.normalsArray = normalsArray;
+	job.sVectorsArray = sVectorsArray;
+
+	numJobs = min( ri.ThreadPool_NumThreads( r_skmthreadpool ), (int)skmesh->numverts / SKM_MIN_JOB_VERTS );
+	if( numJobs <= 1 ) {
+		job.jobVerts = skmesh->numverts;
+		R_SkeletalTransformJob( &job, 0 );
+		return;
 	}
-}
-
-/*
-* R_SkeletalTransformNormalsAndSVecs
-*/
-static void R_SkeletalTransformNormalsAndSVecs( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv )
-{
-	const float *pose;
-
-	for( ; numverts; numverts--, v += 4, ov += 4, sv += 4, osv += 4, blends++ ) {
-		pose = relbonepose[*blends];
 
-		ov[0] = v[0] * pose[0] + v[1] * pose[4] + v[2] * pose[ 8];
-		ov[1] = v[0] * pose[1] + v[1] * pose[5] + v[2] * pose[ 9];
-		ov[2] = v[0] * pose[2] + v[1] * pose[6] + v[2] * pose[10];
-		ov[3] = 0;
-
-		osv[0] = sv[0] * pose[0] + sv[1] * pose[4] + sv[2] * pose[ 8];
-		osv[1] = sv[0] * pose[1] + sv[1] * pose[5] + sv[2] * pose[ 9];
-		osv[2] = sv[0] * pose[2] + sv[1] * pose[6] + sv[2] * pose[10];
-		osv[3] = sv[3];
-	}
+	job.jobVerts = ( skmesh->numverts + numJobs - 1 ) / numJobs;
+	ri.ThreadPool_Run( r_skmthreadpool, R_SkeletalTransformJob, &job, numJobs );
 }
 
-// set the FP precision back to whatever value it was
-#if defined ( _WIN32 ) && ( _MSC_VER >= 1400 ) && defined( NDEBUG )
-# pragma float_control(pop)
-# pragma float_control(pop)
-# pragma fp_contract(off)	// this line is needed on Itanium processors
-#endif
-
-//=======================================================================
-
 /*
 * R_DrawSkeletalSurf
 */
@@ -1164,6 +1136,10 @@ qboolean R_DrawSkeletalSurf( const entity_t *e, const shader_t *shader, const mf
 	mat4_t *bonePoseRelativeMat;
 	dualquat_t *bonePoseRelativeDQ;
 	size_t bonePoseRelativeMatSize, bonePoseRelativeDQSize;
+	size_t meshAttribsSize, vertsCacheSize, cacheSize;
+	vattribmask_t *meshAttribs, skinAttribs;
+	vec4_t *xyzCache, *normalsCache, *sVectorsCache;
+	unsigned int meshVertsOffset;
 	const model_t *mod = drawSurf->model;
 	const mskmodel_t *skmodel = ( const mskmodel_t * )mod->extradata;
 	const mskmesh_t *skmesh = drawSurf->mesh;
@@ -1226,10 +1202,24 @@ qboolean R_DrawSkeletalSurf( const entity_t *e, const shader_t *shader, const mf
 	bonePoseRelativeMatSize = sizeof( mat4_t ) * (skmodel->numbones + skmodel->numblends);
 	bonePoseRelativeDQSize = sizeof( dualquat_t ) * skmodel->numbones;
 
+	// with CPU transforms, the skinned vertices of every mesh are cached as well,
+	// for when the entity is drawn more than once in the frame
+	meshAttribsSize = ALIGN( sizeof( vattribmask_t ) * skmodel->nummeshes, 16 );
+	vertsCacheSize = sizeof( vec4_t ) * skmodel->numverts * 3;
+
 	// fetch bones tranforms from cache (both matrices and dual quaternions)
-	bonePoseRelativeDQ = ( dualquat_t * )R_GetSketalCache( R_ENT2NUM( e ), mod->lodnum );
+	cacheSize = 0;
+	bonePoseRelativeDQ = ( dualquat_t * )R_GetSketalCache( R_ENT2NUM( e ), mod->lodnum, &cacheSize );
 	if( bonePoseRelativeDQ ) {
 		bonePoseRelativeMat = ( mat4_t * )(( qbyte * )bonePoseRelativeDQ + bonePoseRelativeDQSize);
+
+		// a hardware skinned mesh of the same entity only generated the dual quaternions
+		if( !hardwareTransform && cacheSize < bonePoseRelativeDQSize + bonePoseRelativeMatSize + meshAttribsSize + vertsCacheSize ) {
+			for( i = 0; i < skmodel->numbones; i++ ) {
+				Matrix4_FromDualQuaternion( bonePoseRelativeDQ[i], bonePoseRelativeMat[i] );
+			}
+			R_SkeletalBlendPoses( skmodel->numblends, skmodel->blends, skmodel->numbones, bonePoseRelativeMat, r_skmCPUFeatures );
+		}
 	}
 	else {
 		// lerp boneposes and store results in cache
@@ -1291,8 +1281,15 @@ qboolean R_DrawSkeletalSurf( const entity_t *e, const shader_t *shader, const mf
 			}
 		}
 
-		bonePoseRelativeDQ = ( dualquat_t * )R_AllocSkeletalDataCache( R_ENT2NUM( e ), mod->lodnum, 
-			bonePoseRelativeDQSize + bonePoseRelativeMatSize );
+		cacheSize = bonePoseRelativeDQSize + bonePoseRelativeMatSize;
+		if( !hardwareTransform ) {
+			cacheSize += meshAttribsSize + vertsCacheSize;
+		}
+
+		bonePoseRelativeDQ = ( dualquat_t * )R_AllocSkeletalDataCache( R_ENT2NUM( e ), mod->lodnum, cacheSize );
+		if( !hardwareTransform ) {
+			memset( ( qbyte * )bonePoseRelativeDQ + bonePoseRelativeDQSize + bonePoseRelativeMatSize, 0, meshAttribsSize );
+		}
 
 		// generate dual quaternions for all bones
 		for( i = 0; i < skmodel->numbones; i++ ) {
@@ -1310,7 +1307,7 @@ qboolean R_DrawSkeletalSurf( const entity_t *e, const shader_t *shader, const mf
 			}
 
 			// generate matrices for all blend combinations
-			R_SkeletalBlendPoses( skmodel->numblends, skmodel->blends, skmodel->numbones, bonePoseRelativeMat );
+			R_SkeletalBlendPoses( skmodel->numblends, skmodel->blends, skmodel->numbones, bonePoseRelativeMat, r_skmCPUFeatures );
 		}
 	}
 
@@ -1333,16 +1330,38 @@ qboolean R_DrawSkeletalSurf( const entity_t *e, const shader_t *shader, const mf
 			return qfalse;
 		}
 
-		R_SkeletalTransformVerts( skmesh->numverts, skmesh->vertexBlends, bonePoseRelativeMat,
-			( vec_t * )skmesh->xyzArray[0], ( vec_t * )rb_mesh->xyzArray );
-
+		skinAttribs = VATTRIB_POSITION_BIT;
 		if( vattribs & VATTRIB_SVECTOR_BIT ) {
-			R_SkeletalTransformNormalsAndSVecs( skmesh->numverts, skmesh->vertexBlends, bonePoseRelativeMat,
-			( vec_t * )skmesh->normalsArray[0], ( vec_t * )rb_mesh->normalsArray,
-			( vec_t * )skmesh->sVectorsArray[0], ( vec_t * )rb_mesh->sVectorsArray );
+			skinAttribs |= VATTRIB_NORMAL_BIT|VATTRIB_SVECTOR_BIT;
 		} else if( vattribs & VATTRIB_NORMAL_BIT ) {
-			R_SkeletalTransformNormals( skmesh->numverts, skmesh->vertexBlends, bonePoseRelativeMat,
-			( vec_t * )skmesh->normalsArray[0], ( vec_t * )rb_mesh->normalsArray );
+			skinAttribs |= VATTRIB_NORMAL_BIT;
+		}
+
+		if( cacheSize >= bonePoseRelativeDQSize + bonePoseRelativeMatSize + meshAttribsSize + vertsCacheSize ) {
+			meshAttribs = ( vattribmask_t * )(( qbyte * )bonePoseRelativeMat + bonePoseRelativeMatSize);
+			meshAttribs += skmesh - skmodel->meshes;
+
+			meshVertsOffset = skmesh->xyzArray - skmodel->xyzArray;
+			xyzCache = ( vec4_t * )(( qbyte * )bonePoseRelativeMat + bonePoseRelativeMatSize + meshAttribsSize) + meshVertsOffset;
+			normalsCache = xyzCache + skmodel->numverts;
+			sVectorsCache = normalsCache + skmodel->numverts;
+
+			if( ( *meshAttribs & skinAttribs ) != skinAttribs ) {
+				R_SkeletalTransformMesh( skmesh, bonePoseRelativeMat, skinAttribs, xyzCache, normalsCache, sVectorsCache );
+				*meshAttribs |= skinAttribs;
+			}
+
+			memcpy( rb_mesh->xyzArray, xyzCache, sizeof( vec4_t ) * skmesh->numverts );
+			if( skinAttribs & VATTRIB_NORMAL_BIT ) {
+				memcpy( rb_mesh->normalsArray, normalsCache, sizeof( vec4_t ) * skmesh->numverts );
+			}
+			if( skinAttribs & VATTRIB_SVECTOR_BIT ) {
+				memcpy( rb_mesh->sVectorsArray, sVectorsCache, sizeof( vec4_t ) * skmesh->numverts );
+			}
+		}
+		else {
+			R_SkeletalTransformMesh( skmesh, bonePoseRelativeMat, skinAttribs,
+				rb_mesh->xyzArray, rb_mesh->normalsArray, rb_mesh->sVectorsArray );
 		}
 
 		rb_mesh->elems = skmesh->elems;
@@ -0,0 +1,326 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+// r_imagefilter_test.c -- checks the SIMD paths of R_ResampleImage and
+// R_MipMapImage byte for byte against plain C, "-bench" also times them
+
+#include "../../gameshared/q_arch.h"
+#include "../r_imagefilter.h"
+
+#define MAX_TEST_SIZE		300
+#define NUM_TEST_IMAGES		3000
+#define GUARD_BYTES			64
+#define GUARD_VALUE			0xA5
+
+typedef struct
+{
+	const char *name;
+	unsigned int cpuFeatures;
+} testpath_t;
+
+static testpath_t paths[] =
+{
+	{ "C", 0 },
+	{ "SSE2", QCPU_HAS_SSE2 },
+	{ "AVX2", QCPU_HAS_SSE2|QCPU_HAS_AVX2 },
+};
+static int numPaths;
+
+/*
+* Test_ResampleRef
+*
+* The resampling loop as it was before any SIMD code was added
+*/
+static void Test_ResampleRef( const qbyte *in, int inwidth, int inheight, qbyte *out, int outwidth, int outheight, int samples )
+{
+	int i, j, k;
+	unsigned int frac, fracstep;
+	const qbyte *inrow, *inrow2, *pix1, *pix2, *pix3, *pix4;
+	unsigned p1[MAX_TEST_SIZE*8], p2[MAX_TEST_SIZE*8];
+	qbyte *opix;
+
+	if( inwidth == outwidth && inheight == outheight )
+	{
+		memcpy( out, in, inwidth * inheight * samples );
+		return;
+	}
+
+	fracstep = inwidth * 0x10000 / outwidth;
+
+	frac = fracstep >> 2;
+	for( i = 0; i < outwidth; i++ )
+	{
+		p1[i] = samples * ( frac >> 16 );
+		frac += fracstep;
+	}
+
+	frac = 3 * ( fracstep >> 2 );
+	for( i = 0; i < outwidth; i++ )
+	{
+		p2[i] = samples * ( frac >> 16 );
+		frac += fracstep;
+	}
+
+	for( i = 0; i < outheight; i++, out += outwidth * samples )
+	{
+		inrow = in + samples * inwidth * (int)( ( i + 0.25 ) * inheight / outheight );
+		inrow2 = in + samples * inwidth * (int)( ( i + 0.75 ) * inheight / outheight );
+		for( j = 0; j < outwidth; j++ )
+		{
+			pix1 = inrow + p1[j];
+			pix2 = inrow + p2[j];
+			pix3 = inrow2 + p1[j];
+			pix4 = inrow2 + p2[j];
+			opix = out + j * samples;
+
+			for( k = 0; k < samples; k++ )
+				opix[k] = ( pix1[k] + pix2[k] + pix3[k] + pix4[k] ) >> 2;
+		}
+	}
+}
+
+/*
+* Test_MipMapRef
+*/
+static void Test_MipMapRef( qbyte *in, int width, int height, int samples )
+{
+	int i, j, k, samples2;
+	qbyte *out;
+
+	width *= samples;
+	height >>= 1;
+	samples2 = samples << 1;
+
+	out = in;
+	for( i = 0; i < height; i++, in += width )
+	{
+		for( j = 0; j < width; j += samples2, out += samples, in += samples2 )
+		{
+			for( k = 0; k < samples; k++ )
+				out[k] = ( in[k] + in[k+samples] + in[width+k] + in[width+k+samples] )>>2;
+		}
+	}
+}
+
+/*
+* Test_CPUFeatures
+*
+* Only the paths this CPU can run, the ones that aren't compiled in fall back to C
+*/
+static unsigned int Test_CPUFeatures( void )
+{
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+	unsigned int features = 0;
+
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "sse2" ) )
+		features |= QCPU_HAS_SSE2;
+	if( __builtin_cpu_supports( "avx2" ) )
+		features |= QCPU_HAS_AVX2;
+	return features;
+#elif defined( _M_X64 )
+	return QCPU_HAS_SSE2;
+#else
+	return 0;
+#endif
+}
+
+/*
+* Test_Random
+*/
+static unsigned int test_seed = 0x1234567;
+static int Test_Random( int range )
+{
+	test_seed = test_seed * 1103515245 + 12345;
+	return ( test_seed >> 8 ) % range;
+}
+
+/*
+* Test_Compare
+*/
+static qboolean Test_Compare( const char *what, const testpath_t *path, const qbyte *ref, const qbyte *out, size_t size,
+	int inwidth, int inheight, int outwidth, int outheight, int samples )
+{
+	size_t i;
+
+	for( i = 0; i < size + GUARD_BYTES; i++ )
+	{
+		if( out[i] != ref[i] )
+		{
+			printf( "%s %s: %ix%i -> %ix%i, %i samples: byte %i of %i differs (%i != %i)\n", what, path->name,
+				inwidth, inheight, outwidth, outheight, samples, (int)i, (int)size, out[i], ref[i] );
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+* Test_Check
+*/
+static int Test_Check( void )
+{
+	int i, p, n, samples, fails = 0;
+	int inwidth, inheight, outwidth, outheight;
+	size_t insize, outsize;
+	static const int sampleCounts[] = { 1, 3, 4 };
+	static unsigned lines[MAX_TEST_SIZE*2];
+	qbyte *in, *ref, *out;
+
+	in = malloc( MAX_TEST_SIZE * MAX_TEST_SIZE * 4 + GUARD_BYTES );
+	ref = malloc( MAX_TEST_SIZE * MAX_TEST_SIZE * 4 + GUARD_BYTES );
+	out = malloc( MAX_TEST_SIZE * MAX_TEST_SIZE * 4 + GUARD_BYTES );
+
+	for( n = 0; n < NUM_TEST_IMAGES; n++ )
+	{
+		samples = sampleCounts[n % 3];
+		inwidth = 1 + Test_Random( MAX_TEST_SIZE );
+		inheight = 1 + Test_Random( MAX_TEST_SIZE );
+		outwidth = 1 + Test_Random( MAX_TEST_SIZE );
+		outheight = 1 + Test_Random( MAX_TEST_SIZE );
+		insize = inwidth * inheight * samples;
+		outsize = outwidth * outheight * samples;
+
+		for( i = 0; i < (int)insize; i++ )
+			in[i] = Test_Random( 256 );
+
+		// resample
+		memset( ref, GUARD_VALUE, outsize + GUARD_BYTES );
+		Test_ResampleRef( in, inwidth, inheight, ref, outwidth, outheight, samples );
+		for( p = 0; p < numPaths; p++ )
+		{
+			memset( out, GUARD_VALUE, outsize + GUARD_BYTES );
+			R_ResampleImage( in, inwidth, inheight, out, outwidth, outheight, samples, lines, paths[p].cpuFeatures );
+			if( !Test_Compare( "R_ResampleImage", &paths[p], ref, out, outsize, inwidth, inheight, outwidth, outheight, samples ) )
+				fails++;
+		}
+
+		// mipmap the input in place, odd sizes included
+		memcpy( ref, in, insize );
+		memset( ref + insize, GUARD_VALUE, GUARD_BYTES );
+		Test_MipMapRef( ref, inwidth, inheight, samples );
+		for( p = 0; p < numPaths; p++ )
+		{
+			memcpy( out, in, insize );
+			memset( out + insize, GUARD_VALUE, GUARD_BYTES );
+			R_MipMapImage( out, inwidth, inheight, samples, paths[p].cpuFeatures );
+			if( !Test_Compare( "R_MipMapImage", &paths[p], ref, out, insize, inwidth, inheight, inwidth / 2, inheight / 2, samples ) )
+				fails++;
+		}
+
+		if( fails > 10 )
+			break;
+	}
+
+	free( in );
+	free( ref );
+	free( out );
+
+	printf( "%i images, %i paths: %s\n", n, numPaths, fails ? "FAILED" : "passed" );
+	return fails;
+}
+
+/*
+* Test_Bench
+*/
+static void Test_Bench( void )
+{
+	int i, p, c, iterations;
+	int w, h;
+	double resampleMsec, mipMsec;
+	clock_t start;
+	unsigned *lines;
+	qbyte *in, *out;
+	static const struct
+	{
+		int inwidth, inheight, outwidth, outheight, samples;
+	} cases[] =
+	{
+		{ 1000, 1000, 1024, 1024, 4 },
+		{ 1000, 1000, 1024, 1024, 3 },
+		{ 2048, 2048, 1024, 1024, 4 },
+		{ 2048, 2048, 1024, 1024, 1 },
+	};
+
+	in = malloc( 2048 * 2048 * 4 );
+	out = malloc( 1024 * 1024 * 4 );
+	lines = malloc( 1024 * 2 * sizeof( *lines ) );
+	for( i = 0; i < 2048 * 2048 * 4; i++ )
+		in[i] = Test_Random( 256 );
+
+	printf( "msec per call, resample / whole mip chain\n" );
+	for( c = 0; c < (int)( sizeof( cases ) / sizeof( cases[0] ) ); c++ )
+	{
+		printf( "%4ix%-4i -> %4ix%-4i %i samples:", cases[c].inwidth, cases[c].inheight,
+			cases[c].outwidth, cases[c].outheight, cases[c].samples );
+
+		for( p = 0; p < numPaths; p++ )
+		{
+			iterations = 20;
+
+			start = clock();
+			for( i = 0; i < iterations; i++ )
+				R_ResampleImage( in, cases[c].inwidth, cases[c].inheight, out, cases[c].outwidth, cases[c].outheight,
+					cases[c].samples, lines, paths[p].cpuFeatures );
+			resampleMsec = ( clock() - start ) * 1000.0 / CLOCKS_PER_SEC / iterations;
+
+			start = clock();
+			for( i = 0; i < iterations; i++ )
+			{
+				for( w = cases[c].outwidth, h = cases[c].outheight; w > 1 || h > 1; )
+				{
+					R_MipMapImage( out, w, h, cases[c].samples, paths[p].cpuFeatures );
+					w = w > 1 ? w >> 1 : 1;
+					h = h > 1 ? h >> 1 : 1;
+				}
+			}
+			mipMsec = ( clock() - start ) * 1000.0 / CLOCKS_PER_SEC / iterations;
+
+			printf( "  %s %.2f/%.2f", paths[p].name, resampleMsec, mipMsec );
+		}
+		printf( "\n" );
+	}
+
+	free( in );
+	free( out );
+	free( lines );
+}
+
+int main( int argc, char **argv )
+{
+	int i;
+	unsigned int features = Test_CPUFeatures();
+
+	for( numPaths = 0; numPaths < (int)( sizeof( paths ) / sizeof( paths[0] ) ); numPaths++ )
+	{
+		if( ( paths[numPaths].cpuFeatures & features ) != paths[numPaths].cpuFeatures )
+			break;
+	}
+
+	if( Test_Check() )
+		return 1;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-bench" ) )
+			Test_Bench();
+	}
+
+	return 0;
+}
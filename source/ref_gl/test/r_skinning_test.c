@@ -0,0 +1,360 @@
+/*
+Copyright (C) 2002-2011 Victor Luchits
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// r_skinning_test.c -- checks the SSE2 skinning kernels byte for byte against
+// plain C, "-bench" also times a whole model with both
+
+#include "../../gameshared/q_arch.h"
+#include "../r_math.h"
+#include "../r_skinning.h"
+
+#define MAX_TEST_BONES		128
+#define MAX_TEST_BLENDS		128
+#define MAX_TEST_VERTS		1500
+#define NUM_TEST_MODELS		2000
+#define GUARD_BYTES			64
+#define GUARD_VALUE			0xA5
+
+// the model the per-model cost was quoted for
+#define BENCH_BONES			64
+#define BENCH_BLENDS		48
+#define BENCH_VERTS			4000
+
+typedef struct
+{
+	const char *name;
+	unsigned int cpuFeatures;
+} testpath_t;
+
+static testpath_t paths[] =
+{
+	{ "C", 0 },
+	{ "SSE2", QCPU_HAS_SSE2 },
+};
+static int numPaths;
+
+typedef struct
+{
+	unsigned int numbones, numblends, numverts;
+	mat4_t *poses;				// numbones bones followed by numblends blends
+	mskblend_t *blends;
+	unsigned int *vertexBlends;
+	vec_t *xyz, *normals, *svecs;
+} testmodel_t;
+
+/*
+* Test_CPUFeatures
+*
+* Only the paths this CPU can run, the ones that aren't compiled in fall back to C
+*/
+static unsigned int Test_CPUFeatures( void )
+{
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+	unsigned int features = 0;
+
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "sse2" ) )
+		features |= QCPU_HAS_SSE2;
+	return features;
+#elif defined( _M_X64 )
+	return QCPU_HAS_SSE2;
+#else
+	return 0;
+#endif
+}
+
+/*
+* Test_Random
+*/
+static unsigned int test_seed = 0x1234567;
+static int Test_Random( int range )
+{
+	test_seed = test_seed * 1103515245 + 12345;
+	return ( test_seed >> 8 ) % range;
+}
+
+/*
+* Test_RandomFloat
+*/
+static float Test_RandomFloat( float scale )
+{
+	return ( Test_Random( 20001 ) - 10000 ) * scale / 10000.0f;
+}
+
+/*
+* Test_InitModel
+*
+* Random poses, w columns included, and blends that add up to 255 like the
+* ones the loader builds, with unused weights zeroed
+*/
+static void Test_InitModel( testmodel_t *model, unsigned int numbones, unsigned int numblends, unsigned int numverts )
+{
+	unsigned int i, j, left, w;
+
+	model->numbones = numbones;
+	model->numblends = numblends;
+	model->numverts = numverts;
+	model->poses = malloc( sizeof( mat4_t ) * ( numbones + numblends ) );
+	model->blends = malloc( sizeof( mskblend_t ) * ( numblends + 1 ) );
+	model->vertexBlends = malloc( sizeof( unsigned int ) * ( numverts + 1 ) );
+	model->xyz = malloc( sizeof( vec4_t ) * ( numverts + 1 ) );
+	model->normals = malloc( sizeof( vec4_t ) * ( numverts + 1 ) );
+	model->svecs = malloc( sizeof( vec4_t ) * ( numverts + 1 ) );
+
+	for( i = 0; i < numbones + numblends; i++ ) {
+		for( j = 0; j < 16; j++ )
+			model->poses[i][j] = Test_RandomFloat( j >= 12 ? 64 : 2 );
+	}
+
+	for( i = 0; i < numblends; i++ ) {
+		memset( &model->blends[i], 0, sizeof( mskblend_t ) );
+		for( j = 0, left = 255; j < SKM_MAX_WEIGHTS && left; j++ ) {
+			w = j == SKM_MAX_WEIGHTS - 1 ? left : 1 + Test_Random( left );
+			model->blends[i].indices[j] = Test_Random( numbones );
+			model->blends[i].weights[j] = w;
+			left -= w;
+		}
+	}
+
+	for( i = 0; i < numverts; i++ ) {
+		model->vertexBlends[i] = Test_Random( numbones + numblends );
+		for( j = 0; j < 4; j++ ) {
+			model->xyz[i*4+j] = Test_RandomFloat( 128 );
+			model->normals[i*4+j] = Test_RandomFloat( 1 );
+			model->svecs[i*4+j] = Test_RandomFloat( 1 );
+		}
+		model->svecs[i*4+3] = Test_Random( 2 ) ? 1 : -1;
+	}
+}
+
+/*
+* Test_FreeModel
+*/
+static void Test_FreeModel( testmodel_t *model )
+{
+	free( model->poses );
+	free( model->blends );
+	free( model->vertexBlends );
+	free( model->xyz );
+	free( model->normals );
+	free( model->svecs );
+}
+
+/*
+* Test_Compare
+*/
+static qboolean Test_Compare( const char *what, const testpath_t *path, const testmodel_t *model,
+	const qbyte *ref, const qbyte *out, size_t size )
+{
+	size_t i;
+
+	for( i = 0; i < size + GUARD_BYTES; i++ ) {
+		if( out[i] != ref[i] ) {
+			printf( "%s %s: %u bones, %u blends, %u verts: byte %i of %i differs (%i != %i)\n", what, path->name,
+				model->numbones, model->numblends, model->numverts, (int)i, (int)size, out[i], ref[i] );
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+* Test_ComparePoses
+*
+* Only the xyz columns of the blended poses, the SSE2 path writes the w column
+* too and nothing reads it
+*/
+static qboolean Test_ComparePoses( const testpath_t *path, const testmodel_t *model, const mat4_t *ref, const mat4_t *out )
+{
+	unsigned int i, j;
+
+	if( memcmp( ref, out, sizeof( mat4_t ) * model->numbones ) ) {
+		printf( "R_SkeletalBlendPoses %s: %u bones, %u blends: the bone poses were modified\n", path->name,
+			model->numbones, model->numblends );
+		return qfalse;
+	}
+
+	for( i = model->numbones; i < model->numbones + model->numblends; i++ ) {
+		for( j = 0; j < 16; j++ ) {
+			if( ( j & 3 ) != 3 && memcmp( &ref[i][j], &out[i][j], sizeof( vec_t ) ) ) {
+				printf( "R_SkeletalBlendPoses %s: %u bones, %u blends: blend %u, element %u differs (%.9g != %.9g)\n",
+					path->name, model->numbones, model->numblends, i - model->numbones, j, out[i][j], ref[i][j] );
+				return qfalse;
+			}
+		}
+	}
+
+	if( memcmp( ref + model->numbones + model->numblends, out + model->numbones + model->numblends, GUARD_BYTES ) ) {
+		printf( "R_SkeletalBlendPoses %s: %u bones, %u blends: wrote past the poses\n", path->name,
+			model->numbones, model->numblends );
+		return qfalse;
+	}
+	return qtrue;
+}
+
+/*
+* Test_Check
+*/
+static int Test_Check( void )
+{
+	int n, p, fails = 0;
+	size_t posesSize, vertsSize;
+	testmodel_t model;
+	qbyte *ref, *out, *ref2, *out2;
+
+	posesSize = sizeof( mat4_t ) * ( MAX_TEST_BONES + MAX_TEST_BLENDS ) + GUARD_BYTES;
+	vertsSize = sizeof( vec4_t ) * MAX_TEST_VERTS + GUARD_BYTES;
+	ref = malloc( max( posesSize, vertsSize ) );
+	out = malloc( max( posesSize, vertsSize ) );
+	ref2 = malloc( vertsSize );
+	out2 = malloc( vertsSize );
+
+	for( n = 0; n < NUM_TEST_MODELS; n++ ) {
+		Test_InitModel( &model, 1 + Test_Random( MAX_TEST_BONES ), Test_Random( MAX_TEST_BLENDS + 1 ),
+			Test_Random( MAX_TEST_VERTS + 1 ) );
+		posesSize = sizeof( mat4_t ) * ( model.numbones + model.numblends );
+		vertsSize = sizeof( vec4_t ) * model.numverts;
+
+		// blend poses, starting from the same garbage in the blend slots
+		memcpy( ref, model.poses, posesSize );
+		memset( ref + posesSize, GUARD_VALUE, GUARD_BYTES );
+		R_SkeletalBlendPoses( model.numblends, model.blends, model.numbones, ( mat4_t * )ref, 0 );
+		for( p = 1; p < numPaths; p++ ) {
+			memcpy( out, model.poses, posesSize );
+			memset( out + posesSize, GUARD_VALUE, GUARD_BYTES );
+			R_SkeletalBlendPoses( model.numblends, model.blends, model.numbones, ( mat4_t * )out, paths[p].cpuFeatures );
+			if( !Test_ComparePoses( &paths[p], &model, ( mat4_t * )ref, ( mat4_t * )out ) )
+				fails++;
+		}
+
+		// the transforms read the random w columns the model was made with, they must not leak into the output
+		memset( ref, GUARD_VALUE, vertsSize + GUARD_BYTES );
+		R_SkeletalTransformVerts( model.numverts, model.vertexBlends, model.poses, model.xyz, ( vec_t * )ref, 0 );
+		for( p = 1; p < numPaths; p++ ) {
+			memset( out, GUARD_VALUE, vertsSize + GUARD_BYTES );
+			R_SkeletalTransformVerts( model.numverts, model.vertexBlends, model.poses, model.xyz, ( vec_t * )out,
+				paths[p].cpuFeatures );
+			if( !Test_Compare( "R_SkeletalTransformVerts", &paths[p], &model, ref, out, vertsSize ) )
+				fails++;
+		}
+
+		memset( ref, GUARD_VALUE, vertsSize + GUARD_BYTES );
+		R_SkeletalTransformNormals( model.numverts, model.vertexBlends, model.poses, model.normals, ( vec_t * )ref, 0 );
+		for( p = 1; p < numPaths; p++ ) {
+			memset( out, GUARD_VALUE, vertsSize + GUARD_BYTES );
+			R_SkeletalTransformNormals( model.numverts, model.vertexBlends, model.poses, model.normals, ( vec_t * )out,
+				paths[p].cpuFeatures );
+			if( !Test_Compare( "R_SkeletalTransformNormals", &paths[p], &model, ref, out, vertsSize ) )
+				fails++;
+		}
+
+		memset( ref, GUARD_VALUE, vertsSize + GUARD_BYTES );
+		memset( ref2, GUARD_VALUE, vertsSize + GUARD_BYTES );
+		R_SkeletalTransformNormalsAndSVecs( model.numverts, model.vertexBlends, model.poses,
+			model.normals, ( vec_t * )ref, model.svecs, ( vec_t * )ref2, 0 );
+		for( p = 1; p < numPaths; p++ ) {
+			memset( out, GUARD_VALUE, vertsSize + GUARD_BYTES );
+			memset( out2, GUARD_VALUE, vertsSize + GUARD_BYTES );
+			R_SkeletalTransformNormalsAndSVecs( model.numverts, model.vertexBlends, model.poses,
+				model.normals, ( vec_t * )out, model.svecs, ( vec_t * )out2, paths[p].cpuFeatures );
+			if( !Test_Compare( "R_SkeletalTransformNormalsAndSVecs normals", &paths[p], &model, ref, out, vertsSize ) )
+				fails++;
+			if( !Test_Compare( "R_SkeletalTransformNormalsAndSVecs svecs", &paths[p], &model, ref2, out2, vertsSize ) )
+				fails++;
+		}
+
+		Test_FreeModel( &model );
+
+		if( fails > 10 )
+			break;
+	}
+
+	free( ref );
+	free( out );
+	free( ref2 );
+	free( out2 );
+
+	printf( "%i models, %i paths: %s\n", n, numPaths, fails ? "FAILED" : "passed" );
+	return fails;
+}
+
+/*
+* Test_Bench
+*
+* What R_DrawSkeletalSurf does on the CPU for a model that isn't cached:
+* blend the poses, then transform the verts and the normals with the svecs
+*/
+static void Test_Bench( void )
+{
+	int i, p, iterations = 5000;
+	double usec[2] = { 0, 0 };
+	clock_t start;
+	testmodel_t model;
+	vec_t *xyz, *normals, *svecs;
+
+	Test_InitModel( &model, BENCH_BONES, BENCH_BLENDS, BENCH_VERTS );
+	xyz = malloc( sizeof( vec4_t ) * BENCH_VERTS );
+	normals = malloc( sizeof( vec4_t ) * BENCH_VERTS );
+	svecs = malloc( sizeof( vec4_t ) * BENCH_VERTS );
+
+	printf( "usec per model, %i verts, %i bones, %i blends:", BENCH_VERTS, BENCH_BONES, BENCH_BLENDS );
+	for( p = 0; p < numPaths; p++ ) {
+		start = clock();
+		for( i = 0; i < iterations; i++ ) {
+			R_SkeletalBlendPoses( model.numblends, model.blends, model.numbones, model.poses, paths[p].cpuFeatures );
+			R_SkeletalTransformVerts( model.numverts, model.vertexBlends, model.poses, model.xyz, xyz,
+				paths[p].cpuFeatures );
+			R_SkeletalTransformNormalsAndSVecs( model.numverts, model.vertexBlends, model.poses,
+				model.normals, normals, model.svecs, svecs, paths[p].cpuFeatures );
+		}
+		usec[p] = ( clock() - start ) * 1000000.0 / CLOCKS_PER_SEC / iterations;
+
+		printf( "  %s %.1f", paths[p].name, usec[p] );
+	}
+	if( numPaths > 1 && usec[1] > 0 )
+		printf( "  (%.2fx)", usec[0] / usec[1] );
+	printf( "\n" );
+
+	Test_FreeModel( &model );
+	free( xyz );
+	free( normals );
+	free( svecs );
+}
+
+int main( int argc, char **argv )
+{
+	int i;
+	unsigned int features = Test_CPUFeatures();
+
+	for( numPaths = 0; numPaths < (int)( sizeof( paths ) / sizeof( paths[0] ) ); numPaths++ ) {
+		if( ( paths[numPaths].cpuFeatures & features ) != paths[numPaths].cpuFeatures )
+			break;
+	}
+
+	if( Test_Check() )
+		return 1;
+
+	for( i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "-bench" ) )
+			Test_Bench();
+	}
+
+	return 0;
+}
@@ -100,6 +100,7 @@ typedef struct
 	int first_entity;                   // into the circular sv.client_entities[]
 	unsigned int sentTimeStamp;         // time at what this frame snap was sent to the clients
 	unsigned int UcmdExecuted;
+	unsigned int contentKey;          // frames with the same non-zero key have the same contents
 	game_state_t gameState;
 } client_snapshot_t;
 
@@ -121,6 +122,8 @@ typedef struct
 #define	LATENCY_COUNTS	16
 #define	RATE_MESSAGES	25  // wsw : jal : was 10: I think it must fit sv_pps, I have to calculate it
 
+typedef struct sv_replay_s sv_replay_t;
+
 typedef struct client_s
 {
 	sv_client_state_t state;
@@ -164,6 +167,17 @@ typedef struct client_s
 	int rate;
 	int suppressCount;              // number of messages rate suppressed
 #endif
+
+	// adaptive snapshot scheduling
+	unsigned int nextSnapTime;      // gametime at which the next snapshot is due
+	int snapInterval;               // msecs between snapshots for this client
+	int snapSize;                   // running average of the snapshot message size
+	int snapBytes;                  // bytes sent since the last paced snapshot
+	int snapRate;                   // bytes per second currently granted to snapshots
+	int snapPingBase;               // lowest recent ping, the reference for congestion
+	unsigned int snapRateTime;      // gametime of the next rate adjustment
+	int snapBudget;                 // bytes for entities in the next snapshot, 0 for no limit
+	unsigned int *snapRefreshTime;  // [MAX_EDICTS] time each entity was last sent up to date
 	edict_t	*edict;                 // EDICT_NUM(clientnum+1)
 	char name[MAX_INFO_VALUE];      // extracted from userinfo, high bits masked
 	char session[16];               // session id for HTTP requests
@@ -181,6 +195,10 @@ typedef struct client_s
 	int mm_session;
 	unsigned int mm_ticket;
 	char mm_login[MAX_INFO_VALUE];
+
+	struct client_s *hashNext;      // next client in the svs.clientsHash bucket
+
+	struct sv_replay_s *replay;     // in-memory ring of the client's own snapshots
 } client_t;
 
 // a client can leave the server in one of four ways:
@@ -196,6 +214,9 @@ typedef struct client_s
 // out before legitimate users connected
 #define	MAX_CHALLENGES	1024
 
+// clients are hashed by base address and game port for incoming packets lookup
+#define	CLIENTS_HASH_SIZE	256     // must be a power of two
+
 // MAX_SNAP_ENTITIES is the guess of what we consider maximum amount of entities
 // to be sent to a client into a snap. It's used for finding size of the backup storage
 #define MAX_SNAP_ENTITIES 64
@@ -211,6 +232,7 @@ typedef struct
 typedef struct
 {
 	int file;
+	snapDemoWriter_t *writer;       // asynchronous writer, if enabled
 	char *filename;
 	char *tempname;
 	time_t localtime;
@@ -218,6 +240,8 @@ typedef struct
 	client_t client;                // special client for writing the messages
 	char meta_data[SNAP_MAX_DEMO_META_DATA_SIZE];
 	size_t meta_data_realsize;
+	snapDemoIndex_t index;          // keyframes for seeking
+	unsigned int keyframe_time;
 } server_static_demo_t;
 
 typedef server_static_demo_t demorec_t;
@@ -269,6 +293,7 @@ typedef struct
 	                                    // used to check late spawns
 
 	client_t *clients;                  // [sv_maxclients->integer];
+	client_t *clientsHash[CLIENTS_HASH_SIZE];
 	client_entities_t client_entities;
 
 	challenge_t challenges[MAX_CHALLENGES]; // to prevent invalid IPs from connecting
@@ -317,6 +342,8 @@ extern cvar_t *sv_port6;
 
 extern cvar_t *sv_tcp;
 
+extern cvar_t *sv_batchio;
+
 #ifdef HTTP_SUPPORT
 extern cvar_t *sv_http;
 extern cvar_t *sv_http_ip;
@@ -339,6 +366,8 @@ extern cvar_t *sv_highchars;
 
 //wsw : jal
 extern cvar_t *sv_maxrate;
+extern cvar_t *sv_snap_adaptive;
+extern cvar_t *sv_snap_maxinterval;
 extern cvar_t *sv_compresspackets;
 extern cvar_t *sv_public;         // should heartbeats be sent
 
@@ -363,6 +392,9 @@ extern cvar_t *sv_lastAutoUpdate;
 extern cvar_t *sv_defaultmap;
 
 extern cvar_t *sv_demodir;
+extern cvar_t *sv_demoasync;
+extern cvar_t *sv_replay_time;
+extern cvar_t *sv_replay_maxsize;
 
 extern cvar_t *sv_mm_authkey;
 extern cvar_t *sv_mm_loginonly;
@@ -388,6 +420,7 @@ void SV_SendServerinfo( client_t *client );
 void SV_UserinfoChanged( client_t *cl );
 
 void SV_MasterHeartbeat( void );
+void SV_SchedStats_f( void );
 
 void SVC_MasterInfoResponse( const socket_t *socket, const netadr_t *address );
 int SVC_FakeConnect( char *fakeUserinfo, char *fakeSocketType, const char *fakeIP );
@@ -400,6 +433,8 @@ void SV_UpdateActivity( void );
 void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, msg_t *msg );
 void SV_InitMaster( void );
 void SV_UpdateMaster( void );
+void SV_InfoCache_Invalidate( void );
+void SV_OOBStats_f( void );
 
 //
 // sv_init.c
@@ -464,6 +499,9 @@ qboolean SV_ClientConnect( const socket_t *socket, const netadr_t *address, clie
                            unsigned int ticket_id, int session_id );
 void SV_DropClient( client_t *drop, int type, const char *format, ... );
 void SV_ExecuteClientThinks( int clientNum );
+void SV_ClientHash_Add( client_t *client );
+void SV_ClientHash_Remove( client_t *client );
+client_t *SV_ClientHash_Find( const netadr_t *address, int game_port );
 void SV_ClientResetCommandBuffers( client_t *client );
 qboolean SV_ClientAllowHttpRequest( int clientNum, const char *session );
 
@@ -502,11 +540,14 @@ void SV_InitEdict( edict_t *e );
 //
 // sv_demos.c
 //
+#define SV_DEMO_DIR va( "demos/server%s%s", sv_demodir->string[0] ? "/" : "", sv_demodir->string[0] ? sv_demodir->string : "" )
+
 void SV_Demo_WriteSnap( void );
 void SV_Demo_Start_f( void );
 void SV_Demo_Stop_f( void );
 void SV_Demo_Cancel_f( void );
 void SV_Demo_Purge_f( void );
+void SV_Demo_Stats_f( void );
 
 void SV_DemoList_f( client_t *client );
 void SV_DemoGet_f( client_t *client );
@@ -515,6 +556,15 @@ void SV_DemoGet_f( client_t *client );
 
 qboolean SV_IsDemoDownloadRequest( const char *request );
 
+//
+// sv_replay.c
+//
+void SV_Replay_RecordFrame( client_t *client );
+qboolean SV_Replay_Dump( client_t *client, const char *name, unsigned int duration );
+void SV_Replay_Free( client_t *client );
+void SV_Replay_Frame( void );
+void SV_Replay_Shutdown( void );
+
 //
 // sv_motd.c
 //
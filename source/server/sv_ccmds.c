@@ -822,6 +822,7 @@ void SV_InitOperatorCommands( void )
 	Cmd_AddCommand( "serverrecordstop", SV_Demo_Stop_f );
 	Cmd_AddCommand( "serverrecordcancel", SV_Demo_Cancel_f );
 	Cmd_AddCommand( "serverrecordpurge", SV_Demo_Purge_f );
+	Cmd_AddCommand( "serverrecordstats", SV_Demo_Stats_f );
 
 	Cmd_AddCommand( "purelist", SV_PureList_f );
 
@@ -834,6 +835,9 @@ void SV_InitOperatorCommands( void )
 
 	Cmd_AddCommand( "cvarcheck", SV_CvarCheck_f );
 
+	Cmd_AddCommand( "oobstats", SV_OOBStats_f );
+	Cmd_AddCommand( "schedstats", SV_SchedStats_f );
+
 	Cmd_SetCompletionFunc( "map", SV_MapComplete_f );
 	Cmd_SetCompletionFunc( "devmap", SV_MapComplete_f );
 	Cmd_SetCompletionFunc( "gamemap", SV_MapComplete_f );
@@ -858,6 +862,7 @@ void SV_ShutdownOperatorCommands( void )
 	Cmd_RemoveCommand( "serverrecordstop" );
 	Cmd_RemoveCommand( "serverrecordcancel" );
 	Cmd_RemoveCommand( "serverrecordpurge" );
+	Cmd_RemoveCommand( "serverrecordstats" );
 
 	Cmd_RemoveCommand( "purelist" );
 
@@ -869,4 +874,7 @@ void SV_ShutdownOperatorCommands( void )
 	}
 
 	Cmd_RemoveCommand( "cvarcheck" );
+
+	Cmd_RemoveCommand( "oobstats" );
+	Cmd_RemoveCommand( "schedstats" );
 }
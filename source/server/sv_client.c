@@ -46,9 +46,65 @@ void SV_ClientResetCommandBuffers( client_t *client )
 	// reset snapshots delta-compression
 	client->lastframe = -1;
 	client->lastSentFrameNum = 0;
+	client->nextSnapTime = 0;
 }
 
 
+/*
+* SV_ClientHash_Add
+*/
+void SV_ClientHash_Add( client_t *client )
+{
+	unsigned int key;
+
+	if( client->netchan.remoteAddress.type == NA_NOTRANSMIT )
+		return;
+
+	SV_ClientHash_Remove( client );
+
+	key = NET_ClientHashKey( &client->netchan.remoteAddress, client->netchan.game_port, CLIENTS_HASH_SIZE );
+	client->hashNext = svs.clientsHash[key];
+	svs.clientsHash[key] = client;
+}
+
+/*
+* SV_ClientHash_Remove
+*/
+void SV_ClientHash_Remove( client_t *client )
+{
+	client_t **prev;
+
+	prev = &svs.clientsHash[NET_ClientHashKey( &client->netchan.remoteAddress, client->netchan.game_port, CLIENTS_HASH_SIZE )];
+	while( *prev )
+	{
+		if( *prev == client )
+		{
+			*prev = client->hashNext;
+			break;
+		}
+		prev = &( *prev )->hashNext;
+	}
+
+	client->hashNext = NULL;
+}
+
+/*
+* SV_ClientHash_Find
+* Returns the connected client owning the given address and game port
+*/
+client_t *SV_ClientHash_Find( const netadr_t *address, int game_port )
+{
+	client_t *cl;
+
+	for( cl = svs.clientsHash[NET_ClientHashKey( address, game_port, CLIENTS_HASH_SIZE )]; cl; cl = cl->hashNext )
+	{
+		if( cl->netchan.game_port == game_port && NET_CompareBaseAddress( address, &cl->netchan.remoteAddress ) )
+			return cl;
+	}
+
+	return NULL;
+}
+
 /*
 * SV_ClientConnect
 * accept the new client
@@ -82,6 +138,8 @@ qboolean SV_ClientConnect( const socket_t *socket, const netadr_t *address, clie
 
 
 	// the connection is accepted, set up the client slot
+	SV_ClientHash_Remove( client );
+	SV_Replay_Free( client );
 	memset( client, 0, sizeof( *client ) );
 	client->edict = ent;
 	client->challenge = challenge; // save challenge for checksumming
@@ -147,6 +205,7 @@ qboolean SV_ClientConnect( const socket_t *socket, const netadr_t *address, clie
 		{
 			Netchan_Setup( &client->netchan, socket, address, game_port );
 		}
+		SV_ClientHash_Add( client );
 	}
 
 	
@@ -230,6 +289,8 @@ void SV_DropClient( client_t *drop, int type, const char *format, ... )
 
 	SNAP_FreeClientFrames( drop );
 
+	SV_Replay_Free( drop );
+
 	if( drop->download.name )
 	{
 		if( drop->download.data )
@@ -255,8 +316,10 @@ void SV_DropClient( client_t *drop, int type, const char *format, ... )
 	}
 
 	drop->tvclient = qfalse;
+	SV_ClientHash_Remove( drop );
 	drop->state = CS_ZOMBIE;    // become free in a few seconds
 	drop->name[0] = 0;
+	SV_InfoCache_Invalidate();
 }
 
 
@@ -366,6 +429,7 @@ static void SV_New_f( client_t *client )
 
 	// don't let it send reliable commands until we get the first configstring request
 	client->state = CS_CONNECTING;
+	SV_InfoCache_Invalidate();
 }
 
 /*
@@ -379,6 +443,7 @@ static void SV_Configstrings_f( client_t *client )
 	{
 		Com_DPrintf( "Start Configstrings() from %s\n", client->name );
 		client->state = CS_CONNECTED;
+		SV_InfoCache_Invalidate();
 	}
 	else
 		Com_DPrintf( "Configstrings() from %s\n", client->name );
@@ -1074,7 +1139,9 @@ void SV_ExecuteClientThinks( int clientNum )
 		if( client->lastframe > 0 )
 			timeDelta = -(int)( svs.gametime - ucmd->serverTimeStamp );
 
+		PROF_ENTER( "game_clientthink" );
 		ge->ClientThink( client->edict, ucmd, timeDelta );
+		PROF_LEAVE();
 
 		client->UcmdTime = ucmd->serverTimeStamp;
 	}
@@ -20,7 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "server.h"
 
-#define SV_DEMO_DIR va( "demos/server%s%s", sv_demodir->string[0] ? "/" : "", sv_demodir->string[0] ? sv_demodir->string : "" )
+#define SV_DEMO_QUEUE_SIZE	0x100000
 
 /*
 * SV_Demo_WriteMessage
@@ -33,6 +33,11 @@ static void SV_Demo_WriteMessage( msg_t *msg )
 	if( !svs.demo.file )
 		return;
 
+	if( svs.demo.writer ) {
+		SNAP_DemoWriterRecordMessage( svs.demo.writer, msg, 0 );
+		return;
+	}
+
 	SNAP_RecordDemoMessage( svs.demo.file, msg, 0 );
 }
 
@@ -46,6 +51,12 @@ static void SV_Demo_WriteStartMessages( void )
 
 	SNAP_BeginDemoRecording( svs.demo.file, svs.spawncount, svc.snapFrameTime, sv.mapname, SV_BITFLAGS_RELIABLE, 
 		svs.purelist, sv.configstrings[0], sv.baselines );
+	SNAP_SetDemoIndexConfigstrings( &svs.demo.index, sv.configstrings[0] );
+
+	// hand the rest of the messages over to the writer thread
+	if( sv_demoasync->integer ) {
+		svs.demo.writer = SNAP_CreateDemoWriter( svs.demo.file, SV_DEMO_QUEUE_SIZE );
+	}
 }
 
 /*
@@ -73,6 +84,25 @@ void SV_Demo_WriteSnap( void )
 		return;
 	}
 
+	// write a nodelta frame now and then so that the demo can be seeked
+	if( svs.gametime >= svs.demo.keyframe_time + SNAP_DEMO_KEYFRAME_INTERVAL )
+		svs.demo.client.nodelta = qtrue;
+	if( svs.demo.client.nodelta )
+	{
+		SNAP_AddDemoKeyframe( &svs.demo.index, svs.gametime, 
+			svs.demo.writer ? SNAP_DemoWriterTell( svs.demo.writer ) : FS_Tell( svs.demo.file ) );
+		svs.demo.keyframe_time = svs.gametime;
+
+		// the configstrings changed since the start, for the player to seek straight to the keyframe
+		for( i = 0; i < MAX_CONFIGSTRINGS; )
+		{
+			MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
+			i = SNAP_WriteDemoKeyframeConfigstrings( &msg, &svs.demo.index, sv.configstrings[0], i );
+			if( msg.cursize )
+				SV_Demo_WriteMessage( &msg );
+		}
+	}
+
 	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
 
 	SV_BuildClientFrameSnap( &svs.demo.client );
@@ -190,6 +220,7 @@ void SV_Demo_Start_f( void )
 
 	// write serverdata, configstrings and baselines
 	svs.demo.duration = 0;
+	svs.demo.keyframe_time = 0;
 	svs.demo.basetime = svs.gametime;
 	svs.demo.localtime = time( NULL );
 	SV_Demo_WriteStartMessages();
@@ -213,6 +244,9 @@ static void SV_Demo_Stop( qboolean cancel, qboolean silent )
 		return;
 	}
 
+	// all queued messages must hit the file before the trailer and the meta data
+	SNAP_DestroyDemoWriter( &svs.demo.writer );
+
 	if( cancel )
 	{
 		Com_Printf( "Canceled server demo recording: %s\n", svs.demo.filename );
@@ -245,6 +279,8 @@ static void SV_Demo_Stop( qboolean cancel, qboolean silent )
 		SV_SetDemoMetaKeyValue( "matchname", sv.configstrings[CS_MATCHNAME] );
 		SV_SetDemoMetaKeyValue( "matchscore", sv.configstrings[CS_MATCHSCORE] );
 		SV_SetDemoMetaKeyValue( "matchuuid", sv.configstrings[CS_MATCHUUID] );
+		svs.demo.meta_data_realsize = SNAP_SetDemoMetaIndex( svs.demo.meta_data, sizeof( svs.demo.meta_data ), 
+			svs.demo.meta_data_realsize, &svs.demo.index );
 
 		SNAP_WriteDemoMetaData( svs.demo.tempname, svs.demo.meta_data, svs.demo.meta_data_realsize );
 
@@ -256,6 +292,7 @@ static void SV_Demo_Stop( qboolean cancel, qboolean silent )
 	svs.demo.basetime = svs.demo.duration = 0;
 
 	SNAP_FreeClientFrames( &svs.demo.client );
+	SNAP_FreeDemoIndex( &svs.demo.index );
 
 	Mem_ZoneFree( svs.demo.filename );
 	svs.demo.filename = NULL;
@@ -283,6 +320,29 @@ void SV_Demo_Cancel_f( void )
 	SV_Demo_Stop( qtrue, atoi( Cmd_Argv( 1 ) ) != 0 );
 }
 
+/*
+* SV_Demo_Stats_f
+* 
+* Prints the asynchronous demo writer statistics
+*/
+void SV_Demo_Stats_f( void )
+{
+	if( !svs.demo.file )
+	{
+		Com_Printf( "No server demo recording in progress\n" );
+		return;
+	}
+
+	Com_Printf( "Server demo: %s\n", svs.demo.filename );
+	if( !svs.demo.writer )
+	{
+		Com_Printf( "  written synchronously\n" );
+		return;
+	}
+
+	SNAP_PrintDemoWriterStats( svs.demo.writer );
+}
+
 /*
 * SV_Demo_Purge_f
 * 
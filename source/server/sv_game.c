@@ -41,7 +41,9 @@ static inline int PF_CM_TransformedPointContents( vec3_t p, struct cmodel_s *cmo
 
 static inline void PF_CM_TransformedBoxTrace( trace_t *tr, vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
 struct cmodel_s *cmodel, int brushmask, vec3_t origin, vec3_t angles ) {
+	PROF_ENTER( "cm_trace" );
 	CM_TransformedBoxTrace( svs.cms, tr, start, end, mins, maxs, cmodel, brushmask, origin, angles );
+	PROF_LEAVE();
 }
 
 static inline void PF_CM_RoundUpToHullSize( vec3_t mins, vec3_t maxs, struct cmodel_s *cmodel ) {
@@ -90,6 +92,22 @@ static inline int PF_CM_LeafArea( int leafnum ) {
 
 //======================================================================
 
+/*
+* PF_Prof_Enter
+*/
+static void PF_Prof_Enter( const char *name )
+{
+	PROF_ENTER( name );
+}
+
+/*
+* PF_Prof_Leave
+*/
+static void PF_Prof_Leave( void )
+{
+	PROF_LEAVE();
+}
+
 /*
 * PF_DropClient
 */
@@ -124,6 +142,20 @@ static int PF_GetClientState( int numClient )
 	return svs.clients[numClient].state;
 }
 
+/*
+* PF_DumpReplay
+*
+* Writes the last duration msecs of client's replay buffer to a demo file
+*/
+static qboolean PF_DumpReplay( int numClient, const char *filename, unsigned int duration )
+{
+	if( numClient < 0 || numClient >= sv_maxclients->integer )
+		return qfalse;
+	if( !filename || !filename[0] )
+		return qfalse;
+	return SV_Replay_Dump( svs.clients + numClient, filename, duration );
+}
+
 /*
 * PF_GameCmd
 *
@@ -506,6 +538,8 @@ void SV_InitGameProgs( void )
 	import.CM_LeafArea = PF_CM_LeafArea;
 
 	import.Milliseconds = Sys_Milliseconds;
+	import.Prof_Enter = PF_Prof_Enter;
+	import.Prof_Leave = PF_Prof_Leave;
 
 	import.ModelIndex = SV_ModelIndex;
 	import.SoundIndex = SV_SoundIndex;
@@ -570,6 +604,7 @@ void SV_InitGameProgs( void )
 	import.FakeClientConnect = SVC_FakeConnect;
 	import.DropClient = PF_DropClient;
 	import.GetClientState = PF_GetClientState;
+	import.DumpReplay = PF_DumpReplay;
 	import.ExecuteClientThinks = SV_ExecuteClientThinks;
 
 	import.LocateEntities = SV_LocateEntities;
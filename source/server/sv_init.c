@@ -354,6 +354,7 @@ void SV_InitGame( void )
 
 	svs.spawncount = rand();
 	svs.clients = Mem_Alloc( sv_mempool, sizeof( client_t )*sv_maxclients->integer );
+	memset( svs.clientsHash, 0, sizeof( svs.clientsHash ) );
 	svs.client_entities.num_entities = sv_maxclients->integer * UPDATE_BACKUP * MAX_SNAP_ENTITIES;
 	svs.client_entities.entities = Mem_Alloc( sv_mempool, sizeof( entity_state_t ) * svs.client_entities.num_entities );
 
@@ -377,7 +378,11 @@ void SV_InitGame( void )
 		if( !NET_OpenSocket( &svs.socket_udp, SOCKET_UDP, &address, qtrue ) )
 			Com_Printf( "Error: Couldn't open UDP socket: %s\n", NET_ErrorString() );
 		else
+		{
 			socket_opened = qtrue;
+			if( sv_batchio->integer )
+				NET_SetSocketBatching( &svs.socket_udp, qtrue );
+		}
 
 		// IPv6
 		NET_StringToAddress( sv_ip6->string, &ipv6_address );
@@ -387,7 +392,11 @@ void SV_InitGame( void )
 			if( !NET_OpenSocket( &svs.socket_udp6, SOCKET_UDP, &ipv6_address, qtrue ) )
 				Com_Printf( "Error: Couldn't open UDP6 socket: %s\n", NET_ErrorString() );
 			else
+			{
 				socket_opened = qtrue;
+				if( sv_batchio->integer )
+					NET_SetSocketBatching( &svs.socket_udp6, qtrue );
+			}
 		}
 		else
 			Com_Printf( "Error: invalid IPv6 address: %s\n", sv_ip6->string );
@@ -513,6 +522,8 @@ void SV_ShutdownGame( const char *finalmsg, qboolean reconnect )
 	if( svs.demo.file )
 		SV_Demo_Stop_f();
 
+	SV_Replay_Shutdown();
+
 	if( svs.clients )
 		SV_FinalMessage( finalmsg, reconnect );
 
@@ -537,6 +548,7 @@ void SV_ShutdownGame( const char *finalmsg, qboolean reconnect )
 	{
 		Mem_Free( svs.clients );
 		svs.clients = NULL;
+		memset( svs.clientsHash, 0, sizeof( svs.clientsHash ) );
 	}
 
 	if( svs.client_entities.entities )
@@ -626,6 +638,8 @@ void SV_Map( const char *level, qboolean devmap )
 		memset( svs.clients[i].gameCommands, 0, sizeof( svs.clients[i].gameCommands ) );
 	}
 
+	SV_InfoCache_Invalidate();
+
 	SV_MOTD_Update();
 
 	SCR_BeginLoadingPlaque();       // for local system
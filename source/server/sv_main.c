@@ -75,11 +75,19 @@ cvar_t *sv_defaultmap;
 
 cvar_t *sv_iplimit;
 
+cvar_t *sv_oob_rate;        // connectionless packets per second per address
+cvar_t *sv_oob_burst;
+cvar_t *sv_oob_globalrate;  // connectionless packets per second from everyone
+
+cvar_t *sv_batchio;         // use recvmmsg/sendmmsg where available
+
 cvar_t *sv_reconnectlimit; // minimum seconds between connect messages
 
 // wsw : jal
 
 cvar_t *sv_maxrate;
+cvar_t *sv_snap_adaptive;   // per-client snapshot rate and entity budget
+cvar_t *sv_snap_maxinterval; // longest msecs a client may go without a snapshot
 cvar_t *sv_compresspackets;
 cvar_t *sv_masterservers;
 cvar_t *sv_skilllevel;
@@ -95,6 +103,9 @@ cvar_t *sv_autoUpdate;
 cvar_t *sv_lastAutoUpdate;
 
 cvar_t *sv_demodir;
+cvar_t *sv_demoasync;
+cvar_t *sv_replay_time;
+cvar_t *sv_replay_maxsize;
 
 //============================================================================
 
@@ -163,7 +174,7 @@ static qboolean SV_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	MSG_ReadShort( msg ); // game_port
 	if( msg->compressed )
 	{
-		zerror = Netchan_DecompressMessage( msg );
+		zerror = Netchan_DecompressMessage( netchan, msg );
 		if( zerror < 0 )
 		{
 			// compression error. Drop the packet
@@ -305,19 +316,11 @@ static void SV_ReadPackets( void )
 			// data follows
 
 			// check for packets from connected clients
-			for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
+			cl = SV_ClientHash_Find( &address, game_port );
+			if( cl )
 			{
 				unsigned short addr_port;
 
-				if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
-					continue;
-				if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) )
-					continue;
-				if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
-					continue;
-				if( cl->netchan.game_port != game_port )
-					continue;
-
 				addr_port = NET_GetAddressPort( &address );
 				if( NET_GetAddressPort( &cl->netchan.remoteAddress ) != addr_port )
 				{
@@ -330,7 +333,6 @@ static void SV_ReadPackets( void )
 					cl->lastPacketReceivedTime = svs.realtime;
 					SV_ParseClientMessage( cl, &msg );
 				}
-				break;
 			}
 		}
 	}
@@ -447,6 +449,120 @@ static void SV_CheckTimeouts( void )
 	}
 }
 
+//============================================================================
+//
+//FRAME SCHEDULER
+//
+//============================================================================
+
+// if the scheduler clock and the monotonic clock disagree by more than
+// this, the clock is realigned instead of trusted
+#define SV_SCHED_RESYNC_USEC	100000
+
+// shortest socket wait when nothing is due
+#define SV_SCHED_MIN_SLEEP_USEC	100
+
+#define SV_SCHED_BUCKETS		6
+
+static const unsigned int sv_schedBucketLimits[SV_SCHED_BUCKETS - 1] = { 100, 250, 500, 1000, 2000 };
+
+typedef struct
+{
+	quint64 clock;                  // monotonic usec at which the current millisecond of svs.realtime began
+	quint64 deadline;               // end of the pending sleep, 0 if none
+
+	unsigned int frames;            // frames which ran after a deadline
+	unsigned int woken;             // sleeps cut short by incoming packets
+	unsigned int resyncs;
+	quint64 latenessTotal;
+	unsigned int latenessMax;
+	unsigned int histogram[SV_SCHED_BUCKETS];
+} sv_scheduler_t;
+
+static sv_scheduler_t sv_sched;
+
+/*
+* SV_Sched_BeginFrame
+* Advances the scheduler clock by the frame time and records how late
+* the frame started relative to the deadline of the previous sleep
+*/
+static void SV_Sched_BeginFrame( int realmsec )
+{
+	int i;
+	quint64 now;
+	unsigned int lateness;
+
+	now = Sys_Microseconds();
+
+	// the system loop hands out whole milliseconds of the monotonic clock,
+	// so the clock keeps pointing at the start of the current millisecond
+	sv_sched.clock += (quint64)realmsec * 1000;
+	if( sv_sched.clock > now || now - sv_sched.clock > SV_SCHED_RESYNC_USEC )
+	{
+		if( sv_sched.clock )
+			sv_sched.resyncs++;
+		sv_sched.clock = now - now % 1000;
+	}
+
+	if( !sv_sched.deadline )
+		return;
+
+	if( now < sv_sched.deadline )
+	{
+		sv_sched.woken++;
+		sv_sched.deadline = 0;
+		return;
+	}
+
+	lateness = (unsigned int)min( now - sv_sched.deadline, 0xffffffff );
+	sv_sched.deadline = 0;
+
+	for( i = 0; i < SV_SCHED_BUCKETS - 1; i++ )
+	{
+		if( lateness < sv_schedBucketLimits[i] )
+			break;
+	}
+	sv_sched.histogram[i]++;
+
+	sv_sched.frames++;
+	sv_sched.latenessTotal += lateness;
+	if( lateness > sv_sched.latenessMax )
+		sv_sched.latenessMax = lateness;
+}
+
+/*
+* SV_SchedStats_f
+*/
+void SV_SchedStats_f( void )
+{
+	int i;
+
+	Com_Printf( "Frame scheduler:\n" );
+	Com_Printf( "  deadlines:      %u\n", sv_sched.frames );
+	Com_Printf( "  packet wakeups: %u\n", sv_sched.woken );
+	Com_Printf( "  clock resyncs:  %u\n", sv_sched.resyncs );
+	if( sv_sched.frames )
+	{
+		Com_Printf( "  avg lateness:   %u usec\n", (unsigned int)( sv_sched.latenessTotal / sv_sched.frames ) );
+		Com_Printf( "  max lateness:   %u usec\n", sv_sched.latenessMax );
+	}
+	for( i = 0; i < SV_SCHED_BUCKETS; i++ )
+	{
+		if( i < SV_SCHED_BUCKETS - 1 )
+			Com_Printf( "  < %4u usec:    %u\n", sv_schedBucketLimits[i], sv_sched.histogram[i] );
+		else
+			Com_Printf( " >= %4u usec:    %u\n", sv_schedBucketLimits[i - 1], sv_sched.histogram[i] );
+	}
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) )
+	{
+		sv_sched.frames = sv_sched.woken = sv_sched.resyncs = 0;
+		sv_sched.latenessTotal = 0;
+		sv_sched.latenessMax = 0;
+		memset( sv_sched.histogram, 0, sizeof( sv_sched.histogram ) );
+	}
+}
+
 //#define WORLDFRAMETIME 25 // 40fps
 //#define WORLDFRAMETIME 20 // 50fps
 #define WORLDFRAMETIME 16 // 62.5fps
@@ -478,32 +594,44 @@ static qboolean SV_RunGameFrame( int msec )
 		refreshGameModule = qtrue;
 	}
 
-	// if there aren't pending packets to be sent, we can sleep
-	if( dedicated->integer && !sentFragments && !refreshSnapshot )
+	// if nothing is due, block on the sockets until the next frame. a running dedicated
+	// server is handed zero millisecond frames when a packet wakes it up, so it must
+	// always block here or it would spin
+	if( dedicated->integer && !refreshGameModule )
 	{
-		int sleeptime = min( WORLDFRAMETIME - ( accTime + 1 ), sv.nextSnapTime - ( svs.gametime + 1 ) );
-
-		if( sleeptime > 0 )
+		int sleeptime = min( WORLDFRAMETIME - accTime, sv.nextSnapTime - svs.gametime );
+		socket_t *sockets [] = { &svs.socket_udp, &svs.socket_udp6 };
+		socket_t *opened_sockets [sizeof( sockets ) / sizeof( sockets[0] ) + 1 ];
+		size_t sock_ind, open_ind;
+
+		// pending fragments go out on the next millisecond
+		if( sentFragments || sleeptime < 1 )
+			sleeptime = 1;
+
+		// Pass only the opened sockets to the sleep function
+		open_ind = 0;
+		for ( sock_ind = 0; sock_ind < sizeof( sockets ) / sizeof( sockets[0] ); sock_ind++)
 		{
-			socket_t *sockets [] = { &svs.socket_udp, &svs.socket_udp6 };
-			socket_t *opened_sockets [sizeof( sockets ) / sizeof( sockets[0] ) + 1 ];
-			size_t sock_ind, open_ind;
-
-			// Pass only the opened sockets to the sleep function
-			open_ind = 0;
-			for ( sock_ind = 0; sock_ind < sizeof( sockets ) / sizeof( sockets[0] ); sock_ind++)
+			socket_t *sock = sockets[sock_ind];
+			if ( sock->open )
 			{
-				socket_t *sock = sockets[sock_ind];
-				if ( sock->open )
-				{
-					opened_sockets[open_ind] = sock;
-					open_ind++;
-				}
+				opened_sockets[open_ind] = sock;
+				open_ind++;
 			}
-			opened_sockets[open_ind] = NULL;
-
-			NET_Sleep( sleeptime, opened_sockets );
 		}
+		opened_sockets[open_ind] = NULL;
+
+		// wake up exactly when the next world frame or snapshot is due, but never
+		// poll with a zero timeout
+		sv_sched.deadline = sv_sched.clock + (quint64)sleeptime * 1000;
+		sv_sched.deadline = max( sv_sched.deadline, Sys_Microseconds() + SV_SCHED_MIN_SLEEP_USEC );
+
+		PROF_ENTER( "sleep" );
+		if( open_ind )
+			NET_SleepUntil( sv_sched.deadline, opened_sockets );
+		else
+			Sys_Sleep( sleeptime );
+		PROF_LEAVE();
 	}
 
 	if( refreshGameModule )
@@ -529,7 +657,9 @@ static qboolean SV_RunGameFrame( int msec )
 		if( host_speeds->integer )
 			time_before_game = Sys_Milliseconds();
 
+		PROF_ENTER( "game_runframe" );
 		ge->RunFrame( moduleTime, svs.gametime );
+		PROF_LEAVE();
 
 		if( host_speeds->integer )
 			time_after_game = Sys_Milliseconds();
@@ -542,7 +672,9 @@ static qboolean SV_RunGameFrame( int msec )
 
 		// set up for sending a snapshot
 		sv.framenum++;
+		PROF_ENTER( "game_snapframe" );
 		ge->SnapFrame();
+		PROF_LEAVE();
 
 		// set time for next snapshot
 		extraSnapTime = (int)( svs.gametime - sv.nextSnapTime );
@@ -713,6 +845,7 @@ void SV_Frame( int realmsec, int gamemsec )
 	// if server is not active, do nothing
 	if( !svs.initialized )
 	{
+		sv_sched.clock = sv_sched.deadline = 0;
 		SV_CheckDefaultMap();
 		return;
 	}
@@ -720,6 +853,8 @@ void SV_Frame( int realmsec, int gamemsec )
 	svs.realtime += realmsec;
 	svs.gametime += gamemsec;
 
+	SV_Sched_BeginFrame( realmsec );
+
 	// advance to next map if the server is running for too long (numbers taken from q3 src)
 	if( svs.realtime > wrappingPoint || svs.gametime > wrappingPoint || sv.framenum >= wrappingPoint )
 	{
@@ -732,16 +867,23 @@ void SV_Frame( int realmsec, int gamemsec )
 	SV_CheckTimeouts();
 
 	// get packets from clients
+	PROF_ENTER( "sv_readpackets" );
 	SV_ReadPackets();
+	PROF_LEAVE();
 
 	// let everything in the world think and move
 	if( SV_RunGameFrame( gamemsec ) )
 	{
 		// send messages back to the clients that had packets read this frame
+		PROF_ENTER( "sv_sendmessages" );
 		SV_SendClientMessages();
+		PROF_LEAVE();
 
 		// write snap to server demo file
+		PROF_ENTER( "sv_demo" );
 		SV_Demo_WriteSnap();
+		SV_Replay_Frame();
+		PROF_LEAVE();
 
 		// run matchmaker stuff
 		SV_CheckMatchUUID();
@@ -755,8 +897,13 @@ void SV_Frame( int realmsec, int gamemsec )
 		ge->ClearSnap();
 	}
 
+	// push out everything queued on the batched sockets this frame
+	NET_FlushBatches();
+
 	// handle HTTP connections
+	PROF_ENTER( "sv_web" );
 	SV_Web_Frame();
+	PROF_LEAVE();
 
 	SV_CheckAutoUpdate();
 }
@@ -825,6 +972,7 @@ void SV_UserinfoChanged( client_t *client )
 		return;
 	}
 	Q_strncpyz( client->name, val, sizeof( client->name ) );
+	SV_InfoCache_Invalidate();
 
 #ifndef RATEKILLED
 	// rate command
@@ -938,6 +1086,12 @@ void SV_Init( void )
 
 	sv_iplimit = Cvar_Get( "sv_iplimit", "3", CVAR_ARCHIVE );
 
+	sv_oob_rate = Cvar_Get( "sv_oob_rate", "10", CVAR_ARCHIVE );
+	sv_oob_burst = Cvar_Get( "sv_oob_burst", "20", CVAR_ARCHIVE );
+	sv_oob_globalrate = Cvar_Get( "sv_oob_globalrate", "1000", CVAR_ARCHIVE );
+
+	sv_batchio = Cvar_Get( "sv_batchio", "1", CVAR_ARCHIVE | CVAR_LATCH );
+
 	sv_lastAutoUpdate = Cvar_Get( "sv_lastAutoUpdate", "0", CVAR_READONLY|CVAR_ARCHIVE );
 	sv_pure_forcemodulepk3 =    Cvar_Get( "sv_pure_forcemodulepk3", "", CVAR_LATCH );
 
@@ -961,9 +1115,14 @@ void SV_Init( void )
 		Com_Printf( "Invalid demo prefix string: %s\n", sv_demodir->string );
 		Cvar_ForceSet( "sv_demodir", "" );
 	}
+	sv_demoasync = Cvar_Get( "sv_demoasync", "1", CVAR_ARCHIVE );
+	sv_replay_time = Cvar_Get( "sv_replay_time", "0", CVAR_ARCHIVE );
+	sv_replay_maxsize = Cvar_Get( "sv_replay_maxsize", "4096", CVAR_ARCHIVE );
 
 	// wsw : jal : cap client's exceding server rules
 	sv_maxrate =		    Cvar_Get( "sv_maxrate", "0", CVAR_DEVELOPER );
+	sv_snap_adaptive =	    Cvar_Get( "sv_snap_adaptive", "1", CVAR_ARCHIVE );
+	sv_snap_maxinterval =	    Cvar_Get( "sv_snap_maxinterval", "100", CVAR_ARCHIVE );
 	sv_compresspackets =	    Cvar_Get( "sv_compresspackets", "1", CVAR_DEVELOPER );
 	sv_skilllevel =		    Cvar_Get( "sv_skilllevel", "1", CVAR_SERVERINFO|CVAR_ARCHIVE|CVAR_LATCH );
 
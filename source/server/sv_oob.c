@@ -29,6 +29,9 @@ extern cvar_t *sv_skilllevel;
 extern cvar_t *sv_reconnectlimit;     // minimum seconds between connect messages
 extern cvar_t *rcon_password;         // password for remote server commands
 extern cvar_t *sv_iplimit;
+extern cvar_t *sv_oob_rate;
+extern cvar_t *sv_oob_burst;
+extern cvar_t *sv_oob_globalrate;
 
 
 //==============================================================================
@@ -178,21 +181,243 @@ void SV_MasterHeartbeat( void )
 
 //============================================================================
 
+//==============================================================================
+//
+//CONNECTIONLESS PACKETS RATE LIMITING
+//
+//==============================================================================
+
+#define MAX_OOB_RATELIMITS			1024    // must be a power of two
+#define OOB_RATELIMIT_PROBES		8
+#define OOB_RATELIMIT_TOKEN			1000    // one packet worth of tokens, allows fractional refill
+
+typedef struct
+{
+	netadr_t adr;
+	unsigned int time;          // last refill
+	int tokens;
+} oob_ratelimit_t;
+
+typedef struct
+{
+	unsigned int received;
+	unsigned int limited;       // dropped by the per-address bucket
+	unsigned int limitedGlobal; // dropped by the global bucket
+	unsigned int rebuilds;      // info strings built
+	unsigned int cached;        // info strings served from the cache
+} oob_stats_t;
+
+static oob_ratelimit_t oob_ratelimits[MAX_OOB_RATELIMITS];
+static oob_ratelimit_t oob_globallimit;
+static oob_stats_t sv_oobstats;
+
+/*
+* SV_OOB_RefillBucket
+* Returns qtrue if the bucket had a token left for this packet
+*/
+static qboolean SV_OOB_RefillBucket( oob_ratelimit_t *bucket, unsigned int now, int rate, int burst )
+{
+	unsigned int elapsed = now - bucket->time;
+	qint64 maxtokens = (qint64)burst * OOB_RATELIMIT_TOKEN;
+	qint64 tokens;
+
+	// 64 bit math, long idle periods at high rates would wrap an int
+	tokens = (qint64)bucket->tokens + (qint64)elapsed * rate;
+	if( tokens > maxtokens )
+		tokens = maxtokens;
+	if( tokens > INT_MAX )
+		tokens = INT_MAX;
+	bucket->tokens = (int)tokens;
+	bucket->time = now;
+
+	if( bucket->tokens < OOB_RATELIMIT_TOKEN )
+		return qfalse;
+	bucket->tokens -= OOB_RATELIMIT_TOKEN;
+	return qtrue;
+}
+
+/*
+* SV_OOB_AllowPacket
+* Token bucket per base address, plus a global one so spoofed sources can't
+* make us flood the network either
+*/
+static qboolean SV_OOB_AllowPacket( const netadr_t *address )
+{
+	unsigned int i, hash, now;
+	oob_ratelimit_t *bucket, *oldest;
+
+	sv_oobstats.received++;
+
+	if( address->type == NA_LOOPBACK || sv_oob_rate->integer <= 0 )
+		return qtrue;
+
+	now = Sys_Milliseconds();
+
+	hash = NET_BaseAddressHash( address );
+	bucket = oldest = NULL;
+	for( i = 0; i < OOB_RATELIMIT_PROBES; i++ )
+	{
+		oob_ratelimit_t *entry = &oob_ratelimits[( hash + i ) & ( MAX_OOB_RATELIMITS - 1 )];
+		if( NET_CompareBaseAddress( address, &entry->adr ) )
+		{
+			bucket = entry;
+			break;
+		}
+		if( !oldest || now - entry->time > now - oldest->time )
+			oldest = entry;
+	}
+
+	if( !bucket )
+	{
+		// recycle the least recently used entry in the probe window
+		bucket = oldest;
+		bucket->adr = *address;
+		bucket->time = now;
+		bucket->tokens = max( sv_oob_burst->integer, 1 ) * OOB_RATELIMIT_TOKEN;
+	}
+
+	if( !SV_OOB_RefillBucket( bucket, now, sv_oob_rate->integer, max( sv_oob_burst->integer, 1 ) ) )
+	{
+		sv_oobstats.limited++;
+		return qfalse;
+	}
+
+	if( sv_oob_globalrate->integer > 0 &&
+		!SV_OOB_RefillBucket( &oob_globallimit, now, sv_oob_globalrate->integer, sv_oob_globalrate->integer ) )
+	{
+		sv_oobstats.limitedGlobal++;
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/*
+* SV_OOBStats_f
+*/
+void SV_OOBStats_f( void )
+{
+	Com_Printf( "Connectionless packets:\n" );
+	Com_Printf( "  received:       %u\n", sv_oobstats.received );
+	Com_Printf( "  rate limited:   %u\n", sv_oobstats.limited );
+	Com_Printf( "  global limited: %u\n", sv_oobstats.limitedGlobal );
+	Com_Printf( "Info strings:\n" );
+	Com_Printf( "  built:          %u\n", sv_oobstats.rebuilds );
+	Com_Printf( "  cached:         %u\n", sv_oobstats.cached );
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) )
+		memset( &sv_oobstats, 0, sizeof( sv_oobstats ) );
+}
+
+
+//==============================================================================
+//
+//INFO STRINGS CACHE
+//
+//==============================================================================
+
+// the status reply carries frags and pings, which change without notice,
+// so it is rebuilt at most this often even when nothing else changed
+#define SV_STATUS_CACHE_MSEC	1000
+
+#define MAX_STRING_SVCINFOSTRING 180
+#define MAX_SVCINFOSTRING_LEN ( MAX_STRING_SVCINFOSTRING - 4 )
+
+typedef struct
+{
+	qboolean valid;
+	unsigned int time;          // Sys_Milliseconds at build time
+	char string[MAX_MSGLEN - 16];
+} sv_infostring_t;
+
+typedef struct
+{
+	unsigned int modcount;      // info_modcount at build time
+	qboolean mm;                // SV_MM_Initialized at build time
+
+	qboolean counted;
+	int count, bots;
+
+	char shortinfo[MAX_STRING_SVCINFOSTRING];
+	qboolean shortinfoValid;
+
+	sv_infostring_t longinfo;   // getinfo
+	sv_infostring_t status;     // getstatus
+} sv_infocache_t;
+
+static sv_infocache_t sv_infocache;
+
+/*
+* SV_InfoCache_Invalidate
+* Must be called whenever a client enters or leaves the counted states,
+* or a client's name changes
+*/
+void SV_InfoCache_Invalidate( void )
+{
+	sv_infocache.counted = qfalse;
+	sv_infocache.shortinfoValid = qfalse;
+	sv_infocache.longinfo.valid = qfalse;
+	sv_infocache.status.valid = qfalse;
+}
+
+/*
+* SV_InfoCache_Check
+* Drops everything that depends on serverinfo cvars if any of them changed
+*/
+static void SV_InfoCache_Check( void )
+{
+	qboolean mm = SV_MM_Initialized();
+
+	if( sv_infocache.modcount != info_modcount || sv_infocache.mm != mm )
+	{
+		SV_InfoCache_Invalidate();
+		sv_infocache.modcount = info_modcount;
+		sv_infocache.mm = mm;
+	}
+}
+
+/*
+* SV_InfoCache_CountClients
+*/
+static void SV_InfoCache_CountClients( int *count, int *bots )
+{
+	int i;
+	client_t *cl;
+
+	if( !sv_infocache.counted )
+	{
+		sv_infocache.count = 0;
+		sv_infocache.bots = 0;
+		for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
+		{
+			if( cl->state >= CS_CONNECTED )
+			{
+				if( cl->edict->r.svflags & SVF_FAKECLIENT || cl->tvclient )
+					sv_infocache.bots++;
+				sv_infocache.count++;
+			}
+		}
+		sv_infocache.counted = qtrue;
+	}
+
+	*count = sv_infocache.count;
+	*bots = sv_infocache.bots;
+}
+
 /*
 * SV_LongInfoString
 * Builds the string that is sent as heartbeats and status replies
 */
-static char *SV_LongInfoString( qboolean fullStatus )
+static void SV_LongInfoString( char *status, size_t size, qboolean fullStatus )
 {
 	char tempstr[1024] = { 0 };
 	const char *gametype;
-	static char status[MAX_MSGLEN - 16];
 	int i, bots, count;
 	client_t *cl;
 	size_t statusLength;
 	size_t tempstrLength;
 
-	Q_strncpyz( status, Cvar_Serverinfo(), sizeof( status ) );
+	Q_strncpyz( status, Cvar_Serverinfo(), size );
 
 	// convert "g_gametype" to "gametype"
 	gametype = Info_ValueForKey( status, "g_gametype" );
@@ -204,26 +429,15 @@ static char *SV_LongInfoString( qboolean fullStatus )
 
 	statusLength = strlen( status );
 
-	bots = 0;
-	count = 0;
-	for( i = 0; i < sv_maxclients->integer; i++ )
-	{
-		cl = &svs.clients[i];
-		if( cl->state >= CS_CONNECTED )
-		{
-			if( cl->edict->r.svflags & SVF_FAKECLIENT || cl->tvclient )
-				bots++;
-			count++;
-		}
-	}
+	SV_InfoCache_CountClients( &count, &bots );
 
 	if( bots )
 		Q_snprintfz( tempstr, sizeof( tempstr ), "\\bots\\%i", bots );
 	Q_snprintfz( tempstr + strlen( tempstr ), sizeof( tempstr ) - strlen( tempstr ), "\\clients\\%i%s", count, fullStatus ? "\n" : "" );
 	tempstrLength = strlen( tempstr );
-	if( statusLength + tempstrLength >= sizeof( status ) )
-		return status; // can't hold any more
-	Q_strncpyz( status + statusLength, tempstr, sizeof( status ) - statusLength );
+	if( statusLength + tempstrLength >= size )
+		return; // can't hold any more
+	Q_strncpyz( status + statusLength, tempstr, size - statusLength );
 	statusLength += tempstrLength;
 
 	if ( fullStatus )
@@ -236,49 +450,34 @@ static char *SV_LongInfoString( qboolean fullStatus )
 				Q_snprintfz( tempstr, sizeof( tempstr ), "%i %i \"%s\" %i\n",
 					cl->edict->r.client->r.frags, cl->ping, cl->name, cl->edict->s.team );
 				tempstrLength = strlen( tempstr );
-				if( statusLength + tempstrLength >= sizeof( status ) )
+				if( statusLength + tempstrLength >= size )
 					break; // can't hold any more
-				Q_strncpyz( status + statusLength, tempstr, sizeof( status ) - statusLength );
+				Q_strncpyz( status + statusLength, tempstr, size - statusLength );
 				statusLength += tempstrLength;
 			}
 		}
 	}
-
-	return status;
 }
 
 /*
 * SV_ShortInfoString
 * Generates a short info string for broadcast scan replies
 */
-#define MAX_STRING_SVCINFOSTRING 180
-#define MAX_SVCINFOSTRING_LEN ( MAX_STRING_SVCINFOSTRING - 4 )
-static char *SV_ShortInfoString( void )
+static void SV_ShortInfoString( char *string, size_t size )
 {
-	static char string[MAX_STRING_SVCINFOSTRING];
 	char hostname[64];
 	char entry[20];
 	size_t len;
-	int i, count, bots;
+	int count, bots;
 	const char *password;
 
-	bots = 0;
-	count = 0;
-	for( i = 0; i < sv_maxclients->integer; i++ )
-	{
-		if( svs.clients[i].state >= CS_CONNECTED )
-		{
-			if( svs.clients[i].edict->r.svflags & SVF_FAKECLIENT || svs.clients[i].tvclient )
-				bots++;
-			count++;
-		}
-	}
+	SV_InfoCache_CountClients( &count, &bots );
 
 	//format:
 	//" \377\377\377\377info\\n\\server_name\\m\\map name\\u\\clients/maxclients\\g\\gametype\\s\\skill\\EOT "
 
 	Q_strncpyz( hostname, sv_hostname->string, sizeof( hostname ) );
-	Q_snprintfz( string, sizeof( string ),
+	Q_snprintfz( string, size,
 		"\\\\n\\\\%s\\\\m\\\\%8s\\\\u\\\\%2i/%2i\\\\",
 		hostname,
 		sv.mapname,
@@ -290,7 +489,7 @@ static char *SV_ShortInfoString( void )
 	Q_snprintfz( entry, sizeof( entry ), "g\\\\%6s\\\\", Cvar_String( "g_gametype" ) );
 	if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 	{
-		Q_strncatz( string, entry, sizeof( string ) );
+		Q_strncatz( string, entry, size );
 		len = strlen( string );
 	}
 
@@ -299,7 +498,7 @@ static char *SV_ShortInfoString( void )
 		Q_snprintfz( entry, sizeof( entry ), "mo\\\\%8s\\\\", FS_GameDirectory() );
 		if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 		{
-			Q_strncatz( string, entry, sizeof( string ) );
+			Q_strncatz( string, entry, size );
 			len = strlen( string );
 		}
 	}
@@ -309,7 +508,7 @@ static char *SV_ShortInfoString( void )
 		Q_snprintfz( entry, sizeof( entry ), "ig\\\\1\\\\" );
 		if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 		{
-			Q_strncatz( string, entry, sizeof( string ) );
+			Q_strncatz( string, entry, size );
 			len = strlen( string );
 		}
 	}
@@ -318,7 +517,7 @@ static char *SV_ShortInfoString( void )
 	Q_snprintfz( entry, sizeof( entry ), "s\\\\%1d\\\\", sv_skilllevel->integer );
 	if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 	{
-		Q_strncatz( string, entry, sizeof( string ) );
+		Q_strncatz( string, entry, size );
 		len = strlen( string );
 	}
 
@@ -328,7 +527,7 @@ static char *SV_ShortInfoString( void )
 		Q_snprintfz( entry, sizeof( entry ), "p\\\\1\\\\" );
 		if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 		{
-			Q_strncatz( string, entry, sizeof( string ) );
+			Q_strncatz( string, entry, size );
 			len = strlen( string );
 		}
 	}
@@ -338,7 +537,7 @@ static char *SV_ShortInfoString( void )
 		Q_snprintfz( entry, sizeof( entry ), "b\\\\%2i\\\\", bots > 99 ? 99 : bots );
 		if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 		{
-			Q_strncatz( string, entry, sizeof( string ) );
+			Q_strncatz( string, entry, size );
 			len = strlen( string );
 		}
 	}
@@ -348,7 +547,7 @@ static char *SV_ShortInfoString( void )
 		Q_snprintfz( entry, sizeof( entry ), "mm\\\\1\\\\" );
 		if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 		{
-			Q_strncatz( string, entry, sizeof( string ) );
+			Q_strncatz( string, entry, size );
 			len = strlen( string );
 		}
 	}
@@ -358,14 +557,64 @@ static char *SV_ShortInfoString( void )
 		Q_snprintfz( entry, sizeof( entry ), "r\\\\1\\\\" );
 		if( MAX_SVCINFOSTRING_LEN - len > strlen( entry ) )
 		{
-			Q_strncatz( string, entry, sizeof( string ) );
+			Q_strncatz( string, entry, size );
 			len = strlen( string );
 		}
 	}
 
 	// finish it
-	Q_strncatz( string, "EOT", sizeof( string ) );
-	return string;
+	Q_strncatz( string, "EOT", size );
+}
+
+
+
+/*
+* SV_GetLongInfoString
+*/
+static const char *SV_GetLongInfoString( qboolean fullStatus )
+{
+	sv_infostring_t *info = fullStatus ? &sv_infocache.status : &sv_infocache.longinfo;
+	unsigned int now = Sys_Milliseconds();
+
+	SV_InfoCache_Check();
+
+	if( fullStatus && info->valid && now - info->time >= SV_STATUS_CACHE_MSEC )
+		info->valid = qfalse;
+
+	if( !info->valid )
+	{
+		SV_LongInfoString( info->string, sizeof( info->string ), fullStatus );
+		info->time = now;
+		info->valid = qtrue;
+		sv_oobstats.rebuilds++;
+	}
+	else
+	{
+		sv_oobstats.cached++;
+	}
+
+	return info->string;
+}
+
+/*
+* SV_GetShortInfoString
+*/
+static const char *SV_GetShortInfoString( void )
+{
+	SV_InfoCache_Check();
+
+	if( !sv_infocache.shortinfoValid )
+	{
+		SV_ShortInfoString( sv_infocache.shortinfo, sizeof( sv_infocache.shortinfo ) );
+		sv_infocache.shortinfoValid = qtrue;
+		sv_oobstats.rebuilds++;
+	}
+	else
+	{
+		sv_oobstats.cached++;
+	}
+
+	return sv_infocache.shortinfo;
 }
 
 
@@ -403,8 +652,8 @@ static void SVC_Ping( const socket_t *socket, const netadr_t *address )
 */
 static void SVC_InfoResponse( const socket_t *socket, const netadr_t *address )
 {
-	int i, count;
-	char *string;
+	int i, count, bots;
+	const char *string;
 	qboolean allow_empty = qfalse, allow_full = qfalse;
 
 	if( sv_showInfoQueries->integer )
@@ -440,14 +689,8 @@ static void SVC_InfoResponse( const socket_t *socket, const netadr_t *address )
 			allow_empty = qtrue;
 	}
 
-	count = 0;
-	for( i = 0; i < sv_maxclients->integer; i++ )
-	{
-		if( svs.clients[i].state >= CS_CONNECTED )
-		{
-			count++;
-		}
-	}
+	SV_InfoCache_Check();
+	SV_InfoCache_CountClients( &count, &bots );
 
 	if( ( count == sv_maxclients->integer ) && !allow_full )
 	{
@@ -459,7 +702,7 @@ static void SVC_InfoResponse( const socket_t *socket, const netadr_t *address )
 		return;
 	}
 
-	string = SV_ShortInfoString();
+	string = SV_GetShortInfoString();
 	if( string )
 		Netchan_OutOfBandPrint( socket, address, "info\n%s", string );
 }
@@ -469,7 +712,7 @@ static void SVC_InfoResponse( const socket_t *socket, const netadr_t *address )
 */
 static void SVC_SendInfoString( const socket_t *socket, const netadr_t *address, const char *requestType, const char *responseType, qboolean fullStatus )
 {
-	char *string;
+	const char *string;
 
 	if( sv_showInfoQueries->integer )
 		Com_Printf( "%s Packet %s\n", requestType, NET_AddressToString( address ) );
@@ -491,7 +734,7 @@ static void SVC_SendInfoString( const socket_t *socket, const netadr_t *address,
 	//	return;
 
 	// send the same string that we would give for a status OOB command
-	string = SV_LongInfoString( fullStatus );
+	string = SV_GetLongInfoString( fullStatus );
 	if( string )
 		Netchan_OutOfBandPrint( socket, address, "%s\n\\challenge\\%s%s", responseType, Cmd_Argv( 1 ), string );
 }
@@ -555,7 +798,8 @@ static void SVC_GetChallenge( const socket_t *socket, const netadr_t *address )
 		i = oldest;
 	}
 
-	Netchan_OutOfBandPrint( socket, address, "challenge %i", svs.challenges[i].challenge );
+	// the dictionary checksum lets the client tell whether it can ask for dictionary compression
+	Netchan_OutOfBandPrint( socket, address, "challenge %i %u", svs.challenges[i].challenge, Netchan_DictChecksum() );
 }
 
 
@@ -576,6 +820,7 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 	char *session_id_str;
 	unsigned int ticket_id;
 	qboolean tv_client;
+	int flags, accepted_flags;
 
 	Com_DPrintf( "SVC_DirectConnect (%s)\n", Cmd_Args() );
 
@@ -598,7 +843,8 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 
 	game_port = atoi( Cmd_Argv( 2 ) );
 	challenge = atoi( Cmd_Argv( 3 ) );
-	tv_client = ( atoi( Cmd_Argv( 5 ) ) & 1 ? qtrue : qfalse );
+	flags = atoi( Cmd_Argv( 5 ) );
+	tv_client = ( flags & CONNECT_FLAG_TVCLIENT ? qtrue : qfalse );
 
 	if( !Info_Validate( Cmd_Argv( 4 ) ) )
 	{
@@ -786,8 +1032,16 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 		return;
 	}
 
+	// the client only asks for it when our dictionary checksums matched
+	accepted_flags = 0;
+	if( ( flags & CONNECT_FLAG_DICTCOMPRESSION ) && Netchan_DictChecksum() )
+	{
+		newcl->netchan.dictCompression = qtrue;
+		accepted_flags |= CONNECT_FLAG_DICTCOMPRESSION;
+	}
+
 	// send the connect packet to the client
-	Netchan_OutOfBandPrint( socket, address, "client_connect\n%s", newcl->session );
+	Netchan_OutOfBandPrint( socket, address, "client_connect\n%s\n%i", newcl->session, accepted_flags );
 
 	// free the incoming entry
 #ifdef TCP_ALLOW_CONNECT
@@ -854,6 +1108,7 @@ int SVC_FakeConnect( char *fakeUserinfo, char *fakeSocketType, const char *fakeI
 
 	// directly call the game begin function
 	newcl->state = CS_SPAWNED;
+	SV_InfoCache_Invalidate();
 	ge->ClientBegin( newcl->edict );
 
 	return NUM_FOR_EDICT( newcl->edict );
@@ -955,6 +1210,10 @@ void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, m
 	connectionless_cmd_t *cmd;
 	char *s, *c;
 
+	// drop floods before doing any parsing work
+	if( !SV_OOB_AllowPacket( address ) )
+		return;
+
 	MSG_BeginReading( msg );
 	MSG_ReadLong( msg );    // skip the -1 marker
 
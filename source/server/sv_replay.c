@@ -0,0 +1,525 @@
+/*
+Copyright (C) 2014 Chasseur de bots
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "server.h"
+
+/*
+=============================================================================
+
+PER-CLIENT REPLAY BUFFERS
+
+Each spawned client keeps the last sv_replay_time seconds of its own point
+of view in memory, encoded as demo messages. The snapshots are the very
+frames built for the client's network stream, delta compressed against
+the previous replay frame instead of the last acknowledged one. A nodelta
+keyframe is stored every SV_REPLAY_KEYFRAME_INTERVAL msecs so that a dump
+can start anywhere in the buffer. Keyframes are stored along with a copy
+of the configstrings they were built against, which a dump starting at
+the keyframe is initialized with.
+
+Dumps are handed over to the asynchronous demo writer and finished, once
+everything has been written, from SV_Replay_Frame.
+
+=============================================================================
+*/
+
+#define SV_REPLAY_KEYFRAME_INTERVAL	5000
+#define SV_REPLAY_DIR				va( "%s/replays", SV_DEMO_DIR )
+
+typedef struct
+{
+	unsigned int frameNum;
+	unsigned int gameTime;
+	size_t offset;
+	size_t length;
+	size_t csLength;					// packed configstrings preceding the message, keyframes only
+	qboolean keyframe;
+} sv_replayframe_t;
+
+struct sv_replay_s
+{
+	int spawncount;
+	unsigned int time;					// value of sv_replay_time the buffer was allocated for
+
+	qbyte *data;
+	size_t size;
+	size_t head;
+
+	sv_replayframe_t *frames;
+	unsigned int maxFrames;
+	unsigned int firstFrame;
+	unsigned int numFrames;
+
+	int lastFrame;
+	unsigned int lastKeyframeTime;
+	unsigned int reliableSequence;
+};
+
+typedef struct sv_replaydump_s
+{
+	snapDemoWriter_t *writer;
+	int file;
+	char *filename;
+	char *tempname;
+	char player[MAX_NAME_BYTES];
+	size_t meta_data_realsize;
+	char meta_data[SNAP_MAX_DEMO_META_DATA_SIZE];
+	struct sv_replaydump_s *next;
+} sv_replaydump_t;
+
+static qbyte replay_msg_buffer[MAX_MSGLEN];
+static qbyte replay_cs_buffer[MAX_CONFIGSTRINGS * ( 2 + MAX_CONFIGSTRING_CHARS )];
+
+static sv_replaydump_t *replay_dumps;
+
+/*
+* SV_Replay_Free
+*/
+void SV_Replay_Free( client_t *client )
+{
+	sv_replay_t *replay = client->replay;
+
+	if( !replay )
+		return;
+
+	Mem_Free( replay );
+	client->replay = NULL;
+}
+
+/*
+* SV_Replay_Alloc
+*/
+static sv_replay_t *SV_Replay_Alloc( client_t *client )
+{
+	sv_replay_t *replay;
+	unsigned int maxFrames;
+	size_t size;
+
+	maxFrames = sv_replay_time->integer * 1000 / svc.snapFrameTime + 2;
+	size = max( sv_replay_maxsize->integer, 256 ) * 1024;
+
+	// a single allocation for the header, the frame index and the data
+	replay = Mem_Alloc( sv_mempool, sizeof( *replay ) + maxFrames * sizeof( sv_replayframe_t ) + size );
+	replay->frames = ( sv_replayframe_t * )( ( qbyte * )replay + sizeof( *replay ) );
+	replay->maxFrames = maxFrames;
+	replay->data = ( qbyte * )( replay->frames + maxFrames );
+	replay->size = size;
+	replay->spawncount = svs.spawncount;
+	replay->time = sv_replay_time->integer;
+	replay->lastFrame = -1;
+	replay->reliableSequence = client->reliableSequence;
+
+	client->replay = replay;
+	return replay;
+}
+
+/*
+* SV_Replay_Reset
+*/
+static void SV_Replay_Reset( sv_replay_t *replay, client_t *client )
+{
+	replay->spawncount = svs.spawncount;
+	replay->head = 0;
+	replay->firstFrame = replay->numFrames = 0;
+	replay->lastFrame = -1;
+	replay->lastKeyframeTime = 0;
+	replay->reliableSequence = client->reliableSequence;
+}
+
+/*
+* SV_Replay_DropOldestFrame
+*/
+static void SV_Replay_DropOldestFrame( sv_replay_t *replay )
+{
+	replay->firstFrame = ( replay->firstFrame + 1 ) % replay->maxFrames;
+	replay->numFrames--;
+}
+
+/*
+* SV_Replay_AllocFrame
+*
+* Reserves space for a new frame in the ring, dropping the oldest frames
+* which would be overwritten.
+*/
+static sv_replayframe_t *SV_Replay_AllocFrame( sv_replay_t *replay, size_t length )
+{
+	size_t pos;
+	sv_replayframe_t *frame;
+
+	if( length > replay->size / 2 )
+		return NULL;
+
+	pos = replay->head;
+	if( pos + length > replay->size )
+	{
+		// wrap around, frames stored past the head are the oldest ones
+		while( replay->numFrames && replay->frames[replay->firstFrame].offset >= pos )
+			SV_Replay_DropOldestFrame( replay );
+		pos = 0;
+	}
+
+	while( replay->numFrames )
+	{
+		frame = &replay->frames[replay->firstFrame];
+		if( frame->offset >= pos + length || frame->offset + frame->length <= pos )
+			break;
+		SV_Replay_DropOldestFrame( replay );
+	}
+
+	if( replay->numFrames == replay->maxFrames )
+		SV_Replay_DropOldestFrame( replay );
+
+	frame = &replay->frames[( replay->firstFrame + replay->numFrames ) % replay->maxFrames];
+	frame->offset = pos;
+	frame->length = length;
+	replay->numFrames++;
+	replay->head = pos + length;
+
+	return frame;
+}
+
+/*
+* SV_Replay_PackConfigstrings
+*
+* Stores the index and the string of every non-empty configstring.
+*/
+static size_t SV_Replay_PackConfigstrings( qbyte *buffer )
+{
+	int i;
+	size_t len, size = 0;
+
+	for( i = 0; i < MAX_CONFIGSTRINGS; i++ )
+	{
+		if( !sv.configstrings[i][0] )
+			continue;
+
+		len = strlen( sv.configstrings[i] ) + 1;
+		buffer[size++] = i & 0xff;
+		buffer[size++] = i >> 8;
+		memcpy( buffer + size, sv.configstrings[i], len );
+		size += len;
+	}
+
+	return size;
+}
+
+/*
+* SV_Replay_UnpackConfigstrings
+*/
+static void SV_Replay_UnpackConfigstrings( const qbyte *buffer, size_t size, char configstrings[][MAX_CONFIGSTRING_CHARS] )
+{
+	int index;
+	size_t pos = 0;
+
+	memset( configstrings, 0, MAX_CONFIGSTRINGS * MAX_CONFIGSTRING_CHARS );
+
+	while( pos + 2 < size )
+	{
+		index = buffer[pos] | ( buffer[pos+1] << 8 );
+		pos += 2;
+		Q_strncpyz( configstrings[index], ( const char * )buffer + pos, MAX_CONFIGSTRING_CHARS );
+		pos += strlen( ( const char * )buffer + pos ) + 1;
+	}
+}
+
+/*
+* SV_Replay_RecordFrame
+*
+* Stores the snapshot which has just been built and sent to the client.
+*/
+void SV_Replay_RecordFrame( client_t *client )
+{
+	sv_replay_t *replay = client->replay;
+	sv_replayframe_t *frame;
+	msg_t msg;
+	unsigned int i, expireTime;
+	int lastframe, nodelta_frame, suppressCount;
+	size_t csLength;
+	qboolean nodelta, keyframe;
+
+	if( !sv_replay_time->integer || client->state != CS_SPAWNED || !client->edict ||
+		( client->edict->r.svflags & SVF_FAKECLIENT ) )
+	{
+		SV_Replay_Free( client );
+		return;
+	}
+
+	if( replay && replay->time != (unsigned)sv_replay_time->integer )
+	{
+		SV_Replay_Free( client );
+		replay = NULL;
+	}
+
+	if( !replay )
+		replay = SV_Replay_Alloc( client );
+	else if( replay->spawncount != svs.spawncount )
+		SV_Replay_Reset( replay, client );
+
+	keyframe = replay->lastFrame < 0 || (unsigned)replay->lastFrame + UPDATE_MASK <= sv.framenum ||
+		svs.gametime >= replay->lastKeyframeTime + SV_REPLAY_KEYFRAME_INTERVAL;
+
+	MSG_Init( &msg, replay_msg_buffer, sizeof( replay_msg_buffer ) );
+
+	// reliable commands added since the previous replay frame
+	i = replay->reliableSequence + 1;
+	if( client->reliableSequence >= MAX_RELIABLE_COMMANDS && i <= client->reliableSequence - MAX_RELIABLE_COMMANDS )
+		i = client->reliableSequence - MAX_RELIABLE_COMMANDS + 1;
+	for( ; i <= client->reliableSequence; i++ )
+	{
+		const char *cmd = client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS-1 )];
+		if( !cmd[0] )
+			continue;
+		MSG_WriteByte( &msg, svc_servercmd );
+		MSG_WriteString( &msg, cmd );
+	}
+	replay->reliableSequence = client->reliableSequence;
+
+	// write the frame again, delta compressed against the previous replay frame
+	lastframe = client->lastframe;
+	nodelta = client->nodelta;
+	nodelta_frame = client->nodelta_frame;
+	suppressCount = client->suppressCount;
+
+	client->lastframe = replay->lastFrame;
+	client->nodelta = keyframe;
+	client->suppressCount = 0;
+
+	SV_WriteFrameSnapToClient( client, &msg );
+
+	client->lastframe = lastframe;
+	client->nodelta = nodelta;
+	client->nodelta_frame = nodelta_frame;
+	client->suppressCount = suppressCount;
+
+	// expire old frames
+	expireTime = replay->time * 1000;
+	while( replay->numFrames && replay->frames[replay->firstFrame].gameTime + expireTime < svs.gametime )
+		SV_Replay_DropOldestFrame( replay );
+
+	csLength = keyframe ? SV_Replay_PackConfigstrings( replay_cs_buffer ) : 0;
+
+	frame = SV_Replay_AllocFrame( replay, csLength + msg.cursize );
+	if( !frame )
+	{
+		// couldn't store it, the next one must not reference it
+		replay->lastFrame = -1;
+		return;
+	}
+
+	memcpy( replay->data + frame->offset, replay_cs_buffer, csLength );
+	memcpy( replay->data + frame->offset + csLength, msg.data, msg.cursize );
+	frame->frameNum = sv.framenum;
+	frame->gameTime = svs.gametime;
+	frame->csLength = csLength;
+	frame->keyframe = keyframe;
+
+	replay->lastFrame = sv.framenum;
+	if( keyframe )
+		replay->lastKeyframeTime = svs.gametime;
+}
+
+/*
+* SV_Replay_FinishDump
+*/
+static void SV_Replay_FinishDump( sv_replaydump_t *dump )
+{
+	SNAP_DestroyDemoWriter( &dump->writer );
+	SNAP_StopDemoRecording( dump->file );
+	FS_FCloseFile( dump->file );
+
+	SNAP_WriteDemoMetaData( dump->tempname, dump->meta_data, dump->meta_data_realsize );
+
+	if( !FS_MoveFile( dump->tempname, dump->filename ) )
+	{
+		Com_Printf( "SV_Replay_Dump: Failed to rename the replay file\n" );
+		FS_RemoveFile( dump->tempname );
+	}
+	else
+	{
+		Com_Printf( "Saved replay of %s%s: %s\n", dump->player, S_COLOR_WHITE, dump->filename );
+	}
+
+	Mem_ZoneFree( dump->tempname );
+	Mem_ZoneFree( dump->filename );
+	Mem_ZoneFree( dump );
+}
+
+/*
+* SV_Replay_Frame
+*
+* Finishes the dumps which have been completely written.
+*/
+void SV_Replay_Frame( void )
+{
+	sv_replaydump_t *dump, **prev;
+
+	prev = &replay_dumps;
+	while( ( dump = *prev ) != NULL )
+	{
+		if( SNAP_DemoWriterPending( dump->writer ) > 0 )
+		{
+			prev = &dump->next;
+			continue;
+		}
+
+		*prev = dump->next;
+		SV_Replay_FinishDump( dump );
+	}
+}
+
+/*
+* SV_Replay_Shutdown
+*
+* Waits for all pending dumps to be written.
+*/
+void SV_Replay_Shutdown( void )
+{
+	sv_replaydump_t *dump;
+
+	while( replay_dumps )
+	{
+		dump = replay_dumps;
+		replay_dumps = dump->next;
+		SV_Replay_FinishDump( dump );
+	}
+}
+
+/*
+* SV_Replay_Dump
+*
+* Queues the last duration msecs of client's replay buffer for writing to
+* a demo file. The dump starts at the last keyframe preceding the requested time.
+*/
+qboolean SV_Replay_Dump( client_t *client, const char *name, unsigned int duration )
+{
+	sv_replay_t *replay = client->replay;
+	sv_replayframe_t *frame;
+	sv_replaydump_t *dump;
+	unsigned int i, start, startTime, lastTime;
+	int file, filename_size;
+	const char *dir;
+	char *filename, *tempname;
+	char ( *configstrings )[MAX_CONFIGSTRING_CHARS];
+	size_t queueSize;
+	msg_t msg;
+
+	if( !replay || !replay->numFrames || replay->spawncount != svs.spawncount )
+		return qfalse;
+
+	lastTime = replay->frames[( replay->firstFrame + replay->numFrames - 1 ) % replay->maxFrames].gameTime;
+	startTime = ( duration && duration < lastTime ) ? lastTime - duration : 0;
+
+	// find the keyframe to start with
+	start = replay->numFrames;
+	for( i = 0; i < replay->numFrames; i++ )
+	{
+		frame = &replay->frames[( replay->firstFrame + i ) % replay->maxFrames];
+		if( !frame->keyframe )
+			continue;
+		if( start < replay->numFrames && frame->gameTime > startTime )
+			break;
+		start = i;
+	}
+
+	if( start == replay->numFrames )
+		return qfalse;
+
+	dir = SV_REPLAY_DIR;
+	filename_size = strlen( dir ) + 1 + strlen( name ) + strlen( APP_DEMO_EXTENSION_STR ) + 1;
+	filename = Mem_ZoneMalloc( filename_size );
+	Q_snprintfz( filename, filename_size, "%s/%s", dir, name );
+
+	COM_SanitizeFilePath( filename );
+	if( !COM_ValidateRelativeFilename( filename ) )
+	{
+		Com_Printf( "SV_Replay_Dump: Invalid filename: %s\n", name );
+		Mem_ZoneFree( filename );
+		return qfalse;
+	}
+	COM_DefaultExtension( filename, APP_DEMO_EXTENSION_STR, filename_size );
+
+	tempname = Mem_ZoneMalloc( strlen( filename ) + strlen( ".rec" ) + 1 );
+	strcpy( tempname, filename );
+	strcat( tempname, ".rec" );
+
+	if( FS_FOpenFile( tempname, &file, FS_WRITE|SNAP_DEMO_GZ ) == -1 )
+	{
+		Com_Printf( "SV_Replay_Dump: Couldn't open file: %s\n", tempname );
+		Mem_ZoneFree( tempname );
+		Mem_ZoneFree( filename );
+		return qfalse;
+	}
+
+	// start with the configstrings the keyframe was built against
+	frame = &replay->frames[( replay->firstFrame + start ) % replay->maxFrames];
+	configstrings = Mem_TempMalloc( MAX_CONFIGSTRINGS * MAX_CONFIGSTRING_CHARS );
+	SV_Replay_UnpackConfigstrings( replay->data + frame->offset, frame->csLength, configstrings );
+
+	SNAP_BeginDemoRecording( file, 0x10000 + svs.spawncount, svc.snapFrameTime, sv.mapname, SV_BITFLAGS_RELIABLE,
+		svs.purelist, configstrings[0], sv.baselines );
+
+	dump = Mem_ZoneMalloc( sizeof( *dump ) );
+	dump->file = file;
+	dump->filename = filename;
+	dump->tempname = tempname;
+	Q_strncpyz( dump->player, client->name, sizeof( dump->player ) );
+
+	dump->meta_data_realsize = SNAP_ClearDemoMeta( dump->meta_data, sizeof( dump->meta_data ) );
+#define SV_SetReplayMetaKeyValue(k,v) dump->meta_data_realsize = SNAP_SetDemoMetaKeyValue(dump->meta_data, sizeof(dump->meta_data), dump->meta_data_realsize, k, v)
+	SV_SetReplayMetaKeyValue( "hostname", configstrings[CS_HOSTNAME] );
+	SV_SetReplayMetaKeyValue( "localtime", va( "%u", (unsigned)time( NULL ) ) );
+	SV_SetReplayMetaKeyValue( "multipov", "0" );
+	SV_SetReplayMetaKeyValue( "duration", va( "%u", (int)ceil( ( lastTime - frame->gameTime )/1000.0f ) ) );
+	SV_SetReplayMetaKeyValue( "mapname", configstrings[CS_MAPNAME] );
+	SV_SetReplayMetaKeyValue( "gametype", configstrings[CS_GAMETYPENAME] );
+	SV_SetReplayMetaKeyValue( "levelname", configstrings[CS_MESSAGE] );
+	SV_SetReplayMetaKeyValue( "matchname", configstrings[CS_MATCHNAME] );
+	SV_SetReplayMetaKeyValue( "matchuuid", configstrings[CS_MATCHUUID] );
+	SV_SetReplayMetaKeyValue( "player", client->name );
+#undef SV_SetReplayMetaKeyValue
+
+	Mem_TempFree( configstrings );
+
+	// make the queue large enough to take the whole dump without waiting for the disk
+	queueSize = MAX_MSGLEN;
+	for( i = start; i < replay->numFrames; i++ )
+	{
+		frame = &replay->frames[( replay->firstFrame + i ) % replay->maxFrames];
+		queueSize += ( sizeof( int ) * 2 + frame->length - frame->csLength + 3 ) & ~3;
+	}
+
+	dump->writer = SNAP_CreateDemoWriter( file, queueSize );
+
+	for( i = start; i < replay->numFrames; i++ )
+	{
+		frame = &replay->frames[( replay->firstFrame + i ) % replay->maxFrames];
+
+		MSG_Init( &msg, replay->data + frame->offset + frame->csLength, frame->length - frame->csLength );
+		msg.cursize = frame->length - frame->csLength;
+		if( dump->writer )
+			SNAP_DemoWriterRecordMessage( dump->writer, &msg, 0 );
+		else
+			SNAP_RecordDemoMessage( file, &msg, 0 );
+	}
+
+	dump->next = replay_dumps;
+	replay_dumps = dump;
+	return qtrue;
+}
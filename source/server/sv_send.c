@@ -299,7 +299,7 @@ qboolean SV_Netchan_Transmit( netchan_t *netchan, msg_t *msg )
 
 	if( sv_compresspackets->integer )
 	{
-		zerror = Netchan_CompressMessage( msg );
+		zerror = Netchan_CompressMessage( netchan, msg );
 		if( zerror < 0 )
 		{          // it's compression error, just send uncompressed
 			Com_DPrintf( "SV_Netchan_Transmit (ignoring compression): Compression error %i\n", zerror );
@@ -369,8 +369,10 @@ void SV_ResetClientFrameCounters( void )
 */
 void SV_WriteFrameSnapToClient( client_t *client, msg_t *msg )
 {
+	PROF_ENTER( "snap_write" );
 	SNAP_WriteFrameSnapToClient( &sv.gi, client, msg, sv.framenum, svs.gametime, sv.baselines,
-		&svs.client_entities, 0, NULL, NULL );
+		&svs.client_entities, 0, NULL, NULL, NULL );
+	PROF_LEAVE();
 }
 
 /*
@@ -392,19 +394,126 @@ void SV_BuildClientFrameSnap( client_t *client )
 		}
 	}
 
+	PROF_ENTER( "snap_build" );
 	svs.fatvis.skyorg = skyorg;		// HACK HACK HACK
 	SNAP_BuildClientFrameSnap( svs.cms, &sv.gi, sv.framenum, svs.gametime,
 		&svs.fatvis, client, ge->GetGameState(), 
 		&svs.client_entities,
 		qfalse, sv_mempool );
 	svs.fatvis.skyorg = NULL;
+	PROF_LEAVE();
+}
+
+#define SNAP_CONGESTION_PING	100		// ping rise over the baseline that we take as congestion
+#define SNAP_MIN_BUDGET			256		// never squeeze the entities below this many bytes
+#define SNAP_FRAME_OVERHEAD		64		// frame header, areabits and playerstate, roughly
+#define SNAP_HELD_BUDGET		1		// between paced snapshots, only send what can't wait
+
+/*
+* SV_AdaptiveSnapshots
+*/
+static qboolean SV_AdaptiveSnapshots( client_t *client )
+{
+#ifndef RATEKILLED
+	return sv_snap_adaptive->integer && !client->reliable && !client->mv && !client->tvclient;
+#else
+	return qfalse;
+#endif
+}
+
+/*
+* SV_ClientSnapshotDue
+*/
+static qboolean SV_ClientSnapshotDue( client_t *client )
+{
+	if( !SV_AdaptiveSnapshots( client ) )
+		return qtrue;
+
+	// the second check covers gametime going backwards on map changes
+	if( svs.gametime < client->nextSnapTime && client->nextSnapTime - svs.gametime <= (unsigned)client->snapInterval )
+		return qfalse;
+
+	return qtrue;
+}
+
+/*
+* SV_UpdateClientSnapRate
+*
+* Paces the snapshots of a client to its rate, backing the rate off while
+* its ping climbs well above the lowest one seen on the link. The frames
+* sent in between count towards the size of the paced snapshot.
+*/
+static void SV_UpdateClientSnapRate( client_t *client, int size, qboolean due )
+{
+#ifndef RATEKILLED
+	int interval, maxinterval;
+
+	client->snapBytes += size;
+	if( !due )
+		return;
+	size = client->snapBytes;
+	client->snapBytes = 0;
+
+	if( client->snapRate <= 0 || client->snapRate > client->rate )
+		client->snapRate = client->rate;
+
+	client->snapSize = client->snapSize ? ( client->snapSize * 7 + size ) / 8 : size;
+
+	if( client->snapPingBase <= 0 || client->ping < client->snapPingBase )
+		client->snapPingBase = client->ping;
+
+	if( svs.gametime >= client->snapRateTime || client->snapRateTime - svs.gametime > 250 )
+	{
+		client->snapRateTime = svs.gametime + 250;
+
+		if( client->ping > client->snapPingBase + SNAP_CONGESTION_PING )
+			client->snapRate = max( client->snapRate * 3 / 4, 1000 );
+		else
+			client->snapRate = min( client->snapRate + client->rate / 16, client->rate );
+
+		// let the baseline follow route changes
+		client->snapPingBase++;
+	}
+
+	maxinterval = max( sv_snap_maxinterval->integer, svc.snapFrameTime );
+	interval = client->snapSize * 1000 / client->snapRate;
+	clamp( interval, svc.snapFrameTime, maxinterval );
+
+	client->snapInterval = interval;
+	client->nextSnapTime = svs.gametime + interval - svc.snapFrameTime / 2;
+#endif
+}
+
+/*
+* SV_ClientSnapBudget
+*/
+static int SV_ClientSnapBudget( client_t *client, msg_t *msg )
+{
+#ifndef RATEKILLED
+	int budget;
+
+	if( client->snapRate <= 0 || client->snapRate > client->rate )
+		client->snapRate = client->rate;
+
+	budget = client->snapRate * max( client->snapInterval, svc.snapFrameTime ) / 1000;
+	budget -= msg->cursize + SNAP_FRAME_OVERHEAD;
+	return max( budget, SNAP_MIN_BUDGET );
+#else
+	return 0;
+#endif
 }
 
 /*
 * SV_SendClientDatagram
+* 
+* Paced clients still get a frame every snap so that reliable commands,
+* events and teleports aren't delayed or lost, only the entities which can
+* wait are held back until their next snapshot is due.
 */
 static qboolean SV_SendClientDatagram( client_t *client )
 {
+	qboolean due;
+
 	if( client->edict && ( client->edict->r.svflags & SVF_FAKECLIENT ) )
 		return qtrue;
 
@@ -412,12 +521,25 @@ static qboolean SV_SendClientDatagram( client_t *client )
 
 	SV_AddReliableCommandsToMessage( client, &tmpMessage );
 
+	due = SV_ClientSnapshotDue( client );
+	if( !SV_AdaptiveSnapshots( client ) )
+		client->snapBudget = 0;
+	else if( due )
+		client->snapBudget = SV_ClientSnapBudget( client, &tmpMessage );
+	else
+		client->snapBudget = SNAP_HELD_BUDGET;
+
 	// send over all the relevant entity_state_t
 	// and the player_state_t
 	SV_BuildClientFrameSnap( client );
 
 	SV_WriteFrameSnapToClient( client, &tmpMessage );
 
+	SV_Replay_RecordFrame( client );
+
+	if( SV_AdaptiveSnapshots( client ) )
+		SV_UpdateClientSnapRate( client, tmpMessage.cursize, due );
+
 	return SV_SendMessageToClient( client, &tmpMessage );
 }
 
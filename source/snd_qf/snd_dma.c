@@ -86,6 +86,8 @@ static void S_StopAviDemo( void );
 
 static float s_lpf_cw;
 
+static int s_numEvictions;
+
 /*
 * S_SoundList
 */
@@ -94,33 +96,132 @@ static void S_SoundList_f( void )
 	int i;
 	sfx_t *sfx;
 	sfxcache_t *sc;
-	int size, total;
+	int size, total, resident;
+	int loads, loadTime;
 
-	total = 0;
+	total = resident = 0;
+	loads = loadTime = 0;
 	for( sfx = known_sfx, i = 0; i < num_sfx; i++, sfx++ )
 	{
 		if( !sfx->name[0] )
 			continue;
+		loads += sfx->numLoads;
+		loadTime += sfx->loadTime;
 		sc = sfx->cache;
 		if( sc )
 		{
 			size = sc->length*sc->width*sc->channels;
 			total += size;
+			resident++;
 			if( sc->loopstart < sc->length )
 				Com_Printf( "L" );
 			else
 				Com_Printf( " " );
-			Com_Printf( "(%2db) %6i : %s\n", sc->width*8, size, sfx->name );
+			Com_Printf( "(%2db) %8i %5ims %2ix : %s\n", sc->width*8, size, sfx->loadTime, sfx->numLoads, sfx->name );
 		}
 		else
 		{
 			if( sfx->name[0] == '*' )
-				Com_Printf( "  placeholder : %s\n", sfx->name );
+				Com_Printf( "  placeholder                 : %s\n", sfx->name );
 			else
-				Com_Printf( "  not loaded  : %s\n", sfx->name );
+				Com_Printf( "  not loaded    %5ims %2ix : %s\n", sfx->loadTime, sfx->numLoads, sfx->name );
+		}
+	}
+	Com_Printf( "Total resident: %i bytes in %i sounds\n", total, resident );
+	if( s_cachesize->value > 0 )
+		Com_Printf( "Cache budget: %i bytes, %i evictions\n", (int)( s_cachesize->value * 1024 * 1024 ), s_numEvictions );
+	else
+		Com_Printf( "Cache budget: unlimited\n" );
+	Com_Printf( "Total load time: %i msec in %i loads\n", loadTime, loads );
+}
+
+/*
+* S_TrimSoundCache
+*
+* Frees decoded data of the least recently played sounds until the cache
+* fits into s_cachesize megabytes. Sounds referenced by a channel, a loop
+* sound or a pending playsound are never evicted.
+*/
+static void S_TrimSoundCache( const sfx_t *keep )
+{
+	int i;
+	size_t total, budget;
+	qboolean inuse[MAX_SFX];
+	sfx_t *sfx, *oldest;
+	sfxcache_t *sc;
+	playsound_t *ps;
+
+	// the main thread decodes sounds as well during registration
+	if( s_cachesize->value <= 0 || s_registering )
+		return;
+
+	budget = (size_t)( s_cachesize->value * 1024 * 1024 );
+
+	total = 0;
+	for( sfx = known_sfx, i = 0; i < num_sfx; i++, sfx++ )
+	{
+		sc = sfx->cache;
+		if( sc )
+			total += sc->length*sc->width*sc->channels;
+	}
+	if( total <= budget )
+		return;
+
+	memset( inuse, 0, sizeof( inuse ) );
+	inuse[keep - known_sfx] = qtrue;
+	for( i = 0; i < MAX_CHANNELS; i++ )
+	{
+		if( channels[i].sfx )
+			inuse[channels[i].sfx - known_sfx] = qtrue;
+	}
+	for( i = 0; i < num_loopsfx; i++ )
+	{
+		if( loop_sfx[i].sfx )
+			inuse[loop_sfx[i].sfx - known_sfx] = qtrue;
+	}
+	for( ps = s_pendingplays.next; ps != &s_pendingplays; ps = ps->next )
+		inuse[ps->sfx - known_sfx] = qtrue;
+
+	while( total > budget )
+	{
+		oldest = NULL;
+		for( sfx = known_sfx, i = 0; i < num_sfx; i++, sfx++ )
+		{
+			if( !sfx->cache || inuse[i] )
+				continue;
+			if( !oldest || sfx->lastPlayed < oldest->lastPlayed )
+				oldest = sfx;
 		}
+		if( !oldest )
+			break;
+
+		sc = oldest->cache;
+		total -= sc->length*sc->width*sc->channels;
+		oldest->cache = NULL;
+		S_Free( sc );
+		s_numEvictions++;
 	}
-	Com_Printf( "Total resident: %i\n", total );
+}
+
+/*
+* S_TouchSound
+*
+* Decodes the sound if it's not resident and marks it as recently played
+*/
+static sfxcache_t *S_TouchSound( sfx_t *sfx )
+{
+	qboolean resident;
+	sfxcache_t *sc;
+
+	resident = sfx->cache != NULL;
+	sc = S_LoadSound( sfx );
+	if( !sc )
+		return NULL;
+
+	sfx->lastPlayed = trap_Milliseconds();
+	if( !resident )
+		S_TrimSoundCache( sfx );
+	return sc;
 }
 
 /*
@@ -517,7 +618,7 @@ void S_IssuePlaysound( playsound_t *ps )
 		S_FreePlaysound( ps );
 		return;
 	}
-	sc = S_LoadSound( ps->sfx );
+	sc = S_TouchSound( ps->sfx );
 	if( !sc )
 	{
 		S_FreePlaysound( ps );
@@ -583,7 +684,7 @@ static void S_StartSound( sfx_t *sfx, const vec3_t origin, int entnum, int entch
 		return;
 
 	// make sure the sound is loaded
-	sc = S_LoadSound( sfx );
+	sc = S_TouchSound( sfx );
 	if( !sc )
 		return; // couldn't load the sound's data
 
@@ -727,7 +828,7 @@ static void S_AddLoopSounds( void )
 			continue;
 
 		sfx = loop_sfx[i].sfx;
-		sc = sfx->cache;
+		sc = S_TouchSound( sfx );
 		if( !sc )
 			continue;
 
@@ -55,6 +55,10 @@ typedef struct sfx_s
 	int registration_sequence;
 	qboolean isUrl;
 	sfxcache_t *cache;
+
+	unsigned int lastPlayed;	// LRU stamp for the sound cache, 0 if never played
+	unsigned int loadTime;		// total msec spent decoding and resampling
+	int numLoads;
 } sfx_t;
 
 typedef struct
@@ -228,6 +232,7 @@ extern dma_t dma;
 extern playsound_t s_pendingplays;
 
 extern qboolean s_active;
+extern qboolean s_registering;
 
 #define	MAX_RAW_SAMPLES	16384
 
@@ -247,6 +252,8 @@ extern cvar_t *s_swapstereo;
 extern cvar_t *s_vorbis;
 extern cvar_t *s_pseudoAcoustics;
 extern cvar_t *s_separationDelay;
+extern cvar_t *s_cachesize;
+extern cvar_t *s_preload;
 
 extern struct mempool_s *soundpool;
 
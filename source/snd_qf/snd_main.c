@@ -26,7 +26,7 @@ static sndQueue_t *s_cmdQueue;
 static struct qthread_s *s_backThread;
 
 static int		s_registration_sequence;
-static qboolean	s_registering;
+qboolean		s_registering;
 
 struct mempool_s *soundpool;
 
@@ -42,6 +42,8 @@ cvar_t *s_swapstereo;
 cvar_t *s_vorbis;
 cvar_t *s_pseudoAcoustics;
 cvar_t *s_separationDelay;
+cvar_t *s_cachesize;
+cvar_t *s_preload;
 
 sfx_t known_sfx[MAX_SFX];
 int num_sfx;
@@ -176,6 +178,20 @@ void SF_BeginRegistration( void )
 	S_FinishSoundQueue( s_cmdQueue );
 }
 
+/*
+* SF_PreloadSound
+*
+* Only sounds that were played before are decoded at registration time,
+* the rest is decoded by the sound thread when first played
+*/
+static qboolean SF_PreloadSound( const sfx_t *sfx )
+{
+	if( s_preload->integer > 1 ) {
+		return qtrue;
+	}
+	return s_preload->integer == 1 && sfx->lastPlayed != 0;
+}
+
 /*
 * SF_RegisterSound
 */
@@ -189,6 +205,9 @@ sfx_t *SF_RegisterSound( const char *name )
 	sfx = SF_FindName( name );
 	if( sfx->registration_sequence != s_registration_sequence ) {
 		sfx->registration_sequence = s_registration_sequence;
+		if( sfx->cache || !SF_PreloadSound( sfx ) ) {
+			return sfx;
+		}
 
 		// evenly balance the load between two threads during registration
 		sfxnum = sfx - known_sfx;
@@ -213,6 +232,9 @@ void SF_FreeSounds( void )
 	// wait for the queue to be processed
 	S_FinishSoundQueue( s_cmdQueue );
 
+	// keep the sound thread from trimming the cache while we're freeing it
+	s_registering = qtrue;
+
 	// free all sounds
 	for( i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++ )
 	{
@@ -235,8 +257,6 @@ void SF_EndRegistration( void )
 	// wait for the queue to be processed
 	S_FinishSoundQueue( s_cmdQueue );
 
-	s_registering = qfalse;
-
 	// free any sounds not from this registration sequence
 	for( i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++ ) {
 		if( !sfx->name[0] ) {
@@ -248,6 +268,8 @@ void SF_EndRegistration( void )
 			memset( sfx, 0, sizeof( *sfx ) );
 		}
 	}
+
+	s_registering = qfalse;
 }
 
 /*
@@ -269,6 +291,8 @@ qboolean SF_Init( void *hwnd, int maxEntities, qboolean verbose )
 	s_vorbis = trap_Cvar_Get( "s_vorbis", "1", CVAR_ARCHIVE );
 	s_pseudoAcoustics = trap_Cvar_Get( "s_pseudoAcoustics", "0", CVAR_ARCHIVE );
 	s_separationDelay = trap_Cvar_Get( "s_separationDelay", "1.0", CVAR_ARCHIVE );
+	s_cachesize = trap_Cvar_Get( "s_cachesize", "64", CVAR_ARCHIVE );
+	s_preload = trap_Cvar_Get( "s_preload", "1", CVAR_ARCHIVE );
 
 #ifdef ENABLE_PLAY
 	trap_Cmd_AddCommand( "play", SF_Play_f );
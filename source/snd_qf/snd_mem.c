@@ -270,6 +270,8 @@ sfxcache_t *S_LoadSound_Wav( sfx_t *s )
 sfxcache_t *S_LoadSound( sfx_t *s )
 {
 	const char *extension;
+	unsigned int start;
+	sfxcache_t *sc;
 
 	if( !s->name[0] )
 		return NULL;
@@ -279,19 +281,25 @@ sfxcache_t *S_LoadSound( sfx_t *s )
 		return s->cache;
 
 	extension = COM_FileExtension( s->name );
-	if( extension )
+	if( !extension )
+		return NULL;
+
+	start = trap_Milliseconds();
+
+	if( !Q_stricmp( extension, ".wav" ) )
+		sc = S_LoadSound_Wav( s );
+	else if( !Q_stricmp( extension, ".ogg" ) )
+		sc = SNDOGG_Load( s );
+	else
+		return NULL;
+
+	if( sc )
 	{
-		if( !Q_stricmp( extension, ".wav" ) )
-		{
-			return S_LoadSound_Wav( s );
-		}
-		if( !Q_stricmp( extension, ".ogg" ) )
-		{
-			return SNDOGG_Load( s );
-		}
+		s->loadTime += trap_Milliseconds() - start;
+		s->numLoads++;
 	}
 
-	return NULL;
+	return sc;
 }
 
 
@@ -21,13 +21,71 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "snd_local.h"
 
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) ) && !defined( C_ONLY )
+# define SND_MIX_SSE
+# include <emmintrin.h>
+#endif
+
 #define	PAINTBUFFER_SIZE    2048
 static portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
 static int snd_scaletable[32][256];
 static int *snd_p, snd_linear_count, snd_vol, music_vol;
 static short *snd_out;
 
-#if !defined ( id386 ) || defined ( __MACOSX__ )
+#if defined ( SND_MIX_SSE )
+/*
+* S_WriteLinearBlastStereo16
+*
+* packs_epi32 saturates exactly like the clamp in the C version
+*/
+static void S_WriteLinearBlastStereo16( void )
+{
+	int i;
+	int val;
+	__m128i a, b;
+
+	for( i = 0; i + 8 <= snd_linear_count; i += 8 )
+	{
+		a = _mm_srai_epi32( _mm_loadu_si128( ( const __m128i * )( snd_p + i ) ), 8 );
+		b = _mm_srai_epi32( _mm_loadu_si128( ( const __m128i * )( snd_p + i + 4 ) ), 8 );
+		_mm_storeu_si128( ( __m128i * )( snd_out + i ), _mm_packs_epi32( a, b ) );
+	}
+
+	for( ; i < snd_linear_count; i++ )
+	{
+		val = snd_p[i]>>8;
+		snd_out[i] = bound( -32768, val, 0x7fff );
+	}
+}
+
+/*
+* S_WriteSwappedLinearBlastStereo16
+*/
+static void S_WriteSwappedLinearBlastStereo16( void )
+{
+	int i;
+	int val;
+	__m128i a, b;
+
+	for( i = 0; i + 8 <= snd_linear_count; i += 8 )
+	{
+		a = _mm_srai_epi32( _mm_loadu_si128( ( const __m128i * )( snd_p + i ) ), 8 );
+		b = _mm_srai_epi32( _mm_loadu_si128( ( const __m128i * )( snd_p + i + 4 ) ), 8 );
+		a = _mm_shuffle_epi32( a, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+		b = _mm_shuffle_epi32( b, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+		_mm_storeu_si128( ( __m128i * )( snd_out + i ), _mm_packs_epi32( a, b ) );
+	}
+
+	for( ; i < snd_linear_count; i += 2 )
+	{
+		val = snd_p[i+1]>>8;
+		snd_out[i] = bound( -32768, val, 0x7fff );
+
+		val = snd_p[i]>>8;
+		snd_out[i+1] = bound( -32768, val, 0x7fff );
+	}
+}
+#elif !defined ( id386 ) || defined ( __MACOSX__ )
 #ifdef _WIN32
 #pragma warning( push )
 #pragma warning( disable : 4310 )       // cast truncates constant value
@@ -581,6 +639,99 @@ void S_InitScaletable( void )
 	}
 }
 
+#ifdef SND_MIX_SSE
+/*
+* S_PaintPairs_SSE2
+*
+* Adds 4 sample pairs of interleaved 16-bit samples times 0-65535 volumes
+*/
+static inline void S_PaintPairs_SSE2( portable_samplepair_t *samp, __m128i s, __m128i vol, __m128i shift )
+{
+	__m128i lo, hi;
+
+	// the multiply is signed, so volumes above 32767 come out s << 16 short
+	lo = _mm_mullo_epi16( s, vol );
+	hi = _mm_add_epi16( _mm_mulhi_epi16( s, vol ), _mm_and_si128( s, _mm_srai_epi16( vol, 15 ) ) );
+
+	_mm_storeu_si128( ( __m128i * )samp, _mm_add_epi32( _mm_loadu_si128( ( const __m128i * )samp ), 
+		_mm_sra_epi32( _mm_unpacklo_epi16( lo, hi ), shift ) ) );
+	_mm_storeu_si128( ( __m128i * )( samp + 2 ), _mm_add_epi32( _mm_loadu_si128( ( const __m128i * )( samp + 2 ) ), 
+		_mm_sra_epi32( _mm_unpackhi_epi16( lo, hi ), shift ) ) );
+}
+
+/*
+* S_PaintChannel_SSE2
+*
+* Paints ( sample * vol ) >> shift for the 8 and 16-bit paths without
+* lowpass filtering. The 8-bit paths pass scaletable[1], which is the
+* multiplier of their row. Returns the number of samples painted, the
+* caller finishes the rest.
+*/
+static unsigned int S_PaintChannel_SSE2( portable_samplepair_t *samp, const void *data, int width, int channels, 
+	unsigned int count, int leftvol, int rightvol, int shift )
+{
+	unsigned int i;
+	__m128i vol, sh, s, b;
+	const __m128i zero = _mm_setzero_si128();
+
+	if( leftvol < 0 || leftvol > 0xffff || rightvol < 0 || rightvol > 0xffff )
+		return 0;
+
+	vol = _mm_set1_epi32( (int)( (unsigned)leftvol | ( (unsigned)rightvol << 16 ) ) );
+	sh = _mm_cvtsi32_si128( shift );
+
+	if( width == 2 )
+	{
+		const short *sfx = ( const short * )data;
+
+		if( channels == 2 )
+		{
+			for( i = 0; i + 4 <= count; i += 4 )
+				S_PaintPairs_SSE2( samp + i, _mm_loadu_si128( ( const __m128i * )( sfx + i * 2 ) ), vol, sh );
+		}
+		else
+		{
+			for( i = 0; i + 8 <= count; i += 8 )
+			{
+				s = _mm_loadu_si128( ( const __m128i * )( sfx + i ) );
+				S_PaintPairs_SSE2( samp + i, _mm_unpacklo_epi16( s, s ), vol, sh );
+				S_PaintPairs_SSE2( samp + i + 4, _mm_unpackhi_epi16( s, s ), vol, sh );
+			}
+		}
+	}
+	else
+	{
+		const qbyte *sfx = ( const qbyte * )data;
+
+		// 8-bit samples are signed
+		if( channels == 2 )
+		{
+			for( i = 0; i + 8 <= count; i += 8 )
+			{
+				b = _mm_loadu_si128( ( const __m128i * )( sfx + i * 2 ) );
+				S_PaintPairs_SSE2( samp + i, _mm_srai_epi16( _mm_unpacklo_epi8( zero, b ), 8 ), vol, sh );
+				S_PaintPairs_SSE2( samp + i + 4, _mm_srai_epi16( _mm_unpackhi_epi8( zero, b ), 8 ), vol, sh );
+			}
+		}
+		else
+		{
+			for( i = 0; i + 16 <= count; i += 16 )
+			{
+				b = _mm_loadu_si128( ( const __m128i * )( sfx + i ) );
+				s = _mm_srai_epi16( _mm_unpacklo_epi8( zero, b ), 8 );
+				S_PaintPairs_SSE2( samp + i, _mm_unpacklo_epi16( s, s ), vol, sh );
+				S_PaintPairs_SSE2( samp + i + 4, _mm_unpackhi_epi16( s, s ), vol, sh );
+				s = _mm_srai_epi16( _mm_unpackhi_epi8( zero, b ), 8 );
+				S_PaintPairs_SSE2( samp + i + 8, _mm_unpacklo_epi16( s, s ), vol, sh );
+				S_PaintPairs_SSE2( samp + i + 12, _mm_unpackhi_epi16( s, s ), vol, sh );
+			}
+		}
+	}
+
+	return i;
+}
+#endif
+
 static void S_PaintChannelFrom8( channel_t *ch, sfxcache_t *sc, unsigned int count, int offset )
 {
 	unsigned int i;
@@ -609,7 +760,14 @@ static void S_PaintChannelFrom8( channel_t *ch, sfxcache_t *sc, unsigned int cou
 	{
 		sfx = (unsigned char *)sc->data + ch->pos * 2;
 
-		for( i = 0; i < count; i++, samp++ )
+#ifdef SND_MIX_SSE
+		i = S_PaintChannel_SSE2( samp, sfx, 1, 2, count, lscale[1], rscale[1], 0 );
+		samp += i;
+		sfx += i * 2;
+#else
+		i = 0;
+#endif
+		for( ; i < count; i++, samp++ )
 		{
 			samp->left += lscale[*sfx++];
 			samp->right += rscale[*sfx++];
@@ -619,7 +777,14 @@ static void S_PaintChannelFrom8( channel_t *ch, sfxcache_t *sc, unsigned int cou
 	{
 		sfx = (unsigned char *)sc->data + ch->pos;
 
-		for( i = 0; i < count; i++, samp++ )
+#ifdef SND_MIX_SSE
+		i = S_PaintChannel_SSE2( samp, sfx, 1, 1, count, lscale[1], rscale[1], 0 );
+		samp += i;
+		sfx += i;
+#else
+		i = 0;
+#endif
+		for( ; i < count; i++, samp++ )
 		{
 			j = *sfx++;
 			samp->left += lscale[j];
@@ -653,7 +818,14 @@ static void S_PaintChannelFrom16( channel_t *ch, sfxcache_t *sc, unsigned int co
 	{
 		sfx = (signed short *)sc->data + ch->pos * 2;
 
-		for( i = 0; i < count; i++, samp++ )
+#ifdef SND_MIX_SSE
+		i = S_PaintChannel_SSE2( samp, sfx, 2, 2, count, leftvol, rightvol, 8 );
+		samp += i;
+		sfx += i * 2;
+#else
+		i = 0;
+#endif
+		for( ; i < count; i++, samp++ )
 		{
 			samp->left += ( *sfx++ * leftvol ) >> 8;
 			samp->right += ( *sfx++ * rightvol ) >> 8;
@@ -663,7 +835,14 @@ static void S_PaintChannelFrom16( channel_t *ch, sfxcache_t *sc, unsigned int co
 	{
 		sfx = (signed short *)sc->data + ch->pos;
 
-		for( i = 0; i < count; i++, samp++ )
+#ifdef SND_MIX_SSE
+		i = S_PaintChannel_SSE2( samp, sfx, 2, 1, count, leftvol, rightvol, 8 );
+		samp += i;
+		sfx += i;
+#else
+		i = 0;
+#endif
+		for( ; i < count; i++, samp++ )
 		{
 			j = *sfx++;
 			samp->left += ( j * leftvol ) >> 8;
@@ -702,7 +881,14 @@ static void S_PaintChannelFrom8HQ( channel_t *ch, sfxcache_t *sc, unsigned int c
 	{
 		sfx = (unsigned char *)sc->data + ch->pos * 2;
 
-		for( i = 0; i < count; i++, samp++ )
+#ifdef SND_MIX_SSE
+		i = S_PaintChannel_SSE2( samp, sfx, 1, 2, count, lscale[1], rscale[1], 0 );
+		samp += i;
+		sfx += i * 2;
+#else
+		i = 0;
+#endif
+		for( ; i < count; i++, samp++ )
 		{
 			samp->left += lscale[*sfx++];
 			samp->right += rscale[*sfx++];
@@ -778,7 +964,14 @@ static void S_PaintChannelFrom16HQ( channel_t *ch, sfxcache_t *sc, unsigned int
 	{
 		sfx = (signed short *)sc->data + ch->pos * 2;
 
-		for( i = 0; i < count; i++, samp++ )
+#ifdef SND_MIX_SSE
+		i = S_PaintChannel_SSE2( samp, sfx, 2, 2, count, leftvol, rightvol, 8 );
+		samp += i;
+		sfx += i * 2;
+#else
+		i = 0;
+#endif
+		for( ; i < count; i++, samp++ )
 		{
 			samp->left += ( *sfx++ * leftvol ) >> 8;
 			samp->right += ( *sfx++ * rightvol ) >> 8;
@@ -0,0 +1,30 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// snd_mix_c.c -- snd_mix.c built a second time with C_ONLY, so snd_mix_test
+// can run the plain C mixer next to the SIMD one in the same program
+
+#define C_ONLY
+
+#define S_ClearPaintBuffer		S_ClearPaintBuffer_C
+#define S_InitScaletable		S_InitScaletable_C
+#define S_PaintChannels			S_PaintChannels_C
+
+#include "../snd_mix.c"
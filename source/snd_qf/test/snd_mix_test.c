@@ -0,0 +1,339 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// snd_mix_test.c -- renders a scripted scene through the SIMD mixer and the plain
+// C one and compares the DMA output byte for byte, "-bench" also times both
+
+#include "../snd_local.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# define TEST_MIXER_NAME	"SSE2"
+#else
+# define TEST_MIXER_NAME	"default"
+#endif
+
+#define NUM_TEST_SFX		24
+#define TEST_SPEED			44100
+#define TEST_SECONDS		5
+#define TEST_CHANNELS		32
+#define TEST_RING_SAMPLES	( 1 << 15 )		// mono samples, small enough for the painting to wrap around
+#define MAX_TEST_CHUNK		1024
+
+#define BENCH_SECONDS		20
+
+// ============================================================================
+
+// snd_mix.c needs these from the rest of the module
+
+sound_import_t SOUND_IMPORT;
+channel_t channels[MAX_CHANNELS];
+volatile unsigned int paintedtime;
+dma_t dma;
+playsound_t s_pendingplays;
+rawsound_t *raw_sounds[MAX_RAW_SOUNDS];
+struct mempool_s *soundpool;
+
+static cvar_t test_volume, test_musicvolume, test_swapstereo, test_pseudoAcoustics;
+cvar_t *s_volume = &test_volume;
+cvar_t *s_musicvolume = &test_musicvolume;
+cvar_t *s_swapstereo = &test_swapstereo;
+cvar_t *s_pseudoAcoustics = &test_pseudoAcoustics;
+
+void S_IssuePlaysound( playsound_t *ps )
+{
+}
+
+sfxcache_t *S_LoadSound( sfx_t *s )
+{
+	return s->cache;
+}
+
+// snd_mix_c.c
+void S_ClearPaintBuffer_C( void );
+void S_InitScaletable_C( void );
+int S_PaintChannels_C( unsigned int endtime, int dumpfile );
+
+// ============================================================================
+
+typedef struct
+{
+	const char *name;
+	void ( *InitScaletable )( void );
+	void ( *ClearPaintBuffer )( void );
+	int ( *PaintChannels )( unsigned int endtime, int dumpfile );
+} testpath_t;
+
+static const testpath_t paths[] =
+{
+	{ "C", S_InitScaletable_C, S_ClearPaintBuffer_C, S_PaintChannels_C },
+	{ TEST_MIXER_NAME, S_InitScaletable, S_ClearPaintBuffer, S_PaintChannels },
+};
+
+typedef struct
+{
+	unsigned short channels;
+	unsigned int samplebits;
+	qboolean swapstereo;
+} testformat_t;
+
+static const testformat_t formats[] =
+{
+	{ 2, 16, qfalse },
+	{ 2, 16, qtrue },
+	{ 1, 16, qfalse },
+	{ 2, 8, qfalse },
+};
+
+static sfx_t test_sfx[NUM_TEST_SFX];
+static rawsound_t *test_rawsound;
+
+/*
+* Test_Random
+*/
+static int Test_Random( unsigned int *seed, int range )
+{
+	*seed = *seed * 1103515245 + 12345;
+	return ( *seed >> 8 ) % range;
+}
+
+/*
+* Test_InitSounds
+*
+* Every width and channel count, some looping, some quiet and some loud enough
+* for the mix to clip, plus a streamed raw sound
+*/
+static void Test_InitSounds( void )
+{
+	int i, shift;
+	unsigned int j, seed = 0x7654321;
+	sfxcache_t *sc;
+
+	for( i = 0; i < NUM_TEST_SFX; i++ )
+	{
+		unsigned short width = 1 + ( i & 1 ), numchannels = 1 + ( ( i >> 1 ) & 1 );
+		unsigned int length = TEST_SPEED / 4 + Test_Random( &seed, TEST_SPEED * 2 );
+
+		sc = malloc( sizeof( *sc ) + length * width * numchannels );
+		sc->length = length;
+		sc->loopstart = ( i % 3 ) ? length : (unsigned)Test_Random( &seed, length );
+		sc->speed = TEST_SPEED;
+		sc->width = width;
+		sc->channels = numchannels;
+
+		shift = i % 5;
+		if( width == 2 )
+		{
+			for( j = 0; j < length * numchannels; j++ )
+				( (short *)sc->data )[j] = ( Test_Random( &seed, 65536 ) - 32768 ) >> shift;
+		}
+		else
+		{
+			for( j = 0; j < length * numchannels; j++ )
+				sc->data[j] = ( Test_Random( &seed, 256 ) - 128 ) >> shift;
+		}
+
+		test_sfx[i].cache = sc;
+	}
+
+	test_rawsound = malloc( sizeof( *test_rawsound ) + sizeof( portable_samplepair_t ) * ( MAX_RAW_SAMPLES - 1 ) );
+	for( j = 0; j < MAX_RAW_SAMPLES; j++ )
+	{
+		test_rawsound->rawsamples[j].left = Test_Random( &seed, 65536 ) - 32768;
+		test_rawsound->rawsamples[j].right = Test_Random( &seed, 65536 ) - 32768;
+	}
+}
+
+/*
+* Test_StartChannel
+*/
+static void Test_StartChannel( channel_t *ch, unsigned int *seed )
+{
+	sfxcache_t *sc;
+
+	memset( ch, 0, sizeof( *ch ) );
+	ch->sfx = &test_sfx[Test_Random( seed, NUM_TEST_SFX )];
+	sc = ch->sfx->cache;
+
+	ch->leftvol = Test_Random( seed, 8 ) ? Test_Random( seed, 256 ) : 0;
+	ch->rightvol = Test_Random( seed, 256 );
+	ch->pos = Test_Random( seed, sc->length / 2 );
+	ch->end = paintedtime + sc->length - ch->pos;
+	ch->autosound = Test_Random( seed, 2 );
+	ch->lpf_lcoeff = Test_Random( seed, 0x10000 );
+	ch->lpf_rcoeff = Test_Random( seed, 0x10000 );
+	if( Test_Random( seed, 2 ) )
+		ch->ldelay = Test_Random( seed, 20 );
+	else
+		ch->rdelay = Test_Random( seed, 20 );
+}
+
+/*
+* Test_Render
+*
+* Mixes seconds of a scripted scene with the given mixer, copying what each
+* paint left in the DMA ring to out, when it's not NULL
+*/
+static void Test_Render( const testpath_t *path, const testformat_t *format, int seconds, int numchannels, qbyte *out )
+{
+	int i;
+	unsigned int s, start, end, total, seed = 0x1234567;
+	unsigned int samplebytes = format->samplebits / 8;
+
+	test_volume.value = 0.8f;
+	test_musicvolume.value = 1;
+	test_swapstereo.integer = format->swapstereo;
+	test_pseudoAcoustics.value = 0;
+
+	dma.channels = format->channels;
+	dma.samplebits = format->samplebits;
+	dma.samples = TEST_RING_SAMPLES;
+	dma.speed = TEST_SPEED;
+	memset( dma.buffer, 0, dma.samples * samplebytes );
+
+	s_pendingplays.next = s_pendingplays.prev = &s_pendingplays;
+	test_rawsound->left_volume = 1 + Test_Random( &seed, 255 );
+	test_rawsound->right_volume = 1 + Test_Random( &seed, 255 );
+	test_rawsound->rawend = seconds * TEST_SPEED / 2;
+	raw_sounds[0] = test_rawsound;
+
+	path->InitScaletable();
+	path->ClearPaintBuffer();
+
+	paintedtime = 0;
+	memset( channels, 0, sizeof( channels ) );
+	for( i = 0; i < numchannels; i++ )
+		Test_StartChannel( &channels[i], &seed );
+
+	total = seconds * TEST_SPEED;
+	while( paintedtime < total )
+	{
+		start = paintedtime;
+		end = min( start + 1 + Test_Random( &seed, MAX_TEST_CHUNK ), total );
+
+		// something new every 100 msec, the lowpass filters go on and off every second
+		// and every now and then the volume changes, muting included
+		if( start / ( TEST_SPEED / 10 ) != end / ( TEST_SPEED / 10 ) )
+			Test_StartChannel( &channels[Test_Random( &seed, numchannels )], &seed );
+		test_pseudoAcoustics.value = ( start / TEST_SPEED ) & 1;
+		if( !Test_Random( &seed, 200 ) )
+		{
+			test_volume.value = Test_Random( &seed, 5 ) * 0.25f;
+			path->InitScaletable();
+		}
+
+		path->PaintChannels( end, 0 );
+
+		if( out )
+		{
+			for( s = start * dma.channels; s < end * dma.channels; s++ )
+				memcpy( out + s * samplebytes, dma.buffer + ( s & ( dma.samples - 1 ) ) * samplebytes, samplebytes );
+		}
+	}
+
+	raw_sounds[0] = NULL;
+}
+
+/*
+* Test_Check
+*/
+static int Test_Check( void )
+{
+	int f, fails = 0;
+	size_t i, size;
+	qbyte *ref, *out;
+
+	size = TEST_SECONDS * TEST_SPEED * 2 * 2;
+	ref = malloc( size );
+	out = malloc( size );
+
+	for( f = 0; f < (int)( sizeof( formats ) / sizeof( formats[0] ) ); f++ )
+	{
+		size = TEST_SECONDS * TEST_SPEED * formats[f].channels * formats[f].samplebits / 8;
+
+		Test_Render( &paths[0], &formats[f], TEST_SECONDS, TEST_CHANNELS, ref );
+		Test_Render( &paths[1], &formats[f], TEST_SECONDS, TEST_CHANNELS, out );
+
+		for( i = 0; i < size; i++ )
+		{
+			if( out[i] != ref[i] )
+			{
+				printf( "%i-bit %s%s: byte %i of %i differs (%i != %i)\n", formats[f].samplebits,
+					formats[f].channels == 2 ? "stereo" : "mono", formats[f].swapstereo ? " swapped" : "",
+					(int)i, (int)size, out[i], ref[i] );
+				fails++;
+				break;
+			}
+		}
+	}
+
+	free( ref );
+	free( out );
+
+	printf( "%i formats, %i seconds of %i channels, %s against C: %s\n", (int)( sizeof( formats ) / sizeof( formats[0] ) ),
+		TEST_SECONDS, TEST_CHANNELS, paths[1].name, fails ? "FAILED" : "passed" );
+	return fails;
+}
+
+/*
+* Test_Bench
+*/
+static void Test_Bench( void )
+{
+	int c, p;
+	double msec[2];
+	clock_t start;
+	static const int numchannels[] = { 32, MAX_CHANNELS };
+
+	printf( "msec to mix %i seconds of 16-bit stereo\n", BENCH_SECONDS );
+	for( c = 0; c < (int)( sizeof( numchannels ) / sizeof( numchannels[0] ) ); c++ )
+	{
+		printf( "%3i channels:", numchannels[c] );
+		for( p = 0; p < 2; p++ )
+		{
+			start = clock();
+			Test_Render( &paths[p], &formats[0], BENCH_SECONDS, numchannels[c], NULL );
+			msec[p] = ( clock() - start ) * 1000.0 / CLOCKS_PER_SEC;
+
+			printf( "  %s %.1f", paths[p].name, msec[p] );
+		}
+		if( msec[1] > 0 )
+			printf( "  (%.2fx)", msec[0] / msec[1] );
+		printf( "\n" );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	int i;
+
+	Test_InitSounds();
+	dma.buffer = malloc( TEST_RING_SAMPLES * 2 );
+
+	if( Test_Check() )
+		return 1;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-bench" ) )
+			Test_Bench();
+	}
+
+	return 0;
+}
@@ -0,0 +1,563 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// tv_relay_test.c -- feeds a relay of fake downstream clients through
+// TV_Relay_SendClientMessages and checks every message byte for byte against
+// building and encoding each client on its own, "-bench" also times both
+
+#include "../tv_local.h"
+
+#include "../tv_relay.h"
+#include "../tv_relay_client.h"
+
+#define NUM_TEST_PLAYERS	16
+#define NUM_TEST_ENTITIES	200
+#define NUM_TEST_FRAMES		200
+
+// the relay's own slot on the upstream server, right after the players
+#define TEST_PLAYERNUM		NUM_TEST_PLAYERS
+
+typedef struct
+{
+	relay_t *relay;
+	client_t *clients;
+	edict_t *edicts;			// the ones the tv module gives its clients
+	gclient_t *gclients;
+	qbyte ( *messages )[MAX_MSGLEN];
+	int *lengths;
+	double msec;
+	int builds;
+} testpath_t;
+
+static edict_t test_edicts[MAX_EDICTS];
+static gclient_t test_gclients[MAX_CLIENTS];
+static game_state_t test_gamestate;
+static testpath_t *test_sending;
+
+// ============================================================================
+
+// the relay code needs these from the rest of the tv server
+
+tv_t tvs;
+mempool_t *tv_mempool;
+cvar_t *tv_maxclients;
+cvar_t *developer;
+
+static cvar_t test_maxclients;
+static cvar_t test_developer;
+
+void Com_Printf( const char *format, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, format );
+	vprintf( format, argptr );
+	va_end( argptr );
+}
+
+void Com_DPrintf( const char *format, ... )
+{
+}
+
+void Com_Error( com_error_code_t code, const char *format, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, format );
+	vprintf( format, argptr );
+	va_end( argptr );
+	printf( "\n" );
+	exit( 1 );
+}
+
+void Sys_Error( const char *format, ... )
+{
+	va_list argptr;
+
+	va_start( argptr, format );
+	vprintf( format, argptr );
+	va_end( argptr );
+	printf( "\n" );
+	exit( 1 );
+}
+
+cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags )
+{
+	return NULL;
+}
+
+void Cmd_AddCommand( const char *cmd_name, xcommand_t function )
+{
+}
+
+void Cmd_RemoveCommand( const char *cmd_name )
+{
+}
+
+int Cmd_Argc( void )
+{
+	return 0;
+}
+
+char *Cmd_Argv( int arg )
+{
+	return "";
+}
+
+char *Cmd_Args( void )
+{
+	return "";
+}
+
+const char *NET_ErrorString( void )
+{
+	return "";
+}
+
+// a map where everything sees everything
+
+int CM_NumAreas( cmodel_state_t *cms )
+{
+	return 1;
+}
+
+int CM_ClusterRowSize( cmodel_state_t *cms )
+{
+	return MAX_MAP_LEAFS/8;
+}
+
+int CM_AreaRowSize( cmodel_state_t *cms )
+{
+	return 1;
+}
+
+int CM_PointLeafnum( cmodel_state_t *cms, const vec3_t p )
+{
+	return 0;
+}
+
+int CM_LeafCluster( cmodel_state_t *cms, int leafnum )
+{
+	return 0;
+}
+
+int CM_LeafArea( cmodel_state_t *cms, int leafnum )
+{
+	return 0;
+}
+
+int CM_WriteAreaBits( cmodel_state_t *cms, qbyte *buffer )
+{
+	buffer[0] = 1;
+	return 1;
+}
+
+qboolean CM_HeadnodeVisible( cmodel_state_t *cms, int headnode, qbyte *visbits )
+{
+	return qtrue;
+}
+
+void CM_MergePVS( cmodel_state_t *cms, vec3_t org, qbyte *out )
+{
+	memset( out, 0xff, MAX_MAP_LEAFS/8 );
+}
+
+int CM_MergeVisSets( cmodel_state_t *cms, vec3_t org, qbyte *pvs, qbyte *areabits )
+{
+	CM_MergePVS( cms, org, pvs );
+	areabits[0] = 1;
+	return MAX_MAP_LEAFS/8;
+}
+
+// downstream messages, as tv_downstream.c writes them, but kept instead of sent
+
+void TV_Downstream_SendServerCommand( client_t *cl, const char *format, ... )
+{
+}
+
+void TV_Downstream_UserinfoChanged( client_t *cl )
+{
+}
+
+void TV_Relay_UpstreamUserinfoChanged( relay_t *relay )
+{
+}
+
+void TV_Downstream_AddReliableCommandsToMessage( client_t *client, msg_t *msg )
+{
+	unsigned int i;
+
+	for( i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i++ )
+	{
+		if( !strlen( client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS-1 )] ) )
+			continue;
+
+		MSG_WriteByte( msg, svc_servercmd );
+		if( !client->reliable )
+			MSG_WriteLong( msg, i );
+		MSG_WriteString( msg, client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS-1 )] );
+	}
+
+	client->reliableSent = client->reliableSequence;
+	if( client->reliable )
+		client->reliableAcknowledge = client->reliableSent;
+}
+
+void TV_Downstream_InitClientMessage( client_t *client, msg_t *msg, qbyte *data, size_t size )
+{
+	if( data && size )
+		MSG_Init( msg, data, size );
+	MSG_Clear( msg );
+
+	if( !client->reliable )
+	{
+		MSG_WriteByte( msg, svc_clcack );
+		MSG_WriteLong( msg, client->clientCommandExecuted );
+		MSG_WriteLong( msg, client->UcmdReceived );
+	}
+}
+
+qboolean TV_Downstream_SendMessageToClient( client_t *client, msg_t *msg )
+{
+	int i = client - test_sending->clients;
+
+	memcpy( test_sending->messages[i], msg->data, msg->cursize );
+	test_sending->lengths[i] = msg->cursize;
+	return qtrue;
+}
+
+// ============================================================================
+
+static game_state_t *Test_GetGameState( tvm_relay_t *relay )
+{
+	return &test_gamestate;
+}
+
+static tv_module_export_t test_export;
+
+/*
+* Test_InitWorld
+*/
+static void Test_InitWorld( void )
+{
+	int i;
+	edict_t *ent;
+
+	memset( test_edicts, 0, sizeof( test_edicts ) );
+	for( i = 0; i < MAX_EDICTS; i++ )
+		test_edicts[i].s.number = i;
+
+	for( i = 1; i <= NUM_TEST_PLAYERS + 1 + NUM_TEST_ENTITIES; i++ )
+	{
+		ent = &test_edicts[i];
+		ent->r.inuse = qtrue;
+		ent->s.type = 1;		// the relay doesn't know the game's entity types
+		ent->s.modelindex = 1 + i % 7;
+		VectorSet( ent->r.mins, -16, -16, -24 );
+		VectorSet( ent->r.maxs, 16, 16, 40 );
+		if( i <= NUM_TEST_PLAYERS + 1 )
+			ent->r.client = &test_gclients[i - 1];
+	}
+
+	// the relay's own spectator slot
+	test_edicts[TEST_PLAYERNUM + 1].r.svflags = SVF_NOCLIENT;
+	test_edicts[TEST_PLAYERNUM + 1].s.modelindex = 0;
+
+	test_export.GetGameState = Test_GetGameState;
+}
+
+/*
+* Test_WorldFrame
+*
+* Players run in circles, the other entities drift along
+*/
+static void Test_WorldFrame( unsigned int frame )
+{
+	int i;
+	edict_t *ent;
+
+	for( i = 1; i <= NUM_TEST_PLAYERS + 1 + NUM_TEST_ENTITIES; i++ )
+	{
+		if( i == TEST_PLAYERNUM + 1 )
+			continue;
+
+		ent = &test_edicts[i];
+		ent->s.origin[0] = 100 * sin( ( frame + i ) * 0.05 ) + i * 8;
+		ent->s.origin[1] = 100 * cos( ( frame + i ) * 0.05 );
+		if( i > NUM_TEST_PLAYERS && ( i % 3 ) )
+			ent->s.origin[0] = i * 8;
+		ent->s.angles[1] = ( frame * 3 + i ) % 360;
+		VectorAdd( ent->s.origin, ent->r.mins, ent->r.absmin );
+		VectorAdd( ent->s.origin, ent->r.maxs, ent->r.absmax );
+
+		if( ent->r.client )
+		{
+			VectorCopy( ent->s.origin, ent->r.client->ps.pmove.origin );
+			ent->r.client->ps.stats[0] = frame & 255;
+			ent->r.client->ps.viewangles[1] = ent->s.angles[1];
+		}
+	}
+}
+
+/*
+* Test_InitPath
+*/
+static void Test_InitPath( testpath_t *path, int numclients )
+{
+	int i;
+	client_t *client;
+	relay_t *relay;
+
+	memset( path, 0, sizeof( *path ) );
+
+	path->relay = relay = calloc( 1, sizeof( relay_t ) );
+	relay->state = CA_ACTIVE;
+	relay->module_export = &test_export;
+	relay->playernum = TEST_PLAYERNUM;
+	relay->send_mutex = QMutex_Create();
+	relay->curFrame = &relay->frames[0];
+	relay->gi.edicts = test_edicts;
+	relay->gi.edict_size = sizeof( edict_t );
+	relay->gi.num_edicts = NUM_TEST_PLAYERS + 2 + NUM_TEST_ENTITIES;
+	relay->gi.max_edicts = MAX_EDICTS;
+	relay->gi.max_clients = NUM_TEST_PLAYERS + 1;
+	relay->client_entities.num_entities = numclients * UPDATE_BACKUP * MAX_SNAP_ENTITIES;
+	relay->client_entities.entities = calloc( relay->client_entities.num_entities, sizeof( entity_state_t ) );
+
+	path->clients = calloc( numclients, sizeof( client_t ) );
+	path->edicts = calloc( numclients, sizeof( edict_t ) );
+	path->gclients = calloc( numclients, sizeof( gclient_t ) );
+	path->messages = malloc( numclients * sizeof( *path->messages ) );
+	path->lengths = calloc( numclients, sizeof( int ) );
+
+	for( i = 0, client = path->clients; i < numclients; i++, client++ )
+	{
+		client->state = CS_SPAWNED;
+		client->relay = relay;
+		client->edict = &path->edicts[i];
+		client->edict->r.inuse = qtrue;
+		client->edict->r.client = &path->gclients[i];
+		client->lastframe = -1;
+
+		// a quarter connected over udp, which acks client commands in each message
+		client->reliable = ( i % 4 ) ? qtrue : qfalse;
+		client->clientCommandExecuted = i;
+		client->UcmdReceived = i * 3;
+
+		// and a few multiview ones
+		client->mv = ( i % 25 == 24 ) ? qtrue : qfalse;
+	}
+}
+
+/*
+* Test_FreePath
+*/
+static void Test_FreePath( testpath_t *path, int numclients )
+{
+	int i;
+
+	for( i = 0; i < numclients; i++ )
+		SNAP_FreeClientFrames( &path->clients[i] );
+
+	QMutex_Destroy( &path->relay->send_mutex );
+	free( path->relay->client_entities.entities );
+	free( path->relay );
+	free( path->clients );
+	free( path->edicts );
+	free( path->gclients );
+	free( path->messages );
+	free( path->lengths );
+}
+
+/*
+* Test_ClientFrame
+*
+* What the tv module does for its clients: most chase one of the first ten
+* players, every tenth flies freely
+*/
+static void Test_ClientFrame( testpath_t *path, int numclients, unsigned int frame )
+{
+	int i;
+	edict_t *ent, *chased;
+	client_t *client;
+
+	for( i = 0, client = path->clients; i < numclients; i++, client++ )
+	{
+		ent = client->edict;
+		if( i % 10 == 9 )
+		{
+			memset( &ent->s, 0, sizeof( ent->s ) );
+			ent->s.origin[0] = i * 16 + frame;
+			ent->s.origin[2] = 64;
+			ent->r.client->ps.POVnum = 1;
+		}
+		else
+		{
+			chased = &test_edicts[1 + ( i % 10 ) % NUM_TEST_PLAYERS];
+			ent->s = chased->s;
+			ent->r.client->ps = chased->r.client->ps;
+			ent->r.client->ps.pmove.pm_type = PM_CHASECAM;
+		}
+
+		// now and then a reliable command, which comes before the frame
+		if( !( ( frame + i ) % 16 ) )
+		{
+			client->reliableSequence++;
+			Q_snprintfz( client->reliableCommands[client->reliableSequence & ( MAX_RELIABLE_COMMANDS-1 )],
+				sizeof( client->reliableCommands[0] ), "cs %i \"frame %u\"", i % 32, frame );
+		}
+	}
+}
+
+/*
+* Test_SendPerClient
+*
+* The way each client was sent its frame before frames and encoded bytes were shared
+*/
+static void Test_SendPerClient( relay_t *relay )
+{
+	int i;
+	client_t *client;
+	qbyte msg_buf[MAX_MSGLEN];
+	msg_t msg;
+	snapshot_t *frame = relay->curFrame;
+
+	for( i = 0, client = tvs.clients; i < tv_maxclients->integer; i++, client++ )
+	{
+		if( client->state != CS_SPAWNED || client->relay != relay )
+			continue;
+
+		TV_Downstream_InitClientMessage( client, &msg, msg_buf, sizeof( msg_buf ) );
+		TV_Downstream_AddReliableCommandsToMessage( client, &msg );
+		TV_Relay_BuildClientFrameSnap( relay, client, NULL );
+		SNAP_WriteFrameSnapToClient( &relay->gi, client, &msg, relay->framenum, relay->serverTime, relay->baselines,
+			&relay->client_entities, frame->numgamecommands, frame->gamecommands, frame->gamecommandsData, NULL );
+		TV_Downstream_SendMessageToClient( client, &msg );
+	}
+}
+
+/*
+* Test_SendFrame
+*/
+static void Test_SendFrame( testpath_t *path, int numclients, unsigned int frame, qboolean shared )
+{
+	int i;
+	clock_t start;
+	unsigned int key;
+	relay_t *relay = path->relay;
+	client_t *client;
+
+	relay->framenum = frame;
+	relay->realtime = frame * 50;
+	relay->serverTime = frame * 50;
+
+	tvs.clients = path->clients;
+	test_sending = path;
+
+	key = relay->snapContentKey;
+	start = clock();
+	if( shared )
+		TV_Relay_SendClientMessages( relay );
+	else
+		Test_SendPerClient( relay );
+	path->msec += ( clock() - start ) * 1000.0 / CLOCKS_PER_SEC;
+	path->builds += shared ? (int)( relay->snapContentKey - key ) : numclients;
+
+	// acked with a per client ping
+	for( i = 0, client = path->clients; i < numclients; i++, client++ )
+	{
+		client->lastframe = frame - ( i % 3 );
+		client->reliableAcknowledge = client->reliableSent;
+	}
+}
+
+/*
+* Test_Run
+*/
+static int Test_Run( int numclients, qboolean timings )
+{
+	int i, mismatches = 0;
+	unsigned int frame;
+	testpath_t perclient, shared;
+
+	test_maxclients.integer = numclients;
+	tv_maxclients = &test_maxclients;
+
+	Test_InitWorld();
+	Test_InitPath( &perclient, numclients );
+	Test_InitPath( &shared, numclients );
+
+	for( frame = 1; frame <= NUM_TEST_FRAMES; frame++ )
+	{
+		Test_WorldFrame( frame );
+		Test_ClientFrame( &perclient, numclients, frame );
+		Test_ClientFrame( &shared, numclients, frame );
+
+		Test_SendFrame( &perclient, numclients, frame, qfalse );
+		Test_SendFrame( &shared, numclients, frame, qtrue );
+
+		for( i = 0; i < numclients; i++ )
+		{
+			if( perclient.lengths[i] != shared.lengths[i] || memcmp( perclient.messages[i], shared.messages[i], perclient.lengths[i] ) )
+			{
+				if( !mismatches )
+					printf( "frame %u, client %i: %i bytes, expected %i\n", frame, i, shared.lengths[i], perclient.lengths[i] );
+				mismatches++;
+			}
+		}
+	}
+
+	printf( "%i clients, %i frames: %i messages differ", numclients, NUM_TEST_FRAMES, mismatches );
+	if( timings )
+		printf( ", per client %.3f ms/frame (%i builds), shared %.3f ms/frame (%i builds)",
+			perclient.msec / NUM_TEST_FRAMES, perclient.builds, shared.msec / NUM_TEST_FRAMES, shared.builds );
+	printf( "\n" );
+
+	Test_FreePath( &perclient, numclients );
+	Test_FreePath( &shared, numclients );
+	return mismatches;
+}
+
+int main( int argc, char **argv )
+{
+	int i, fails = 0;
+	qboolean bench = qfalse;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-bench" ) )
+			bench = qtrue;
+	}
+
+	developer = &test_developer;
+
+	Memory_Init();
+	tv_mempool = Mem_AllocPool( NULL, "TV" );
+
+	fails += Test_Run( 100, bench ) ? 1 : 0;
+	if( bench )
+		fails += Test_Run( 400, bench ) ? 1 : 0;
+
+	Mem_FreePool( &tv_mempool );
+	Memory_Shutdown();
+
+	printf( "%s\n", fails ? "FAILED" : "passed" );
+	return fails ? 1 : 0;
+}
@@ -60,6 +60,30 @@ void TV_Downstream_ClientResetCommandBuffers( client_t *client, qboolean resetRe
 	memset( client->ucmds, 0, sizeof( client->ucmds ) );
 }
 
+/*
+* TV_Downstream_LockCommands
+* 
+* Relays send out their snapshots without holding the frame lock, so the
+* command queues of their clients are guarded by the relay's send_mutex
+*/
+static relay_t *TV_Downstream_LockCommands( client_t *client )
+{
+	relay_t *relay = client->relay;
+
+	if( relay && relay->send_mutex )
+		QMutex_Lock( relay->send_mutex );
+	return relay;
+}
+
+/*
+* TV_Downstream_UnlockCommands
+*/
+static void TV_Downstream_UnlockCommands( relay_t *relay )
+{
+	if( relay && relay->send_mutex )
+		QMutex_Unlock( relay->send_mutex );
+}
+
 /*
 * TV_Downstream_AddGameCommand
 */
@@ -71,6 +95,8 @@ void TV_Downstream_AddGameCommand( relay_t *relay, client_t *client, const char
 	assert( client->relay == relay );
 	assert( cmd && cmd[0] );
 
+	TV_Downstream_LockCommands( client );
+
 	client->gameCommandCurrent++;
 	index = client->gameCommandCurrent & ( MAX_RELIABLE_COMMANDS - 1 );
 	Q_strncpyz( client->gameCommands[index].command, cmd, sizeof( client->gameCommands[index].command ) );
@@ -85,6 +111,8 @@ void TV_Downstream_AddGameCommand( relay_t *relay, client_t *client, const char
 		else
 			client->gameCommands[index].framenum = tvs.lobby.framenum;
 	}
+
+	TV_Downstream_UnlockCommands( client->relay );
 }
 
 /*
@@ -308,7 +336,7 @@ static qboolean TV_Downstream_Netchan_Transmit( netchan_t *netchan, msg_t *msg )
 
 	if( tv_compresspackets->integer )
 	{
-		zerror = Netchan_CompressMessage( msg );
+		zerror = Netchan_CompressMessage( netchan, msg );
 		if( zerror < 0 )
 		{
 			// it's compression error, just send uncompressed
@@ -329,6 +357,7 @@ void TV_Downstream_AddServerCommand( client_t *client, const char *cmd )
 {
 	int index;
 	unsigned int i;
+	relay_t *relay;
 
 	assert( client );
 	assert( cmd && strlen( cmd ) );
@@ -336,6 +365,8 @@ void TV_Downstream_AddServerCommand( client_t *client, const char *cmd )
 	if( !cmd || !cmd[0] || !strlen( cmd ) )
 		return;
 
+	relay = TV_Downstream_LockCommands( client );
+
 	// ch : To avoid overflow of messages from excessive amount of configstrings
 	// we batch them here. On incoming "cs" command, we'll trackback the queue
 	// to find a pending "cs" command that has space in it. If we'll find one,
@@ -358,6 +389,7 @@ void TV_Downstream_AddServerCommand( client_t *client, const char *cmd )
 				{
 					// yahoo, put it in here
 					Q_strncatz( otherCmd, cmd + 2, MAX_STRING_CHARS - 1 );
+					TV_Downstream_UnlockCommands( relay );
 					return;
 				}
 			}
@@ -375,12 +407,17 @@ void TV_Downstream_AddServerCommand( client_t *client, const char *cmd )
 			Com_DPrintf( "cmd %5d: %s\n", i, client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS-1 )] );
 		}
 		Com_DPrintf( "cmd %5d: %s\n", i, cmd );
-		TV_Downstream_DropClient( client, DROP_TYPE_GENERAL, "Server command overflow" );
+
+		// the relay may be sending to the client from another thread
+		client->dropReason = "Server command overflow";
+		TV_Downstream_UnlockCommands( relay );
 		return;
 	}
 
 	index = client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 );
 	Q_strncpyz( client->reliableCommands[index], cmd, sizeof( client->reliableCommands[index] ) );
+
+	TV_Downstream_UnlockCommands( relay );
 }
 
 /*
@@ -493,6 +530,8 @@ void TV_Downstream_DropClient( client_t *drop, int type, const char *format, ...
 	Q_vsnprintfz( string, sizeof( string ), format, argptr );
 	va_end( argptr );
 
+	drop->dropReason = NULL;
+
 	Com_Printf( "%s" S_COLOR_WHITE " dropped: %s\n", drop->name, string );
 
 	TV_Downstream_InitClientMessage( drop, &Message, MessageData, sizeof( MessageData ) );
@@ -540,6 +579,7 @@ void TV_Downstream_DropClient( client_t *drop, int type, const char *format, ...
 	drop->edict = NULL;
 	drop->relay = NULL;
 	drop->tv = qfalse;
+	TV_Downstream_ClientHash_Remove( drop );
 	drop->state = CS_ZOMBIE;    // become free in a few seconds
 	drop->name[0] = 0;
 }
@@ -607,7 +647,7 @@ static qboolean TV_Downstream_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	/*game_port = */MSG_ReadShort( msg );
 	if( msg->compressed )
 	{
-		zerror = Netchan_DecompressMessage( msg );
+		zerror = Netchan_DecompressMessage( netchan, msg );
 		if( zerror < 0 )
 		{          // compression error. Drop the packet
 			Com_DPrintf( "TV_Downstream_ProcessPacket: Compression error %i. Dropping packet\n", zerror );
@@ -618,6 +658,58 @@ static qboolean TV_Downstream_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	return qtrue;
 }
 
+/*
+* TV_Downstream_ClientHash_Add
+*/
+void TV_Downstream_ClientHash_Add( client_t *client )
+{
+	unsigned int key;
+
+	TV_Downstream_ClientHash_Remove( client );
+
+	key = NET_ClientHashKey( &client->netchan.remoteAddress, client->netchan.game_port, CLIENTS_HASH_SIZE );
+	client->hashNext = tvs.clientsHash[key];
+	tvs.clientsHash[key] = client;
+}
+
+/*
+* TV_Downstream_ClientHash_Remove
+*/
+void TV_Downstream_ClientHash_Remove( client_t *client )
+{
+	client_t **prev;
+
+	prev = &tvs.clientsHash[NET_ClientHashKey( &client->netchan.remoteAddress, client->netchan.game_port, CLIENTS_HASH_SIZE )];
+	while( *prev )
+	{
+		if( *prev == client )
+		{
+			*prev = client->hashNext;
+			break;
+		}
+		prev = &( *prev )->hashNext;
+	}
+
+	client->hashNext = NULL;
+}
+
+/*
+* TV_Downstream_ClientHash_Find
+* Returns the connected client owning the given address and game port
+*/
+client_t *TV_Downstream_ClientHash_Find( const netadr_t *address, int game_port )
+{
+	client_t *cl;
+
+	for( cl = tvs.clientsHash[NET_ClientHashKey( address, game_port, CLIENTS_HASH_SIZE )]; cl; cl = cl->hashNext )
+	{
+		if( cl->netchan.game_port == game_port && NET_CompareBaseAddress( address, &cl->netchan.remoteAddress ) )
+			return cl;
+	}
+
+	return NULL;
+}
+
 /*
 * TV_Downstream_ReadPackets
 */
@@ -737,17 +829,11 @@ void TV_Downstream_ReadPackets( void )
 			// data follows
 
 			// check for packets from connected clients
-			for( i = 0, cl = tvs.clients; i < tv_maxclients->integer; i++, cl++ )
+			cl = TV_Downstream_ClientHash_Find( &address, game_port );
+			if( cl )
 			{
 				unsigned short remoteaddr_port, addr_port;
 
-				if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
-					continue;
-				if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
-					continue;
-				if( cl->netchan.game_port != game_port )
-					continue;
-
 				remoteaddr_port = NET_GetAddressPort( &cl->netchan.remoteAddress );
 				addr_port = NET_GetAddressPort( &address );
 				if( remoteaddr_port != addr_port )
@@ -762,7 +848,6 @@ void TV_Downstream_ReadPackets( void )
 					cl->lastPacketReceivedTime = tvs.realtime;
 					TV_Downstream_ParseClientMessage( cl, &msg );
 				}
-				break;
 			}
 		}
 	}
@@ -843,6 +928,13 @@ void TV_Downstream_CheckTimeouts( void )
 			continue;
 		}
 
+		// drops requested while the relays were running
+		if( ( client->state != CS_FREE && client->state != CS_ZOMBIE ) && client->dropReason )
+		{
+			TV_Downstream_DropClient( client, DROP_TYPE_GENERAL, "%s", client->dropReason );
+			continue;
+		}
+
 		if( ( client->state != CS_FREE && client->state != CS_ZOMBIE ) &&
 			( client->lastPacketReceivedTime + 1000 * tv_timeout->value < tvs.realtime ) )
 		{
@@ -38,6 +38,9 @@ void TV_Downstream_AddReliableCommandsToMessage( client_t *client, msg_t *msg );
 void TV_Downstream_InitClientMessage( client_t *client, msg_t *msg, qbyte *data, size_t size );
 qboolean TV_Downstream_SendMessageToClient( client_t *client, msg_t *msg );
 void TV_Downstream_DropClient( client_t *drop, int type, const char *format, ... );
+void TV_Downstream_ClientHash_Add( client_t *client );
+void TV_Downstream_ClientHash_Remove( client_t *client );
+client_t *TV_Downstream_ClientHash_Find( const netadr_t *address, int game_port );
 void TV_Downstream_ReadPackets( void );
 void TV_Downstream_CheckTimeouts( void );
 qboolean TV_Downstream_SendClientsFragments( void );
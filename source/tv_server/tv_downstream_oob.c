@@ -327,11 +327,16 @@ static qboolean TV_Downstream_ClientConnect( const socket_t *socket, const netad
 	// init the upstream
 	client->state = CS_CONNECTING;
 
+	// the slot may be reused, so unlink it before the netchan address changes
+	TV_Downstream_ClientHash_Remove( client );
+
 	if( client->individual_socket )
 		Netchan_Setup( &client->netchan, &client->socket, address, game_port );
 	else
 		Netchan_Setup( &client->netchan, socket, address, game_port );
 
+	TV_Downstream_ClientHash_Add( client );
+
 	// parse some info from the info strings
 	Q_strncpyz( client->userinfo, userinfo, sizeof( client->userinfo ) );
 	TV_Downstream_UserinfoChanged( client );
@@ -354,6 +359,7 @@ static void TV_Downstream_DirectConnect( const socket_t *socket, const netadr_t
 	client_t *cl, *newcl;
 	int i, version, game_port, challenge;
 	qboolean tv_client;
+	int flags, accepted_flags;
 
 	version = atoi( Cmd_Argv( 1 ) );
 	if( version != APP_PROTOCOL_VERSION )
@@ -373,7 +379,8 @@ static void TV_Downstream_DirectConnect( const socket_t *socket, const netadr_t
 
 	game_port = atoi( Cmd_Argv( 2 ) );
 	challenge = atoi( Cmd_Argv( 3 ) );
-	tv_client = ( atoi( Cmd_Argv( 5 ) ) & 1 ? qtrue : qfalse );
+	flags = atoi( Cmd_Argv( 5 ) );
+	tv_client = ( flags & CONNECT_FLAG_TVCLIENT ? qtrue : qfalse );
 
 	if( !Info_Validate( Cmd_Argv( 4 ) ) )
 	{
@@ -508,8 +515,16 @@ static void TV_Downstream_DirectConnect( const socket_t *socket, const netadr_t
 		return;
 	}
 
-	// send the connect packet to the client
-	Netchan_OutOfBandPrint( socket, address, "client_connect" );
+	// the client only asks for it when our dictionary checksums matched
+	accepted_flags = 0;
+	if( ( flags & CONNECT_FLAG_DICTCOMPRESSION ) && Netchan_DictChecksum() )
+	{
+		newcl->netchan.dictCompression = qtrue;
+		accepted_flags |= CONNECT_FLAG_DICTCOMPRESSION;
+	}
+
+	// send the connect packet to the client, with an empty session
+	Netchan_OutOfBandPrint( socket, address, "client_connect\n\n%i", accepted_flags );
 
 	// free the incoming entry
 #ifdef TCP_ALLOW_CONNECT
@@ -560,7 +575,7 @@ static void TV_Downstream_GetChallenge( const socket_t *socket, const netadr_t *
 		i = oldest;
 	}
 
-	Netchan_OutOfBandPrint( socket, address, "challenge %i", tvs.challenges[i].challenge );
+	Netchan_OutOfBandPrint( socket, address, "challenge %i %u", tvs.challenges[i].challenge, Netchan_DictChecksum() );
 }
 
 /*
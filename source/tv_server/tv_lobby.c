@@ -34,7 +34,7 @@ static void TV_Lobby_WriteFrameSnapToClient( client_t *client, msg_t *msg )
 
 	memset( &gi, 0, sizeof( ginfo_t ) );
 
-	SNAP_WriteFrameSnapToClient( &gi, client, msg, tvs.lobby.framenum, tvs.realtime, NULL, NULL, 0, NULL, NULL );
+	SNAP_WriteFrameSnapToClient( &gi, client, msg, tvs.lobby.framenum, tvs.realtime, NULL, NULL, 0, NULL, NULL, NULL );
 }
 
 /*
@@ -102,6 +102,7 @@ typedef struct
 	int first_entity;                   // into the circular sv_packet_entities[]
 	unsigned int sentTimeStamp;         // time at what this frame snap was sent to the clients
 	unsigned int UcmdExecuted;
+	unsigned int contentKey;          // frames with the same non-zero key have the same contents
 	game_state_t gameState;
 } client_snapshot_t;
 
@@ -164,6 +165,7 @@ typedef struct client_s
 	usercmd_t ucmds[CMD_BACKUP];        // each message will send several old cmds
 
 	unsigned int lastPacketSentTime;    // time when we sent the last message to this client
+	const char *dropReason;             // set off the main thread, the client is dropped by TV_Downstream_CheckTimeouts
 	unsigned int lastPacketReceivedTime; // time when we received the last message from this client
 	unsigned lastconnect;
 
@@ -172,6 +174,8 @@ typedef struct client_s
 	int nodelta_frame;              // when we get confirmation of this frame, the non-delta frame is trough
 	usercmd_t lastcmd;              // for filling in big drops
 	unsigned int lastSentFrameNum;  // for knowing which was last frame we sent
+	int snapBudget;                 // bytes for entities in the next snapshot, 0 for no limit
+	unsigned int *snapRefreshTime;  // [MAX_EDICTS] time each entity was last sent up to date
 
 	int frame_latency[LATENCY_COUNTS];
 	int ping;
@@ -192,8 +196,12 @@ typedef struct client_s
 	client_flood_t flood;
 
 	netchan_t netchan;
+
+	struct client_s *hashNext;	// next client in the same tvs.clientsHash bucket
 } client_t;
 
+#define CLIENTS_HASH_SIZE 256
+
 typedef struct
 {
 	int spawncount;
@@ -226,11 +234,15 @@ typedef struct
 #endif
 
 	client_t *clients;    // [tv_maxclients->integer];
+	client_t *clientsHash[CLIENTS_HASH_SIZE];   // keyed by base address and game port
 	int nummvclients;
 
 	// relay
 	int numupstreams;
 	upstream_t **upstreams; // maxrelay
+
+	qthreadpool_t *taskpool;    // runs the upstreams, NULL to run them on the main thread
+	qmutex_t *frame_mutex;      // held by upstream tasks, except while they send snapshots
 } tv_t;
 
 extern mempool_t *tv_mempool;
@@ -254,6 +266,7 @@ extern cvar_t *tv_reconnectlimit;
 extern cvar_t *tv_public;
 extern cvar_t *tv_autorecord;
 extern cvar_t *tv_lobbymusic;
+extern cvar_t *tv_threads;
 
 extern cvar_t *tv_masterservers;
 
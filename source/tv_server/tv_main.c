@@ -46,6 +46,9 @@ cvar_t *tv_tcp;
 cvar_t *tv_public;
 cvar_t *tv_autorecord;
 cvar_t *tv_lobbymusic;
+cvar_t *tv_threads;
+
+static ATTRIBUTE_TLS qboolean tv_taskthread;   // runs upstream tasks
 
 cvar_t *tv_timeout;
 cvar_t *tv_zombietime;
@@ -106,6 +109,7 @@ void TV_Init( void )
 	tv_rcon_password = Cvar_Get( "tv_rcon_password", "", 0 );
 	tv_autorecord = Cvar_Get( "tv_autorecord", "", CVAR_ARCHIVE );
 	tv_lobbymusic = Cvar_Get( "tv_lobbymusic", "", CVAR_ARCHIVE );
+	tv_threads = Cvar_Get( "tv_threads", "4", CVAR_ARCHIVE | CVAR_NOSET );
 
 	tv_masterservers = Cvar_Get( "tv_masterservers", DEFAULT_MASTER_SERVERS_IPS, CVAR_LATCH );
 
@@ -128,6 +132,7 @@ void TV_Init( void )
 	{
 		tvs.clients = NULL;
 	}
+	memset( tvs.clientsHash, 0, sizeof( tvs.clientsHash ) );
 	tvs.lobby.spawncount = rand();
 	tvs.lobby.snapFrameTime = 100;
 
@@ -207,6 +212,124 @@ void TV_Init( void )
 #endif
 
 	TV_Downstream_InitMaster();
+
+	// upstreams are run as independent tasks, 0 threads runs them on the main thread
+	if( tv_threads->integer > 0 )
+	{
+		tvs.taskpool = QThreadPool_Create( tv_threads->integer );
+		if( tvs.taskpool )
+			tvs.frame_mutex = QMutex_Create();
+		else
+			Com_Printf( "Error: Couldn't start the TV task threads\n" );
+	}
+}
+
+/*
+* TV_LockFrame
+* 
+* Everything but sending the snapshots to the relay's clients runs under
+* the frame lock: parsing, the TV module, anything that touches shared state
+*/
+void TV_LockFrame( void )
+{
+	if( tvs.frame_mutex )
+		QMutex_Lock( tvs.frame_mutex );
+}
+
+/*
+* TV_UnlockFrame
+*/
+void TV_UnlockFrame( void )
+{
+	if( tvs.frame_mutex )
+		QMutex_Unlock( tvs.frame_mutex );
+}
+
+/*
+* TV_RunUpstreamTask
+*/
+static void TV_RunUpstreamTask( void *param, int index )
+{
+	upstream_t *upstream;
+
+	tv_taskthread = ( tvs.taskpool != NULL );
+
+	TV_LockFrame();
+
+	upstream = tvs.upstreams[index];
+	if( upstream )
+		TV_Upstream_Run( upstream, *( int * )param );
+
+	TV_UnlockFrame();
+}
+
+/*
+* TV_Sleep
+* 
+* Blocks until a socket has data or an upstream has something to do
+*/
+static void TV_Sleep( void )
+{
+	int i, numsockets, timeout;
+	socket_t **sockets;
+	upstream_t *upstream;
+	client_t *client;
+	size_t mark;
+
+	// the lobby also paces the downstream checks
+	timeout = tvs.lobby.lastrun + tvs.lobby.snapFrameTime > tvs.realtime ? 
+		tvs.lobby.lastrun + tvs.lobby.snapFrameTime - tvs.realtime : 0;
+
+	for( i = 0; i < tvs.numupstreams && timeout > 0; i++ )
+	{
+		if( tvs.upstreams[i] )
+			timeout = TV_Upstream_Timeout( tvs.upstreams[i], timeout );
+	}
+
+	if( timeout <= 0 )
+		return;
+
+	mark = Mem_FrameMark();
+	sockets = Mem_FrameAlloc( sizeof( *sockets ) * ( 5 + tvs.numupstreams + tv_maxclients->integer
+#ifdef TCP_ALLOW_CONNECT
+		+ MAX_INCOMING_CONNECTIONS
+#endif
+		) );
+	numsockets = 0;
+
+	if( tvs.socket_udp.open )
+		sockets[numsockets++] = &tvs.socket_udp;
+	if( tvs.socket_udp6.open )
+		sockets[numsockets++] = &tvs.socket_udp6;
+#ifdef TCP_ALLOW_CONNECT
+	if( tvs.socket_tcp.open )
+		sockets[numsockets++] = &tvs.socket_tcp;
+	if( tvs.socket_tcp6.open )
+		sockets[numsockets++] = &tvs.socket_tcp6;
+	for( i = 0; i < MAX_INCOMING_CONNECTIONS; i++ )
+	{
+		if( tvs.incoming[i].active )
+			sockets[numsockets++] = &tvs.incoming[i].socket;
+	}
+#endif
+
+	for( i = 0; i < tvs.numupstreams; i++ )
+	{
+		upstream = tvs.upstreams[i];
+		if( upstream && upstream->individual_socket && upstream->socket_real.open )
+			sockets[numsockets++] = &upstream->socket_real;
+	}
+
+	for( i = 0, client = tvs.clients; i < tv_maxclients->integer; i++, client++ )
+	{
+		if( client->state != CS_FREE && client->individual_socket && client->socket.open )
+			sockets[numsockets++] = &client->socket;
+	}
+	sockets[numsockets] = NULL;
+
+	NET_Sleep( timeout, sockets );
+
+	Mem_FrameRelease( mark );
 }
 
 /*
@@ -215,33 +338,47 @@ void TV_Init( void )
 void TV_Frame( int realmsec, int gamemsec )
 {
 	int i;
+	qboolean sentFragments;
 
 	tvs.realtime += realmsec;
 
 	TV_Lobby_Run();
 
-	for( i = 0; i < tvs.numupstreams; i++ )
+	if( userinfo_modified )
 	{
-		if( !tvs.upstreams[i] )
-			continue;
-
-		if( userinfo_modified )
-			tvs.upstreams[i]->userinfo_modified = qtrue;
-
-		TV_Upstream_Run( tvs.upstreams[i], realmsec );
+		for( i = 0; i < tvs.numupstreams; i++ )
+		{
+			if( tvs.upstreams[i] )
+				tvs.upstreams[i]->userinfo_modified = qtrue;
+		}
+		userinfo_modified = qfalse;
 	}
-	userinfo_modified = qfalse;
 
+	PROF_ENTER( "tv_upstreams" );
+	QThreadPool_Run( tvs.taskpool, TV_RunUpstreamTask, &realmsec, tvs.numupstreams );
+	PROF_LEAVE();
+
+	PROF_ENTER( "tv_readpackets" );
 	TV_Downstream_ReadPackets();
+	PROF_LEAVE();
+
+	PROF_ENTER( "tv_sendmessages" );
 	TV_Downstream_SendClientMessages();
+	PROF_LEAVE();
+
 	TV_Downstream_CheckTimeouts();
 
 	// FIXME
-	TV_Downstream_SendClientsFragments();
+	sentFragments = TV_Downstream_SendClientsFragments();
 
 	TV_Downstream_MasterHeartbeat();
 
-	Sys_Sleep( 5 );
+	if( !sentFragments )
+	{
+		PROF_ENTER( "sleep" );
+		TV_Sleep();
+		PROF_LEAVE();
+	}
 }
 
 /*
@@ -251,6 +388,14 @@ void TV_Shutdown( const char *finalmsg )
 {
 	int i;
 
+	// fatal error on a task thread, the other tasks may still be
+	// running, so leave it all to the process exit
+	if( tv_taskthread )
+		return;
+
+	QThreadPool_Destroy( &tvs.taskpool );
+	QMutex_Destroy( &tvs.frame_mutex );
+
 	for( i = 0; i < tvs.numupstreams; i++ )
 	{
 		if( !tvs.upstreams[i] )
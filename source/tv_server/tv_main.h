@@ -23,4 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "tv_local.h"
 
+void TV_LockFrame( void );
+void TV_UnlockFrame( void );
+
 #endif // __TV_MAIN_H
@@ -171,6 +171,10 @@ void TVM_ClientBegin( tvm_relay_t *relay, edict_t *ent )
 
 	TVM_PrintMsg( relay, ent, S_COLOR_ORANGE "For more information about chase camera modes type 'chase help' at console.\n" );
 
+	// scoreboard updates are deltas against this
+	if( relay->scoreboard[0] )
+		trap_GameCmd( relay, PLAYERNUM( ent ), relay->scoreboard );
+
 	if( ent->r.client->chase.active )
 		TVM_ChaseClientEndSnapFrame( ent );
 	else
@@ -32,6 +32,19 @@ static void TVM_Cmd_Ignore_f( edict_t *ent )
 {
 }
 
+//==================
+//TVM_Cmd_ScoreboardFull_f
+//
+//The client lost track of the scoreboard
+//==================
+static void TVM_Cmd_ScoreboardFull_f( edict_t *ent )
+{
+	tvm_relay_t *relay = ent->relay;
+
+	if( relay->scoreboard[0] )
+		trap_GameCmd( relay, PLAYERNUM( ent ), relay->scoreboard );
+}
+
 //=================
 //TVM_Cmd_PlayersExt_f
 //=================
@@ -201,6 +214,7 @@ static gamecmd_t gamecmdlist[] =
 	{ "camswitch", TVM_Cmd_SwitchChaseCamMode },
 	{ "spec", TVM_Cmd_Ignore_f },
 	{ "players", TVM_Cmd_Players_f },
+	{ "scbfull", TVM_Cmd_ScoreboardFull_f },
 	{ "say", NULL },
 
 	{ NULL, NULL }
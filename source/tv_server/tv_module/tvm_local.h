@@ -63,6 +63,7 @@ struct tvm_relay_s
 	game_state_t gameState;
 	char configStrings[MAX_CONFIGSTRINGS][MAX_CONFIGSTRING_CHARS];
 	qboolean configStringsOverwritten[MAX_CONFIGSTRINGS];
+	char scoreboard[MAX_STRING_CHARS];	// last full scoreboard command from the server
 
 	int playernum;
 
@@ -47,10 +47,48 @@ static void TVM_RelayCommand_Pass( tvm_relay_t *relay, snapshot_t *frame, gcomma
 	}
 }
 
+//==================
+//TVM_RelayScoreboard
+//
+//Scoreboard deltas are built against the messages each player received,
+//which spectators joining or switching chase targets don't have, so only
+//full scoreboards are relayed, to everyone
+//==================
+static qboolean TVM_RelayScoreboard( tvm_relay_t *relay, const char *cmd )
+{
+	int i;
+	edict_t *ent;
+
+	if( !strncmp( cmd, "scbd ", 5 ) )
+		return qtrue;
+	if( strncmp( cmd, "scb ", 4 ) )
+		return qfalse;
+
+	if( !strcmp( relay->scoreboard, cmd ) )
+		return qtrue;
+	Q_strncpyz( relay->scoreboard, cmd, sizeof( relay->scoreboard ) );
+
+	for( i = 0; i < relay->local_maxclients; i++ )
+	{
+		ent = relay->local_edicts + i;
+		if( !ent->r.inuse || !ent->r.client )
+			continue;
+		if( trap_GetClientState( relay, PLAYERNUM( ent ) ) != CS_SPAWNED )
+			continue;
+
+		trap_GameCmd( relay, PLAYERNUM( ent ), relay->scoreboard );
+	}
+
+	return qtrue;
+}
+
 //==================
 //TVM_RelayCommand
 //==================
 void TVM_RelayCommand( tvm_relay_t *relay, snapshot_t *frame, gcommand_t *gcmd )
 {
+	if( TVM_RelayScoreboard( relay, frame->gamecommandsData + gcmd->commandOffset ) )
+		return;
+
 	TVM_RelayCommand_Pass( relay, frame, gcmd );
 }
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "tv_relay.h"
 
+#include "tv_main.h"
 #include "tv_upstream.h"
 #include "tv_relay_parse.h"
 #include "tv_relay_module.h"
@@ -31,26 +32,29 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <setjmp.h>
 
 // for jumping over relay handling when it's disconnected
-jmp_buf relay_abortframe;
+// relays are run from the task threads, so each one has its own
+static ATTRIBUTE_TLS jmp_buf relay_abortframe;
+static ATTRIBUTE_TLS qboolean relay_unlocked; // sending to clients without the frame lock
 
 /*
-* TV_Relay_RunSnap
+* TV_Relay_NextSnap
+* The buffered snap that is to be launched next, if any
 */
-static qboolean TV_Relay_RunSnap( relay_t *relay )
+static snapshot_t *TV_Relay_NextSnap( relay_t *relay )
 {
 	int start, i;
 
 	if( relay->state != CA_ACTIVE )
-		return qfalse;
+		return NULL;
 
 	if( !relay->lastFrame || !relay->lastFrame->valid )
-		return qfalse;
+		return NULL;
 
 	if( relay->curFrame == relay->lastFrame )
-		return qfalse;
+		return NULL;
 
 	if( !relay->map_checksum )
-		return qfalse; // not fully loaded yet
+		return NULL; // not fully loaded yet
 
 	if( relay->curFrame && relay->curFrame->valid )
 	{
@@ -67,20 +71,32 @@ static qboolean TV_Relay_RunSnap( relay_t *relay )
 	for( i = start; i <= relay->lastFrame->serverFrame; i++ )
 	{
 		if( relay->frames[i & UPDATE_MASK].valid && relay->frames[i & UPDATE_MASK].serverFrame == i )
-		{
-			// we buffer server snaps and launch them with slight delay to add smoothness
-			if( relay->serverTime < relay->frames[i & UPDATE_MASK].serverTime + relay->snapFrameTime )
-				return qfalse;
-
-			relay->curFrame = &relay->frames[i & UPDATE_MASK];
-			relay->framenum = relay->curFrame->serverFrame;
-
-			return qtrue;
-		}
+			return &relay->frames[i & UPDATE_MASK];
 	}
 	assert( qfalse ); // lastFrame has to match atleast
 
-	return qfalse;
+	return NULL;
+}
+
+/*
+* TV_Relay_RunSnap
+*/
+static qboolean TV_Relay_RunSnap( relay_t *relay )
+{
+	snapshot_t *snap;
+
+	snap = TV_Relay_NextSnap( relay );
+	if( !snap )
+		return qfalse;
+
+	// we buffer server snaps and launch them with slight delay to add smoothness
+	if( relay->serverTime < snap->serverTime + relay->snapFrameTime )
+		return qfalse;
+
+	relay->curFrame = snap;
+	relay->framenum = relay->curFrame->serverFrame;
+
+	return qtrue;
 }
 
 /*
@@ -168,6 +184,21 @@ void TV_Relay_Error( relay_t *relay, const char *format, ... )
 	longjmp( relay_abortframe, -1 );
 }
 
+/*
+* TV_Relay_DropHandler
+* An ERR_DROP while running the relay only shuts down this relay
+*/
+static void TV_Relay_DropHandler( void *context, const char *msg )
+{
+	if( relay_unlocked )
+	{
+		relay_unlocked = qfalse;
+		TV_LockFrame();
+	}
+
+	TV_Relay_Error( ( relay_t * )context, "%s", msg );
+}
+
 /*
 * TV_Relay_Shutdown
 */
@@ -232,6 +263,8 @@ void TV_Relay_Shutdown( relay_t *relay, const char *format, ... )
 	CM_ReleaseReference( relay->cms );
 	relay->cms = NULL;
 
+	QMutex_Destroy( &relay->send_mutex );
+
 	relay->state = CA_UNINITIALIZED;
 }
 
@@ -258,24 +291,55 @@ void TV_Relay_ClearState( relay_t *relay )
 */
 static msg_t *TV_Relay_GetPacket( relay_t *relay )
 {
-	packet_t *packet;
+	packetheader_t *packet;
 
 	assert( relay && relay->state > CA_UNINITIALIZED );
 
-	if( !relay->packetqueue_pos )
-		packet = relay->upstream->packetqueue;
-	else
-		packet = relay->packetqueue_pos->next;
+	packet = TV_Upstream_PeekPacket( relay->upstream, &relay->packetqueue_pos );
 
 	if( packet && ( tvs.realtime >= relay->delay ) && ( packet->time + relay->delay < tvs.realtime ) )
 	{
-		relay->packetqueue_pos = packet;
-		return &packet->msg;
+		MSG_Init( &relay->packetmsg, ( qbyte * )( packet + 1 ), packet->length );
+		relay->packetmsg.cursize = packet->length;
+		relay->packetqueue_pos += PACKET_RECORDSIZE( packet->length );
+		return &relay->packetmsg;
 	}
 
 	return NULL;
 }
 
+/*
+* TV_Relay_Timeout
+* Milliseconds until the relay has a delayed packet or a buffered snap to
+* handle, or timeout if it has neither
+*/
+int TV_Relay_Timeout( relay_t *relay, int timeout )
+{
+	packetheader_t *packet;
+	snapshot_t *snap;
+	unsigned int due;
+
+	if( relay->state <= CA_UNINITIALIZED )
+		return timeout;
+
+	packet = TV_Upstream_PeekPacket( relay->upstream, &relay->packetqueue_pos );
+
+	if( packet )
+	{
+		due = max( packet->time + relay->delay + 1, relay->delay );
+		timeout = min( timeout, due > tvs.realtime ? (int)( due - tvs.realtime ) : 0 );
+	}
+
+	snap = TV_Relay_NextSnap( relay );
+	if( snap )
+	{
+		due = snap->serverTime + relay->snapFrameTime;
+		timeout = min( timeout, due > relay->serverTime ? (int)( due - relay->serverTime ) : 0 );
+	}
+
+	return timeout;
+}
+
 /*
 * TV_Relay_NumPlayers
 */
@@ -385,6 +449,8 @@ void TV_Relay_Run( relay_t *relay, int msec )
 	if( setjmp( relay_abortframe ) )  // disconnect while running
 		return;
 
+	Com_SetDropHandler( TV_Relay_DropHandler, relay );
+
 	relay->serverTime = relay->realtime + relay->serverTimeDelta;
 
 	TV_Relay_ReadPackets( relay );
@@ -399,12 +465,18 @@ void TV_Relay_Run( relay_t *relay, int msec )
 		relay->module_export->NewFrameSnapshot( relay->module, relay->curFrame );
 		relay->module_export->SnapFrame( relay->module );
 
+		// building and sending the snapshots only touches this relay and its
+		// clients, so let the other upstreams parse and run their modules
+		TV_UnlockFrame();
+		relay_unlocked = qtrue;
 		TV_Relay_SendClientMessages( relay );
+		relay_unlocked = qfalse;
+		TV_LockFrame();
 
 		relay->module_export->ClearSnap( relay->module );
 	}
 
-	if( relay->upstream->state == CA_DISCONNECTED && relay->packetqueue_pos == relay->upstream->packetqueue_head )
+	if( relay->upstream->state == CA_DISCONNECTED && !TV_Upstream_PeekPacket( relay->upstream, &relay->packetqueue_pos ) )
 		TV_Relay_Shutdown( relay, "Out of data" );
 }
 
@@ -430,6 +502,7 @@ void TV_Relay_Init( relay_t *relay, upstream_t *upstream, int delay )
 
 	relay->state = CA_CONNECTING;
 	relay->upstream = upstream;
+	relay->packetqueue_pos = upstream->packetqueue.tail;
 
 	relay->gi.max_clients = MAX_CLIENTS;
 
@@ -439,6 +512,8 @@ void TV_Relay_Init( relay_t *relay, upstream_t *upstream, int delay )
 	relay->cms = CM_New( upstream->mempool );
 	CM_AddReference( relay->cms );
 
+	relay->send_mutex = QMutex_Create();
+
 	relay->delay = max( delay, RELAY_MIN_DELAY );
 }
 
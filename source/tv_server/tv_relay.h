@@ -29,14 +29,27 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define LOCAL_EDICT_NUM( u, n ) ( (edict_t *)( (qbyte *)u->gi.local_edicts + u->gi.local_edict_size*( n ) ) )
 #define NUM_FOR_LOCAL_EDICT( u, e ) ( ( (qbyte *)( e )-(qbyte *)u->gi.local_edicts ) / u->gi.local_edict_size )
 
-typedef struct packet_s packet_t;
-
-struct packet_s
+// upstream packets are kept until the relay's delay has passed, stored back
+// to back in a ring that only grows when the delay window doesn't fit in it
+typedef struct
 {
 	unsigned int time;
-	msg_t msg;
-	packet_t *next;
-};
+	unsigned int length;        // of the data following the header, PACKET_PADDING if it's skipped space
+} packetheader_t;
+
+#define PACKET_PADDING			0x80000000
+#define PACKET_ALIGN			8
+#define PACKET_RECORDSIZE( len ) ( ( sizeof( packetheader_t ) + ( len ) + PACKET_ALIGN - 1 ) & ~( PACKET_ALIGN - 1 ) )
+
+#define PACKETQUEUE_MIN_SIZE	0x10000
+
+typedef struct
+{
+	qbyte *data;
+	size_t size;                // power of two
+	size_t head;                // ever growing positions, wrapped by size
+	size_t tail;
+} packetqueue_t;
 
 #define RELAY_MIN_DELAY			3*1000		// 3 seconds
 
@@ -79,7 +92,8 @@ struct relay_s
 	int lastExecutedServerCommand;
 	qboolean multiview;
 
-	packet_t *packetqueue_pos;
+	size_t packetqueue_pos;     // next packet to read from the upstream's queue
+	msg_t packetmsg;
 	unsigned int delay;
 	qboolean reliable;
 
@@ -104,6 +118,8 @@ struct relay_s
 	unsigned int framenum;
 
 	client_entities_t client_entities;
+	unsigned int snapContentKey;    // last key given to a frame built for our clients
+	qmutex_t *send_mutex;       // guards the command queues of our clients while snapshots go out
 
 	// serverdata
 	int playernum;
@@ -126,5 +142,6 @@ void TV_Relay_UpstreamUserinfoChanged( relay_t *relay );
 int TV_Relay_NumPlayers( relay_t *relay );
 void TV_Relay_NameNotify( relay_t *relay, client_t *client );
 void TV_Relay_SetAudioTrack( relay_t *relay, const char *track );
+int TV_Relay_Timeout( relay_t *relay, int timeout );
 
 #endif // __TV_RELAY_H
@@ -25,15 +25,40 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "tv_relay.h"
 #include "tv_downstream.h"
 
+/*
+* TV_Relay_GetSnapPOV
+*/
+static void TV_Relay_GetSnapPOV( client_t *client, relay_snappov_t *pov )
+{
+	edict_t *clent = client->edict;
+
+	memset( pov, 0, sizeof( *pov ) );
+	pov->mv = client->mv;
+	if( !clent )
+		return;
+
+	pov->edict = qtrue;
+	memcpy( &pov->s, &clent->s, sizeof( pov->s ) );
+	if( clent->r.client )
+		memcpy( &pov->ps, &clent->r.client->ps, sizeof( pov->ps ) );
+	pov->svflags = clent->r.svflags;
+}
+
 /*
 * TV_Relay_BuildClientFrameSnap
+*
+* If snapgroups is given, the frame is copied from a client which has
+* already been given one from the same point of view this frame
 */
-void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client )
+void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client, relay_snapgroups_t *snapgroups )
 {
+	int i;
 	edict_t *clent;
 	entity_state_t backup_state = { 0 };
 	entity_shared_t backup_shared = { 0 };
 	vec_t *skyorg = NULL, origin[3];
+	relay_snappov_t pov;
+	relay_snapgroup_t *group;
 
 	if( relay->configstrings[CS_SKYBOX][0] != '\0' )
 	{
@@ -76,11 +101,43 @@ void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client )
 		}
 	}
 
-	relay->fatvis.skyorg = skyorg;		// HACK HACK HACK
-	SNAP_BuildClientFrameSnap( relay->cms, &relay->gi, relay->framenum, relay->realtime, &relay->fatvis,
-		client, relay->module_export->GetGameState( relay->module ),
-		&relay->client_entities,
-		qtrue, tv_mempool );
+	group = NULL;
+	if( snapgroups )
+	{
+		TV_Relay_GetSnapPOV( client, &pov );
+		for( i = 0; i < snapgroups->numGroups; i++ )
+		{
+			if( !memcmp( &snapgroups->groups[i].pov, &pov, sizeof( pov ) ) )
+			{
+				group = &snapgroups->groups[i];
+				break;
+			}
+		}
+	}
+
+	if( group )
+	{
+		SNAP_CopyClientFrameSnap( relay->cms, client, group->client, relay->framenum, tv_mempool );
+	}
+	else
+	{
+		relay->fatvis.skyorg = skyorg;		// HACK HACK HACK
+		SNAP_BuildClientFrameSnap( relay->cms, &relay->gi, relay->framenum, relay->realtime, &relay->fatvis,
+			client, relay->module_export->GetGameState( relay->module ),
+			&relay->client_entities,
+			qtrue, tv_mempool );
+
+		if( snapgroups && snapgroups->numGroups < snapgroups->maxGroups )
+		{
+			if( !++relay->snapContentKey )
+				relay->snapContentKey++;
+			client->snapShots[relay->framenum & UPDATE_MASK].contentKey = relay->snapContentKey;
+
+			group = &snapgroups->groups[snapgroups->numGroups++];
+			group->pov = pov;
+			group->client = client;
+		}
+	}
 
 	if( relay->playernum >= 0 )
 	{
@@ -93,7 +150,8 @@ void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client )
 /*
 * TV_Relay_SendClientDatagram
 */
-static qboolean TV_Relay_SendClientDatagram( relay_t *relay, client_t *client )
+static qboolean TV_Relay_SendClientDatagram( relay_t *relay, client_t *client, relay_snapgroups_t *snapgroups,
+											snap_bodycache_t *bodycache )
 {
 	qbyte msg_buf[MAX_MSGLEN];
 	msg_t msg;
@@ -109,11 +167,11 @@ static qboolean TV_Relay_SendClientDatagram( relay_t *relay, client_t *client )
 
 	// send over all the relevant entity_state_t
 	// and the player_state_t
-	TV_Relay_BuildClientFrameSnap( relay, client );
+	TV_Relay_BuildClientFrameSnap( relay, client, snapgroups );
 
 	frame = relay->curFrame;
 	SNAP_WriteFrameSnapToClient( &relay->gi, client, &msg, relay->framenum, relay->serverTime, relay->baselines,
-		&relay->client_entities, frame->numgamecommands, frame->gamecommands, frame->gamecommandsData );
+		&relay->client_entities, frame->numgamecommands, frame->gamecommands, frame->gamecommandsData, bodycache );
 
 	return TV_Downstream_SendMessageToClient( client, &msg );
 }
@@ -163,14 +221,32 @@ void TV_Relay_ReconnectClients( relay_t *relay )
 
 /*
 * TV_Relay_SendClientMessages
+* 
+* May run without the frame lock held, so only the relay and its own clients
+* are touched, and failing clients are left for TV_Downstream_CheckTimeouts
 */
 void TV_Relay_SendClientMessages( relay_t *relay )
 {
 	int i;
+	size_t mark;
 	client_t *client;
+	relay_snapgroups_t snapgroups;
+	snap_bodycache_t bodycache;
 
 	assert( relay );
 
+	// clients watching from the same point of view share their frame, and
+	// the ones which also share the delta base share the encoded bytes
+	mark = Mem_FrameMark();
+
+	snapgroups.numGroups = 0;
+	snapgroups.maxGroups = tv_maxclients->integer;
+	snapgroups.groups = Mem_FrameAlloc( sizeof( *snapgroups.groups ) * snapgroups.maxGroups );
+
+	bodycache.numBodies = 0;
+	bodycache.maxBodies = tv_maxclients->integer;
+	bodycache.bodies = Mem_FrameAlloc( sizeof( *bodycache.bodies ) * bodycache.maxBodies );
+
 	// send a message to each connected client
 	for( i = 0, client = tvs.clients; i < tv_maxclients->integer; i++, client++ )
 	{
@@ -179,16 +255,17 @@ void TV_Relay_SendClientMessages( relay_t *relay )
 		if( client->relay != relay )
 			continue;
 
-		if( !TV_Relay_SendClientDatagram( relay, client ) )
+		QMutex_Lock( relay->send_mutex );
+		if( !TV_Relay_SendClientDatagram( relay, client, &snapgroups, &bodycache ) )
 		{
 			Com_Printf( "%s" S_COLOR_WHITE ": Error sending message: %s\n", client->name, NET_ErrorString() );
 			if( client->reliable )
-			{
-				TV_Downstream_DropClient( client, DROP_TYPE_GENERAL, "Error sending message: %s\n",
-					NET_ErrorString() );
-			}
+				client->dropReason = "Error sending message";
 		}
+		QMutex_Unlock( relay->send_mutex );
 	}
+
+	Mem_FrameRelease( mark );
 }
 
 /*
@@ -265,7 +342,7 @@ qboolean TV_Relay_CanConnect( relay_t *relay, client_t *client, char *userinfo )
 */
 void TV_Relay_ClientConnect( relay_t *relay, client_t *client )
 {
-	int edictnum;
+	int i, edictnum;
 
 	assert( relay );
 	assert( relay->module_export );
@@ -275,6 +352,10 @@ void TV_Relay_ClientConnect( relay_t *relay, client_t *client )
 	client->edict = LOCAL_EDICT_NUM( relay, edictnum );
 	client->relay = relay;
 
+	// frames built by another relay must not be mistaken for ours
+	for( i = 0; i < UPDATE_BACKUP; i++ )
+		client->snapShots[i].contentKey = 0;
+
 	relay->module_export->ClientConnect( relay->module, client->edict, client->userinfo );
 	relay->num_active_specs++;
 
@@ -32,6 +32,29 @@ qboolean TV_Relay_CanConnect( relay_t *relay, client_t *client, char *userinfo )
 void TV_Relay_ClientConnect( relay_t *relay, client_t *client );
 qboolean TV_Relay_ClientCommand_f( relay_t *relay, client_t *client );
 
-void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client );
+// clients which see the world from the same point of view are sent the same frame
+typedef struct
+{
+	qboolean mv;
+	qboolean edict;
+	entity_state_t s;
+	player_state_t ps;
+	int svflags;
+} relay_snappov_t;
+
+typedef struct
+{
+	relay_snappov_t pov;
+	client_t *client;			// the one the frame was built for
+} relay_snapgroup_t;
+
+typedef struct
+{
+	int numGroups;
+	int maxGroups;
+	relay_snapgroup_t *groups;	// [maxGroups]
+} relay_snapgroups_t;
+
+void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client, relay_snapgroups_t *snapgroups );
 
 #endif // __TV_RELAY_CLIENT_H
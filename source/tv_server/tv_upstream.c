@@ -30,7 +30,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <setjmp.h>
 
 // for jumping over upstream handling when it's disconnected
-jmp_buf upstream_abortframe;
+// upstreams are run from the task threads, so each one has its own
+static ATTRIBUTE_TLS jmp_buf upstream_abortframe;
 
 /*
 * TV_UpstreamForText
@@ -165,7 +166,7 @@ static void TV_Upstream_Netchan_Transmit( upstream_t *upstream, msg_t *msg )
 
 	// do not enable client compression until I fix the compression+fragmentation rare case bug
 	/*if( cl_compresspackets->integer ) {
-	zerror = Netchan_CompressMessage( msg );
+	zerror = Netchan_CompressMessage( &upstream->netchan, msg );
 	if( zerror < 0 ) {  // it's compression error, just send uncompressed
 	Com_DPrintf( "TV_Upstream_Netchan_Transmit (ignoring compression): Compression error %i\n", zerror );
 	}
@@ -192,7 +193,7 @@ static qboolean TV_Upstream_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	/*sequence_ack = */MSG_ReadLong( msg );
 	if( msg->compressed )
 	{
-		zerror = Netchan_DecompressMessage( msg );
+		zerror = Netchan_DecompressMessage( netchan, msg );
 		if( zerror < 0 )
 		{          // compression error. Drop the packet
 			Com_Printf( "Compression error %i. Dropping packet\n", zerror );
@@ -342,49 +343,103 @@ static void TV_Upstream_CheckForResend( upstream_t *upstream )
 	}
 }
 
+/*
+* TV_Upstream_GrowPacketQueue
+* 
+* Positions stay valid, since the old size divides the new one
+*/
+static void TV_Upstream_GrowPacketQueue( upstream_t *upstream, size_t needed )
+{
+	packetqueue_t *queue = &upstream->packetqueue;
+	size_t newsize, pos, len;
+	qbyte *data;
+
+	newsize = queue->size ? queue->size : PACKETQUEUE_MIN_SIZE;
+	while( newsize < needed )
+		newsize <<= 1;
+	if( newsize == queue->size )
+		return;
+
+	data = Mem_Alloc( upstream->mempool, newsize );
+	for( pos = queue->tail; pos != queue->head; pos += len )
+	{
+		len = min( queue->head - pos, queue->size - ( pos & ( queue->size - 1 ) ) );
+		len = min( len, newsize - ( pos & ( newsize - 1 ) ) );
+		memcpy( data + ( pos & ( newsize - 1 ) ), queue->data + ( pos & ( queue->size - 1 ) ), len );
+	}
+
+	if( queue->data )
+		Mem_Free( queue->data );
+	queue->data = data;
+	queue->size = newsize;
+}
+
 /*
 * TV_Upstream_SavePacket
 */
 void TV_Upstream_SavePacket( upstream_t *upstream, msg_t *msg, int timeBias )
 {
-	packet_t *packet;
+	packetqueue_t *queue = &upstream->packetqueue;
+	packetheader_t *header;
+	size_t recordsize, padding;
 
 	assert( upstream );
 	assert( msg && msg->cursize && msg->cursize < MAX_MSGLEN );
 
-	if( upstream->packetqueue_discarded )
+	recordsize = PACKET_RECORDSIZE( msg->cursize );
+
+	// packets are never split, skip the end of the ring if it doesn't fit there
+	while( 1 )
 	{
-		packet = upstream->packetqueue_discarded;
-		upstream->packetqueue_discarded = upstream->packetqueue_discarded->next;
-		if( packet->msg.maxsize && packet->msg.maxsize < msg->cursize )
+		padding = 0;
+		if( queue->size )
 		{
-			Mem_Free( packet->msg.data );
-			packet->msg.data = NULL;
-			packet->msg.maxsize = 0;
+			padding = queue->size - ( queue->head & ( queue->size - 1 ) );
+			if( padding >= recordsize )
+				padding = 0;
 		}
+
+		if( queue->head - queue->tail + padding + recordsize <= queue->size )
+			break;
+
+		TV_Upstream_GrowPacketQueue( upstream, max( queue->head - queue->tail + padding + recordsize, queue->size + 1 ) );
 	}
-	else
+
+	if( padding )
 	{
-		packet = Mem_Alloc( upstream->mempool, sizeof( packet_t ) );
+		header = ( packetheader_t * )( queue->data + ( queue->head & ( queue->size - 1 ) ) );
+		header->time = 0;
+		header->length = PACKET_PADDING | padding;
+		queue->head += padding;
 	}
 
-	packet->time = tvs.realtime + timeBias;
-	packet->next = NULL;
+	header = ( packetheader_t * )( queue->data + ( queue->head & ( queue->size - 1 ) ) );
+	header->time = tvs.realtime + timeBias;
+	header->length = msg->cursize;
+	memcpy( header + 1, msg->data, msg->cursize );
+	queue->head += recordsize;
+}
+
+/*
+* TV_Upstream_PeekPacket
+* 
+* Returns the packet at the given position, if there's any,
+* skipping over padding at the end of the ring
+*/
+packetheader_t *TV_Upstream_PeekPacket( upstream_t *upstream, size_t *pos )
+{
+	packetqueue_t *queue = &upstream->packetqueue;
+	packetheader_t *header;
 
-	if( !packet->msg.maxsize )
+	while( *pos != queue->head )
 	{
-		packet->msg.maxsize = msg->cursize;
-		packet->msg.data = Mem_Alloc( upstream->mempool, packet->msg.maxsize );
+		header = ( packetheader_t * )( queue->data + ( *pos & ( queue->size - 1 ) ) );
+		if( !( header->length & PACKET_PADDING ) )
+			return header;
+		*pos += header->length & ~PACKET_PADDING;
 	}
 
-	MSG_Clear( &packet->msg );
-	MSG_CopyData( &packet->msg, msg->data, msg->cursize );
-
-	if( !upstream->packetqueue )
-		upstream->packetqueue = packet;
-	if( upstream->packetqueue_head )
-		upstream->packetqueue_head->next = packet;
-	upstream->packetqueue_head = packet;
+	return NULL;
 }
 
 /*
@@ -392,39 +447,11 @@ void TV_Upstream_SavePacket( upstream_t *upstream, msg_t *msg, int timeBias )
 */
 static void TV_Upstream_FreePackets( upstream_t *upstream )
 {
-	packet_t *stop, *iter;
-
+	// everything the relay has read is gone
 	if( upstream->relay.state == CA_UNINITIALIZED )
-	{
-		stop = upstream->packetqueue_head;
-	}
+		upstream->packetqueue.tail = upstream->packetqueue.head;
 	else
-	{
-		if( upstream->relay.packetqueue_pos )
-			stop = upstream->relay.packetqueue_pos;
-		else
-			stop = upstream->packetqueue;
-	}
-
-	iter = upstream->packetqueue;
-	while( iter != stop )
-	{
-		upstream->packetqueue = iter->next;
-
-		if( upstream->state == CA_DISCONNECTED )
-		{
-			if( iter->msg.maxsize )
-				Mem_Free( iter->msg.data );
-			Mem_Free( iter );
-		}
-		else
-		{
-			iter->next = upstream->packetqueue_discarded;
-			upstream->packetqueue_discarded = iter;
-		}
-
-		iter = upstream->packetqueue;
-	}
+		upstream->packetqueue.tail = upstream->relay.packetqueue_pos;
 }
 
 /*
@@ -586,10 +613,15 @@ static void TV_Upstream_ReadPackets( upstream_t *upstream )
 */
 void TV_Upstream_SendConnectPacket( upstream_t *upstream )
 {
+	int flags = CONNECT_FLAG_TVCLIENT;
+
 	upstream->userinfo_modified = qfalse;
 
+	if( upstream->dictCompression )
+		flags |= CONNECT_FLAG_DICTCOMPRESSION;
+
 	Netchan_OutOfBandPrint( upstream->socket, &upstream->serveraddress, "connect %i %i %i \"%s\" %i\n",
-		APP_PROTOCOL_VERSION, Netchan_GamePort(), upstream->challenge, TV_Upstream_Userinfo( upstream ), 1 );
+		APP_PROTOCOL_VERSION, Netchan_GamePort(), upstream->challenge, TV_Upstream_Userinfo( upstream ), flags );
 }
 
 /*
@@ -612,6 +644,15 @@ void TV_Upstream_Error( upstream_t *upstream, const char *format, ... )
 	longjmp( upstream_abortframe, -1 );
 }
 
+/*
+* TV_Upstream_DropHandler
+* An ERR_DROP while running the upstream only disconnects this upstream
+*/
+static void TV_Upstream_DropHandler( void *context, const char *msg )
+{
+	TV_Upstream_Error( ( upstream_t * )context, "%s", msg );
+}
+
 /*
 * TV_Upstream_Disconnect
 */
@@ -659,7 +700,6 @@ void TV_Upstream_Shutdown( upstream_t *upstream, const char *format, ... )
 	va_list	argptr;
 	char msg[1024];
 	int i;
-	packet_t *remove;
 	mempool_t *mempool;
 
 	assert( upstream );
@@ -689,23 +729,8 @@ void TV_Upstream_Shutdown( upstream_t *upstream, const char *format, ... )
 
 	mempool = upstream->mempool;
 
-	while( upstream->packetqueue_discarded )
-	{
-		remove = upstream->packetqueue_discarded;
-		upstream->packetqueue_discarded = remove->next;
-		if( remove->msg.maxsize )
-			Mem_Free( remove->msg.data );
-		Mem_Free( remove );
-	}
-
-	while( upstream->packetqueue )
-	{
-		remove = upstream->packetqueue;
-		upstream->packetqueue = remove->next;
-		if( remove->msg.maxsize )
-			Mem_Free( remove->msg.data );
-		Mem_Free( remove );
-	}
+	if( upstream->packetqueue.data )
+		Mem_Free( upstream->packetqueue.data );
 
 	if( upstream->password )
 		Mem_Free( upstream->password );
@@ -799,7 +824,12 @@ void TV_Upstream_UpdateReliableCommandsToServer( upstream_t *upstream, msg_t *ms
 void TV_Upstream_Run( upstream_t *upstream, int msec )
 {
 	if( setjmp( upstream_abortframe ) )  // disconnect while running
+	{
+		Com_SetDropHandler( NULL, NULL );
 		return;
+	}
+
+	Com_SetDropHandler( TV_Upstream_DropHandler, upstream );
 
 	if( upstream->state > CA_DISCONNECTED )
 	{
@@ -832,11 +862,40 @@ void TV_Upstream_Run( upstream_t *upstream, int msec )
 	if( upstream->relay.state != CA_UNINITIALIZED )
 	{
 		TV_Relay_Run( &upstream->relay, msec );
+		Com_SetDropHandler( TV_Upstream_DropHandler, upstream );
 		TV_Upstream_FreePackets( upstream );
 	}
 
 	if( upstream->relay.state == CA_UNINITIALIZED )
 		TV_Upstream_Shutdown( upstream, "Relay was shutdown" );
+
+	Com_SetDropHandler( NULL, NULL );
+}
+
+/*
+* TV_Upstream_Timeout
+* Milliseconds until the upstream or its relay have something to do without
+* any new network input, or timeout if it's further away than that
+*/
+int TV_Upstream_Timeout( upstream_t *upstream, int timeout )
+{
+	unsigned int due;
+
+	if( upstream->state > CA_DISCONNECTED )
+	{
+		if( upstream->demo.playing )
+			due = upstream->lastPacketReceivedTime + 1000;
+		else if( upstream->state == CA_CONNECTING )
+			due = upstream->connect_time + 3000;
+		else if( upstream->netchan.unsentFragments )
+			due = tvs.realtime;
+		else
+			due = upstream->lastPacketSentTime + ( upstream->state < CA_ACTIVE ? 100 : 40 ) + 1;
+
+		timeout = min( timeout, due > tvs.realtime ? (int)( due - tvs.realtime ) : 0 );
+	}
+
+	return TV_Relay_Timeout( &upstream->relay, timeout );
 }
 
 /*
@@ -29,9 +29,7 @@ struct upstream_s
 {
 	connstate_t state;
 
-	packet_t *packetqueue;
-	packet_t *packetqueue_head;
-	packet_t *packetqueue_discarded;
+	packetqueue_t packetqueue;
 
 	int number;
 	char *name;
@@ -51,6 +49,7 @@ struct upstream_s
 	int connect_time;
 	int connect_count;
 	int challenge;
+	qboolean dictCompression;	// the server has the same compression dictionary
 	qboolean rejected;
 
 	int timeoutcount;
@@ -119,7 +118,9 @@ void TV_Upstream_Shutdown( upstream_t *upstream, const char *format, ... );
 void TV_Upstream_ClearState( upstream_t *upstream );
 void TV_Upstream_AddReliableCommand( upstream_t *upstream, const char *cmd );
 void TV_Upstream_Run( upstream_t *upstream, int msec );
+int TV_Upstream_Timeout( upstream_t *upstream, int timeout );
 void TV_Upstream_SavePacket( upstream_t *upstream, msg_t *msg, int timeBias );
+packetheader_t *TV_Upstream_PeekPacket( upstream_t *upstream, size_t *pos );
 void TV_Upstream_SendConnectPacket( upstream_t *upstream );
 void TV_Upstream_Connect( upstream_t *upstream, const char *servername, const char *password, socket_type_t type, netadr_t *address );
 void TV_Upstream_Reconnect_f( upstream_t *upstream );
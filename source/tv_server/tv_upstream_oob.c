@@ -42,6 +42,8 @@ static void TV_Upstream_Challenge_f( upstream_t *upstream, msg_t *msg )
 		return;
 
 	upstream->challenge = atoi( Cmd_Argv( 1 ) );
+	upstream->dictCompression = Netchan_DictChecksum() && Cmd_Argc() > 2
+		&& (unsigned int)strtoul( Cmd_Argv( 2 ), NULL, 10 ) == Netchan_DictChecksum();
 	upstream->connect_time = tvs.realtime;
 	TV_Upstream_SendConnectPacket( upstream );
 }
@@ -56,6 +58,12 @@ static void TV_Upstream_ClientConnectPacket( upstream_t *upstream, msg_t *msg )
 		return;
 
 	Netchan_Setup( &upstream->netchan, upstream->socket, &upstream->serveraddress, Netchan_GamePort() );
+	if( upstream->dictCompression )
+	{
+		MSG_ReadStringLine( msg ); // session
+		if( atoi( MSG_ReadStringLine( msg ) ) & CONNECT_FLAG_DICTCOMPRESSION )
+			upstream->netchan.dictCompression = qtrue;
+	}
 	upstream->state = CA_HANDSHAKE;
 	TV_Upstream_AddReliableCommand( upstream, "new" );
 
@@ -29,6 +29,7 @@ FIXME:  This will be remidied once a native Mac port is complete
 #include <stdlib.h>
 #include <limits.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -256,10 +257,25 @@ void Sys_Error( const char *format, ... )
 
 /*
 * Sys_Microseconds
+* Uses the monotonic clock when available, so that frame timing isn't
+* affected by wall clock adjustments
 */
 static unsigned long sys_secbase;
 quint64 Sys_Microseconds( void )
 {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	if( !sys_secbase )
+	{
+		sys_secbase = ts.tv_sec;
+		return ts.tv_nsec / 1000;
+	}
+
+	return (quint64)( ts.tv_sec - sys_secbase )*1000000 + ts.tv_nsec / 1000;
+#else
 	struct timeval tp;
 	struct timezone tzp;
 
@@ -273,6 +289,7 @@ quint64 Sys_Microseconds( void )
 
 	// TODO handle the wrap
 	return (quint64)( tp.tv_sec - sys_secbase )*1000000 + tp.tv_usec;
+#endif
 }
 
 /*
@@ -502,6 +519,11 @@ int main( int argc, char **argv )
 			time = newtime - oldtime;
 			if( time > 0 )
 				break;
+			// a running dedicated server blocks on its sockets until the next
+			// deadline, so when a packet wakes it up let it handle the packet
+			// right away instead of spinning until the next millisecond
+			if( dedicated->integer && Com_ServerState() )
+				break;
 #ifdef PUTCPU2SLEEP
 			Sys_Sleep( 0 );
 #endif
@@ -31,6 +31,12 @@ struct qmutex_s {
 	pthread_mutex_t m;
 };
 
+struct qsemaphore_s {
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	int count;
+};
+
 /*
 * Sys_Mutex_Create
 */
@@ -79,17 +85,59 @@ void Sys_Mutex_Unlock( qmutex_t *mutex )
 	pthread_mutex_unlock( &mutex->m );
 }
 
+typedef struct {
+	void *(*routine) (void*);
+	void *param;
+} qthreadstart_t;
+
+static void ( *sys_threadExitHook )( void );
+
+/*
+* Sys_Thread_SetExitHook
+*
+* The hook is called on every thread started by Sys_Thread_Create right
+* after its routine returns, to release per-thread state.
+*/
+void Sys_Thread_SetExitHook( void ( *hook )( void ) )
+{
+	sys_threadExitHook = hook;
+}
+
+/*
+* Sys_Thread_Start
+*/
+static void *Sys_Thread_Start( void *param )
+{
+	qthreadstart_t start = *( qthreadstart_t * )param;
+	void *ret;
+
+	free( param );
+
+	ret = start.routine( start.param );
+
+	if( sys_threadExitHook ) {
+		sys_threadExitHook();
+	}
+	return ret;
+}
+
 /*
 * Sys_Thread_Create
 */
 int Sys_Thread_Create( qthread_t **pthread, void *(*routine) (void*), void *param )
 {
 	qthread_t *thread;
+	qthreadstart_t *start;
 	pthread_t t;
 	int res;
 
-	res = pthread_create( &t, NULL, routine, param );
+	start = ( qthreadstart_t * )malloc( sizeof( *start ) );
+	start->routine = routine;
+	start->param = param;
+
+	res = pthread_create( &t, NULL, Sys_Thread_Start, start );
 	if( res != 0 ) {
+		free( start );
 		return res;
 	}
 
@@ -124,3 +172,80 @@ int Sys_Atomic_Add( volatile int *value, int add, qmutex_t *mutex )
 {
 	return __sync_fetch_and_add( value, add ) + add;
 }
+
+/*
+* Sys_Atomic_CAS
+*/
+qboolean Sys_Atomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex )
+{
+	return __sync_bool_compare_and_swap( value, oldval, newval ) ? qtrue : qfalse;
+}
+
+/*
+* Sys_Semaphore_Create
+*/
+int Sys_Semaphore_Create( qsemaphore_t **psem, int count )
+{
+	int res;
+	qsemaphore_t *sem;
+
+	sem = ( qsemaphore_t * )malloc( sizeof( *sem ) );
+
+	res = pthread_mutex_init( &sem->m, NULL );
+	if( res != 0 ) {
+		free( sem );
+		return res;
+	}
+
+	res = pthread_cond_init( &sem->c, NULL );
+	if( res != 0 ) {
+		pthread_mutex_destroy( &sem->m );
+		free( sem );
+		return res;
+	}
+
+	sem->count = count;
+	*psem = sem;
+	return 0;
+}
+
+/*
+* Sys_Semaphore_Destroy
+*/
+void Sys_Semaphore_Destroy( qsemaphore_t *sem )
+{
+	if( !sem ) {
+		return;
+	}
+	pthread_cond_destroy( &sem->c );
+	pthread_mutex_destroy( &sem->m );
+	free( sem );
+}
+
+/*
+* Sys_Semaphore_Wait
+*/
+void Sys_Semaphore_Wait( qsemaphore_t *sem )
+{
+	pthread_mutex_lock( &sem->m );
+	while( sem->count <= 0 ) {
+		pthread_cond_wait( &sem->c, &sem->m );
+	}
+	sem->count--;
+	pthread_mutex_unlock( &sem->m );
+}
+
+/*
+* Sys_Semaphore_Post
+*/
+void Sys_Semaphore_Post( qsemaphore_t *sem, int count )
+{
+	pthread_mutex_lock( &sem->m );
+	sem->count += count;
+	if( count > 1 ) {
+		pthread_cond_broadcast( &sem->c );
+	} else {
+		pthread_cond_signal( &sem->c );
+	}
+	pthread_mutex_unlock( &sem->m );
+}
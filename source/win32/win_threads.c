@@ -30,6 +30,10 @@ struct qmutex_s {
 	HANDLE h;
 };
 
+struct qsemaphore_s {
+	HANDLE h;
+};
+
 /*
 * Sys_Mutex_Create
 */
@@ -76,23 +80,66 @@ void Sys_Mutex_Unlock( qmutex_t *mutex )
 	ReleaseMutex( mutex->h );
 }
 
+typedef struct {
+	void *(*routine) (void*);
+	void *param;
+} qthreadstart_t;
+
+static void ( *sys_threadExitHook )( void );
+
+/*
+* Sys_Thread_SetExitHook
+*
+* The hook is called on every thread started by Sys_Thread_Create right
+* after its routine returns, to release per-thread state.
+*/
+void Sys_Thread_SetExitHook( void ( *hook )( void ) )
+{
+	sys_threadExitHook = hook;
+}
+
+/*
+* Sys_Thread_Start
+*/
+static DWORD WINAPI Sys_Thread_Start( LPVOID param )
+{
+	qthreadstart_t start = *( qthreadstart_t * )param;
+	void *ret;
+
+	free( param );
+
+	ret = start.routine( start.param );
+
+	if( sys_threadExitHook ) {
+		sys_threadExitHook();
+	}
+	return (DWORD)(size_t)ret;
+}
+
 /*
 * Sys_Thread_Create
 */
 int Sys_Thread_Create( qthread_t **pthread, void *(*routine) (void*), void *param )
 {
 	qthread_t *thread;
+	qthreadstart_t *start;
+	HANDLE h;
+
+	start = ( qthreadstart_t * )malloc( sizeof( *start ) );
+	start->routine = routine;
+	start->param = param;
 
-	HANDLE h = CreateThread(
+	h = CreateThread(
 		NULL,
 		0,
-		(LPTHREAD_START_ROUTINE) routine,
-		(LPVOID) param,
+		Sys_Thread_Start,
+		(LPVOID) start,
 		0,
         NULL
 	);
 
 	if( h == NULL ) {
+		free( start );
 		return 1;
 	}
 
@@ -126,5 +173,59 @@ void Sys_Thread_Yield( void )
 */
 int Sys_Atomic_Add( volatile int *value, int add, qmutex_t *mutex )
 {
-	return InterlockedExchangeAdd( (volatile LONG*)value, add );
+	return InterlockedExchangeAdd( (volatile LONG*)value, add ) + add;
+}
+
+/*
+* Sys_Atomic_CAS
+*/
+qboolean Sys_Atomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex )
+{
+	return InterlockedCompareExchange( (volatile LONG*)value, newval, oldval ) == oldval ? qtrue : qfalse;
+}
+
+/*
+* Sys_Semaphore_Create
+*/
+int Sys_Semaphore_Create( qsemaphore_t **psem, int count )
+{
+	qsemaphore_t *sem;
+
+	HANDLE h = CreateSemaphore( NULL, count, LONG_MAX, NULL );
+	if( h == NULL ) {
+		return 1;
+	}
+
+	sem = ( qsemaphore_t * )malloc( sizeof( *sem ) );
+	sem->h = h;
+	*psem = sem;
+	return 0;
+}
+
+/*
+* Sys_Semaphore_Destroy
+*/
+void Sys_Semaphore_Destroy( qsemaphore_t *sem )
+{
+	if( !sem ) {
+		return;
+	}
+	CloseHandle( sem->h );
+	free( sem );
+}
+
+/*
+* Sys_Semaphore_Wait
+*/
+void Sys_Semaphore_Wait( qsemaphore_t *sem )
+{
+	WaitForSingleObject( sem->h, INFINITE );
+}
+
+/*
+* Sys_Semaphore_Post
+*/
+void Sys_Semaphore_Post( qsemaphore_t *sem, int count )
+{
+	ReleaseSemaphore( sem->h, count, NULL );
 }